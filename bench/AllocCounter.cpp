@@ -0,0 +1,58 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+#include "AllocCounter.h"
+
+namespace {
+
+std::atomic<unsigned long long> Calls(0); ///< Число вызовов operator new.
+std::atomic<unsigned long long> Bytes(0); ///< Запрошено байт.
+
+void* Allocate(size_t size)
+{
+  Calls.fetch_add(1, std::memory_order_relaxed);
+  Bytes.fetch_add(size, std::memory_order_relaxed);
+  void* p = std::malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+} // anonymous namespace
+
+AllocCounter::Snapshot::Snapshot():
+  calls(Calls.load()),
+  bytes(Bytes.load()),
+  heapInUse(mallinfo2().uordblks)
+{
+}
+
+void* operator new(size_t size)
+{
+  return Allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+  return Allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+  std::free(p);
+}
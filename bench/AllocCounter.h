@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+
+///
+/// @brief Счетчик динамических выделений памяти.
+
+/// Подменяет глобальные operator new/delete программы (см. AllocCounter.cpp)
+/// и считает число и суммарный объем выделений через new. Выделения через
+/// malloc() и strdup()/wcsdup() не учитываются; для них Snapshot() дает
+/// занятый объем кучи по mallinfo2().
+///
+/// AllocCounter.cpp подключается только в исполняемый файл, которому нужен
+/// подсчет.
+///
+/// @author cycleg
+///
+class AllocCounter
+{
+  public:
+    ///
+    /// @brief Состояние счетчиков на момент вызова Snapshot().
+    ///
+    struct Snapshot
+    {
+      unsigned long long calls; ///< Число вызовов operator new.
+      unsigned long long bytes; ///< Запрошено байт через operator new.
+      size_t heapInUse; ///< Занято байт в куче malloc.
+
+      ///
+      /// Снять состояние счетчиков.
+      ///
+      Snapshot();
+    };
+};
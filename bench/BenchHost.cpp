@@ -0,0 +1,185 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+#include <windows.h>
+#include <WideMB.h> // far2l/utils
+#include <PlatformConstants.h> // far2l/utils
+#include "Configuration.h"
+#include "MountPointStorage.h"
+#include "BenchHost.h"
+
+// чтобы TEXT из WinCompat.h работал с макросом
+#define MACRO_TEXT(s) TEXT(s)
+
+std::atomic_ulong BenchHost::m_panelUpdates(0);
+std::atomic_ulong BenchHost::m_panelRedraws(0);
+
+BenchHost::BenchHost(const std::wstring& name)
+{
+  m_rootKey = L"Software/Far2/gvfspanel-bench-" + name + L"-" +
+              std::to_wstring(getpid());
+  m_registryRoot = m_rootKey;
+  m_registryRoot.append(WGOOD_SLASH);
+  m_registryRoot.append(MACRO_TEXT(PLUGIN_NAME));
+  std::memset(&m_psi, 0, sizeof(m_psi));
+  m_psi.StructSize = sizeof(m_psi);
+  m_psi.ModuleNumber = 0;
+  m_psi.RootKey = m_rootKey.c_str();
+  m_psi.GetMsg = &BenchHost::GetMsg;
+  m_psi.Control = &BenchHost::Control;
+  m_psi.Message = &BenchHost::Message;
+  m_psi.Menu = &BenchHost::Menu;
+  m_psi.SaveScreen = &BenchHost::SaveScreen;
+  m_psi.RestoreScreen = &BenchHost::RestoreScreen;
+}
+
+BenchHost::~BenchHost()
+{
+  RemoveKey(m_rootKey);
+}
+
+bool BenchHost::seedCatalog(const std::vector<std::string>& urls) const
+{
+  // SaveBatch() выбирает хранилище паролей по конфигурации; ее синглет
+  // создается здесь с той же папкой, что и в Plugin::setStartupInfo()
+  Configuration::Instance(m_registryRoot);
+  MountPointStorage storage(m_registryRoot);
+  std::vector<MountPoint> points;
+  points.reserve(urls.size());
+  for (const auto& url : urls)
+  {
+    MountPoint point = MountPointStorage::PointFactory();
+    point.setUrl(StrMB2Wide(url)).setUser(L"bench");
+    points.push_back(point);
+  }
+  std::vector<std::wstring> failed;
+  return storage.SaveBatch(points, failed);
+}
+
+bool BenchHost::seedCatalog(unsigned int count) const
+{
+  std::vector<std::string> urls;
+  urls.reserve(count);
+  for (unsigned int i = 0; i < count; i++) urls.push_back(Url(i));
+  return seedCatalog(urls);
+}
+
+std::string BenchHost::Url(unsigned int i)
+{
+  static const char* schemes[] = { "sftp", "smb", "ftp", "dav" };
+  return std::string(schemes[i % 4]) + "://host" + std::to_string(i) +
+         ".bench/";
+}
+
+unsigned long BenchHost::PeakRss()
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      return std::stoul(line.substr(6));
+  return 0;
+}
+
+const wchar_t* WINAPI BenchHost::GetMsg(INT_PTR pluginNumber, int msgId)
+{
+  (void)pluginNumber;
+  (void)msgId;
+  return L"";
+}
+
+int WINAPI BenchHost::Control(HANDLE plugin, int command, int param1,
+                              LONG_PTR param2)
+{
+  (void)plugin;
+  (void)param1;
+  (void)param2;
+  switch (command)
+  {
+    case FCTL_UPDATEPANEL:
+      m_panelUpdates++;
+      break;
+    case FCTL_REDRAWPANEL:
+      m_panelRedraws++;
+      break;
+  }
+  return 1;
+}
+
+int WINAPI BenchHost::Message(INT_PTR pluginNumber, DWORD flags,
+                              const wchar_t* helpTopic,
+                              const wchar_t* const* items, int itemsNumber,
+                              int buttonsNumber)
+{
+  (void)pluginNumber;
+  (void)flags;
+  (void)helpTopic;
+  (void)items;
+  (void)itemsNumber;
+  (void)buttonsNumber;
+  // оператор закрыл сообщение
+  return -1;
+}
+
+int WINAPI BenchHost::Menu(INT_PTR pluginNumber, int x, int y, int maxHeight,
+                           DWORD flags, const wchar_t* title,
+                           const wchar_t* bottom, const wchar_t* helpTopic,
+                           const int* breakKeys, int* breakCode,
+                           const struct FarMenuItem* item, int itemsNumber)
+{
+  (void)pluginNumber;
+  (void)x;
+  (void)y;
+  (void)maxHeight;
+  (void)flags;
+  (void)title;
+  (void)bottom;
+  (void)helpTopic;
+  (void)breakKeys;
+  (void)breakCode;
+  (void)item;
+  (void)itemsNumber;
+  // оператор отказался от выбора
+  return -1;
+}
+
+HANDLE WINAPI BenchHost::SaveScreen(int x1, int y1, int x2, int y2)
+{
+  (void)x1;
+  (void)y1;
+  (void)x2;
+  (void)y2;
+  return nullptr;
+}
+
+void WINAPI BenchHost::RestoreScreen(HANDLE screen)
+{
+  (void)screen;
+}
+
+void BenchHost::RemoveKey(const std::wstring& key)
+{
+  HKEY hKey = nullptr;
+  if (WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, key.c_str(), 0,
+                            KEY_ENUMERATE_SUB_KEYS | KEY_READ, &hKey) != ERROR_SUCCESS)
+    return;
+  std::vector<std::wstring> subKeys;
+  LONG res;
+  DWORD index = 0;
+  do
+  {
+    wchar_t subKey[MAX_PATH];
+    FILETIME tTime;
+    DWORD subKeySize = MAX_PATH * sizeof(wchar_t);
+    std::memset(subKey, 0, subKeySize);
+    res = WINPORT(RegEnumKeyEx)(hKey, index, subKey, &subKeySize, 0, nullptr,
+                                nullptr, &tTime);
+    if (res == ERROR_SUCCESS) subKeys.push_back(subKey);
+    index++;
+  } while (res == ERROR_SUCCESS);
+  WINPORT(RegCloseKey)(hKey);
+  for (const auto& subKey : subKeys)
+    RemoveKey(key + WGOOD_SLASH + subKey);
+  WINPORT(RegDeleteKey)(HKEY_CURRENT_USER, key.c_str());
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <farplug-wide.h>
+
+///
+/// @brief Окружение far2l для измерительных программ.
+
+/// Заменяет far2l при вызове экспортируемых функций дополнения вне
+/// редактора: предоставляет PluginStartupInfo с заглушками (сообщения и
+/// меню "отменяются" оператором, тексты из языковых файлов пустые) и
+/// одноразовую ветку реестра, которая удаляется в деструкторе. Обновления
+/// панели, которые дополнение запрашивает через Control(), подсчитываются.
+///
+/// В процессе допустим один экземпляр, т.к. Plugin -- синглетон.
+///
+/// @author cycleg
+///
+class BenchHost
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] name Имя измерения, входит в имя ветки реестра.
+    ///
+    explicit BenchHost(const std::wstring& name);
+    ///
+    /// Деструктор.
+    ///
+    /// Удаляет ветку реестра вместе с каталогом ресурсов.
+    ///
+    ~BenchHost();
+
+    ///
+    /// @return Описание "редактора" для SetStartupInfoW().
+    ///
+    inline const PluginStartupInfo* startupInfo() const { return &m_psi; }
+    ///
+    /// @return Корневая папка дополнения в реестре, как ее строит
+    ///         Plugin::setStartupInfo().
+    ///
+    inline const std::wstring& registryRoot() const { return m_registryRoot; }
+
+    ///
+    /// Заполнить каталог ресурсов.
+    ///
+    /// @param [in] urls URL ресурсов.
+    /// @return Результат операции.
+    ///
+    /// Ресурсы сохраняются без паролей.
+    ///
+    bool seedCatalog(const std::vector<std::string>& urls) const;
+    ///
+    /// Заполнить каталог ресурсами URL(i) для i от 0 до count - 1.
+    ///
+    bool seedCatalog(unsigned int count) const;
+
+    ///
+    /// URL i-го ресурса каталога.
+    ///
+    /// Схемы чередуются (sftp, smb, ftp, dav), у каждого ресурса свой узел.
+    ///
+    static std::string Url(unsigned int i);
+
+    ///
+    /// @return Число запросов FCTL_UPDATEPANEL.
+    ///
+    static inline unsigned long PanelUpdates() { return m_panelUpdates; }
+    ///
+    /// @return Число запросов FCTL_REDRAWPANEL.
+    ///
+    static inline unsigned long PanelRedraws() { return m_panelRedraws; }
+    ///
+    /// Сбросить счетчики обновлений панели.
+    ///
+    static inline void ResetPanelCounters()
+    { m_panelUpdates = 0; m_panelRedraws = 0; }
+
+    ///
+    /// @return Пиковый размер резидентной памяти процесса, КиБ (VmHWM).
+    ///
+    static unsigned long PeakRss();
+
+  private:
+    static const wchar_t* WINAPI GetMsg(INT_PTR pluginNumber, int msgId);
+    static int WINAPI Control(HANDLE plugin, int command, int param1,
+                              LONG_PTR param2);
+    static int WINAPI Message(INT_PTR pluginNumber, DWORD flags,
+                              const wchar_t* helpTopic,
+                              const wchar_t* const* items, int itemsNumber,
+                              int buttonsNumber);
+    static int WINAPI Menu(INT_PTR pluginNumber, int x, int y, int maxHeight,
+                           DWORD flags, const wchar_t* title,
+                           const wchar_t* bottom, const wchar_t* helpTopic,
+                           const int* breakKeys, int* breakCode,
+                           const struct FarMenuItem* item, int itemsNumber);
+    static HANDLE WINAPI SaveScreen(int x1, int y1, int x2, int y2);
+    static void WINAPI RestoreScreen(HANDLE screen);
+
+    ///
+    /// Рекурсивно удалить папку реестра.
+    ///
+    static void RemoveKey(const std::wstring& key);
+
+    static std::atomic_ulong m_panelUpdates; ///< Счетчик FCTL_UPDATEPANEL.
+    static std::atomic_ulong m_panelRedraws; ///< Счетчик FCTL_REDRAWPANEL.
+
+    std::wstring m_rootKey; ///< Одноразовая ветка реестра ("RootKey" far2l).
+    std::wstring m_registryRoot; ///< Корневая папка дополнения.
+    PluginStartupInfo m_psi; ///< Описание "редактора".
+};
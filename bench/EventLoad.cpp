@@ -0,0 +1,245 @@
+///
+/// @file EventLoad.cpp
+///
+/// Нагрузочный генератор событий монтирования для GvfsServiceMonitor.
+///
+/// Каталог из заданного числа ресурсов (см. BenchHost::seedCatalog())
+/// загружается дополнением, после чего FakeMountBackend с заданной частотой
+/// порождает события подсоединения и отключения ресурсов каталога. События
+/// проходят обычный путь: GvfsServiceMonitor -> JobUnitQueue ->
+/// Plugin::onPointMounted()/onPointUnmounted(). Вместо синтетической
+/// нагрузки можно воспроизвести трассу, записанную монитором (переменная
+/// окружения GVFSPANEL_EVENT_TRACE), с исходными интервалами между
+/// событиями.
+///
+/// Отчет: глубина очереди событий, задержка от постановки события в очередь
+/// до завершения обработки, время удержания и ожидания мутекса набора
+/// ресурсов, число обновлений панели.
+///
+/// Использование:
+///
+///     gvfspanel-eventload [-n ресурсов] [-r событий/с] [-d секунд]
+///                         [-m доля подсоединенных] [-l задержка GVFS, мс]
+///                         [-s начальное значение] [-t трасса]
+///
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "FakeMountBackend.h"
+#include "GvfsServiceMonitor.h"
+#include "Plugin.h"
+#include "BenchHost.h"
+
+extern "C"
+{
+void WINAPI SetStartupInfoW(const struct PluginStartupInfo* psi);
+void WINAPI ExitFARW();
+}
+
+namespace {
+
+///
+/// @brief Параметры прогона.
+///
+struct Options
+{
+  unsigned int points = 1000; ///< Размер каталога.
+  unsigned int rate = 2000; ///< Событий в секунду.
+  unsigned int duration = 10; ///< Длительность, с.
+  double mounted = 0.5; ///< Доля изначально подсоединенных ресурсов.
+  unsigned int latency = 0; ///< Задержка операций имитации, мс.
+  unsigned int seed = 1; ///< Начальное значение генератора.
+  std::string trace; ///< Файл трассы для воспроизведения.
+};
+
+///
+/// @brief Счетчики сценария.
+///
+struct Script
+{
+  unsigned long events = 0; ///< Событий в очереди имитации.
+  unsigned long skipped = 0; ///< Событий "changed", монитор их не ставит
+                             ///< в очередь.
+  unsigned int length = 0; ///< Время последнего события, мс.
+};
+
+void Usage(const char* name)
+{
+  std::cerr << "Usage: " << name << " [-n points] [-r events/s] [-d seconds]"
+            << " [-m mounted share] [-l latency ms] [-s seed] [-t trace]"
+            << std::endl;
+}
+
+///
+/// Синтетический сценарий: события через равные интервалы, каждое
+/// переключает состояние случайного ресурса каталога.
+///
+Script Synthesize(const Options& opt, FakeMountBackend& backend)
+{
+  Script script;
+  std::mt19937 random(opt.seed);
+  std::uniform_int_distribution<unsigned int> pick(0, opt.points - 1);
+  std::vector<bool> state(opt.points, false);
+  for (unsigned int i = 0; i < opt.points * opt.mounted; i++)
+  {
+    state[i] = true;
+    backend.setMounted(BenchHost::Url(i));
+  }
+  unsigned long total = static_cast<unsigned long>(opt.rate) * opt.duration;
+  for (unsigned long i = 0; i < total; i++)
+  {
+    unsigned int point = pick(random),
+                 at = static_cast<unsigned int>(i * 1000 / opt.rate);
+    state[point] = !state[point];
+    backend.scheduleEvent(at, state[point], BenchHost::Url(point));
+    script.length = at;
+  }
+  script.events = total;
+  return script;
+}
+
+///
+/// Сценарий из трассы монитора: "мс added|removed|changed URI".
+///
+/// URI трассы возвращаются в urls, чтобы попасть в каталог.
+///
+bool Replay(const std::string& fileName, FakeMountBackend& backend,
+            Script& script, std::vector<std::string>& urls)
+{
+  std::set<std::string> known;
+  std::ifstream file(fileName);
+  if (!file) return false;
+  std::string line;
+  while (std::getline(file, line))
+  {
+    std::istringstream stream(line);
+    unsigned int at;
+    std::string kind, uri;
+    if (!(stream >> at >> kind >> uri)) continue;
+    if (kind == "changed")
+    {
+      script.skipped++;
+      continue;
+    }
+    if (known.insert(uri).second) urls.push_back(uri);
+    backend.scheduleEvent(at, kind == "added", uri);
+    script.events++;
+    if (at > script.length) script.length = at;
+  }
+  return true;
+}
+
+void PrintHistogram(const char* title, const LatencyHistogram& histogram)
+{
+  std::printf("%-22s count %-10llu mean %9.1f us  p50 %8llu  p95 %8llu  "
+              "p99 %8llu  max %8llu us\n", title,
+              (unsigned long long)histogram.count(), histogram.mean(),
+              (unsigned long long)histogram.percentile(0.5),
+              (unsigned long long)histogram.percentile(0.95),
+              (unsigned long long)histogram.percentile(0.99),
+              (unsigned long long)histogram.max());
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  Options opt;
+  int c;
+  while ((c = getopt(argc, argv, "n:r:d:m:l:s:t:h")) != -1)
+    switch (c)
+    {
+      case 'n': opt.points = std::strtoul(optarg, nullptr, 10); break;
+      case 'r': opt.rate = std::strtoul(optarg, nullptr, 10); break;
+      case 'd': opt.duration = std::strtoul(optarg, nullptr, 10); break;
+      case 'm': opt.mounted = std::strtod(optarg, nullptr); break;
+      case 'l': opt.latency = std::strtoul(optarg, nullptr, 10); break;
+      case 's': opt.seed = std::strtoul(optarg, nullptr, 10); break;
+      case 't': opt.trace = optarg; break;
+      default:
+        Usage(argv[0]);
+        return 1;
+    }
+  if (!opt.points || !opt.rate)
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  std::shared_ptr<FakeMountBackend> backend = std::make_shared<FakeMountBackend>();
+  backend->setSeed(opt.seed).setLatency("*", opt.latency);
+  Script script;
+  std::vector<std::string> urls;
+  if (!opt.trace.empty())
+    {
+      if (!Replay(opt.trace, *backend, script, urls))
+      {
+        std::cerr << "Can't read trace " << opt.trace << std::endl;
+        return 1;
+      }
+    }
+    else script = Synthesize(opt, *backend);
+  // каталог: ресурсы трассы, дополненные синтетическими до заданного размера
+  for (unsigned int i = urls.size(); i < opt.points; i++)
+    urls.push_back(BenchHost::Url(i));
+  BenchHost host(L"eventload");
+  if (!host.seedCatalog(urls))
+  {
+    std::cerr << "Can't create catalog." << std::endl;
+    return 1;
+  }
+  MountBackend::Install(backend);
+
+  // события сценария начинают поступать с подпиской монитора
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  SetStartupInfoW(host.startupInfo());
+  GvfsServiceMonitor& monitor = GvfsServiceMonitor::instance();
+
+  // опрос глубины очереди до обработки всех событий, но не дольше минуты
+  // после окончания сценария
+  std::chrono::steady_clock::time_point deadline =
+    start + std::chrono::milliseconds(script.length) + std::chrono::minutes(1);
+  unsigned long samples = 0, depthSum = 0;
+  while ((monitor.eventLatency().count() < script.events) &&
+         (std::chrono::steady_clock::now() < deadline))
+  {
+    depthSum += monitor.queueDepth();
+    samples++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  double wall = std::chrono::duration<double>(
+                  std::chrono::steady_clock::now() - start
+                ).count();
+
+  // без задержек при отсоединении ресурсов на выходе
+  backend->setLatency("*", 0);
+  ExitFARW();
+  MountBackend::Install(std::shared_ptr<MountBackend>());
+
+  std::printf("catalog %zu points, %s\n", urls.size(),
+              opt.trace.empty() ? "synthetic load" : opt.trace.c_str());
+  std::printf("events: scripted %lu, skipped (changed) %lu, processed %llu "
+              "in %.2f s (%.0f events/s)\n", script.events, script.skipped,
+              (unsigned long long)monitor.eventLatency().count(), wall,
+              monitor.eventLatency().count() / wall);
+  std::printf("queue depth: max %lu, mean %.1f\n", monitor.maxQueueDepth(),
+              samples ? static_cast<double>(depthSum) / samples : 0.0);
+  PrintHistogram("event latency:", monitor.eventLatency());
+  PrintHistogram("m_pointsMutex hold:", Plugin::getInstance().pointsMutex().holdTimes());
+  PrintHistogram("m_pointsMutex wait:", Plugin::getInstance().pointsMutex().waitTimes());
+  std::printf("panel: %lu updates, %lu redraws\n", BenchHost::PanelUpdates(),
+              BenchHost::PanelRedraws());
+  std::printf("backend operations: %lu\n", backend->operations());
+  return (monitor.eventLatency().count() < script.events) ? 2 : 0;
+}
@@ -0,0 +1,161 @@
+///
+/// @file Reachability.cpp
+///
+/// Время проверки доступности сервера перед монтированием.
+///
+/// GvfsService::reachable() проверяется на локальных серверах: на порту,
+/// который принимает соединения (сокет слушает, но соединения не
+/// принимает -- их принимает ядро), и на порту, который заведомо закрыт
+/// (сокет был связан с портом и закрыт). Дополнительно можно задать адрес,
+/// на который пакеты уходят без ответа, например, несуществующий узел
+/// локальной сети: так видно, что недоступный сервер отклоняется за
+/// заданное время, а не за системное время соединения.
+///
+/// Отчет: для каждого адреса -- итог проверки и минимальное, среднее и
+/// максимальное время проверки.
+///
+/// Использование:
+///
+///     gvfspanel-reachability [-n повторов] [-t время соединения, мс]
+///                            [-a узел:порт]
+///
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "GvfsService.h"
+
+namespace {
+
+///
+/// @brief Параметры прогона.
+///
+struct Options
+{
+  unsigned int repeats = 20; ///< Повторов проверки каждого адреса.
+  unsigned int timeout = 2000; ///< Время соединения, мс.
+  std::string blackhole; ///< Адрес без ответа, "узел:порт".
+};
+
+void Usage(const char* name)
+{
+  std::cerr << "Usage: " << name << " [-n repeats] [-t timeout ms]"
+            << " [-a host:port]" << std::endl;
+}
+
+///
+/// Связать сокет TCP с произвольным свободным портом на 127.0.0.1.
+///
+/// @param [out] port Назначенный порт.
+/// @return Дескриптор сокета; -1 в случае ошибки.
+///
+int BindLoopback(unsigned short& port)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t len = sizeof(addr);
+  if ((bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) ||
+      (getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0))
+  {
+    close(fd);
+    return -1;
+  }
+  port = ntohs(addr.sin_port);
+  return fd;
+}
+
+///
+/// Проверить адрес заданное число раз и напечатать отчет.
+///
+void Run(const std::string& title, const std::string& address,
+         const Options& opt)
+{
+  Glib::RefPtr<Gio::File> file =
+    Gio::File::create_for_uri("sftp://" + address + "/");
+  std::map<std::string, unsigned int> outcomes;
+  double total = 0, least = 0, most = 0;
+  for (unsigned int i = 0; i < opt.repeats; i++)
+  {
+    std::string outcome;
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+      outcome = GvfsService().reachable(file, opt.timeout) ? "connected" :
+                                                             "skipped";
+    }
+    catch (const GvfsServiceException& ex)
+    {
+      outcome = ex.what().c_str();
+    }
+    double elapsed = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start
+    ).count();
+    total += elapsed;
+    if ((i == 0) || (elapsed < least)) least = elapsed;
+    if (elapsed > most) most = elapsed;
+    outcomes[outcome]++;
+  }
+  std::printf("%s (%s)\n", title.c_str(), address.c_str());
+  for (const auto& outcome : outcomes)
+    std::printf("  %5u  %s\n", outcome.second, outcome.first.c_str());
+  std::printf("  min %.2f ms, avg %.2f ms, max %.2f ms\n", least,
+              total / opt.repeats, most);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  Options opt;
+  int c;
+  while ((c = getopt(argc, argv, "n:t:a:h")) != -1)
+    switch (c)
+    {
+      case 'n': opt.repeats = std::strtoul(optarg, nullptr, 10); break;
+      case 't': opt.timeout = std::strtoul(optarg, nullptr, 10); break;
+      case 'a': opt.blackhole = optarg; break;
+      default:
+        Usage(argv[0]);
+        return 1;
+    }
+  if (opt.repeats == 0)
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  Gio::init();
+  unsigned short listening, closed;
+  int listener = BindLoopback(listening);
+  if ((listener < 0) || (listen(listener, SOMAXCONN) != 0))
+  {
+    std::perror("listener");
+    return 1;
+  }
+  int spare = BindLoopback(closed);
+  if (spare < 0)
+  {
+    std::perror("closed port");
+    return 1;
+  }
+  // порт свободен, пока его не займет кто-то другой
+  close(spare);
+
+  Run("listening", "127.0.0.1:" + std::to_string(listening), opt);
+  Run("closed", "127.0.0.1:" + std::to_string(closed), opt);
+  if (!opt.blackhole.empty()) Run("blackhole", opt.blackhole, opt);
+  close(listener);
+  return 0;
+}
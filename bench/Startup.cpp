@@ -0,0 +1,211 @@
+///
+/// @file Startup.cpp
+///
+/// Измерение запуска дополнения и обновления его панели.
+///
+/// Для каждого размера каталога (по умолчанию 10, 1000 и 100000 ресурсов)
+/// в отдельном процессе выполняются фазы, как их проходит far2l:
+/// * seed -- заполнение одноразового каталога (для справки);
+/// * SetStartupInfoW -- загрузка конфигурации и каталога, запуск монитора;
+/// * GetOpenPluginInfoW -- описание панели;
+/// * first GetFindDataW -- первое открытие панели с проверкой статуса всех
+///   ресурсов;
+/// * idle GetFindDataW -- повторные обновления панели без изменений
+///   (среднее по числу повторов);
+/// * ExitFARW -- завершение с отсоединением ресурсов.
+///
+/// Механизм монтирования -- FakeMountBackend без задержек, заданная доля
+/// ресурсов подсоединена. Для каждой фазы выдаются время, число и объем
+/// выделений через operator new, прирост занятой кучи malloc и пиковый
+/// размер резидентной памяти процесса после фазы.
+///
+/// Использование:
+///
+///     gvfspanel-startup [-n размер[,размер...]] [-m доля подсоединенных]
+///                       [-i повторов idle]
+///
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "FakeMountBackend.h"
+#include "AllocCounter.h"
+#include "BenchHost.h"
+
+extern "C"
+{
+void WINAPI SetStartupInfoW(const struct PluginStartupInfo* psi);
+void WINAPI ExitFARW();
+HANDLE WINAPI OpenPluginW(int openFrom, INT_PTR item);
+void WINAPI ClosePluginW(HANDLE plugin);
+void WINAPI GetOpenPluginInfoW(HANDLE plugin, struct OpenPluginInfo* pluginInfo);
+int WINAPI GetFindDataW(HANDLE plugin, struct PluginPanelItem** panelItem,
+                        int* itemsNumber, int opMode);
+void WINAPI FreeFindDataW(HANDLE plugin, struct PluginPanelItem* panelItem,
+                          int itemsNumber);
+}
+
+namespace {
+
+///
+/// @brief Замер одной фазы.
+///
+class Phase
+{
+  public:
+    ///
+    /// Начать замер.
+    ///
+    /// @param [in] name Название фазы.
+    /// @param [in] repeats Число повторов: результат делится на него.
+    ///
+    Phase(const char* name, unsigned int repeats = 1):
+      m_name(name), m_repeats(repeats),
+      m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ///
+    /// Завершить замер и вывести строку отчета.
+    ///
+    ~Phase()
+    {
+      double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - m_start
+                  ).count() / m_repeats;
+      AllocCounter::Snapshot end;
+      std::printf("  %-20s %12.3f ms %12llu allocs %14llu bytes %+12lld KiB heap"
+                  " %10lu KiB peak RSS\n", m_name, ms,
+                  (end.calls - m_allocs.calls) / m_repeats,
+                  (end.bytes - m_allocs.bytes) / m_repeats,
+                  (static_cast<long long>(end.heapInUse) -
+                   static_cast<long long>(m_allocs.heapInUse)) / 1024,
+                  BenchHost::PeakRss());
+    }
+
+  private:
+    const char* m_name; ///< Название фазы.
+    unsigned int m_repeats; ///< Число повторов.
+    AllocCounter::Snapshot m_allocs; ///< Счетчики выделений в начале.
+    std::chrono::steady_clock::time_point m_start; ///< Начало фазы.
+};
+
+///
+/// Выполнить все фазы для каталога заданного размера.
+///
+int Run(unsigned int points, double mounted, unsigned int idleRepeats)
+{
+  std::printf("catalog %u points\n", points);
+  std::shared_ptr<FakeMountBackend> backend = std::make_shared<FakeMountBackend>();
+  for (unsigned int i = 0; i < points * mounted; i++)
+    backend->setMounted(BenchHost::Url(i));
+  MountBackend::Install(backend);
+  BenchHost host(L"startup");
+  {
+    Phase phase("seed");
+    if (!host.seedCatalog(points))
+    {
+      std::cerr << "Can't create catalog." << std::endl;
+      return 1;
+    }
+  }
+  {
+    Phase phase("SetStartupInfoW");
+    SetStartupInfoW(host.startupInfo());
+  }
+  HANDLE panel = OpenPluginW(OPEN_DISKMENU, 0);
+  {
+    Phase phase("GetOpenPluginInfoW");
+    OpenPluginInfo info;
+    GetOpenPluginInfoW(panel, &info);
+  }
+  PluginPanelItem* items = nullptr;
+  int itemsNumber = 0;
+  {
+    Phase phase("first GetFindDataW");
+    GetFindDataW(panel, &items, &itemsNumber, 0);
+    FreeFindDataW(panel, items, itemsNumber);
+  }
+  if (static_cast<unsigned int>(itemsNumber) != points)
+    std::cerr << "Panel shows " << itemsNumber << " items of " << points
+              << std::endl;
+  if (idleRepeats)
+  {
+    Phase phase("idle GetFindDataW", idleRepeats);
+    for (unsigned int i = 0; i < idleRepeats; i++)
+    {
+      GetFindDataW(panel, &items, &itemsNumber, 0);
+      FreeFindDataW(panel, items, itemsNumber);
+    }
+  }
+  ClosePluginW(panel);
+  {
+    Phase phase("ExitFARW");
+    ExitFARW();
+  }
+  std::printf("  backend operations: %lu, panel updates: %lu\n",
+              backend->operations(), BenchHost::PanelUpdates());
+  MountBackend::Install(std::shared_ptr<MountBackend>());
+  return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  std::vector<unsigned int> sizes;
+  double mounted = 0.1;
+  unsigned int idleRepeats = 10;
+  int c;
+  while ((c = getopt(argc, argv, "n:m:i:h")) != -1)
+    switch (c)
+    {
+      case 'n':
+      {
+        std::istringstream list(optarg);
+        std::string item;
+        while (std::getline(list, item, ','))
+          sizes.push_back(std::strtoul(item.c_str(), nullptr, 10));
+        break;
+      }
+      case 'm': mounted = std::strtod(optarg, nullptr); break;
+      case 'i': idleRepeats = std::strtoul(optarg, nullptr, 10); break;
+      default:
+        std::cerr << "Usage: " << argv[0]
+                  << " [-n size[,size...]] [-m mounted share] [-i idle repeats]"
+                  << std::endl;
+        return 1;
+    }
+  if (sizes.empty()) sizes = { 10, 1000, 100000 };
+
+  // Plugin -- синглетон, поэтому каждый размер измеряется в отдельном
+  // процессе; заодно пиковый RSS относится только к этому размеру
+  int result = 0;
+  for (unsigned int size : sizes)
+  {
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+      std::perror("fork");
+      return 1;
+    }
+    if (pid == 0)
+    {
+      int rc = Run(size, mounted, idleRepeats);
+      std::fflush(stdout);
+      std::exit(rc);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status)) result = 2;
+  }
+  return result;
+}
@@ -0,0 +1,524 @@
+///
+/// @file StorageBench.cpp
+///
+/// Микроизмерения хранилища описаний ресурсов и шифрования паролей.
+///
+/// Замеры:
+/// * Crypto -- генерация ключа (init()), шифрование и дешифрование пароля,
+///   полный путь MountPointStorage::Encrypt();
+/// * RegistryStorage::GetValue() для полей типа "String", "Binary" и
+///   "Dword";
+/// * каталог текущей версии -- Save(), LoadAll(), LoadOne(), Delete();
+/// * каталоги версий 1..7, записанные в формате соответствующей версии, --
+///   Load() записи без конвертации, Decrypt() пароля и LoadAll() с
+///   конвертацией хранилища в текущую версию.
+///
+/// Замеры каталогов выполняются для обоих хранилищ паролей: реестра
+/// (кодирование либо шифрование OpenSSL) и безопасного хранилища, если
+/// дополнение собрано с его поддержкой и служба Secret Service доступна.
+/// Для безопасного хранилища форматы версий 1..3 не отличаются от реестра и
+/// не измеряются.
+///
+/// Все данные пишутся в одноразовую ветку реестра (см. BenchHost), пароли
+/// из безопасного хранилища удаляются по окончании замера. Результат --
+/// время на одну запись (один вызов): среднее, 50-й и 99-й процентили (с
+/// точностью до интервала гистограммы) и максимум, в микросекундах.
+///
+/// Использование:
+///
+///     gvfspanel-storagebench [-n записей] [-r повторов GetValue]
+///                            [-b registry|secret[,...]]
+///
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <windows.h>
+#include <WideMB.h> // far2l/utils
+#include <PlatformConstants.h> // far2l/utils
+#include "Configuration.h"
+#include "LatencyHistogram.h"
+#include "MountPointStorage.h"
+#ifdef USE_OPENSSL
+#include "Crypto.h"
+#endif
+#ifdef USE_SECRET_STORAGE
+#include "SecretServiceStorage.h"
+#endif
+#include "BenchHost.h"
+
+///
+/// @brief Набор микроизмерений.
+
+/// Друг MountPointStorage: обращается к закрытым Load(), Encrypt(),
+/// Decrypt() и защищенным GetValue()/SetValue() без изменения их поведения.
+///
+/// @author cycleg
+///
+class StorageBench
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] registryRoot Корневая папка дополнения в реестре.
+    /// @param [in] records Число записей в каталоге.
+    /// @param [in] reads Число повторов GetValue().
+    ///
+    StorageBench(const std::wstring& registryRoot, unsigned int records,
+                 unsigned int reads):
+      m_registryRoot(registryRoot), m_records(records), m_reads(reads)
+    {
+    }
+
+    ///
+    /// @return Текущая версия формата хранилища.
+    ///
+    static inline DWORD CurrentVersion()
+    { return MountPointStorage::StorageVersion; }
+
+    ///
+    /// Замеры Crypto.
+    ///
+    void runCrypto() const;
+    ///
+    /// Замеры RegistryStorage::GetValue().
+    ///
+    void runRegistry() const;
+    ///
+    /// Замеры каталога текущей версии.
+    ///
+    /// @param [in] backend Название хранилища паролей, для отчета.
+    ///
+    void runCatalog(const char* backend) const;
+    ///
+    /// Замеры каталога заданной версии.
+    ///
+    /// @param [in] version Версия формата хранилища.
+    /// @param [in] backend Название хранилища паролей, для отчета.
+    ///
+    void runVersion(DWORD version, const char* backend) const;
+
+  private:
+    ///
+    /// Выполнить действие и учесть его длительность.
+    ///
+    template <class Action> static void Measure(LatencyHistogram& histogram,
+                                                Action action)
+    {
+      std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+      action();
+      histogram.record(std::chrono::steady_clock::now() - start);
+    }
+
+    ///
+    /// Вывести строку отчета по гистограмме.
+    ///
+    static void Report(const std::string& name,
+                       const LatencyHistogram& histogram);
+    ///
+    /// Вывести строку отчета по общему времени пакетной операции.
+    ///
+    /// @param [in] name Название замера.
+    /// @param [in] total Длительность операции.
+    /// @param [in] records Число обработанных записей.
+    ///
+    static void Report(const std::string& name,
+                       std::chrono::steady_clock::duration total,
+                       unsigned int records);
+
+    ///
+    /// @return Описание i-й записи каталога, с паролем.
+    ///
+    static MountPoint Point(unsigned int i);
+    ///
+    /// Пароль в том виде, в каком его пишет в реестр хранилище заданной
+    /// версии.
+    ///
+    /// @param [in] version Версия формата хранилища.
+    /// @param [in] point Запись.
+    /// @param [out] out Значение поля "Password".
+    ///
+    static void PasswordValue(DWORD version, const MountPoint& point,
+                              std::vector<BYTE>& out);
+
+    ///
+    /// @return Папка в реестре для каталога с заданным именем.
+    ///
+    std::wstring folder(const std::string& name) const;
+    ///
+    /// Записать каталог в формате заданной версии в обход
+    /// MountPointStorage::Save().
+    ///
+    /// @param [in] storage Хранилище, куда пишутся записи.
+    /// @param [in] version Версия формата хранилища.
+    /// @param [out] points Записанные записи.
+    /// @param [out] passwords Значения поля "Password" записей.
+    /// @return Результат операции.
+    ///
+    bool writeCatalog(const MountPointStorage& storage, DWORD version,
+                      std::vector<MountPoint>& points,
+                      std::vector<std::vector<BYTE> >& passwords) const;
+
+    std::wstring m_registryRoot; ///< Корневая папка дополнения в реестре.
+    unsigned int m_records; ///< Число записей в каталоге.
+    unsigned int m_reads; ///< Число повторов GetValue().
+};
+
+void StorageBench::runCrypto() const
+{
+#ifdef USE_OPENSSL
+  LatencyHistogram init, encrypt, decrypt, storageEncrypt;
+  std::vector<MountPoint> points;
+  points.reserve(m_records);
+  for (unsigned int i = 0; i < m_records; i++) points.push_back(Point(i));
+  for (const auto& point : points)
+  {
+    const std::string password = StrWide2MB(point.getPassword());
+    std::vector<BYTE> plain(password.begin(), password.end()), cipher, out;
+    Crypto crypto;
+    Measure(init, [&crypto, &point] () { crypto.init(point.getStorageId()); });
+    Measure(encrypt, [&crypto, &plain, &cipher] ()
+                     { crypto.encrypt(plain, cipher); });
+    Measure(decrypt, [&crypto, &cipher, &out] () { crypto.decrypt(cipher, out); });
+    if (out != plain) std::cerr << "Crypto round trip failed." << std::endl;
+    Measure(storageEncrypt, [&point, &cipher] ()
+                            {
+                              MountPointStorage::Encrypt(point.getStorageId(),
+                                                         point.getPassword(),
+                                                         cipher);
+                            });
+  }
+  Report("Crypto::init", init);
+  Report("Crypto::encrypt", encrypt);
+  Report("Crypto::decrypt", decrypt);
+  Report("MountPointStorage::Encrypt", storageEncrypt);
+#else
+  std::printf("  Crypto: built without OpenSSL\n");
+#endif
+}
+
+void StorageBench::runRegistry() const
+{
+  MountPointStorage storage(folder("registry"));
+  MountPoint point = Point(0);
+  std::vector<BYTE> password;
+  PasswordValue(MountPointStorage::StorageVersion, point, password);
+  HKEY hKey = nullptr;
+  std::wstring key = storage.m_registryFolder;
+  key.append(WGOOD_SLASH);
+  key.append(point.getStorageId());
+  DWORD disposition;
+  if (WINPORT(RegCreateKeyEx)(HKEY_CURRENT_USER, key.c_str(), 0, nullptr, 0,
+                              KEY_WRITE | KEY_READ, nullptr, &hKey,
+                              &disposition) != ERROR_SUCCESS)
+  {
+    std::cerr << "Can't create registry key." << std::endl;
+    return;
+  }
+  storage.SetValue(hKey, L"URL", point.getUrl());
+  storage.SetValue(hKey, L"Password", password);
+  storage.SetValue(hKey, L"AskPassword", DWORD(0));
+  LatencyHistogram stringValue, binaryValue, dwordValue;
+  std::wstring l_string;
+  std::vector<BYTE> l_binary;
+  DWORD l_dword;
+  for (unsigned int i = 0; i < m_reads; i++)
+  {
+    Measure(stringValue, [&] () { storage.GetValue(hKey, L"URL", l_string); });
+    Measure(binaryValue, [&] ()
+                         { storage.GetValue(hKey, L"Password", l_binary); });
+    Measure(dwordValue, [&] ()
+                        { storage.GetValue(hKey, L"AskPassword", l_dword); });
+  }
+  WINPORT(RegCloseKey)(hKey);
+  Report("GetValue String", stringValue);
+  Report("GetValue Binary", binaryValue);
+  Report("GetValue Dword", dwordValue);
+}
+
+void StorageBench::runCatalog(const char* backend) const
+{
+  MountPointStorage storage(folder(std::string("current-") + backend));
+  std::vector<MountPoint> points;
+  points.reserve(m_records);
+  for (unsigned int i = 0; i < m_records; i++) points.push_back(Point(i));
+  LatencyHistogram save, loadOne, remove;
+  for (const auto& point : points)
+    Measure(save, [&storage, &point] () { storage.Save(point); });
+  std::map<std::wstring, MountPoint> loaded;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  storage.LoadAll(loaded);
+  std::chrono::steady_clock::duration loadAll =
+    std::chrono::steady_clock::now() - start;
+  if (loaded.size() != points.size())
+    std::cerr << "Loaded " << loaded.size() << " records of " << points.size()
+              << std::endl;
+  for (const auto& point : points)
+  {
+    MountPoint buffer;
+    Measure(loadOne, [&storage, &point, &buffer] ()
+                     { storage.LoadOne(point.getStorageId(), buffer); });
+  }
+  for (const auto& point : points)
+    Measure(remove, [&storage, &point] () { storage.Delete(point); });
+  const std::string suffix = std::string(" [") + backend + "]";
+  Report("Save" + suffix, save);
+  Report("LoadAll" + suffix, loadAll, points.size());
+  Report("LoadOne" + suffix, loadOne);
+  Report("Delete" + suffix, remove);
+}
+
+void StorageBench::runVersion(DWORD version, const char* backend) const
+{
+  const std::string name = "v" + std::to_string(version) + "-" + backend;
+  std::vector<MountPoint> points;
+  std::vector<std::vector<BYTE> > passwords;
+  {
+    MountPointStorage storage(folder(name));
+    if (!writeCatalog(storage, version, points, passwords))
+    {
+      std::cerr << "Can't write " << name << " catalog." << std::endl;
+      return;
+    }
+  }
+  // хранилище открывается заново, чтобы прочитать записанную версию
+  MountPointStorage storage(folder(name));
+  if (storage.m_version != version)
+  {
+    std::cerr << "Catalog " << name << " has version " << storage.m_version
+              << std::endl;
+    return;
+  }
+  LatencyHistogram load, decrypt;
+  for (const auto& point : points)
+  {
+    MountPoint buffer(point);
+    Measure(load, [&storage, &buffer] () { storage.Load(buffer); });
+  }
+  bool registryPasswords = true;
+#ifdef USE_SECRET_STORAGE
+  registryPasswords = (version < 4) ||
+                      !Configuration::Instance()->useSecretStorage();
+#endif
+  if (registryPasswords)
+    for (unsigned int i = 0; i < points.size(); i++)
+    {
+      std::wstring out;
+#ifdef USE_OPENSSL
+      if (version >= 3)
+        {
+          Measure(decrypt, [&] ()
+                           {
+                             storage.Decrypt(points[i].getStorageId(),
+                                             passwords[i], out);
+                           });
+        }
+        else
+#endif
+        {
+          Measure(decrypt, [&] () { storage.Decrypt(passwords[i], out); });
+        }
+    }
+  std::map<std::wstring, MountPoint> loaded;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  storage.LoadAll(loaded);
+  std::chrono::steady_clock::duration loadAll =
+    std::chrono::steady_clock::now() - start;
+  // после конвертации записи в текущем формате; Delete() заодно убирает
+  // пароли из безопасного хранилища
+  for (const auto& point : points) storage.Delete(point);
+  const std::string suffix = " [" + name + "]";
+  Report("Load" + suffix, load);
+  if (decrypt.count()) Report("Decrypt" + suffix, decrypt);
+  Report(((version < MountPointStorage::StorageVersion) ?
+            "LoadAll+convert" : "LoadAll") + suffix,
+         loadAll, points.size());
+}
+
+void StorageBench::Report(const std::string& name,
+                          const LatencyHistogram& histogram)
+{
+  std::printf("  %-32s %8lu calls %10.2f mean %8lu p50 %8lu p99 %8lu max us\n",
+              name.c_str(), static_cast<unsigned long>(histogram.count()),
+              histogram.mean(),
+              static_cast<unsigned long>(histogram.percentile(0.5)),
+              static_cast<unsigned long>(histogram.percentile(0.99)),
+              static_cast<unsigned long>(histogram.max()));
+}
+
+void StorageBench::Report(const std::string& name,
+                          std::chrono::steady_clock::duration total,
+                          unsigned int records)
+{
+  double us = std::chrono::duration<double, std::micro>(total).count();
+  std::printf("  %-32s %8u records %10.2f per record, %.3f ms total\n",
+              name.c_str(), records, records ? us / records : 0.0, us / 1000);
+}
+
+MountPoint StorageBench::Point(unsigned int i)
+{
+  MountPoint point = MountPointStorage::PointFactory();
+  point.setUrl(StrMB2Wide(BenchHost::Url(i)))
+       .setUser(L"bench")
+       .setPassword(L"password" + std::to_wstring(i));
+  return point;
+}
+
+void StorageBench::PasswordValue(DWORD version, const MountPoint& point,
+                                 std::vector<BYTE>& out)
+{
+#ifdef USE_OPENSSL
+  if (version >= 3)
+  {
+    MountPointStorage::Encrypt(point.getStorageId(), point.getPassword(), out);
+    return;
+  }
+#else
+  (void)version;
+#endif
+  MountPointStorage::Encrypt(point.getPassword(), out);
+}
+
+std::wstring StorageBench::folder(const std::string& name) const
+{
+  std::wstring path = m_registryRoot;
+  path.append(WGOOD_SLASH);
+  path.append(StrMB2Wide(name));
+  return path;
+}
+
+bool StorageBench::writeCatalog(const MountPointStorage& storage,
+                                DWORD version,
+                                std::vector<MountPoint>& points,
+                                std::vector<std::vector<BYTE> >& passwords) const
+{
+  points.clear();
+  passwords.clear();
+  HKEY hStorage = nullptr;
+  if (WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, storage.m_registryFolder.c_str(),
+                            0, KEY_WRITE, &hStorage) != ERROR_SUCCESS)
+    return false;
+  bool ret = true;
+  for (unsigned int i = 0; ret && (i < m_records); i++)
+  {
+    MountPoint point = Point(i);
+    std::vector<BYTE> password;
+#ifdef USE_SECRET_STORAGE
+    if ((version >= 4) && Configuration::Instance()->useSecretStorage())
+      {
+        // в реестре вместо пароля пустое значение, см. Save()
+        SecretServiceStorage secrets;
+        ret = secrets.SavePassword(point.getStorageId(), point.getPassword());
+      }
+      else
+#endif
+      {
+        PasswordValue(version, point, password);
+      }
+    HKEY hKey = nullptr;
+    DWORD disposition;
+    ret = ret &&
+          (WINPORT(RegCreateKeyEx)(hStorage, point.getStorageId().c_str(), 0,
+                                   nullptr, 0, KEY_WRITE, nullptr, &hKey,
+                                   &disposition) == ERROR_SUCCESS);
+    if (!ret) break;
+    // поле URL называлось "Path" до версии 5, AskPassword появилось в
+    // версии 2, KeepMounted -- в версии 6, AutoMount -- в версии 7
+    ret = storage.SetValue(hKey, (version < 5) ? L"Path" : L"URL",
+                           point.getUrl()) &&
+          storage.SetValue(hKey, L"User", point.getUser()) &&
+          storage.SetValue(hKey, L"Password", password) &&
+          ((version < 2) || storage.SetValue(hKey, L"AskPassword", DWORD(0))) &&
+          ((version < 6) || storage.SetValue(hKey, L"KeepMounted", DWORD(0))) &&
+          ((version < 7) || storage.SetValue(hKey, L"AutoMount", DWORD(0)));
+    WINPORT(RegCloseKey)(hKey);
+    points.push_back(point);
+    passwords.push_back(password);
+  }
+  ret = ret &&
+        storage.SetValue(hStorage, MountPointStorage::StorageVersionKey,
+                         version);
+  WINPORT(RegCloseKey)(hStorage);
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  unsigned int records = 1000, reads = 10000;
+  std::vector<std::string> backends;
+  int c;
+  while ((c = getopt(argc, argv, "n:r:b:h")) != -1)
+    switch (c)
+    {
+      case 'n': records = std::strtoul(optarg, nullptr, 10); break;
+      case 'r': reads = std::strtoul(optarg, nullptr, 10); break;
+      case 'b':
+      {
+        std::istringstream list(optarg);
+        std::string item;
+        while (std::getline(list, item, ',')) backends.push_back(item);
+        break;
+      }
+      default:
+        std::cerr << "Usage: " << argv[0]
+                  << " [-n records] [-r GetValue repeats]"
+                  << " [-b registry|secret[,...]]" << std::endl;
+        return 1;
+    }
+  if (backends.empty())
+  {
+    backends.push_back("registry");
+#ifdef USE_SECRET_STORAGE
+    backends.push_back("secret");
+#endif
+  }
+
+  BenchHost host(L"storage");
+  Configuration* config = Configuration::Instance(host.registryRoot());
+  StorageBench bench(host.registryRoot(), records, reads);
+  std::printf("crypto\n");
+  bench.runCrypto();
+  std::printf("registry\n");
+  bench.runRegistry();
+  for (const auto& backend : backends)
+  {
+    DWORD firstVersion = 1;
+    if (backend == "secret")
+      {
+#ifdef USE_SECRET_STORAGE
+        config->setUseSecretStorage(true);
+        // версии 1..3 не используют безопасное хранилище
+        firstVersion = 4;
+#else
+        std::cerr << "Built without secret storage support." << std::endl;
+        continue;
+#endif
+      }
+      else if (backend == "registry")
+      {
+#ifdef USE_SECRET_STORAGE
+        config->setUseSecretStorage(false);
+#endif
+      }
+      else
+      {
+        std::cerr << "Unknown password backend " << backend << std::endl;
+        return 1;
+      }
+    std::printf("catalog, %s passwords\n", backend.c_str());
+    bench.runCatalog(backend.c_str());
+    for (DWORD version = firstVersion;
+         version <= StorageBench::CurrentVersion(); version++)
+      bench.runVersion(version, backend.c_str());
+  }
+  (void)config;
+  return 0;
+}
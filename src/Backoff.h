@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+
+///
+/// @brief Задержка перед повтором операции.
+
+/// Общая политика повторов монтирования (см. GvfsService::mountTask()) и
+/// переподключений (см. Plugin::scheduleRemount()): задержка удваивается с
+/// каждой попыткой до верхней границы, половина ее -- случайная, чтобы
+/// повторы разных операций не совпадали.
+///
+/// @author cycleg
+///
+class Backoff
+{
+  public:
+    ///
+    /// Задержка перед повтором.
+    ///
+    /// @param [in] attempt Номер повтора, начиная с 1.
+    /// @param [in] delay Задержка перед первым повтором, мс.
+    /// @param [in] maxDelay Предельная задержка, мс.
+    /// @return delay * 2^(attempt-1), но не более maxDelay, со случайным
+    ///         разбросом в пределах второй половины, мс.
+    ///
+    /// Удвоение останавливается на maxDelay и поэтому не переполняется.
+    ///
+    static inline unsigned int Delay(unsigned int attempt, unsigned int delay,
+                                     unsigned int maxDelay)
+    {
+      thread_local std::minstd_rand jitter(std::random_device{}());
+      delay = std::min(delay, maxDelay);
+      for (unsigned int i = 1; (i < attempt) && (delay < maxDelay); i++)
+        delay = (delay > maxDelay / 2) ? maxDelay : delay * 2;
+      std::uniform_int_distribution<unsigned int> spread(0, delay - delay / 2);
+      return delay / 2 + spread(jitter);
+    }
+};
@@ -0,0 +1,187 @@
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <glibmm.h>
+#include <WideMB.h> // far2l/utils
+#include "CatalogFile.h"
+
+const wchar_t* CatalogFile::Extension = L".gvfsmounts";
+const unsigned int CatalogFile::ReadChunkSize = 64 * 1024;
+
+namespace {
+
+const char* RootElement = "gvfsmounts"; ///< Имя корневого элемента.
+const char* EntryElement = "mount"; ///< Имя элемента записи.
+
+///
+/// Потоковый разборщик файла каталога.
+///
+class CatalogParser: public Glib::Markup::Parser
+{
+  public:
+    CatalogParser(const CatalogFile::EntryHandler& handler):
+      m_handler(handler),
+      m_depth(0)
+    {}
+
+  protected:
+    void on_start_element(Glib::Markup::ParseContext& context,
+                          const Glib::ustring& element_name,
+                          const Glib::Markup::Parser::AttributeMap& attributes) override
+    {
+      (void)context;
+      m_depth++;
+      if (m_depth == 1)
+      {
+        if (element_name != RootElement)
+          throw Glib::MarkupError(Glib::MarkupError::INVALID_CONTENT,
+                                  "not a GVFS panel catalog");
+        return;
+      }
+      // вложенные элементы неизвестных типов пропускаются
+      if ((m_depth != 2) || (element_name != EntryElement)) return;
+      CatalogFile::Entry entry;
+      auto it = attributes.find("url");
+      if ((it == attributes.end()) || it->second.empty()) return;
+      StrMB2Wide(it->second.raw(), entry.url);
+      it = attributes.find("user");
+      if (it != attributes.end()) StrMB2Wide(it->second.raw(), entry.user);
+      it = attributes.find("askpassword");
+      entry.askPassword = (it != attributes.end()) &&
+                          ((it->second == "yes") || (it->second == "1"));
+      it = attributes.find("keepmounted");
+      entry.keepMounted = (it != attributes.end()) &&
+                          ((it->second == "yes") || (it->second == "1"));
+      it = attributes.find("automount");
+      entry.autoMount = (it != attributes.end()) &&
+                        ((it->second == "yes") || (it->second == "1"));
+      m_handler(entry);
+    }
+
+    void on_end_element(Glib::Markup::ParseContext& context,
+                        const Glib::ustring& element_name) override
+    {
+      (void)context;
+      (void)element_name;
+      m_depth--;
+    }
+
+  private:
+    const CatalogFile::EntryHandler& m_handler;
+    int m_depth; ///< Глубина вложенности текущего элемента.
+};
+
+///
+/// Экранировать строку для значения атрибута XML.
+///
+std::string Escape(const std::wstring& value)
+{
+  return Glib::Markup::escape_text(StrWide2MB(value)).raw();
+}
+
+} // anonymous namespace
+
+bool CatalogFile::IsCatalogFile(const std::wstring& fileName,
+                                const unsigned char* header, int headerSize)
+{
+  std::wstring ext(Extension);
+  if ((fileName.size() <= ext.size()) ||
+      (fileName.compare(fileName.size() - ext.size(), ext.size(), ext) != 0))
+    return false;
+  // заголовок не передается, если файл открывают не из панели
+  if (!header || (headerSize <= 0)) return true;
+  const char* begin = reinterpret_cast<const char*>(header);
+  const char* end = begin + headerSize;
+  // BOM UTF-8
+  if ((headerSize >= 3) && !std::memcmp(begin, "\xEF\xBB\xBF", 3)) begin += 3;
+  while ((begin < end) && std::isspace(static_cast<unsigned char>(*begin))) begin++;
+  static const char xmlHeader[] = "<?xml";
+  static const size_t xmlHeaderSize = sizeof(xmlHeader) - 1;
+  return (static_cast<size_t>(end - begin) >= xmlHeaderSize) &&
+         !std::memcmp(begin, xmlHeader, xmlHeaderSize);
+}
+
+bool CatalogFile::Read(const std::wstring& fileName,
+                       const EntryHandler& handler, std::wstring& error)
+{
+  error.clear();
+  std::ifstream file(StrWide2MB(fileName), std::ios::binary);
+  if (!file)
+  {
+    StrMB2Wide(std::strerror(errno), error);
+    return false;
+  }
+  CatalogParser parser(handler);
+  Glib::Markup::ParseContext context(parser);
+  std::vector<char> buffer(ReadChunkSize);
+  try
+  {
+    while (file)
+    {
+      file.read(buffer.data(), buffer.size());
+      if (file.gcount() > 0)
+        context.parse(buffer.data(), buffer.data() + file.gcount());
+    }
+    if (file.bad())
+    {
+      StrMB2Wide(std::strerror(errno), error);
+      return false;
+    }
+    context.end_parse();
+  }
+  catch (const Glib::MarkupError& e)
+  {
+    StrMB2Wide(e.what().raw(), error);
+    return false;
+  }
+  return true;
+}
+
+bool CatalogFile::Write(const std::wstring& fileName,
+                        const std::map<std::wstring, MountPoint>& points,
+                        std::wstring& error)
+{
+  error.clear();
+  std::string target(StrWide2MB(fileName)), temporary(target + ".tmp");
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+      StrMB2Wide(std::strerror(errno), error);
+      return false;
+    }
+    file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+         << "<" << RootElement << " version=\"1\">\n";
+    for (const auto& point : points)
+    {
+      file << "  <" << EntryElement
+           << " url=\"" << Escape(point.second.getUrl()) << "\""
+           << " user=\"" << Escape(point.second.getUser()) << "\""
+           << " askpassword=\""
+           << (point.second.getAskPassword() ? "yes" : "no") << "\""
+           << " keepmounted=\""
+           << (point.second.getKeepMounted() ? "yes" : "no") << "\""
+           << " automount=\""
+           << (point.second.getAutoMount() ? "yes" : "no") << "\"/>\n";
+    }
+    file << "</" << RootElement << ">\n";
+    file.flush();
+    if (!file)
+    {
+      StrMB2Wide(std::strerror(errno), error);
+      file.close();
+      std::remove(temporary.c_str());
+      return false;
+    }
+  }
+  if (std::rename(temporary.c_str(), target.c_str()) != 0)
+  {
+    StrMB2Wide(std::strerror(errno), error);
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include "MountPoint.h"
+
+///
+/// @brief Чтение и запись файлов каталога ресурсов (*.gvfsmounts).
+
+/// Файл каталога -- XML-документ следующего вида:
+///
+///     <?xml version="1.0" encoding="UTF-8"?>
+///     <gvfsmounts version="1">
+///       <mount url="sftp://host/path" user="name" askpassword="no"/>
+///       ...
+///     </gvfsmounts>
+///
+/// Пароли в файл каталога не выгружаются.
+///
+/// Чтение потоковое: файл разбирается порциями по ReadChunkSize байт
+/// средствами Glib::Markup, и каждая запись передается обработчику сразу
+/// после разбора. Таким образом, память, занимаемая разбором, не зависит от
+/// размера файла. Запись также ведется потоком, во временный файл, который
+/// затем переименовывается в целевой.
+///
+/// @author cycleg
+///
+class CatalogFile
+{
+  public:
+    ///
+    /// Запись о ресурсе в файле каталога.
+    ///
+    struct Entry
+    {
+      std::wstring url; ///< URL ресурса.
+      std::wstring user; ///< Имя пользователя.
+      bool askPassword; ///< Флаг "спрашивать пароль перед монтированием".
+      bool keepMounted; ///< Флаг "поддерживать подсоединенным".
+      bool autoMount; ///< Флаг "подсоединять при запуске".
+    };
+
+    ///
+    /// Обработчик прочитанной записи.
+    ///
+    typedef std::function<void(const Entry&)> EntryHandler;
+
+    static const wchar_t* Extension; ///< Расширение имени файла каталога.
+
+    ///
+    /// Проверить, является ли файл файлом каталога.
+    ///
+    /// @param [in] fileName Имя файла.
+    /// @param [in] header Начало содержимого файла.
+    /// @param [in] headerSize Размер начала содержимого файла.
+    /// @return true, если у файла подходящие расширение и заголовок.
+    ///
+    static bool IsCatalogFile(const std::wstring& fileName,
+                              const unsigned char* header, int headerSize);
+    ///
+    /// Прочитать файл каталога.
+    ///
+    /// @param [in] fileName Имя файла.
+    /// @param [in] handler Обработчик прочитанных записей.
+    /// @param [out] error Описание ошибки.
+    /// @return Результат чтения.
+    ///
+    /// При ошибке разбора записи, прочитанные до нее, уже переданы в
+    /// обработчик.
+    ///
+    static bool Read(const std::wstring& fileName, const EntryHandler& handler,
+                     std::wstring& error);
+    ///
+    /// Записать ресурсы в файл каталога.
+    ///
+    /// @param [in] fileName Имя файла.
+    /// @param [in] points Набор ресурсов.
+    /// @param [out] error Описание ошибки.
+    /// @return Результат записи.
+    ///
+    /// Существующий файл перезаписывается только в случае успеха.
+    ///
+    static bool Write(const std::wstring& fileName,
+                      const std::map<std::wstring, MountPoint>& points,
+                      std::wstring& error);
+
+  private:
+    static const unsigned int ReadChunkSize; ///< Размер порции чтения.
+};
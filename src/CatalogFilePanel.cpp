@@ -0,0 +1,95 @@
+#include <cstring>
+#include "CatalogFile.h"
+#include "LngStringIDs.h"
+#include "CatalogFilePanel.h"
+
+CatalogFilePanel::CatalogFilePanel(const PluginStartupInfo& psi,
+                                   const std::wstring& fileName):
+  m_psi(psi),
+  m_fileName(fileName)
+{
+  static const wchar_t* emptyHint = L"";
+  std::wstring::size_type pos = m_fileName.rfind(L'/');
+  m_title = m_psi.GetMsg(m_psi.ModuleNumber, MGvfsPanel);
+  m_title.append(L": ");
+  m_title.append((pos == std::wstring::npos) ? m_fileName
+                                             : m_fileName.substr(pos + 1));
+  // панель только для просмотра, все изменяющие команды блокируются в
+  // Plugin::processKey()
+  for (int i = 2; i < 8; i++) m_keyBar.setNormalKey(i, emptyHint);
+  for (int i = 0; i < 8; i++) m_keyBar.setShiftKey(i, emptyHint);
+  for (int i = 2; i < 6; i++) m_keyBar.setAltKey(i, emptyHint);
+  m_keyBar.setNormalKey(4, m_psi.GetMsg(m_psi.ModuleNumber, MF5ImportBar));
+}
+
+CatalogFilePanel::~CatalogFilePanel()
+{
+  clearItems();
+}
+
+bool CatalogFilePanel::load(std::wstring& error)
+{
+  clearItems();
+  return CatalogFile::Read(
+    m_fileName,
+    [this] (const CatalogFile::Entry& entry)
+    {
+      PluginPanelItem item;
+      std::memset(&item, 0, sizeof(item));
+      item.FindData.lpwszFileName = wcsdup(entry.url.c_str());
+      if (item.FindData.lpwszFileName == nullptr) return;
+      item.CustomColumnNumber = 3;
+      wchar_t** data = new wchar_t*[3];
+      data[0] = wcsdup(entry.askPassword ? L"?" : L" "); // C0
+      data[1] = wcsdup(entry.url.c_str()); // C1
+      data[2] = wcsdup(entry.user.c_str()); // C2
+      item.CustomColumnData = data;
+      m_items.push_back(item);
+    },
+    error
+  );
+}
+
+void CatalogFilePanel::getOpenPluginInfo(OpenPluginInfo* pluginInfo)
+{
+  pluginInfo->StructSize = sizeof(*pluginInfo);
+  pluginInfo->Flags = OPIF_USEHIGHLIGHTING | OPIF_SHOWPRESERVECASE;
+  pluginInfo->HostFile = m_fileName.c_str();
+  pluginInfo->CurDir = L"";
+  pluginInfo->PanelTitle = m_title.c_str();
+  static struct PanelMode PanelModesArray[10];
+  static const wchar_t* ColumnTitles[3] = { nullptr };
+  memset(&PanelModesArray, 0, sizeof(PanelModesArray));
+  ColumnTitles[1] = m_psi.GetMsg(m_psi.ModuleNumber, MResourceTitle);
+  ColumnTitles[2] = m_psi.GetMsg(m_psi.ModuleNumber, MUser);
+  PanelModesArray[0].ColumnTypes = L"C0,C1,C2";
+  PanelModesArray[0].ColumnWidths = L"1,0,0";
+  PanelModesArray[0].ColumnTitles = ColumnTitles;
+  PanelModesArray[0].StatusColumnTypes = PanelModesArray[0].ColumnTypes;
+  PanelModesArray[0].StatusColumnWidths = PanelModesArray[0].ColumnWidths;
+  pluginInfo->PanelModesArray = PanelModesArray;
+  pluginInfo->PanelModesNumber = ARRAYSIZE(PanelModesArray);
+  pluginInfo->StartPanelMode = _T('0');
+  pluginInfo->KeyBar = &(m_keyBar.getKeyBar());
+}
+
+void CatalogFilePanel::getFindData(PluginPanelItem** panelItem,
+                                   int* itemsNumber)
+{
+  *panelItem = m_items.empty() ? nullptr : m_items.data();
+  *itemsNumber = m_items.size();
+}
+
+void CatalogFilePanel::clearItems()
+{
+  for (PluginPanelItem& item : m_items)
+  {
+    free((void*)item.FindData.lpwszFileName);
+    item.FindData.lpwszFileName = nullptr;
+    for (int i = 0; i < item.CustomColumnNumber; i++)
+      free((void*)item.CustomColumnData[i]);
+    delete[] item.CustomColumnData;
+    item.CustomColumnData = nullptr;
+  }
+  m_items.clear();
+}
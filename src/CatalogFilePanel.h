@@ -0,0 +1,73 @@
+#pragma once
+
+#include <farplug-wide.h>
+#include <string>
+#include <vector>
+#include "KeyBarTitlesHelper.h"
+
+///
+/// @brief Панель просмотра файла каталога ресурсов (*.gvfsmounts).
+
+/// Открывается из OpenFilePluginW при входе в файл каталога на файловой
+/// панели. Показывает записи файла (URL и имя пользователя) только для
+/// просмотра; по F5 записи файла загружаются в каталог плагина (см.
+/// Plugin::importCatalog()).
+///
+/// Записи читаются потоково методом CatalogFile::Read(), в памяти хранятся
+/// только элементы панели.
+///
+/// @author cycleg
+///
+class CatalogFilePanel
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] psi API между плагином и far2l.
+    /// @param [in] fileName Полное имя файла каталога.
+    ///
+    CatalogFilePanel(const PluginStartupInfo& psi, const std::wstring& fileName);
+    ///
+    /// Деструктор.
+    ///
+    ~CatalogFilePanel();
+
+    ///
+    /// @return Полное имя файла каталога.
+    ///
+    inline const std::wstring& getFileName() const { return m_fileName; }
+
+    ///
+    /// Прочитать файл каталога в элементы панели.
+    ///
+    /// @param [out] error Описание ошибки.
+    /// @return Результат чтения.
+    ///
+    bool load(std::wstring& error);
+    ///
+    /// Заполнить описание панели для far2l.
+    ///
+    /// @param [out] pluginInfo Описание панели.
+    ///
+    void getOpenPluginInfo(OpenPluginInfo* pluginInfo);
+    ///
+    /// Выдать элементы панели far2l.
+    ///
+    /// @param [out] panelItem Элементы панели.
+    /// @param [out] itemsNumber Число элементов.
+    ///
+    void getFindData(PluginPanelItem** panelItem, int* itemsNumber);
+
+  private:
+    ///
+    /// Очистить набор элементов панели.
+    ///
+    void clearItems();
+
+    const PluginStartupInfo& m_psi; ///< API между плагином и far2l.
+    std::wstring m_fileName; ///< Полное имя файла каталога.
+    std::wstring m_title; ///< Заголовок панели.
+    std::vector<PluginPanelItem> m_items; ///< Элементы панели.
+    KeyBarTitlesHelper m_keyBar; ///< Подсказки функциональных кнопок.
+};
@@ -0,0 +1,297 @@
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <WideMB.h> // far2l/utils
+#include <utils.h> // far2l/utils
+#include "MountPointStorage.h"
+#include "Trace.h"
+#include "CatalogWatcher.h"
+
+#define UUID_TEXT_LENGTH 36
+
+const int CatalogWatcher::SettleTimeout = 200;
+const int CatalogWatcher::MaxSearchDepth = 16;
+
+namespace {
+
+///
+/// Директория, в которой WinPort эмулирует реестр текущего профиля far2l.
+///
+/// Профиль (ключ far2l -u, переменная FARSETTINGS) учитывает сам far2l в
+/// InMyConfig(), так что наблюдатель не попадет в дерево чужого профиля.
+/// Если отдельной директории реестра нет, поиск ведется по всей
+/// директории настроек профиля.
+///
+std::string RegistryRoot()
+{
+  std::string root(InMyConfig("REG", false));
+  struct stat st;
+  if ((stat(root.c_str(), &st) == 0) && S_ISDIR(st.st_mode)) return root;
+  return InMyConfig(nullptr, false);
+}
+
+std::string BaseName(const std::string& path)
+{
+  std::string::size_type pos = path.rfind('/');
+  return (pos == std::string::npos) ? path : path.substr(pos + 1);
+}
+
+std::string DirName(const std::string& path)
+{
+  std::string::size_type pos = path.rfind('/');
+  return (pos == std::string::npos) ? std::string() : path.substr(0, pos);
+}
+
+} // anonymous namespace
+
+CatalogWatcher::CatalogWatcher():
+  m_layout(ELayout::Unknown),
+  m_inotify(-1),
+  m_quitEvent(-1),
+  m_rootWatch(-1)
+{
+}
+
+CatalogWatcher::~CatalogWatcher()
+{
+  quit();
+}
+
+void CatalogWatcher::run(const std::wstring& registryRoot,
+                         const ChangeCallback& callback)
+{
+  if (m_thread) return;
+  m_registryRoot = registryRoot;
+  m_callback = callback;
+  m_quitEvent = eventfd(0, EFD_CLOEXEC);
+  if (m_quitEvent == -1) return;
+  m_thread = std::make_shared<std::thread>(std::bind(&CatalogWatcher::loop,
+                                                     this));
+}
+
+void CatalogWatcher::quit()
+{
+  if (!m_thread) return;
+  uint64_t value = 1;
+  if (write(m_quitEvent, &value, sizeof(value)) != sizeof(value))
+  {
+    // поток не разбудить, но он проверяет eventfd на каждой итерации
+  }
+  m_thread->join();
+  m_thread.reset();
+  close(m_quitEvent);
+  m_quitEvent = -1;
+}
+
+bool CatalogWatcher::locate()
+{
+  MountPointStorage storage(m_registryRoot);
+  if (!storage.valid()) return false;
+  // имя метки уникально, как и идентификатор новой записи
+  std::wstring marker(L"WatchMarker-");
+  marker.append(MountPointStorage::PointFactory().getStorageId());
+  if (!storage.WriteMarker(marker)) return false;
+  std::string l_marker(StrWide2MB(marker)), found;
+  std::string root(RegistryRoot());
+  m_layout = ELayout::Unknown;
+  if (FindMarker(root, l_marker, false, MaxSearchDepth, found))
+    {
+      // метке соответствует файл, папке хранилища -- директория
+      // "Resources" (или ее кодированное имя) на пути к нему
+      std::string dir(DirName(found)), storageName("Resources");
+      while (!dir.empty() && (BaseName(dir).find(storageName) == std::string::npos))
+        dir = DirName(dir);
+      m_path = dir.empty() ? DirName(found) : dir;
+      m_layout = ELayout::KeyDirectories;
+    }
+    else if (FindMarker(root, l_marker, true, MaxSearchDepth, found))
+    {
+      m_path = found;
+      m_layout = ELayout::SingleFile;
+    }
+  storage.RemoveMarker(marker);
+  TRACE_DEBUG("CatalogWatcher::locate()", "storage: %s", m_path.c_str());
+  return m_layout != ELayout::Unknown;
+}
+
+bool CatalogWatcher::FindMarker(const std::string& dir,
+                                const std::string& marker, bool byContent,
+                                int depth, std::string& found)
+{
+  if (depth <= 0) return false;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return false;
+  bool ret = false;
+  struct dirent* entry;
+  while (!ret && ((entry = readdir(d)) != nullptr))
+  {
+    if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+    std::string path(dir);
+    path.append("/").append(entry->d_name);
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) continue;
+    if (S_ISDIR(st.st_mode))
+      {
+        ret = FindMarker(path, marker, byContent, depth - 1, found);
+      }
+      else if (S_ISREG(st.st_mode))
+      {
+        if (!byContent)
+          {
+            ret = (std::string(entry->d_name).find(marker) != std::string::npos);
+          }
+          // файлы настроек невелики, большие файлы не рассматриваются
+          else if (st.st_size < 4 * 1024 * 1024)
+          {
+            std::ifstream file(path, std::ios::binary);
+            std::string content((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+            ret = (content.find(marker) != std::string::npos);
+          }
+        if (ret) found = path;
+      }
+  }
+  closedir(d);
+  return ret;
+}
+
+bool CatalogWatcher::ExtractId(const std::string& name, std::wstring& id)
+{
+  // UUID в текстовом виде: 8-4-4-4-12 шестнадцатеричных цифр
+  for (std::string::size_type start = 0;
+       start + UUID_TEXT_LENGTH <= name.size(); start++)
+  {
+    bool match = true;
+    for (int i = 0; match && (i < UUID_TEXT_LENGTH); i++)
+    {
+      char ch = name[start + i];
+      if ((i == 8) || (i == 13) || (i == 18) || (i == 23))
+        match = (ch == '-');
+        else match = std::isxdigit(static_cast<unsigned char>(ch));
+    }
+    if (match)
+    {
+      MB2Wide(name.substr(start, UUID_TEXT_LENGTH).c_str(), id);
+      return true;
+    }
+  }
+  return false;
+}
+
+std::wstring CatalogWatcher::watchRecord(const std::string& name)
+{
+  std::wstring id;
+  if (!ExtractId(name, id)) return id;
+  std::string path(m_path);
+  path.append("/").append(name);
+  int wd = inotify_add_watch(m_inotify, path.c_str(),
+                             IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE |
+                             IN_DELETE | IN_ONLYDIR);
+  if (wd != -1) m_records[wd] = id;
+  return id;
+}
+
+void CatalogWatcher::loop()
+{
+  TRACE_DEBUG("CatalogWatcher::loop()", "run");
+  if (!locate()) return;
+  m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_inotify == -1) return;
+  if (m_layout == ELayout::KeyDirectories)
+    {
+      m_rootWatch = inotify_add_watch(m_inotify, m_path.c_str(),
+                                      IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                      IN_MOVED_TO | IN_ONLYDIR);
+      DIR* d = opendir(m_path.c_str());
+      if (d)
+      {
+        struct dirent* entry;
+        while ((entry = readdir(d)) != nullptr) watchRecord(entry->d_name);
+        closedir(d);
+      }
+    }
+    else
+    {
+      // файл могут перезаписывать через переименование временного, поэтому
+      // наблюдаем за директорией, в которой он лежит
+      m_rootWatch = inotify_add_watch(m_inotify, DirName(m_path).c_str(),
+                                      IN_CLOSE_WRITE | IN_MOVED_TO |
+                                      IN_ONLYDIR);
+    }
+  std::set<std::wstring> changed;
+  bool rescan = false;
+  alignas(struct inotify_event) char buffer[4096];
+  while (true)
+  {
+    struct pollfd fds[2] = {
+      { m_inotify, POLLIN, 0 },
+      { m_quitEvent, POLLIN, 0 }
+    };
+    bool pending = rescan || !changed.empty();
+    int res = poll(fds, 2, pending ? SettleTimeout : -1);
+    if (res < 0) continue; // EINTR
+    if (fds[1].revents & POLLIN) break;
+    if (res == 0)
+    {
+      // события "успокоились"
+      m_callback(changed, rescan);
+      changed.clear();
+      rescan = false;
+      continue;
+    }
+    ssize_t len;
+    while ((len = read(m_inotify, buffer, sizeof(buffer))) > 0)
+    {
+      for (char* ptr = buffer; ptr < buffer + len;
+           ptr += sizeof(struct inotify_event) + reinterpret_cast<struct inotify_event*>(ptr)->len)
+      {
+        const struct inotify_event* event =
+          reinterpret_cast<const struct inotify_event*>(ptr);
+        std::string name(event->len ? event->name : "");
+        if (event->mask & IN_Q_OVERFLOW)
+        {
+          rescan = true;
+          continue;
+        }
+        if (m_layout == ELayout::SingleFile)
+        {
+          if (name == BaseName(m_path)) rescan = true;
+          continue;
+        }
+        if (event->wd == m_rootWatch)
+          {
+            // запись добавлена или удалена целиком
+            std::wstring id;
+            if (event->mask & (IN_CREATE | IN_MOVED_TO))
+              id = watchRecord(name);
+              else ExtractId(name, id);
+            if (!id.empty()) changed.insert(id);
+          }
+          else
+          {
+            auto i = m_records.find(event->wd);
+            if (i == m_records.end()) continue;
+            if (event->mask & IN_IGNORED)
+              {
+                // директорию записи удалили, наблюдение снято
+                changed.insert(i->second);
+                m_records.erase(i);
+              }
+              else changed.insert(i->second);
+          }
+      }
+    }
+  }
+  close(m_inotify);
+  m_inotify = -1;
+  m_records.clear();
+  TRACE_DEBUG("CatalogWatcher::loop()", "end");
+}
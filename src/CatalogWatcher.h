@@ -0,0 +1,134 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+
+///
+/// @brief Наблюдатель за изменениями хранилища описаний ресурсов на диске.
+
+/// Реестр far2l эмулируется в файловой системе, поэтому изменения хранилища
+/// MountPointStorage, сделанные другими экземплярами far2l, можно отследить
+/// средствами inotify. Директорию реестра текущего профиля far2l сообщает
+/// сам far2l (InMyConfig()), но раскладку папок реестра в ней WinPort не
+/// раскрывает. Поэтому расположение хранилища внутри нее определяется
+/// опытным путем: в папку хранилища записывается ключ-метка с уникальным
+/// именем, который затем ищется в директории реестра профиля. После поиска
+/// метка удаляется.
+///
+/// Поддерживаются две раскладки реестра на диске:
+/// * каждой папке реестра соответствует директория -- тогда отслеживаются
+///   директории отдельных записей, и в обработчик передаются
+///   идентификаторы только измененных записей;
+/// * папка реестра хранится в одном файле -- тогда любое его изменение
+///   требует сверки всех записей (флаг rescan в обработчике).
+///
+/// События накапливаются и передаются в обработчик пачкой, когда в течение
+/// SettleTimeout миллисекунд новых событий не поступает: одно сохранение
+/// записи порождает несколько событий, по одному на каждое поле.
+///
+/// Обработчик вызывается в отдельном потоке наблюдателя.
+///
+/// @author cycleg
+///
+class CatalogWatcher
+{
+  public:
+    ///
+    /// Обработчик изменений.
+    ///
+    /// Параметры: идентификаторы измененных записей и флаг "сверить все
+    /// записи".
+    ///
+    typedef std::function<void(const std::set<std::wstring>&, bool)> ChangeCallback;
+
+    ///
+    /// Конструктор.
+    ///
+    CatalogWatcher();
+    ///
+    /// Деструктор.
+    ///
+    ~CatalogWatcher();
+
+    ///
+    /// Запустить наблюдение в отдельном потоке.
+    ///
+    /// @param [in] registryRoot Путь к папке плагина в реестре far2l.
+    /// @param [in] callback Обработчик изменений.
+    ///
+    void run(const std::wstring& registryRoot, const ChangeCallback& callback);
+    ///
+    /// Остановить наблюдение.
+    ///
+    void quit();
+
+  private:
+    ///
+    /// Раскладка хранилища на диске.
+    ///
+    enum class ELayout {
+      Unknown, ///< Хранилище на диске не найдено.
+      KeyDirectories, ///< Папка реестра -- директория.
+      SingleFile ///< Папка реестра хранится в файле.
+    };
+
+    static const int SettleTimeout; ///< Время "успокоения" событий, мс.
+    static const int MaxSearchDepth; ///< Глубина поиска метки.
+
+    ///
+    /// Найти хранилище на диске.
+    ///
+    /// @return true, если хранилище найдено.
+    ///
+    bool locate();
+    ///
+    /// Рекурсивно найти файл с меткой.
+    ///
+    /// @param [in] dir Директория поиска.
+    /// @param [in] marker Метка.
+    /// @param [in] byContent Искать метку в содержимом файлов, а не в их
+    ///                       именах.
+    /// @param [in] depth Оставшаяся глубина поиска.
+    /// @param [out] found Путь к найденному файлу.
+    /// @return true, если файл найден.
+    ///
+    static bool FindMarker(const std::string& dir, const std::string& marker,
+                           bool byContent, int depth, std::string& found);
+    ///
+    /// Извлечь идентификатор записи (UUID) из имени файла или директории.
+    ///
+    /// @param [in] name Имя.
+    /// @param [out] id Идентификатор.
+    /// @return true, если идентификатор найден.
+    ///
+    static bool ExtractId(const std::string& name, std::wstring& id);
+
+    ///
+    /// Цикл приема событий inotify.
+    ///
+    void loop();
+    ///
+    /// Подключить наблюдение за директорией записи.
+    ///
+    /// @param [in] name Имя директории в директории хранилища.
+    /// @return Идентификатор записи или пустая строка.
+    ///
+    std::wstring watchRecord(const std::string& name);
+
+    std::wstring m_registryRoot; ///< Путь к папке плагина в реестре.
+    ChangeCallback m_callback; ///< Обработчик изменений.
+    ELayout m_layout; ///< Раскладка хранилища.
+    std::string m_path; ///< Директория или файл хранилища.
+    int m_inotify; ///< Дескриптор inotify.
+    int m_quitEvent; ///< Дескриптор eventfd для остановки цикла.
+    int m_rootWatch; ///< Наблюдение за директорией или файлом хранилища.
+    std::map<int, std::wstring> m_records; ///< Наблюдения за директориями
+                                           ///< записей: ключ -- дескриптор
+                                           ///< наблюдения, значение --
+                                           ///< идентификатор записи.
+    std::shared_ptr<std::thread> m_thread; ///< Поток наблюдателя.
+};
@@ -5,7 +5,29 @@ Configuration* Configuration::instance = nullptr;
 Configuration::Configuration(const std::wstring& registryFolder):
   RegistryStorage(registryFolder),
   m_unmountAtExit(true),
-  m_unmountThisSessionOnly(false)
+  m_unmountThisSessionOnly(false),
+  m_mountAttempts(4),
+  m_mountRetryDelay(500),
+  m_mountRetryMaxDelay(8000),
+  m_statusTtl(30000),
+  m_keepaliveInterval(0),
+  m_keepaliveMaxInterval(120000),
+  m_keepaliveTimeout(3000),
+  m_staleCheckTimeout(2000),
+  m_connectTimeout(0),
+  m_remountDelay(2000),
+  m_remountMaxDelay(300000),
+  m_remountRate(10),
+  m_speculativeMount(false),
+  m_speculativeDwell(1500),
+  m_speculativeGrace(120000),
+  m_warmUpConcurrency(4),
+  m_protocolConcurrency(4),
+  m_hostConcurrency(2),
+  m_shareCredentials(true),
+  m_backgroundConcurrency(4),
+  m_schedulerAging(10000),
+  m_persistSession(false)
 #ifdef USE_SECRET_STORAGE
   , m_useSecretStorage(false)
 #endif
@@ -31,6 +53,7 @@ void Configuration::save() const
   if (res != ERROR_SUCCESS) return;
   SetValue(hKey, L"UnmountAtExit", m_unmountAtExit);
   SetValue(hKey, L"UnmountThisSessionOnly", m_unmountThisSessionOnly);
+  SetValue(hKey, L"SpeculativeMount", m_speculativeMount);
 #ifdef USE_SECRET_STORAGE
   SetValue(hKey, L"UseSecretStorage", m_useSecretStorage);
 #endif
@@ -60,6 +83,67 @@ void Configuration::load()
     if (GetSetValue<DWORD>(hKey, L"UnmountThisSessionOnly", l_bool,
                            m_unmountThisSessionOnly))
       m_unmountThisSessionOnly = l_bool;
+    DWORD l_number;
+    if (GetSetValue<DWORD>(hKey, L"MountAttempts", l_number, m_mountAttempts))
+      m_mountAttempts = (l_number > 0) ? l_number : 1;
+    if (GetSetValue<DWORD>(hKey, L"MountRetryDelay", l_number,
+                           m_mountRetryDelay))
+      m_mountRetryDelay = l_number;
+    if (GetSetValue<DWORD>(hKey, L"MountRetryMaxDelay", l_number,
+                           m_mountRetryMaxDelay))
+      m_mountRetryMaxDelay = l_number;
+    if (GetSetValue<DWORD>(hKey, L"StatusTtl", l_number, m_statusTtl))
+      m_statusTtl = l_number;
+    if (GetSetValue<DWORD>(hKey, L"KeepaliveInterval", l_number,
+                           m_keepaliveInterval))
+      m_keepaliveInterval = l_number;
+    if (GetSetValue<DWORD>(hKey, L"KeepaliveMaxInterval", l_number,
+                           m_keepaliveMaxInterval))
+      m_keepaliveMaxInterval = l_number;
+    if (GetSetValue<DWORD>(hKey, L"KeepaliveTimeout", l_number,
+                           m_keepaliveTimeout))
+      m_keepaliveTimeout = l_number;
+    if (GetSetValue<DWORD>(hKey, L"StaleCheckTimeout", l_number,
+                           m_staleCheckTimeout))
+      m_staleCheckTimeout = l_number;
+    if (GetSetValue<DWORD>(hKey, L"ConnectTimeout", l_number, m_connectTimeout))
+      m_connectTimeout = l_number;
+    if (GetSetValue<DWORD>(hKey, L"RemountDelay", l_number, m_remountDelay))
+      m_remountDelay = l_number;
+    if (GetSetValue<DWORD>(hKey, L"RemountMaxDelay", l_number,
+                           m_remountMaxDelay))
+      m_remountMaxDelay = l_number;
+    if (GetSetValue<DWORD>(hKey, L"RemountRate", l_number, m_remountRate))
+      m_remountRate = l_number;
+    if (GetSetValue<DWORD>(hKey, L"SpeculativeMount", l_bool,
+                           m_speculativeMount))
+      m_speculativeMount = l_bool;
+    if (GetSetValue<DWORD>(hKey, L"SpeculativeDwell", l_number,
+                           m_speculativeDwell))
+      m_speculativeDwell = l_number;
+    if (GetSetValue<DWORD>(hKey, L"SpeculativeGrace", l_number,
+                           m_speculativeGrace))
+      m_speculativeGrace = l_number;
+    if (GetSetValue<DWORD>(hKey, L"WarmUpConcurrency", l_number,
+                           m_warmUpConcurrency))
+      m_warmUpConcurrency = (l_number > 0) ? l_number : 1;
+    if (GetSetValue<DWORD>(hKey, L"ProtocolConcurrency", l_number,
+                           m_protocolConcurrency))
+      m_protocolConcurrency = l_number;
+    if (GetSetValue<DWORD>(hKey, L"HostConcurrency", l_number,
+                           m_hostConcurrency))
+      m_hostConcurrency = l_number;
+    if (GetSetValue<DWORD>(hKey, L"ShareCredentials", l_bool,
+                           m_shareCredentials))
+      m_shareCredentials = l_bool;
+    if (GetSetValue<DWORD>(hKey, L"BackgroundConcurrency", l_number,
+                           m_backgroundConcurrency))
+      m_backgroundConcurrency = l_number;
+    if (GetSetValue<DWORD>(hKey, L"SchedulerAging", l_number,
+                           m_schedulerAging))
+      m_schedulerAging = l_number;
+    if (GetSetValue<DWORD>(hKey, L"PersistSession", l_bool, m_persistSession))
+      m_persistSession = l_bool;
 #ifdef USE_SECRET_STORAGE
     if (GetSetValue<DWORD>(hKey, L"UseSecretStorage", l_bool, m_useSecretStorage))
       m_useSecretStorage = l_bool;
@@ -12,7 +12,22 @@
 /// * отключение только тех известных подмонтированных ресурсов при выходе из
 ///   far2l, которые были смонтированы в текущем сеансе (да/нет);
 /// * ииспользовать для хранения паролей системное безопасное хранилище
-///   (да/нет).
+///   (да/нет);
+/// * упреждающее монтирование ресурса под курсором (да/нет).
+///
+/// Параметры повтора монтирования после временных ошибок (число попыток,
+/// начальная и предельная задержки между попытками) в диалоге настройки не
+/// показываются и задаются только в реестре. Так же задается время жизни
+/// статуса смонтированности ресурсов (см. MountPoint::statusFresh()),
+/// параметры фоновой проверки сеансов связи (см. KeepaliveProber),
+/// переподключения ресурсов с флагом "поддерживать подсоединенным",
+/// упреждающего монтирования и монтирования ресурсов при запуске.
+///
+/// Фоновая сетевая активность, не привязанная к флагам ресурсов (проверка
+/// сеансов связи, проверка доступности сервера перед монтированием,
+/// сохранение состояния ресурсов между запусками), по умолчанию выключена.
+/// Параметры и их значения по умолчанию описаны в справке дополнения
+/// (GvfsEng.hlf, GvfsRus.hlf).
 ///
 /// Класс реализован как синглетон для доступа к параметрам из любой точки
 /// плагина.
@@ -76,6 +91,167 @@ class Configuration: public RegistryStorage
     ///
     inline Configuration* setUnmountThisSessionOnly(bool v)
     { m_unmountThisSessionOnly = v; return this; }
+    ///
+    /// Извлечь значение параметра "число попыток монтирования".
+    ///
+    /// @return Число попыток монтирования ресурса при временных ошибках,
+    ///         включая первую.
+    ///
+    inline unsigned int mountAttempts() const { return m_mountAttempts; }
+    ///
+    /// Извлечь значение параметра "задержка перед повтором монтирования".
+    ///
+    /// @return Задержка перед первым повтором, мс.
+    ///
+    inline unsigned int mountRetryDelay() const { return m_mountRetryDelay; }
+    ///
+    /// Извлечь значение параметра "предельная задержка перед повтором
+    /// монтирования".
+    ///
+    /// @return Предельная задержка между попытками, мс.
+    ///
+    inline unsigned int mountRetryMaxDelay() const
+    { return m_mountRetryMaxDelay; }
+    ///
+    /// Извлечь значение параметра "время жизни статуса ресурса".
+    ///
+    /// @return Время, в течение которого статус смонтированности ресурса не
+    ///         перепроверяется, мс; 0 -- проверять всегда.
+    ///
+    inline unsigned int statusTtl() const { return m_statusTtl; }
+    ///
+    /// Извлечь значение параметра "минимальный интервал проверки сеанса".
+    ///
+    /// @return Минимальный интервал проверки сеанса связи со смонтированным
+    ///         ресурсом, мс; 0 -- проверка отключена.
+    ///
+    inline unsigned int keepaliveInterval() const { return m_keepaliveInterval; }
+    ///
+    /// Извлечь значение параметра "максимальный интервал проверки сеанса".
+    ///
+    /// @return Максимальный интервал проверки, мс.
+    ///
+    inline unsigned int keepaliveMaxInterval() const
+    { return m_keepaliveMaxInterval; }
+    ///
+    /// Извлечь значение параметра "время ответа при проверке сеанса".
+    ///
+    /// @return Предельное время ответа ресурса, мс.
+    ///
+    inline unsigned int keepaliveTimeout() const { return m_keepaliveTimeout; }
+    ///
+    /// Извлечь значение параметра "время ответа при переходе на ресурс".
+    ///
+    /// @return Предельное время ответа смонтированного ресурса перед сменой
+    ///         директории панели, мс; 0 -- не проверять.
+    ///
+    inline unsigned int staleCheckTimeout() const { return m_staleCheckTimeout; }
+    ///
+    /// Извлечь значение параметра "время проверки доступности узла".
+    ///
+    /// @return Предельное время соединения TCP с сервером ресурса перед
+    ///         монтированием, мс; 0 -- не проверять.
+    ///
+    inline unsigned int connectTimeout() const { return m_connectTimeout; }
+    ///
+    /// Извлечь значение параметра "задержка переподключения".
+    ///
+    /// @return Задержка перед первой попыткой переподключения ресурса, мс.
+    ///
+    inline unsigned int remountDelay() const { return m_remountDelay; }
+    ///
+    /// Извлечь значение параметра "предельная задержка переподключения".
+    ///
+    /// @return Предельная задержка между попытками переподключения, мс.
+    ///
+    inline unsigned int remountMaxDelay() const { return m_remountMaxDelay; }
+    ///
+    /// Извлечь значение параметра "частота переподключений".
+    ///
+    /// @return Предельное число попыток переподключения в минуту по всем
+    ///         ресурсам; 0 -- без ограничения.
+    ///
+    inline unsigned int remountRate() const { return m_remountRate; }
+    ///
+    /// Извлечь значение параметра "упреждающее монтирование".
+    ///
+    /// @return Значение параметра "упреждающее монтирование".
+    ///
+    inline bool speculativeMount() const { return m_speculativeMount; }
+    ///
+    /// Присвоить значение параметру "упреждающее монтирование".
+    ///
+    /// @param [in] v Новое значение.
+    /// @return Указатель на синглет.
+    ///
+    inline Configuration* setSpeculativeMount(bool v)
+    { m_speculativeMount = v; return this; }
+    ///
+    /// Извлечь значение параметра "задержка курсора".
+    ///
+    /// @return Время, которое курсор должен простоять на ресурсе, чтобы
+    ///         началось упреждающее монтирование, мс.
+    ///
+    inline unsigned int speculativeDwell() const { return m_speculativeDwell; }
+    ///
+    /// Извлечь значение параметра "срок невостребованного монтирования".
+    ///
+    /// @return Время, через которое ресурс, смонтированный упреждающе, но
+    ///         так и не открытый, отсоединяется, мс.
+    ///
+    inline unsigned int speculativeGrace() const { return m_speculativeGrace; }
+    ///
+    /// Извлечь значение параметра "параллельность монтирования при запуске".
+    ///
+    /// @return Число ресурсов с флагом "подсоединять при запуске",
+    ///         монтируемых одновременно.
+    ///
+    inline unsigned int warmUpConcurrency() const { return m_warmUpConcurrency; }
+    ///
+    /// Извлечь значение параметра "параллельность по протоколу".
+    ///
+    /// @return Предельное число фоновых операций, одновременно выполняемых
+    ///         над ресурсами одного протокола; 0 -- без ограничения.
+    ///
+    inline unsigned int protocolConcurrency() const
+    { return m_protocolConcurrency; }
+    ///
+    /// Извлечь значение параметра "параллельность по узлу".
+    ///
+    /// @return Предельное число фоновых операций, одновременно выполняемых
+    ///         над ресурсами одного узла; 0 -- без ограничения.
+    ///
+    inline unsigned int hostConcurrency() const { return m_hostConcurrency; }
+    ///
+    /// Извлечь значение параметра "общие аутентификационные данные узла".
+    ///
+    /// @return Пароли и ответы на вопросы при монтировании разделяются
+    ///         между ресурсами одного узла (см. CredentialCache).
+    ///
+    inline bool shareCredentials() const { return m_shareCredentials; }
+    ///
+    /// Извлечь значение параметра "параллельность фоновых операций".
+    ///
+    /// @return Предельное число одновременно выполняемых фоновых операций
+    ///         планировщика; 0 -- без ограничения.
+    ///
+    inline unsigned int backgroundConcurrency() const
+    { return m_backgroundConcurrency; }
+    ///
+    /// Извлечь значение параметра "интервал старения".
+    ///
+    /// @return Время ожидания, за которое приоритет отложенной операции
+    ///         планировщика повышается на ступень, мс; 0 -- без старения.
+    ///
+    inline unsigned int schedulerAging() const { return m_schedulerAging; }
+    ///
+    /// Извлечь значение параметра "сохранять состояние ресурсов".
+    ///
+    /// @return Состояние ресурсов сохраняется при выходе из far2l и
+    ///         восстанавливается при запуске, если сеанс GVFS тот же (см.
+    ///         SessionStateStorage).
+    ///
+    inline bool persistSession() const { return m_persistSession; }
 #ifdef USE_SECRET_STORAGE
     ///
     /// Извлечь значение параметра "использовать безопасное хранилище".
@@ -118,6 +294,54 @@ class Configuration: public RegistryStorage
     bool m_unmountThisSessionOnly; ///< Значение параметра "отключать при
                                    ///< выходе только ресурсы, смонтированные
                                    ///< в данном сеансе".
+    unsigned int m_mountAttempts; ///< Значение параметра "число попыток
+                                  ///< монтирования".
+    unsigned int m_mountRetryDelay; ///< Значение параметра "задержка перед
+                                    ///< повтором монтирования", мс.
+    unsigned int m_mountRetryMaxDelay; ///< Значение параметра "предельная
+                                       ///< задержка перед повтором
+                                       ///< монтирования", мс.
+    unsigned int m_statusTtl; ///< Значение параметра "время жизни статуса
+                              ///< ресурса", мс.
+    unsigned int m_keepaliveInterval; ///< Значение параметра "минимальный
+                                      ///< интервал проверки сеанса", мс.
+    unsigned int m_keepaliveMaxInterval; ///< Значение параметра
+                                         ///< "максимальный интервал проверки
+                                         ///< сеанса", мс.
+    unsigned int m_keepaliveTimeout; ///< Значение параметра "время ответа
+                                     ///< при проверке сеанса", мс.
+    unsigned int m_staleCheckTimeout; ///< Значение параметра "время ответа
+                                      ///< при переходе на ресурс", мс.
+    unsigned int m_connectTimeout; ///< Значение параметра "время проверки
+                                   ///< доступности узла", мс.
+    unsigned int m_remountDelay; ///< Значение параметра "задержка
+                                 ///< переподключения", мс.
+    unsigned int m_remountMaxDelay; ///< Значение параметра "предельная
+                                    ///< задержка переподключения", мс.
+    unsigned int m_remountRate; ///< Значение параметра "частота
+                                ///< переподключений", в минуту.
+    bool m_speculativeMount; ///< Значение параметра "упреждающее
+                             ///< монтирование".
+    unsigned int m_speculativeDwell; ///< Значение параметра "задержка
+                                     ///< курсора", мс.
+    unsigned int m_speculativeGrace; ///< Значение параметра "срок
+                                     ///< невостребованного монтирования", мс.
+    unsigned int m_warmUpConcurrency; ///< Значение параметра
+                                      ///< "параллельность монтирования при
+                                      ///< запуске".
+    unsigned int m_protocolConcurrency; ///< Значение параметра
+                                        ///< "параллельность по протоколу".
+    unsigned int m_hostConcurrency; ///< Значение параметра "параллельность по
+                                    ///< узлу".
+    bool m_shareCredentials; ///< Значение параметра "общие
+                             ///< аутентификационные данные узла".
+    unsigned int m_backgroundConcurrency; ///< Значение параметра
+                                          ///< "параллельность фоновых
+                                          ///< операций".
+    unsigned int m_schedulerAging; ///< Значение параметра "интервал
+                                   ///< старения", мс.
+    bool m_persistSession; ///< Значение параметра "сохранять состояние
+                           ///< ресурсов".
 #ifdef USE_SECRET_STORAGE
     bool m_useSecretStorage; ///< Значение параметра "использовать безопасное
                              ///< хранилище".
@@ -0,0 +1,106 @@
+#include <WideMB.h> // far2l/utils
+#include "MountPoint.h"
+#include "CredentialCache.h"
+
+namespace {
+
+///
+/// Ключ узла ресурса по разобранному URL, см. CredentialCache::HostKey().
+///
+std::wstring PartsHostKey(const MountPoint::UrlParts& parts)
+{
+  // разные порты одного узла -- разные серверы со своими ключами и паролями;
+  // явно указанный порт по умолчанию ключа не меняет
+  return parts.scheme + L"://" + parts.host +
+         (parts.port.empty() ? L"" : L":" + parts.port);
+}
+
+} // anonymous namespace
+
+CredentialCache::CredentialCache():
+  m_enabled(true)
+{
+}
+
+CredentialCache& CredentialCache::Instance()
+{
+  static CredentialCache instance;
+  return instance;
+}
+
+void CredentialCache::setEnabled(bool enabled)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  m_enabled = enabled;
+  if (m_enabled) return;
+  m_passwords.clear();
+  m_answers.clear();
+}
+
+void CredentialCache::storePassword(const std::wstring& url,
+                                    const std::wstring& user,
+                                    const std::wstring& password)
+{
+  std::wstring key(PasswordKey(url, user));
+  if (key.empty() || password.empty()) return;
+  std::lock_guard<std::mutex> lck(m_mutex);
+  if (m_enabled) m_passwords[key] = password;
+}
+
+bool CredentialCache::password(const std::wstring& url,
+                               const std::wstring& user,
+                               std::wstring& password) const
+{
+  std::wstring key(PasswordKey(url, user));
+  if (key.empty()) return false;
+  std::lock_guard<std::mutex> lck(m_mutex);
+  auto it = m_passwords.find(key);
+  if (it == m_passwords.end()) return false;
+  password = it->second;
+  return true;
+}
+
+void CredentialCache::forgetPassword(const std::wstring& url,
+                                     const std::wstring& user)
+{
+  std::wstring key(PasswordKey(url, user));
+  std::lock_guard<std::mutex> lck(m_mutex);
+  m_passwords.erase(key);
+}
+
+void CredentialCache::storeAnswer(const std::string& uri,
+                                  const std::string& question, int choice)
+{
+  std::wstring host(HostKey(StrMB2Wide(uri)));
+  if (host.empty()) return;
+  std::lock_guard<std::mutex> lck(m_mutex);
+  if (m_enabled) m_answers[host + L'\n' + StrMB2Wide(question)] = choice;
+}
+
+bool CredentialCache::answer(const std::string& uri,
+                             const std::string& question, int& choice) const
+{
+  std::wstring host(HostKey(StrMB2Wide(uri)));
+  if (host.empty()) return false;
+  std::lock_guard<std::mutex> lck(m_mutex);
+  auto it = m_answers.find(host + L'\n' + StrMB2Wide(question));
+  if (it == m_answers.end()) return false;
+  choice = it->second;
+  return true;
+}
+
+std::wstring CredentialCache::HostKey(const std::wstring& url)
+{
+  MountPoint::UrlParts parts;
+  if (!MountPoint::SplitUrl(url, parts)) return std::wstring();
+  return PartsHostKey(parts);
+}
+
+std::wstring CredentialCache::PasswordKey(const std::wstring& url,
+                                          const std::wstring& user)
+{
+  MountPoint::UrlParts parts;
+  if (!MountPoint::SplitUrl(url, parts)) return std::wstring();
+  // имя пользователя может быть задано и в самом URL
+  return PartsHostKey(parts) + L'\n' + parts.userInfo + L'\n' + user;
+}
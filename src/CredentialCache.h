@@ -0,0 +1,129 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+
+///
+/// @brief Общие для ресурсов одного узла аутентификационные данные сеанса.
+
+/// Каталог часто содержит несколько ресурсов одного сервера SMB или SFTP с
+/// одними и теми же учетными данными. Чтобы подсоединение десятка таких
+/// ресурсов стоило одного запроса пароля и одного вопроса о ключе узла,
+/// синглет хранит в памяти, до завершения far2l:
+/// * пароли, с которыми ресурсы были удачно подсоединены, -- по схеме, узлу,
+///   порту и имени пользователя (см. MountPoint::mount());
+/// * ответы оператора на вопросы GVFS при монтировании, например, о
+///   неизвестном ключе узла SSH, -- по схеме, узлу, порту и тексту вопроса
+///   (см. GvfsService::on_ask_question()).
+///
+/// Ресурс без сохраненного пароля или с флагом "спрашивать пароль"
+/// монтируется с паролем из кэша, если он есть для его узла и пользователя;
+/// такой ресурс можно подсоединить и в фоне. Пароль, который не подошел,
+/// из кэша удаляется (см. forgetPassword()).
+///
+/// В хранилище ресурсов (реестр, безопасное хранилище) кэш ничего не
+/// пишет. Может быть отключен параметром конфигурации
+/// Configuration::shareCredentials().
+///
+/// @author cycleg
+///
+class CredentialCache
+{
+  public:
+    ///
+    /// Доступ к экземпляру-синглету.
+    ///
+    static CredentialCache& Instance();
+
+    ///
+    /// Включить или отключить кэш.
+    ///
+    /// @param [in] enabled Кэш включен.
+    ///
+    /// При отключении накопленные данные забываются.
+    ///
+    void setEnabled(bool enabled);
+
+    ///
+    /// Запомнить пароль, с которым ресурс был удачно подсоединен.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [in] user Имя пользователя.
+    /// @param [in] password Пароль; пустой не запоминается.
+    ///
+    void storePassword(const std::wstring& url, const std::wstring& user,
+                       const std::wstring& password);
+    ///
+    /// Найти пароль для узла и пользователя ресурса.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [in] user Имя пользователя.
+    /// @param [out] password Пароль.
+    /// @return Пароль найден.
+    ///
+    bool password(const std::wstring& url, const std::wstring& user,
+                  std::wstring& password) const;
+    ///
+    /// Забыть пароль для узла и пользователя ресурса.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [in] user Имя пользователя.
+    ///
+    void forgetPassword(const std::wstring& url, const std::wstring& user);
+
+    ///
+    /// Запомнить ответ оператора на вопрос при монтировании.
+    ///
+    /// @param [in] uri URI ресурса.
+    /// @param [in] question Текст вопроса.
+    /// @param [in] choice Номер выбранного варианта ответа.
+    ///
+    void storeAnswer(const std::string& uri, const std::string& question,
+                     int choice);
+    ///
+    /// Найти ответ на тот же вопрос о том же узле.
+    ///
+    /// @param [in] uri URI ресурса.
+    /// @param [in] question Текст вопроса.
+    /// @param [out] choice Номер варианта ответа.
+    /// @return Ответ найден.
+    ///
+    bool answer(const std::string& uri, const std::string& question,
+                int& choice) const;
+
+  private:
+    ///
+    /// Конструктор.
+    ///
+    CredentialCache();
+
+    ///
+    /// Ключ узла ресурса.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @return Схема и имя узла в нижнем регистре с портом, "схема://узел:порт"
+    ///         (порт по умолчанию для схемы, если в URL он не указан; без
+    ///         порта, если схема неизвестна); пустая строка, если URL не
+    ///         содержит схемы.
+    ///
+    static std::wstring HostKey(const std::wstring& url);
+    ///
+    /// Ключ пароля.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [in] user Имя пользователя.
+    /// @return Ключ узла, имя пользователя из URL и user через перевод
+    ///         строки; пустая строка, если URL не содержит схемы.
+    ///
+    static std::wstring PasswordKey(const std::wstring& url,
+                                    const std::wstring& user);
+
+    bool m_enabled; ///< Кэш включен.
+    std::map<std::wstring, std::wstring> m_passwords; ///< Пароли, ключ --
+                                                      ///< см. PasswordKey().
+    std::map<std::wstring, int> m_answers; ///< Ответы, ключ -- см. HostKey(),
+                                           ///< и текст вопроса через перевод
+                                           ///< строки.
+    mutable std::mutex m_mutex; ///< Мутекс всех полей выше.
+};
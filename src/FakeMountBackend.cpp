@@ -0,0 +1,313 @@
+#include <fstream>
+#include <sstream>
+#include <gio/gio.h>
+#include <WideMB.h> // far2l/utils
+#include "MountPoint.h"
+#include "FakeMountBackend.h"
+
+namespace {
+
+///
+/// Каталог, в котором "находятся" точки монтирования имитации.
+///
+const char* FakeMountRoot = "/tmp/gvfspanel-fake";
+
+} // anonymous namespace
+
+FakeMountBackend::FakeMountBackend():
+  m_defaultRule{0, 0.0, true},
+  m_random(0),
+  m_quit(false),
+  m_operations(0)
+{
+}
+
+FakeMountBackend::~FakeMountBackend()
+{
+  unsubscribe();
+}
+
+bool FakeMountBackend::load(const std::string& fileName, std::string& error)
+{
+  std::ifstream file(fileName);
+  if (!file)
+  {
+    error = "can't open " + fileName;
+    return false;
+  }
+  std::string line;
+  unsigned int lineNo = 0;
+  while (std::getline(file, line))
+  {
+    lineNo++;
+    std::istringstream stream(line.substr(0, line.find('#')));
+    std::string directive;
+    if (!(stream >> directive)) continue;
+    bool ok = false;
+    if (directive == "seed")
+    {
+      unsigned int seed;
+      ok = static_cast<bool>(stream >> seed);
+      if (ok) setSeed(seed);
+    }
+    else if (directive == "latency")
+    {
+      std::string prefix;
+      unsigned int ms;
+      ok = static_cast<bool>(stream >> prefix >> ms);
+      if (ok) setLatency(prefix, ms);
+    }
+    else if (directive == "failure")
+    {
+      std::string prefix, kind;
+      double rate;
+      ok = static_cast<bool>(stream >> prefix >> rate >> kind) &&
+           ((kind == "transient") || (kind == "permanent"));
+      if (ok) setFailureRate(prefix, rate, kind == "transient");
+    }
+    else if (directive == "mounted")
+    {
+      std::string url;
+      ok = static_cast<bool>(stream >> url);
+      if (ok) setMounted(url);
+    }
+    else if (directive == "event")
+    {
+      unsigned int ms;
+      std::string kind, url;
+      ok = static_cast<bool>(stream >> ms >> kind >> url) &&
+           ((kind == "mount") || (kind == "unmount"));
+      if (ok) scheduleEvent(ms, kind == "mount", url);
+    }
+    if (!ok)
+    {
+      error = fileName + ":" + std::to_string(lineNo) + ": bad directive";
+      return false;
+    }
+  }
+  return true;
+}
+
+FakeMountBackend& FakeMountBackend::setSeed(unsigned int seed)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  m_random.seed(seed);
+  return *this;
+}
+
+FakeMountBackend& FakeMountBackend::setLatency(const std::string& prefix,
+                                               unsigned int ms)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  ruleFor(prefix).latency = ms;
+  return *this;
+}
+
+FakeMountBackend& FakeMountBackend::setFailureRate(const std::string& prefix,
+                                                   double rate, bool transient)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  Rule& rule = ruleFor(prefix);
+  rule.failureRate = rate;
+  rule.transient = transient;
+  return *this;
+}
+
+FakeMountBackend& FakeMountBackend::setMounted(const std::string& url)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  m_mounted.insert(Canonical(url));
+  return *this;
+}
+
+FakeMountBackend& FakeMountBackend::scheduleEvent(unsigned int ms, bool mount,
+                                                  const std::string& url)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  m_script.push_back(std::make_pair(ms, Event{mount, Canonical(url)}));
+  return *this;
+}
+
+bool FakeMountBackend::mount(const std::string& url, const std::string& user,
+                             const std::string& password, MountInfo& info)
+{
+  (void)user;
+  (void)password;
+  m_operations++;
+  std::string key(Canonical(url));
+  Rule rule;
+  bool failed = false;
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    rule = findRule(key);
+    if (rule.failureRate > 0.0)
+      failed = std::uniform_real_distribution<double>(0.0, 1.0)(m_random) <
+               rule.failureRate;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(rule.latency));
+  if (failed)
+  {
+    if (rule.transient)
+      throw GvfsServiceException(G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                                 "Fake backend: timed out");
+    throw GvfsServiceException(G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED,
+                               "Fake backend: permission denied");
+  }
+  bool added = false;
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    added = m_mounted.insert(key).second;
+  }
+  if (added) post(Clock::now(), true, key);
+  info = this->info(key, false);
+  return true;
+}
+
+bool FakeMountBackend::unmount(const std::string& url)
+{
+  m_operations++;
+  std::string key(Canonical(url));
+  Rule rule;
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    rule = findRule(key);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(rule.latency));
+  bool removed = false;
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    removed = (m_mounted.erase(key) > 0);
+  }
+  if (!removed)
+    throw GvfsServiceException(G_IO_ERROR, G_IO_ERROR_NOT_MOUNTED,
+                               "Fake backend: not mounted");
+  post(Clock::now(), false, key);
+  return true;
+}
+
+bool FakeMountBackend::mounted(const std::string& url, MountInfo& info)
+{
+  m_operations++;
+  std::string key(Canonical(url));
+  Rule rule;
+  bool found = false;
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    rule = findRule(key);
+    found = (m_mounted.find(key) != m_mounted.end());
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(rule.latency));
+  if (found) info = this->info(key, false);
+  return found;
+}
+
+void FakeMountBackend::subscribe(const EventHandler& handler)
+{
+  unsubscribe();
+  std::lock_guard<std::mutex> lck(m_mutex);
+  m_handler = handler;
+  m_quit = false;
+  Clock::time_point now = Clock::now();
+  for (const auto& item : m_script)
+    m_events.emplace(now + std::chrono::milliseconds(item.first), item.second);
+  m_thread = std::thread(&FakeMountBackend::eventLoop, this);
+}
+
+void FakeMountBackend::unsubscribe()
+{
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_quit = true;
+  }
+  m_wakeup.notify_all();
+  if (m_thread.joinable()) m_thread.join();
+  std::lock_guard<std::mutex> lck(m_mutex);
+  m_handler = nullptr;
+  m_events.clear();
+}
+
+std::string FakeMountBackend::Canonical(const std::string& url)
+{
+  return StrWide2MB(MountPoint::CanonicalUrl(StrMB2Wide(url)));
+}
+
+FakeMountBackend::Rule& FakeMountBackend::ruleFor(const std::string& prefix)
+{
+  if (prefix == "*") return m_defaultRule;
+  std::string key(Canonical(prefix));
+  auto i = m_rules.find(key);
+  if (i == m_rules.end()) i = m_rules.emplace(key, m_defaultRule).first;
+  return i->second;
+}
+
+FakeMountBackend::Rule FakeMountBackend::findRule(const std::string& url) const
+{
+  // самый длинный совпадающий префикс
+  const Rule* found = &m_defaultRule;
+  std::string::size_type length = 0;
+  for (const auto& rule : m_rules)
+    if ((rule.first.size() > length) && (url.compare(0, rule.first.size(), rule.first) == 0))
+    {
+      found = &rule.second;
+      length = rule.first.size();
+    }
+  return *found;
+}
+
+MountBackend::MountInfo FakeMountBackend::info(const std::string& url,
+                                               bool root) const
+{
+  MountInfo result;
+  std::string::size_type pos = url.find("://");
+  result.scheme = url.substr(0, pos);
+  std::string rest((pos == std::string::npos) ? url : url.substr(pos + 3));
+  pos = rest.find('/');
+  std::string authority(rest.substr(0, pos)),
+              path((pos == std::string::npos) ? "" : rest.substr(pos));
+  pos = authority.rfind('@');
+  result.name = (pos == std::string::npos) ? authority : authority.substr(pos + 1);
+  // как в каталогах FUSE GVFS: "схема:host=узел"
+  result.path = std::string(FakeMountRoot) + "/" + result.scheme + ":host=" +
+                result.name;
+  if (!root) result.path.append(path);
+  return result;
+}
+
+void FakeMountBackend::post(Clock::time_point due, bool mount,
+                            const std::string& url)
+{
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    if (!m_handler) return;
+    m_events.emplace(due, Event{mount, url});
+  }
+  m_wakeup.notify_all();
+}
+
+void FakeMountBackend::eventLoop()
+{
+  std::unique_lock<std::mutex> lck(m_mutex);
+  while (!m_quit)
+  {
+    if (m_events.empty())
+    {
+      m_wakeup.wait(lck);
+      continue;
+    }
+    auto next = m_events.begin();
+    if (next->first > Clock::now())
+    {
+      m_wakeup.wait_until(lck, next->first);
+      continue;
+    }
+    Event event(next->second);
+    m_events.erase(next);
+    // событие "извне" меняет и состояние ресурса
+    if (event.mount) m_mounted.insert(event.url);
+      else m_mounted.erase(event.url);
+    EventHandler handler(m_handler);
+    lck.unlock();
+    handler(event.mount, info(event.url, true));
+    lck.lock();
+  }
+}
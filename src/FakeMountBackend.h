@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MountBackend.h"
+
+///
+/// @brief Программируемая имитация механизма монтирования.
+
+/// Реализация MountBackend, работающая целиком в памяти процесса. Для
+/// каждого URL (по самому длинному совпадающему префиксу канонического URL,
+/// см. MountPoint::CanonicalUrl(); "*" -- правило по умолчанию) задаются:
+/// * задержка операций в миллисекундах;
+/// * вероятность неудачи монтирования и вид ошибки (временная -- истечение
+///   времени ожидания, постоянная -- отказ в доступе).
+///
+/// Случайные неудачи определяются генератором с заданным начальным
+/// значением, поэтому прогоны воспроизводимы. Успешные mount() и unmount()
+/// порождают события о подсоединении и отключении точки монтирования, как
+/// это делает GVFS. Кроме того, можно запланировать события "извне" с
+/// задержкой от момента подписки.
+///
+/// Сценарий читается из текстового файла (см. load()), по строке на
+/// директиву, "#" -- комментарий:
+///
+///     seed 42
+///     latency * 20
+///     latency sftp://slow.example.com 1500
+///     failure smb:// 0.2 transient
+///     mounted sftp://build.example.com
+///     event 5000 unmount sftp://build.example.com
+///     event 7000 mount sftp://build.example.com
+///
+/// Правило для префикса создается копией правила по умолчанию на момент
+/// первого упоминания, поэтому директивы для "*" следует задавать первыми.
+///
+/// @author cycleg
+///
+class FakeMountBackend: public MountBackend
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// Без задержек и неудач, начальное значение генератора -- 0.
+    ///
+    FakeMountBackend();
+    ///
+    /// Деструктор.
+    ///
+    ~FakeMountBackend();
+
+    ///
+    /// Загрузить сценарий из файла.
+    ///
+    /// @param [in] fileName Имя файла сценария.
+    /// @param [out] error Описание ошибки.
+    /// @return Результат операции.
+    ///
+    bool load(const std::string& fileName, std::string& error);
+
+    ///
+    /// Задать начальное значение генератора случайных неудач.
+    ///
+    FakeMountBackend& setSeed(unsigned int seed);
+    ///
+    /// Задать задержку операций для URL с префиксом prefix ("*" -- все).
+    ///
+    FakeMountBackend& setLatency(const std::string& prefix, unsigned int ms);
+    ///
+    /// Задать вероятность (0..1) и вид неудачи монтирования для URL с
+    /// префиксом prefix ("*" -- все).
+    ///
+    FakeMountBackend& setFailureRate(const std::string& prefix, double rate,
+                                     bool transient);
+    ///
+    /// Отметить ресурс изначально подсоединенным.
+    ///
+    FakeMountBackend& setMounted(const std::string& url);
+    ///
+    /// Запланировать событие через ms миллисекунд после подписки. Событие
+    /// меняет и состояние ресурса.
+    ///
+    FakeMountBackend& scheduleEvent(unsigned int ms, bool mount,
+                                    const std::string& url);
+
+    ///
+    /// @return Число выполненных операций mount(), unmount() и mounted().
+    ///
+    inline unsigned long operations() const { return m_operations; }
+
+    bool mount(const std::string& url, const std::string& user,
+               const std::string& password, MountInfo& info) override;
+    bool unmount(const std::string& url) override;
+    bool mounted(const std::string& url, MountInfo& info) override;
+    void subscribe(const EventHandler& handler) override;
+    void unsubscribe() override;
+
+  private:
+    typedef std::chrono::steady_clock Clock; ///< Часы для событий.
+
+    ///
+    /// @brief Правило имитации для группы URL.
+    ///
+    struct Rule
+    {
+      unsigned int latency; ///< Задержка операций, мс.
+      double failureRate; ///< Вероятность неудачи монтирования.
+      bool transient; ///< Неудача -- временная ошибка.
+    };
+
+    ///
+    /// @brief Запланированное событие.
+    ///
+    struct Event
+    {
+      bool mount; ///< Подсоединение или отключение.
+      std::string url; ///< Канонический URL ресурса.
+    };
+
+    static std::string Canonical(const std::string& url);
+    Rule& ruleFor(const std::string& prefix);
+    Rule findRule(const std::string& url) const;
+    MountInfo info(const std::string& url, bool root) const;
+    void post(Clock::time_point due, bool mount, const std::string& url);
+    void eventLoop();
+
+    mutable std::mutex m_mutex; ///< Защищает все состояние имитации.
+    std::condition_variable m_wakeup; ///< Новое событие или остановка.
+    Rule m_defaultRule; ///< Правило по умолчанию.
+    std::map<std::string, Rule> m_rules; ///< Правила по префиксам URL.
+    std::set<std::string> m_mounted; ///< Подсоединенные ресурсы.
+    std::mt19937 m_random; ///< Генератор случайных неудач.
+    std::vector<std::pair<unsigned int, Event>> m_script; ///< События
+                                                          ///< сценария.
+    std::multimap<Clock::time_point, Event> m_events; ///< Очередь событий.
+    EventHandler m_handler; ///< Подписчик.
+    std::thread m_thread; ///< Поток доставки событий.
+    bool m_quit; ///< Флаг остановки потока доставки.
+    std::atomic_ulong m_operations; ///< Счетчик операций.
+};
@@ -0,0 +1,364 @@
+#include <WideMB.h> // far2l/utils
+#include "GlibTrampoline.h"
+#include "Trace.h"
+#ifdef USE_SECRET_STORAGE
+#include "SecretServiceStorage.h"
+#endif // USE_SECRET_STORAGE
+#include "GioAwait.h"
+
+namespace {
+
+///
+/// Преобразовать ошибку GIO в исключение и освободить ее.
+///
+std::shared_ptr<GvfsServiceException> TakeError(GError* error)
+{
+  std::shared_ptr<GvfsServiceException> ex;
+  if (error)
+  {
+    ex = std::make_shared<GvfsServiceException>(error->domain, error->code,
+                                                error->message);
+    g_error_free(error);
+  }
+  return ex;
+}
+
+} // anonymous namespace
+
+AwaitMount::AwaitMount(const Glib::RefPtr<Gio::File>& file,
+                       const Glib::RefPtr<Gio::MountOperation>& operation,
+                       const Glib::RefPtr<Gio::Cancellable>& cancellable):
+  m_file(file), m_operation(operation), m_cancellable(cancellable)
+{
+}
+
+void AwaitMount::await_suspend(std::coroutine_handle<> h)
+{
+  m_handle = h;
+  g_file_mount_enclosing_volume(
+    m_file->gobj(), G_MOUNT_MOUNT_NONE,
+    m_operation ? m_operation->gobj() : nullptr,
+    m_cancellable ? m_cancellable->gobj() : nullptr,
+    GlibTrampoline<AwaitMount, GObject*, GAsyncResult*>::
+      Invoke<&AwaitMount::onReady>,
+    this);
+}
+
+void AwaitMount::await_resume()
+{
+  if (m_exception) throw *m_exception;
+}
+
+void AwaitMount::onReady(GObject* source, GAsyncResult* result)
+{
+  GError* error = nullptr;
+  g_file_mount_enclosing_volume_finish(G_FILE(source), result, &error);
+  m_exception = TakeError(error);
+  m_handle.resume();
+}
+
+AwaitFindMount::AwaitFindMount(const Glib::RefPtr<Gio::File>& file,
+                               const Glib::RefPtr<Gio::Cancellable>& cancellable):
+  m_file(file), m_cancellable(cancellable)
+{
+}
+
+void AwaitFindMount::await_suspend(std::coroutine_handle<> h)
+{
+  m_handle = h;
+  g_file_find_enclosing_mount_async(
+    m_file->gobj(), G_PRIORITY_DEFAULT,
+    m_cancellable ? m_cancellable->gobj() : nullptr,
+    GlibTrampoline<AwaitFindMount, GObject*, GAsyncResult*>::
+      Invoke<&AwaitFindMount::onReady>,
+    this);
+}
+
+Glib::RefPtr<Gio::Mount> AwaitFindMount::await_resume()
+{
+  if (m_exception) throw *m_exception;
+  return m_mount;
+}
+
+void AwaitFindMount::onReady(GObject* source, GAsyncResult* result)
+{
+  GError* error = nullptr;
+  GMount* mount = g_file_find_enclosing_mount_finish(G_FILE(source), result,
+                                                     &error);
+  // владение ссылкой на mount передается в Glib::RefPtr
+  if (mount) m_mount = Glib::wrap(mount, false);
+  m_exception = TakeError(error);
+  m_handle.resume();
+}
+
+AwaitUnmount::AwaitUnmount(const Glib::RefPtr<Gio::Mount>& mount,
+                           const Glib::RefPtr<Gio::MountOperation>& operation,
+                           bool force):
+  m_mount(mount), m_operation(operation), m_force(force), m_result(false)
+{
+}
+
+void AwaitUnmount::await_suspend(std::coroutine_handle<> h)
+{
+  m_handle = h;
+  g_mount_unmount_with_operation(
+    m_mount->gobj(), m_force ? G_MOUNT_UNMOUNT_FORCE : G_MOUNT_UNMOUNT_NONE,
+    m_operation ? m_operation->gobj() : nullptr, nullptr,
+    GlibTrampoline<AwaitUnmount, GObject*, GAsyncResult*>::
+      Invoke<&AwaitUnmount::onReady>,
+    this);
+}
+
+bool AwaitUnmount::await_resume()
+{
+  if (m_exception) throw *m_exception;
+  return m_result;
+}
+
+void AwaitUnmount::onReady(GObject* source, GAsyncResult* result)
+{
+  GError* error = nullptr;
+  m_result = g_mount_unmount_with_operation_finish(G_MOUNT(source), result,
+                                                   &error);
+  m_exception = TakeError(error);
+  m_handle.resume();
+}
+
+AwaitDelay::AwaitDelay(unsigned int ms): m_ms(ms)
+{
+}
+
+void AwaitDelay::await_suspend(std::coroutine_handle<> h)
+{
+  m_handle = h;
+  GSource* source = g_timeout_source_new(m_ms);
+  g_source_set_callback(source, &AwaitDelay::onElapsed, this, nullptr);
+  g_source_attach(source, g_main_context_get_thread_default());
+  g_source_unref(source);
+}
+
+gboolean AwaitDelay::onElapsed(gpointer user_data)
+{
+  static_cast<AwaitDelay*>(user_data)->m_handle.resume();
+  return G_SOURCE_REMOVE;
+}
+
+AwaitFilesystemInfo::AwaitFilesystemInfo(const Glib::RefPtr<Gio::File>& file,
+                                         unsigned int timeout):
+  m_file(file), m_timeout(timeout), m_timedOut(false), m_cancellable(nullptr),
+  m_timer(nullptr)
+{
+}
+
+void AwaitFilesystemInfo::await_suspend(std::coroutine_handle<> h)
+{
+  m_handle = h;
+  m_cancellable = g_cancellable_new();
+  g_file_query_filesystem_info_async(
+    m_file->gobj(), G_FILE_ATTRIBUTE_FILESYSTEM_FREE, G_PRIORITY_DEFAULT,
+    m_cancellable,
+    GlibTrampoline<AwaitFilesystemInfo, GObject*, GAsyncResult*>::
+      Invoke<&AwaitFilesystemInfo::onReady>,
+    this);
+  if (m_timeout > 0)
+  {
+    // ссылка на таймер сохраняется, чтобы снять его при ответе
+    m_timer = g_timeout_source_new(m_timeout);
+    g_source_set_callback(m_timer, &AwaitFilesystemInfo::onTimeout, this,
+                          nullptr);
+    g_source_attach(m_timer, g_main_context_get_thread_default());
+  }
+}
+
+void AwaitFilesystemInfo::await_resume()
+{
+  if (m_exception) throw *m_exception;
+}
+
+void AwaitFilesystemInfo::onReady(GObject* source, GAsyncResult* result)
+{
+  GError* error = nullptr;
+  GFileInfo* info = g_file_query_filesystem_info_finish(G_FILE(source), result,
+                                                        &error);
+  if (info) g_object_unref(info);
+  if (m_timer)
+  {
+    g_source_destroy(m_timer);
+    g_source_unref(m_timer);
+    m_timer = nullptr;
+  }
+  g_object_unref(m_cancellable);
+  m_cancellable = nullptr;
+  if (m_timedOut && error)
+  {
+    g_error_free(error);
+    m_exception = std::make_shared<GvfsServiceException>(
+      G_IO_ERROR, G_IO_ERROR_TIMED_OUT, "filesystem info query timed out"
+    );
+  }
+  else m_exception = TakeError(error);
+  m_handle.resume();
+}
+
+gboolean AwaitFilesystemInfo::onTimeout(gpointer user_data)
+{
+  AwaitFilesystemInfo* self = static_cast<AwaitFilesystemInfo*>(user_data);
+  // операция завершится ошибкой отмены в onReady()
+  self->m_timedOut = true;
+  g_cancellable_cancel(self->m_cancellable);
+  return G_SOURCE_REMOVE;
+}
+
+AwaitConnect::AwaitConnect(const std::string& address, unsigned int timeout,
+                           const Glib::RefPtr<Gio::Cancellable>& cancellable):
+  m_address(address), m_timeout(timeout), m_outer(cancellable),
+  m_outerHandler(0), m_resolved(false), m_connected(false), m_timedOut(false),
+  m_client(nullptr), m_cancellable(nullptr), m_timer(nullptr)
+{
+}
+
+void AwaitConnect::await_suspend(std::coroutine_handle<> h)
+{
+  m_handle = h;
+  // собственный объект отмены: по таймеру отменяется только соединение, а
+  // не вся операция, частью которой оно является
+  m_cancellable = g_cancellable_new();
+  if (m_outer)
+    m_outerHandler = g_cancellable_connect(m_outer->gobj(),
+                                           G_CALLBACK(&AwaitConnect::onCancelled),
+                                           m_cancellable, nullptr);
+  m_client = g_socket_client_new();
+  g_socket_client_set_enable_proxy(m_client, FALSE);
+  g_signal_connect(m_client, "event",
+                   G_CALLBACK((GlibTrampoline<AwaitConnect, GSocketClient*,
+                                              GSocketClientEvent,
+                                              GSocketConnectable*, GIOStream*>::
+                               Invoke<&AwaitConnect::onEvent>)),
+                   this);
+  g_socket_client_connect_to_host_async(
+    m_client, m_address.c_str(), 0, m_cancellable,
+    GlibTrampoline<AwaitConnect, GObject*, GAsyncResult*>::
+      Invoke<&AwaitConnect::onReady>,
+    this);
+  if (m_timeout > 0)
+  {
+    m_timer = g_timeout_source_new(m_timeout);
+    g_source_set_callback(m_timer, &AwaitConnect::onTimeout, this, nullptr);
+    g_source_attach(m_timer, g_main_context_get_thread_default());
+  }
+}
+
+bool AwaitConnect::await_resume()
+{
+  if (m_exception) throw *m_exception;
+  return m_connected;
+}
+
+void AwaitConnect::onEvent(GSocketClient* client, GSocketClientEvent event,
+                           GSocketConnectable* connectable,
+                           GIOStream* connection)
+{
+  if (event == G_SOCKET_CLIENT_RESOLVED) m_resolved = true;
+}
+
+void AwaitConnect::onReady(GObject* source, GAsyncResult* result)
+{
+  GError* error = nullptr;
+  GSocketConnection* connection = g_socket_client_connect_to_host_finish(
+    G_SOCKET_CLIENT(source), result, &error
+  );
+  m_connected = (connection != nullptr);
+  if (connection) g_object_unref(connection);
+  if (m_timer)
+  {
+    g_source_destroy(m_timer);
+    g_source_unref(m_timer);
+    m_timer = nullptr;
+  }
+  if (m_outerHandler != 0)
+  {
+    g_cancellable_disconnect(m_outer->gobj(), m_outerHandler);
+    m_outerHandler = 0;
+  }
+  g_signal_handlers_disconnect_by_data(m_client, this);
+  g_object_unref(m_client);
+  m_client = nullptr;
+  g_object_unref(m_cancellable);
+  m_cancellable = nullptr;
+  bool cancelled = m_outer && m_outer->is_cancelled();
+  if (error && !m_resolved && !cancelled)
+  {
+    // имя узла не разрешено, в том числе вовремя: у GVFS могут быть свои
+    // способы его разрешить, судить о доступности сервера должен он
+    TRACE_DEBUG("AwaitConnect::onReady()", "%s: %s", m_address.c_str(),
+                error->message);
+    g_error_free(error);
+  }
+  else if (m_timedOut && error)
+  {
+    g_error_free(error);
+    m_exception = std::make_shared<GvfsServiceException>(
+      G_IO_ERROR, G_IO_ERROR_TIMED_OUT, "connection timed out"
+    );
+  }
+  else m_exception = TakeError(error);
+  m_handle.resume();
+}
+
+gboolean AwaitConnect::onTimeout(gpointer user_data)
+{
+  AwaitConnect* self = static_cast<AwaitConnect*>(user_data);
+  // операция завершится ошибкой отмены в onReady()
+  self->m_timedOut = true;
+  g_cancellable_cancel(self->m_cancellable);
+  return G_SOURCE_REMOVE;
+}
+
+void AwaitConnect::onCancelled(GCancellable* cancellable, gpointer user_data)
+{
+  g_cancellable_cancel(static_cast<GCancellable*>(user_data));
+}
+
+#ifdef USE_SECRET_STORAGE
+AwaitPasswordLookup::AwaitPasswordLookup(const std::wstring& id):
+  m_id(StrWide2MB(id))
+{
+}
+
+void AwaitPasswordLookup::await_suspend(std::coroutine_handle<> h)
+{
+  m_handle = h;
+  secret_password_lookup(SecretServiceStorage::Schema(),
+                         nullptr, // Cancellation object.
+                         GlibTrampoline<AwaitPasswordLookup, GObject*,
+                                        GAsyncResult*>::
+                           Invoke<&AwaitPasswordLookup::onReady>, // Callback
+                         this, // User data for callback.
+                         "id", m_id.c_str(),
+                         nullptr); // Always end with NULL.
+}
+
+std::wstring AwaitPasswordLookup::await_resume()
+{
+  return StrMB2Wide(m_password);
+}
+
+void AwaitPasswordLookup::onReady(GObject* source, GAsyncResult* result)
+{
+  (void)source;
+  GError* error = nullptr;
+  gchar* password = secret_password_lookup_finish(result, &error);
+  if (password != nullptr)
+  {
+    m_password = password;
+    secret_password_free(password);
+  }
+  if (error != nullptr)
+  {
+    TRACE_WARNING("AwaitPasswordLookup::onReady()",
+                  "couldn't find password: %s", error->message);
+    g_error_free(error);
+  }
+  m_handle.resume();
+}
+#endif // USE_SECRET_STORAGE
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <coroutine>
+#include <memory>
+#include <string>
+#include <gtkmm.h>
+#include "GvfsServiceException.h"
+
+///
+/// @file GioAwait.h
+///
+/// Ожидаемые объекты (awaitables) для асинхронных операций GIO и libsecret,
+/// используются в сопрограммах GioTask:
+///
+///     Glib::RefPtr<Gio::Mount> mount = co_await AwaitFindMount(file);
+///
+/// Операция запускается при приостановке сопрограммы в контексте glib
+/// потока по умолчанию, сопрограмма возобновляется из обратного вызова
+/// операции в том же контексте. Обратный вызов находит ожидаемый объект по
+/// user_data (см. GlibTrampoline), сам объект живет в кадре сопрограммы.
+///
+/// Ошибки GIO пробрасываются из co_await как GvfsServiceException.
+///
+
+///
+/// @brief Ожидание подсоединения ресурса (g_file_mount_enclosing_volume()).
+///
+/// @author cycleg
+///
+class AwaitMount
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] file Ресурс.
+    /// @param [in] operation Операция монтирования с аутентификационными
+    ///                       данными и обработчиками сигналов.
+    /// @param [in] cancellable Отмена операции (необязательная).
+    ///
+    AwaitMount(const Glib::RefPtr<Gio::File>& file,
+               const Glib::RefPtr<Gio::MountOperation>& operation,
+               const Glib::RefPtr<Gio::Cancellable>& cancellable =
+                 Glib::RefPtr<Gio::Cancellable>());
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    ///
+    /// @throw GvfsServiceException
+    ///
+    void await_resume();
+
+  private:
+    void onReady(GObject* source, GAsyncResult* result);
+
+    Glib::RefPtr<Gio::File> m_file; ///< Ресурс.
+    Glib::RefPtr<Gio::MountOperation> m_operation; ///< Операция монтирования.
+    Glib::RefPtr<Gio::Cancellable> m_cancellable; ///< Отмена операции.
+    std::coroutine_handle<> m_handle; ///< Ожидающая сопрограмма.
+    std::shared_ptr<GvfsServiceException> m_exception; ///< Ошибка операции.
+};
+
+///
+/// @brief Ожидание поиска точки монтирования ресурса
+/// (g_file_find_enclosing_mount_async()).
+///
+/// @author cycleg
+///
+class AwaitFindMount
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] file Ресурс.
+    /// @param [in] cancellable Отмена операции (необязательная).
+    ///
+    explicit AwaitFindMount(const Glib::RefPtr<Gio::File>& file,
+                            const Glib::RefPtr<Gio::Cancellable>& cancellable =
+                              Glib::RefPtr<Gio::Cancellable>());
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    ///
+    /// @return Точка монтирования, содержащая ресурс.
+    /// @throw GvfsServiceException
+    ///
+    Glib::RefPtr<Gio::Mount> await_resume();
+
+  private:
+    void onReady(GObject* source, GAsyncResult* result);
+
+    Glib::RefPtr<Gio::File> m_file; ///< Ресурс.
+    Glib::RefPtr<Gio::Mount> m_mount; ///< Найденная точка монтирования.
+    Glib::RefPtr<Gio::Cancellable> m_cancellable; ///< Отмена операции.
+    std::coroutine_handle<> m_handle; ///< Ожидающая сопрограмма.
+    std::shared_ptr<GvfsServiceException> m_exception; ///< Ошибка операции.
+};
+
+///
+/// @brief Ожидание отсоединения точки монтирования
+/// (g_mount_unmount_with_operation()).
+///
+/// @author cycleg
+///
+class AwaitUnmount
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] mount Точка монтирования.
+    /// @param [in] operation Операция для взаимодействия с пользователем
+    ///                       (необязательная).
+    /// @param [in] force Отсоединить принудительно, даже если сеанс связи с
+    ///                   ресурсом разорван или его файлы открыты.
+    ///
+    AwaitUnmount(const Glib::RefPtr<Gio::Mount>& mount,
+                 const Glib::RefPtr<Gio::MountOperation>& operation =
+                   Glib::RefPtr<Gio::MountOperation>(),
+                 bool force = false);
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    ///
+    /// @return Отсоединена точка монтирования или нет.
+    /// @throw GvfsServiceException
+    ///
+    bool await_resume();
+
+  private:
+    void onReady(GObject* source, GAsyncResult* result);
+
+    Glib::RefPtr<Gio::Mount> m_mount; ///< Точка монтирования.
+    Glib::RefPtr<Gio::MountOperation> m_operation; ///< Операция.
+    bool m_force; ///< Принудительное отсоединение.
+    bool m_result; ///< Результат операции.
+    std::coroutine_handle<> m_handle; ///< Ожидающая сопрограмма.
+    std::shared_ptr<GvfsServiceException> m_exception; ///< Ошибка операции.
+};
+
+///
+/// @brief Ожидание заданного времени в главном цикле glib.
+///
+/// В отличие от std::this_thread::sleep_for() поток не блокируется: другие
+/// сопрограммы того же контекста продолжают работать.
+///
+/// @author cycleg
+///
+class AwaitDelay
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] ms Время ожидания, мс.
+    ///
+    explicit AwaitDelay(unsigned int ms);
+
+    bool await_ready() const noexcept { return m_ms == 0; }
+    void await_suspend(std::coroutine_handle<> h);
+    void await_resume() const noexcept {}
+
+  private:
+    static gboolean onElapsed(gpointer user_data);
+
+    unsigned int m_ms; ///< Время ожидания, мс.
+    std::coroutine_handle<> m_handle; ///< Ожидающая сопрограмма.
+};
+
+///
+/// @brief Ожидание ответа о файловой системе ресурса с ограничением времени
+/// (g_file_query_filesystem_info_async()).
+///
+/// Запрашивается свободное место: для ресурсов GVFS это требует обращения
+/// демона к серверу, поэтому ответ подтверждает, что сеанс жив. Если ответа
+/// нет в течение заданного времени, операция отменяется, а из co_await
+/// пробрасывается ошибка G_IO_ERROR_TIMED_OUT.
+///
+/// @author cycleg
+///
+class AwaitFilesystemInfo
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] file Ресурс.
+    /// @param [in] timeout Предельное время ожидания, мс; 0 -- без
+    ///                     ограничения.
+    ///
+    AwaitFilesystemInfo(const Glib::RefPtr<Gio::File>& file, unsigned int timeout);
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    ///
+    /// @throw GvfsServiceException
+    ///
+    void await_resume();
+
+  private:
+    void onReady(GObject* source, GAsyncResult* result);
+    static gboolean onTimeout(gpointer user_data);
+
+    Glib::RefPtr<Gio::File> m_file; ///< Ресурс.
+    unsigned int m_timeout; ///< Предельное время ожидания, мс.
+    bool m_timedOut; ///< Операция отменена по истечении времени.
+    GCancellable* m_cancellable; ///< Отмена операции.
+    GSource* m_timer; ///< Таймер отмены.
+    std::coroutine_handle<> m_handle; ///< Ожидающая сопрограмма.
+    std::shared_ptr<GvfsServiceException> m_exception; ///< Ошибка операции.
+};
+
+///
+/// @brief Ожидание соединения TCP с сервером
+/// (g_socket_client_connect_to_host_async()).
+///
+/// Имя узла разрешается и соединение устанавливается асинхронно, в
+/// пределах одного заданного времени; прокси не используется. Соединение
+/// сразу закрывается: важен только факт, что сервер принимает соединения.
+/// Если время истекло, из co_await пробрасывается ошибка
+/// G_IO_ERROR_TIMED_OUT, если сервер отказал -- ошибка соединения.
+///
+/// Если имя узла не удалось разрешить, в том числе за отведенное время,
+/// проверка считается несостоявшейся:
+/// ошибка не пробрасывается, а co_await возвращает false. Узлы, известные
+/// только GVFS (например, имена NetBIOS), должны монтироваться как обычно.
+///
+/// @author cycleg
+///
+class AwaitConnect
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] address Адрес сервера, "узел:порт".
+    /// @param [in] timeout Предельное время ожидания, мс; 0 -- без
+    ///                     ограничения.
+    /// @param [in] cancellable Отмена операции (необязательная).
+    ///
+    AwaitConnect(const std::string& address, unsigned int timeout,
+                 const Glib::RefPtr<Gio::Cancellable>& cancellable =
+                   Glib::RefPtr<Gio::Cancellable>());
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    ///
+    /// @return Соединение установлено; false, если проверка не состоялась.
+    /// @throw GvfsServiceException
+    ///
+    bool await_resume();
+
+  private:
+    void onEvent(GSocketClient* client, GSocketClientEvent event,
+                 GSocketConnectable* connectable, GIOStream* connection);
+    void onReady(GObject* source, GAsyncResult* result);
+    static gboolean onTimeout(gpointer user_data);
+    static void onCancelled(GCancellable* cancellable, gpointer user_data);
+
+    std::string m_address; ///< Адрес сервера.
+    unsigned int m_timeout; ///< Предельное время ожидания, мс.
+    Glib::RefPtr<Gio::Cancellable> m_outer; ///< Отмена операции извне.
+    gulong m_outerHandler; ///< Обработчик отмены извне.
+    bool m_resolved; ///< Имя узла разрешено.
+    bool m_connected; ///< Соединение установлено.
+    bool m_timedOut; ///< Операция отменена по истечении времени.
+    GSocketClient* m_client; ///< Клиент соединения.
+    GCancellable* m_cancellable; ///< Отмена операции.
+    GSource* m_timer; ///< Таймер отмены.
+    std::coroutine_handle<> m_handle; ///< Ожидающая сопрограмма.
+    std::shared_ptr<GvfsServiceException> m_exception; ///< Ошибка операции.
+};
+
+#ifdef USE_SECRET_STORAGE
+///
+/// @brief Ожидание поиска пароля в безопасном хранилище
+/// (secret_password_lookup()).
+///
+/// Используется та же схема, что и в SecretServiceStorage.
+///
+/// @author cycleg
+///
+class AwaitPasswordLookup
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] id Идентификатор ресурса.
+    ///
+    explicit AwaitPasswordLookup(const std::wstring& id);
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    ///
+    /// @return Найденный пароль; пустая строка, если пароль не найден или
+    ///         хранилище недоступно.
+    ///
+    std::wstring await_resume();
+
+  private:
+    void onReady(GObject* source, GAsyncResult* result);
+
+    std::string m_id; ///< Идентификатор ресурса.
+    std::string m_password; ///< Найденный пароль.
+    std::coroutine_handle<> m_handle; ///< Ожидающая сопрограмма.
+};
+#endif // USE_SECRET_STORAGE
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <gtkmm.h>
+
+template <class T> class GioTask;
+
+namespace GioTaskDetail {
+
+///
+/// @brief Общая часть promise_type для GioTask.
+
+/// Хранит исключение, выброшенное в сопрограмме, сопрограмму-продолжение
+/// (ожидающую результата через co_await) и обработчик завершения для
+/// сопрограммы верхнего уровня (см. GioTask::start()).
+///
+class PromiseBase
+{
+  public:
+    ///
+    /// @brief Ожидание при завершении сопрограммы.
+
+    /// Передает управление продолжению, если оно есть, иначе вызывает
+    /// обработчик завершения. Кадр сопрограммы при этом не уничтожается,
+    /// им владеет экземпляр GioTask.
+    ///
+    struct FinalAwaiter
+    {
+      bool await_ready() const noexcept { return false; }
+
+      template <class Promise>
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+      {
+        PromiseBase& promise = h.promise();
+        if (promise.m_continuation) return promise.m_continuation;
+        if (promise.m_onDone) promise.m_onDone();
+        return std::noop_coroutine();
+      }
+
+      void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { m_exception = std::current_exception(); }
+
+    std::coroutine_handle<> m_continuation; ///< Ожидающая сопрограмма.
+    std::function<void()> m_onDone; ///< Обработчик завершения.
+    std::exception_ptr m_exception; ///< Исключение из сопрограммы.
+};
+
+///
+/// @brief promise_type для GioTask, возвращающей значение.
+///
+template <class T>
+class Promise: public PromiseBase
+{
+  public:
+    GioTask<T> get_return_object();
+
+    template <class U>
+    void return_value(U&& value) { m_value.emplace(std::forward<U>(value)); }
+
+    T result()
+    {
+      if (m_exception) std::rethrow_exception(m_exception);
+      return std::move(*m_value);
+    }
+
+  private:
+    std::optional<T> m_value; ///< Результат сопрограммы.
+};
+
+///
+/// @brief promise_type для GioTask без результата.
+///
+template <>
+class Promise<void>: public PromiseBase
+{
+  public:
+    GioTask<void> get_return_object();
+
+    void return_void() {}
+
+    void result()
+    {
+      if (m_exception) std::rethrow_exception(m_exception);
+    }
+};
+
+} // namespace GioTaskDetail
+
+///
+/// @brief Сопрограмма над асинхронными операциями GIO.
+
+/// Результат сопрограмм C++20, в которых асинхронные операции GIO и
+/// libsecret ожидаются через co_await (см. GioAwait.h). Сопрограмма ленивая:
+/// она начинает выполняться, когда ее ожидают через co_await из другой
+/// сопрограммы или запускают методом start(). Обратные вызовы GIO приходят
+/// в контекст glib, бывший контекстом потока по умолчанию в момент начала
+/// операции; в нем же возобновляется сопрограмма. Поэтому многошаговые
+/// процедуры ("запросить пароль, смонтировать, найти точку монтирования")
+/// записываются линейно, и сколько угодно таких процедур выполняются
+/// одновременно в одном потоке с одним главным циклом, см. RunAll().
+///
+/// Экземпляр владеет кадром сопрограммы, копирование запрещено. Уничтожать
+/// экземпляр можно только после завершения сопрограммы: приостановленная
+/// сопрограмма ждет обратного вызова GIO, который обращается к ее кадру.
+///
+/// @param T Тип результата сопрограммы (void, если результата нет).
+///
+/// @author cycleg
+///
+template <class T = void>
+class GioTask
+{
+  public:
+    typedef GioTaskDetail::Promise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> handle_type;
+
+    explicit GioTask(handle_type h): m_handle(h) {}
+    GioTask(GioTask&& other) noexcept: m_handle(std::exchange(other.m_handle, {})) {}
+    GioTask(const GioTask&) = delete;
+    GioTask& operator=(const GioTask&) = delete;
+
+    ~GioTask()
+    {
+      if (m_handle) m_handle.destroy();
+    }
+
+    ///
+    /// @return Завершилась ли сопрограмма.
+    ///
+    inline bool done() const { return !m_handle || m_handle.done(); }
+
+    ///
+    /// Запустить сопрограмму верхнего уровня.
+    ///
+    /// @param [in] onDone Обработчик завершения сопрограммы.
+    ///
+    /// Сопрограмма выполняется до первой приостановки. По завершению, в
+    /// том числе с исключением, вызывается onDone.
+    ///
+    void start(std::function<void()> onDone = nullptr)
+    {
+      m_handle.promise().m_onDone = std::move(onDone);
+      m_handle.resume();
+    }
+
+    ///
+    /// Результат завершенной сопрограммы.
+    ///
+    /// @return Результат.
+    ///
+    /// Если сопрограмма завершилась исключением, оно пробрасывается.
+    ///
+    T result() { return m_handle.promise().result(); }
+
+    ///
+    /// Выполнить сопрограмму синхронно.
+    ///
+    /// @param [in] task Сопрограмма.
+    /// @param [in] loop Главный цикл, в контексте которого выполняются
+    ///                  асинхронные операции сопрограммы.
+    /// @return Результат сопрограммы.
+    ///
+    /// Главный цикл работает, пока сопрограмма не завершится. Контекст
+    /// цикла должен быть контекстом потока по умолчанию.
+    ///
+    static T RunSync(GioTask task, const Glib::RefPtr<Glib::MainLoop>& loop)
+    {
+      task.start([&loop] () { loop->quit(); });
+      if (!task.done()) loop->run();
+      return task.result();
+    }
+
+    ///
+    /// Выполнить несколько сопрограмм одновременно в одном цикле.
+    ///
+    /// @param [in] tasks Сопрограммы.
+    /// @param [in] loop Главный цикл, см. RunSync().
+    ///
+    /// Возвращает управление, когда завершатся все сопрограммы. Результаты
+    /// забираются из tasks методом result().
+    ///
+    static void RunAll(std::vector<GioTask>& tasks,
+                       const Glib::RefPtr<Glib::MainLoop>& loop)
+    {
+      size_t running = tasks.size();
+      for (auto& task : tasks)
+        task.start([&running, &loop] () { if (--running == 0) loop->quit(); });
+      if (running > 0) loop->run();
+    }
+
+    ///
+    /// @brief Ожидание сопрограммы через co_await.
+    ///
+    struct Awaiter
+    {
+      handle_type m_handle; ///< Ожидаемая сопрограмма.
+
+      bool await_ready() const noexcept { return false; }
+
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+      {
+        m_handle.promise().m_continuation = continuation;
+        return m_handle;
+      }
+
+      T await_resume() { return m_handle.promise().result(); }
+    };
+
+    Awaiter operator co_await() && { return Awaiter{m_handle}; }
+
+  private:
+    handle_type m_handle; ///< Кадр сопрограммы.
+};
+
+namespace GioTaskDetail {
+
+template <class T>
+inline GioTask<T> Promise<T>::get_return_object()
+{
+  return GioTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline GioTask<void> Promise<void>::get_return_object()
+{
+  return GioTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+} // namespace GioTaskDetail
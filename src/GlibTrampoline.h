@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glib.h>
+
+///
+/// @brief Трамплин для вызова метода объекта из обратного вызова glib.
+
+/// Обратные вызовы C-интерфейса glib (обработчики сигналов GObject,
+/// GAsyncReadyCallback и т.п.) получают последним параметром user_data. Если
+/// при подключении обратного вызова передать в user_data указатель на
+/// экземпляр класса T, то трамплин вызовет у него метод Method с остальными
+/// параметрами обратного вызова:
+///
+///     g_signal_connect(op, "ask_question",
+///                      G_CALLBACK((GlibTrampoline<Service, GMountOperation*,
+///                                  char*, char**>::Invoke<&Service::onAsk>)),
+///                      this);
+///
+/// Объект находится по самим данным обратного вызова, без глобальных таблиц
+/// и блокировок, поэтому параллельные операции в разных потоках друг друга
+/// не ждут. Вызывающий код должен гарантировать, что объект жив, пока
+/// обратный вызов может сработать: отключить обработчики сигналов (например,
+/// g_signal_handlers_disconnect_by_data()) или дождаться завершения
+/// асинхронной операции.
+///
+/// @param T Класс объекта.
+/// @param Args Параметры обратного вызова без завершающего user_data.
+///
+/// @author cycleg
+///
+template <class T, class... Args>
+class GlibTrampoline
+{
+  public:
+    ///
+    /// Обратный вызов для glib.
+    ///
+    /// @param Method Вызываемый метод класса T.
+    ///
+    template <void (T::*Method)(Args...)>
+    static void Invoke(Args... args, gpointer user_data)
+    {
+      (static_cast<T*>(user_data)->*Method)(args...);
+    }
+};
@@ -1,168 +1,56 @@
-#include <atomic>
-#include <iostream>
+#include <algorithm>
+#include <chrono>
 #include <functional>
-#include <mutex>
-#include <unordered_map>
+#include <WideMB.h> // far2l/utils
+#include "Backoff.h"
+#include "CredentialCache.h"
+#include "GioAwait.h"
+#include "GlibTrampoline.h"
+#include "HostListReader.h"
+#include "Metrics.h"
+#include "MountPoint.h"
+#include "Trace.h"
 #include "UiCallbacks.h"
 #include "GvfsService.h"
 
 // "Объезд" ошибки в glibmm v2.50.0: проблемы с управлением памятью из-за
 // использования Glib::StringArrayHandle в сигнале/слоте ask_question класса
-// Gio::MountOperation. Приходится использовать оригинальный C-интерфейс GIO
-// и глобальную переменную mountCallbacksRegistry. См. GvfsService::mount() и
-// слот GvfsService::on_ask_question().
+// Gio::MountOperation. Приходится использовать оригинальный C-интерфейс GIO,
+// обработчики сигналов подключаются через GlibTrampoline с экземпляром
+// GvfsService в user_data. См. GvfsService::mount() и слот
+// GvfsService::on_ask_question().
 //
 // Ошибка, казалась, исправлена в glibmm v2.66, однако снова проявилась в
 // Debian Trixie. Текущая версия glibmm в ней -- 2.66.6, для нее по-прежнему
 // используется "объезд", см. glibmmconf.h. Необходимо дальнейшее наблюдение.
 
-#ifndef USE_GIO_MOUNTOPERATION_ONLY
-
-extern "C" void ask_question_wrapper(GMountOperation* op, char* message,
-                                     char** choices, gpointer user_data);
-extern "C" void ask_password_wrapper(GMountOperation* op, const char* message,
-                                     const char* default_user,
-                                     const char* default_domain,
-                                     GAskPasswordFlags flags);
-
-namespace {
-
-///
-/// @brief Таблица слотов для обработки сигналов процедуры монтирования ресурса.
-
-/// Здесь слоты -- обращения к методам класса GvfsService при обработке
-/// сигналов от GMountOperation через C-интерфейс (не C++!). Перед запуском
-/// монтирования экземпляр GMountOperation регистрируется в этой таблице, по
-/// завершению -- удаляется из нее.
-///
-/// При манипуляциях с таблицей потокобезопасность обеспечивается стратегией
-/// "один писатель, много читателей". Попытки зарегистрировать объект в таблице
-/// или удалить из нее задерживаются до тех пор, пока не завершатся все
-/// запущенные слоты. Эти операции выполняются за фиксированное время, в
-/// отличие от слотов. Слоты могут запускаться параллельно.
-///
-/// @author cycleg
-///
-class MountCallbacks
-{
-    friend class ::GvfsService; ///< Только экземпляры GvfsService могут
-                                ///< манипулировать таблицей.
-
-  public:
-    MountCallbacks(): m_readers(0), m_lock(m_mapMutex, std::defer_lock)
-    {
-    }
-
-    void onAskQuestion(GMountOperation* op, char* message, char** choices,
-                       gpointer user_data)
-    {
-        if (m_readers++ == 0) m_lock.lock();
-        auto i = m_slots.find(op);
-        if (i != m_slots.end())
-            i->second.onAskQuestion(op, message, choices, user_data);
-        if (--m_readers == 0) m_lock.unlock();
-    }
-
-    void onAskPassword(GMountOperation* op, const char* message,
-                       const char* default_user, const char* default_domain,
-                       GAskPasswordFlags flags)
-    {
-        if (m_readers++ == 0) m_lock.lock();
-        auto i = m_slots.find(op);
-        if (i != m_slots.end())
-            i->second.onAskPassword(op, message, default_user, default_domain,
-                                    flags);
-        if (--m_readers == 0) m_lock.unlock();
-    }
-
-  private:
-    struct slots
-    {
-        std::function<void(GMountOperation*, char*, char**, gpointer)>
-            onAskQuestion; ///< слот для сигнала "ask_question"
-        std::function<void(GMountOperation* op, const char* message,
-                           const char* default_user,
-                           const char* default_domain,
-                           GAskPasswordFlags flags)>
-            onAskPassword; ///< слот для сигнала "ask_password"
-    };
-
-    void connect(GMountOperation* op, slots& cb)
-    {
-        // ожидаем, когда отработают все вызванные слоты
-        std::lock_guard<std::mutex> lck(m_mapMutex);
-        m_slots.emplace(op, cb);
-        g_signal_connect(op, "ask_question", G_CALLBACK(ask_question_wrapper),
-                         nullptr);
-        g_signal_connect(op, "ask_password", G_CALLBACK(ask_password_wrapper),
-                         nullptr);
-    }
-
-    void disconnect(GMountOperation* op)
-    {
-        std::lock_guard<std::mutex> lck(m_mapMutex);
-        auto i = m_slots.find(op);
-        if (i != m_slots.end()) m_slots.erase(i);
-    }
-
-    std::atomic_int m_readers; ///< Число потоков-читателей таблицы (извлекших
-                               ///< указатели на слоты).
-    std::mutex m_mapMutex; ///< Мутекс на запись таблицы слотов.
-                           ///< Заперт, если есть хотя бы один читатель таблицы
-                           ///< или имеется писатель в таблицу.
-    std::unique_lock<std::mutex> m_lock; ///< Закрыт, если есть хотя бы один
-                                         ///< читатель таблицы.
-    std::unordered_map<GMountOperation*, slots>
-        m_slots; ///< Таблица слотов: ключ -- указатель на целевой объект,
-                 ///< который будет обрабатываться.
-                                                                  
-};
-
-MountCallbacks mountCallbacksRegistry;
-
-extern "C" void ask_question_wrapper(GMountOperation* op,
-                                     char* message, char** choices,
-                                     gpointer user_data)
-{
-    mountCallbacksRegistry.onAskQuestion(op, message, choices, user_data);
-}
-
-
-extern "C" void ask_password_wrapper(GMountOperation* op,
-                                     const char* message,
-                                     const char* default_user,
-                                     const char* default_domain,
-                                     GAskPasswordFlags flags)
-{
-    mountCallbacksRegistry.onAskPassword(op, message, default_user,
-                                         default_domain, flags);
-}
-
-} // anonymous namespace
-
-#endif // USE_GIO_MOUNTOPERATION_ONLY
-
 GvfsService::GvfsService(UiCallbacks* uic) :
-    m_uiCallbacks(uic)
+    m_uiCallbacks(uic),
+    m_forceUnmount(false),
+    m_connectTimeout(0)
 {
 }
 
-bool GvfsService::mount(const std::string &resPath, const std::string &userName,
+bool GvfsService::mount(const Glib::RefPtr<Gio::File>& file,
+                        const std::string &userName,
                         const std::string &password)
 {
     using namespace std::placeholders;
 
     // какая-то операция в данном экземпляре уже запущена
     if (m_mainLoop && m_mainLoop->is_running()) return false;
-#ifndef NDEBUG
-    std::cout << std::hex << std::this_thread::get_id() << std::dec
-              << " GvfsService::mount() " << resPath << std::endl;
-#endif //NDEBUG
+    Metrics::Scope scope(Metrics::Mount);
+    Trace::Span span("GvfsService::mount()", file->get_parse_name());
     m_exception.reset();
     m_mountScheme.clear();
     m_mountPath.clear();
     m_mountName.clear();
 
+    m_file = file;
+    m_mount.reset();
+    if (MountBackend::Installed())
+        return backendMount(*MountBackend::Installed(), userName, password);
+
     Glib::RefPtr<Glib::MainContext> main_context = Glib::MainContext::create();
     // Чтобы контекст главного цикла Glib::MainLoop не отслеживал ничего,
     // кроме операций с ресурсами! Иначе блокируется пользовательский ввод Far.
@@ -174,7 +62,6 @@ bool GvfsService::mount(const std::string &resPath, const std::string &userName,
     g_main_context_push_thread_default(main_context->gobj());
     m_mainLoop = Glib::MainLoop::create(main_context, false);
 
-    m_file = Gio::File::create_for_parse_name(resPath);
     Glib::RefPtr<Gio::MountOperation> mount_operation = Gio::MountOperation::create();
 
     if (!userName.empty()) mount_operation->set_username(userName);
@@ -190,182 +77,276 @@ bool GvfsService::mount(const std::string &resPath, const std::string &userName,
                   _3, _4)
     );
 #else // USE_GIO_MOUNTOPERATION_ONLY
-    MountCallbacks::slots sl;
-    sl.onAskQuestion = std::bind(&GvfsService::on_ask_question, this, _1, _2,
-                                 _3, _4);
-    sl.onAskPassword = std::bind(&GvfsService::on_ask_password, this, _1, _2,
-                                 _3, _4, _5);
-    mountCallbacksRegistry.connect(mount_operation->gobj(), sl);
+    // экземпляр GvfsService передается в обработчики через user_data,
+    // обработчики отключаются по завершению операции
+    g_signal_connect(mount_operation->gobj(), "ask_question",
+                     G_CALLBACK((GlibTrampoline<GvfsService, GMountOperation*,
+                                                char*, char**>::
+                                 Invoke<&GvfsService::on_ask_question>)),
+                     this);
+    g_signal_connect(mount_operation->gobj(), "ask_password",
+                     G_CALLBACK((GlibTrampoline<GvfsService, GMountOperation*,
+                                                const char*, const char*,
+                                                const char*, GAskPasswordFlags>::
+                                 Invoke<&GvfsService::on_ask_password>)),
+                     this);
 #endif // USE_GIO_MOUNTOPERATION_ONLY
     mount_operation->signal_aborted().connect(
         std::bind(&GvfsService::on_aborted, this, mount_operation)
     );
 
     // do mount
-    bool l_mounted = false;
     try
     {
-        m_file->mount_enclosing_volume(mount_operation,
-                                       [this] (Glib::RefPtr<Gio::AsyncResult>& result)
-                                       {
-                                          this->mount_cb(result);
-                                       });
-        m_mainLoop->run();
-#ifndef USE_GIO_MOUNTOPERATION_ONLY
-        mountCallbacksRegistry.disconnect(mount_operation->gobj());
-#endif // USE_GIO_MOUNTOPERATION_ONLY
-        // Если адрес уже подключен (пользователь завел два ресурса про один
-        // и тот же сервер), то m_file->find_enclosing_mount() завершится без
-        // исключения, и ошибка "already mount" будет проигнорирована, что
-        // правильно. В случае других ошибок монтирования здесь возникнет
-        // исключение.
-        m_mountName = m_file->find_enclosing_mount()->get_name();
-        m_mountPath = m_file->get_path();
-        m_mountScheme = m_file->get_uri_scheme();
-        std::cout << std::hex << std::this_thread::get_id() << std::dec
-                  << " GvfsService::mount() name: " << m_mountName << std::endl
-                  << std::hex << std::this_thread::get_id() << std::dec
-                  << " GvfsService::mount() path: " << m_mountPath << std::endl
-                  << std::hex << std::this_thread::get_id() << std::dec
-                  << " GvfsService::mount() scheme: " << m_mountScheme << std::endl;
-        l_mounted = true;
-        // Из руководства:
-        // In some cases however, you may want to schedule a single operation
-        // in a non-default context, or temporarily use a non-default context
-        // in the main thread. In that case, you can wrap the call to the
-        // asynchronous operation inside a
-        // g_main_context_push_thread_default() / g_main_context_pop_thread_default()
-        // pair...
-        // Второй вариант, видимо, наш случай. Без этого вызова Glib выдает
-        // assert.
-        g_main_context_pop_thread_default(main_context->gobj());
+        m_mount = GioTask<Glib::RefPtr<Gio::Mount>>::RunSync(
+            mountTask(mount_operation), m_mainLoop
+        );
     }
     catch (const Glib::Error& ex)
     {
-        std::cerr << std::hex << std::this_thread::get_id() << std::dec
-                  << " GvfsService::mount() Glib::Error: " << ex.what().raw()
-                  << std::endl;
+        TRACE_ERROR("GvfsService::mount()", "Glib::Error: %s",
+                    ex.what().c_str());
+        m_exception = std::make_shared<GvfsServiceException>(ex.domain(),
+                                       ex.code(), ex.what());
+    }
 #ifndef USE_GIO_MOUNTOPERATION_ONLY
-        mountCallbacksRegistry.disconnect(mount_operation->gobj());
+    g_signal_handlers_disconnect_by_data(mount_operation->gobj(), this);
 #endif // USE_GIO_MOUNTOPERATION_ONLY
-        g_main_context_pop_thread_default(main_context->gobj());
-        if (m_exception.get() == nullptr)
-        {
-          m_exception = std::make_shared<GvfsServiceException>(ex.domain(),
-                                         ex.code(), ex.what());
-        }
-        throw *m_exception;
-    }
-    return l_mounted;
+    // Из руководства:
+    // In some cases however, you may want to schedule a single operation
+    // in a non-default context, or temporarily use a non-default context
+    // in the main thread. In that case, you can wrap the call to the
+    // asynchronous operation inside a
+    // g_main_context_push_thread_default() / g_main_context_pop_thread_default()
+    // pair...
+    // Второй вариант, видимо, наш случай. Без этого вызова Glib выдает
+    // assert.
+    g_main_context_pop_thread_default(main_context->gobj());
+    if ((m_exception.get() != nullptr) || (m_mount.operator->() == nullptr))
+        Metrics::Instance().increment(Metrics::MountFailures);
+    if (m_exception.get() != nullptr) throw *m_exception;
+    if (m_mount.operator->() == nullptr) return false;
+    m_mountName = m_mount->get_name();
+    m_mountPath = m_file->get_path();
+    m_mountScheme = m_file->get_uri_scheme();
+    TRACE_INFO("GvfsService::mount()", "name: %s path: %s scheme: %s",
+               m_mountName.c_str(), m_mountPath.c_str(), m_mountScheme.c_str());
+    return true;
 }
 
-bool GvfsService::umount(const std::string &resPath)
+bool GvfsService::umount(const Glib::RefPtr<Gio::File>& file,
+                         const Glib::RefPtr<Gio::Mount>& mount)
 {
     // какая-то операция в данном экземпляре уже запущена
     if (m_mainLoop && m_mainLoop->is_running()) return false;
-#ifndef NDEBUG
-    std::cout << std::hex << std::this_thread::get_id() << std::dec
-              << " GvfsService::umount() " << resPath << std::endl;
-#endif // NDEBUG
+    Metrics::Scope scope(Metrics::Unmount);
+    Trace::Span span("GvfsService::umount()", file->get_parse_name());
     m_exception.reset();
 
-    m_mainLoop = Glib::MainLoop::create(false);
+    m_file = file;
+    m_mount = mount;
+    if (MountBackend::Installed())
+        return backendUmount(*MountBackend::Installed());
 
-    m_file = Gio::File::create_for_parse_name(resPath);
+    // контекст операции, как и в mount(), чтобы не обрабатывать чужие
+    // события
+    Glib::RefPtr<Glib::MainContext> main_context = Glib::MainContext::create();
+    g_main_context_push_thread_default(main_context->gobj());
+    m_mainLoop = Glib::MainLoop::create(main_context, false);
     Glib::RefPtr<Gio::MountOperation> mount_operation = Gio::MountOperation::create();
 
     bool l_unmounted = false;
     try
     {
-        Glib::RefPtr<Gio::Mount> mount = m_file->find_enclosing_mount();
-        mount->unmount(mount_operation,
-                       [&l_unmounted, this] (Glib::RefPtr<Gio::AsyncResult>& result)
-                       {
-                           l_unmounted = this->unmount_cb(result);
-                       });
-        m_mainLoop->run();
+        l_unmounted = GioTask<bool>::RunSync(umountTask(mount_operation),
+                                             m_mainLoop);
     }
     catch (const Glib::Error& ex)
     {
-        std::cerr << std::hex << std::this_thread::get_id() << std::dec
-                  << " GvfsService::umount() Glib::Error: "<< ex.what().raw()
-                  << std::endl;
-        if (m_exception.get() == nullptr)
-        {
-          m_exception = std::make_shared<GvfsServiceException>(ex.domain(),
-                                         ex.code(), ex.what());
-        }
+        TRACE_ERROR("GvfsService::umount()", "Glib::Error: %s",
+                    ex.what().c_str());
+        m_exception = std::make_shared<GvfsServiceException>(ex.domain(),
+                                       ex.code(), ex.what());
+    }
+    g_main_context_pop_thread_default(main_context->gobj());
+    if ((m_exception.get() != nullptr) || l_unmounted)
+    {
         m_mountScheme.clear();
         m_mountPath.clear();
         m_mountName.clear();
+        m_mount.reset();
+    }
+    if (m_exception.get() != nullptr)
+    {
+        Metrics::Instance().increment(Metrics::UnmountFailures);
         throw *m_exception;
     }
-    if (l_unmounted)
-        {
-            m_mountScheme.clear();
-            m_mountPath.clear();
-            m_mountName.clear();
-        }
-        else
-        {
-            if (m_exception.get() != nullptr)
-            {
-                m_mountScheme.clear();
-                m_mountPath.clear();
-                m_mountName.clear();
-                throw *m_exception;
-            }
-        }
     return l_unmounted;
 }
 
-bool GvfsService::mounted(const std::string& resPath)
+bool GvfsService::mounted(const Glib::RefPtr<Gio::File>& file,
+                          const Glib::RefPtr<Gio::Mount>& mount)
 {
     // какая-то операция в данном экземпляре уже запущена
     if (m_mainLoop && m_mainLoop->is_running()) return false;
-#ifndef NDEBUG
-    std::cout << std::hex << std::this_thread::get_id() << std::dec
-              << " GvfsService::mounted() " << resPath << std::endl;
-#endif // NDEBUG
+    Metrics::Scope scope(Metrics::Probe);
+    TRACE_DEBUG("GvfsService::mounted()", "%s", file->get_parse_name().c_str());
     m_exception.reset();
     m_mountScheme.clear();
     m_mountPath.clear();
     m_mountName.clear();
 
-    m_mainLoop = Glib::MainLoop::create(false);
+    m_file = file;
+    m_mount = mount;
+    if (MountBackend::Installed())
+        return backendMounted(*MountBackend::Installed());
+    if (m_mount.operator->() == nullptr)
+    {
+        // точка монтирования неизвестна, ищем ее в контексте операции, как и
+        // в mount()
+        Glib::RefPtr<Glib::MainContext> main_context = Glib::MainContext::create();
+        g_main_context_push_thread_default(main_context->gobj());
+        m_mainLoop = Glib::MainLoop::create(main_context, false);
+        try
+        {
+            m_mount = GioTask<Glib::RefPtr<Gio::Mount>>::RunSync(findTask(),
+                                                                 m_mainLoop);
+        }
+        catch (const Glib::Error& ex)
+        {
+            // don't escalate error here
+            TRACE_WARNING("GvfsService::mounted()", "Glib::Error: %s",
+                          ex.what().c_str());
+            m_mount.reset();
+        }
+        g_main_context_pop_thread_default(main_context->gobj());
+    }
+    if (m_mount.operator->() != nullptr)
+    {
+        m_mountName = m_mount->get_name();
+        m_mountPath = m_file->get_path();
+        m_mountScheme = m_file->get_uri_scheme();
+        TRACE_DEBUG("GvfsService::mounted()", "name: %s path: %s scheme: %s",
+                    m_mountName.c_str(), m_mountPath.c_str(),
+                    m_mountScheme.c_str());
+    }
+    return (m_mount.operator->() != nullptr);
+}
 
-    m_file = Gio::File::create_for_parse_name(resPath);
-    Glib::RefPtr<Gio::Mount> l_mount;
-    try
+bool GvfsService::probe(const Glib::RefPtr<Gio::File>& file, unsigned int timeout)
+{
+    // какая-то операция в данном экземпляре уже запущена
+    if (m_mainLoop && m_mainLoop->is_running()) return false;
+    Metrics::Scope scope(Metrics::Keepalive);
+    m_exception.reset();
+
+    m_file = file;
+    if (MountBackend::Installed())
     {
-        m_file->find_enclosing_mount_async([&l_mount, this] (Glib::RefPtr<Gio::AsyncResult>& result)
-                                           {
-                                               l_mount = this->find_mount_cb(result);
-                                           });
-        m_mainLoop->run();
-        if (l_mount.operator->() != nullptr)
+        MountBackend::MountInfo info;
+        try
+        {
+            return MountBackend::Installed()->mounted(m_file->get_parse_name(),
+                                                      info);
+        }
+        catch (const GvfsServiceException& ex)
         {
-            m_mountName = l_mount->get_name();
-            m_mountPath = m_file->get_path();
-            m_mountScheme = m_file->get_uri_scheme();
-            std::cout << std::hex << std::this_thread::get_id() << std::dec
-                      << " GvfsService::mounted() name: " << m_mountName << std::endl
-                      << std::hex << std::this_thread::get_id() << std::dec
-                      << " GvfsService::mounted() path: " << m_mountPath << std::endl
-                      << std::hex << std::this_thread::get_id() << std::dec
-                      << " GvfsService::mounted() scheme: " << m_mountScheme << std::endl;
+            TRACE_WARNING("GvfsService::probe()", "error: %s", ex.what().c_str());
         }
+        return false;
+    }
+
+    // контекст операции, как и в mount(), чтобы не обрабатывать чужие
+    // события
+    Glib::RefPtr<Glib::MainContext> main_context = Glib::MainContext::create();
+    g_main_context_push_thread_default(main_context->gobj());
+    m_mainLoop = Glib::MainLoop::create(main_context, false);
+    bool alive = false;
+    try
+    {
+        GioTask<>::RunSync(probeTask(timeout), m_mainLoop);
+        alive = true;
     }
     catch (const Glib::Error& ex)
     {
-        std::cerr << std::hex << std::this_thread::get_id() << std::dec
-                  << " GvfsService::mounted() Glib::Error: "<< ex.what().raw()
-                  << std::endl;
-        l_mount.reset();
+        TRACE_WARNING("GvfsService::probe()", "%s: %s",
+                      m_file->get_parse_name().c_str(), ex.what().c_str());
     }
-    // don't escalate error here
+    g_main_context_pop_thread_default(main_context->gobj());
+    return alive;
+}
+
+GioTask<bool> GvfsService::umountTask(Glib::RefPtr<Gio::MountOperation> mount_operation)
+{
+    // точка монтирования неизвестна, ищем ее
+    if (m_mount.operator->() == nullptr) m_mount = co_await findTask();
+    if (m_mount.operator->() == nullptr) co_return false;
+    co_return co_await AwaitUnmount(m_mount, mount_operation, m_forceUnmount);
+}
+
+GioTask<Glib::RefPtr<Gio::Mount>> GvfsService::findTask()
+{
+    co_return co_await AwaitFindMount(m_file);
+}
+
+GioTask<> GvfsService::probeTask(unsigned int timeout)
+{
+    co_await AwaitFilesystemInfo(m_file, timeout);
+}
+
+bool GvfsService::reachable(const Glib::RefPtr<Gio::File>& file, unsigned int timeout)
+{
+    // какая-то операция в данном экземпляре уже запущена
+    if (m_mainLoop && m_mainLoop->is_running()) return false;
     m_exception.reset();
-    return (l_mount.operator->() != nullptr);
+
+    m_file = file;
+    // контекст операции, как и в mount()
+    Glib::RefPtr<Glib::MainContext> main_context = Glib::MainContext::create();
+    g_main_context_push_thread_default(main_context->gobj());
+    m_mainLoop = Glib::MainLoop::create(main_context, false);
+    bool connected = false;
+    try
+    {
+        connected = GioTask<bool>::RunSync(reachTask(timeout), m_mainLoop);
+    }
+    catch (const Glib::Error& ex)
+    {
+        m_exception = std::make_shared<GvfsServiceException>(ex.domain(),
+                                       ex.code(), ex.what());
+    }
+    g_main_context_pop_thread_default(main_context->gobj());
+    if (m_exception.get() != nullptr) throw *m_exception;
+    return connected;
+}
+
+GioTask<bool> GvfsService::reachTask(unsigned int timeout)
+{
+    std::wstring url(StrMB2Wide(m_file->get_uri()));
+    std::wstring port(MountPoint::UrlPort(url));
+    // порт протокола неизвестен, например, у локального ресурса
+    if (port.empty()) co_return false;
+    // ssh соединяется не с узлом и портом из URL, а куда укажет ssh_config
+    if ((MountPoint::UrlProto(url) == MountPoint::EProtocol::Sftp) &&
+        HostListReader::SshRedirects(MountPoint::UrlHost(url)))
+        co_return false;
+    std::string address(StrWide2MB(MountPoint::UrlHost(url) + L":" + port));
+    Trace::Span span("connect", address);
+    try
+    {
+        co_return co_await AwaitConnect(address, timeout, m_cancellable);
+    }
+    catch (const GvfsServiceException& ex)
+    {
+        TRACE_WARNING("GvfsService::reachTask()", "%s: %s", address.c_str(),
+                      ex.what().c_str());
+        if ((ex.domain() == G_IO_ERROR) && (ex.code() == G_IO_ERROR_CANCELLED))
+            throw;
+        Metrics::Instance().increment(Metrics::UnreachableHosts);
+        // в сообщении оператору должно быть видно, какой сервер недоступен
+        throw GvfsServiceException(ex.domain(), ex.code(),
+                                   address + ": " + ex.what().c_str());
+    }
 }
 
 #ifdef USE_GIO_MOUNTOPERATION_ONLY
@@ -374,27 +355,46 @@ void GvfsService::on_ask_question(Glib::RefPtr<Gio::MountOperation>& mount_opera
                                   const Glib::ustring& msg,
                                   const std::vector<Glib::ustring>& choices)
 {
-#ifndef NDEBUG
-    std::cout << std::hex << std::this_thread::get_id() << std::dec
-              << " on signal_ask_question: " << msg.raw() << std::endl
-              << std::hex << std::this_thread::get_id() << std::dec
-              << " choices:" << std::endl;
-    int i = 0;
-    for (const auto& choice : choices)
-        std::cout << i++ << " " << choice.raw() << std::endl;
-#endif // NDEBUG
+    Trace::Span span("GvfsService::on_ask_question()", msg.raw());
+    if (Trace::Enabled(Trace::Debug))
+    {
+        int i = 0;
+        for (const auto& choice : choices)
+            Trace::Event(Trace::Debug, "GvfsService::on_ask_question()",
+                         "choice %d: %s", i++, choice.c_str());
+    }
+    int shared;
+    // тот же вопрос о том же узле уже задавался, например, о ключе SSH
+    if (CredentialCache::Instance().answer(m_file->get_uri(), msg.raw(), shared))
+    {
+        Metrics::Instance().increment(Metrics::SharedAnswers);
+        mount_operation->set_choice(shared);
+        mount_operation->reply(Gio::MOUNT_OPERATION_HANDLED);
+        return;
+    }
     if (m_uiCallbacks)
         {
             int answer = mount_operation->get_choice();
             m_uiCallbacks->onAskQuestion(msg, choices, answer);
             if (answer != -1)
                 {
+                    CredentialCache::Instance().storeAnswer(m_file->get_uri(),
+                                                            msg.raw(), answer);
                     mount_operation->set_choice(answer);
                     mount_operation->reply(Gio::MOUNT_OPERATION_HANDLED);
                 }
                 else mount_operation->reply(Gio::MOUNT_OPERATION_ABORTED);
         }
-        else mount_operation->reply(Gio::MOUNT_OPERATION_HANDLED);
+        else
+        {
+            // Спросить некого (фоновое монтирование): ответ по умолчанию
+            // мог бы, например, принять неизвестный ключ узла SSH. GVFS
+            // завершит монтирование ошибкой G_IO_ERROR_FAILED_HANDLED,
+            // которая не повторяется (см. GvfsServiceException::isTransient()).
+            TRACE_INFO("GvfsService::on_ask_question()",
+                       "no one to answer, aborted");
+            mount_operation->reply(Gio::MOUNT_OPERATION_ABORTED);
+        }
 }
 
 void GvfsService::on_ask_password(Glib::RefPtr<Gio::MountOperation>& mount_operation,
@@ -403,26 +403,16 @@ void GvfsService::on_ask_password(Glib::RefPtr<Gio::MountOperation>& mount_opera
                                   const Glib::ustring& defaultdomain,
                                   Gio::AskPasswordFlags flags)
 {
-#ifndef NDEBUG
-    std::cout << std::hex << std::this_thread::get_id() << std::dec
-              << " Gvfs on signal_ask_password ask password: "
-              << msg.raw() << std::endl
-              << std::hex << std::this_thread::get_id() << std::dec
-              << " Gvfs on signal_ask_password default user: "
-              << defaultUser.raw() << std::endl
-              << std::hex << std::this_thread::get_id() << std::dec
-              << " Gvfs on signal_ask_password default domain: "
-              << defaultdomain.raw() << std::endl;
-#endif // NDEBUG
+    Trace::Span span("GvfsService::on_ask_password()", msg.raw());
+    TRACE_DEBUG("GvfsService::on_ask_password()",
+                "default user: %s default domain: %s", defaultUser.c_str(),
+                defaultdomain.c_str());
 
     if ((flags & G_ASK_PASSWORD_ANONYMOUS_SUPPORTED) &&
         mount_operation->get_username().empty() &&
         mount_operation->get_password().empty())
     {
-#ifndef NDEBUG
-        std::cout << std::hex << std::this_thread::get_id() << std::dec
-                  << " Gvfs on signal_ask_password set anonymous" << std::endl;
-#endif // NDEBUG
+        TRACE_DEBUG("GvfsService::on_ask_password()", "set anonymous");
         mount_operation->set_anonymous(true);
     }
     else
@@ -430,26 +420,17 @@ void GvfsService::on_ask_password(Glib::RefPtr<Gio::MountOperation>& mount_opera
         // trigger functor for entering user credentials
         if (flags & G_ASK_PASSWORD_NEED_USERNAME)
         {
-#ifndef NDEBUG
-            std::cout << std::hex << std::this_thread::get_id() << std::dec
-                      << " Gvfs on signal_ask_password NEED USERNAME" << std::endl;
-#endif // NDEBUG
+            TRACE_DEBUG("GvfsService::on_ask_password()", "need user name");
             // trigger user name enter callback, call passwd functor
         }
         if (flags & G_ASK_PASSWORD_NEED_DOMAIN)
         {
-#ifndef NDEBUG
-            std::cout << std::hex << std::this_thread::get_id() << std::dec
-                      << " Gvfs on signal_ask_password NEED DOMAIN" << std::endl;
-#endif // NDEBUG
+            TRACE_DEBUG("GvfsService::on_ask_password()", "need domain");
             // trigger domain name enter callback, call passwd functor
         }
         if (flags & G_ASK_PASSWORD_NEED_PASSWORD)
         {
-#ifndef NDEBUG
-            std::cout << std::hex << std::this_thread::get_id() << std::dec
-                      << " Gvfs on signal_ask_password NEED PASSWORD" << std::endl;
-#endif // NDEBUG
+            TRACE_DEBUG("GvfsService::on_ask_password()", "need password");
             // trigger password name enter callback, call passwd functor
         }
     }
@@ -459,35 +440,48 @@ void GvfsService::on_ask_password(Glib::RefPtr<Gio::MountOperation>& mount_opera
 #else // USE_GIO_MOUNTOPERATION_ONLY
 
 void GvfsService::on_ask_question(GMountOperation* op, char* message,
-                                  char** choices, gpointer user_data)
+                                  char** choices)
 {
-    (void)user_data;
-#ifndef NDEBUG
-    std::cout << std::hex << std::this_thread::get_id() << std::dec
-              << " on signal_ask_question: " << message << std::endl
-              << std::hex << std::this_thread::get_id() << std::dec
-              << " choices:" << std::endl;
-    int i = 0;
-    char** choice = choices;
-    while (*choice)
+    Trace::Span span("GvfsService::on_ask_question()", message);
+    if (Trace::Enabled(Trace::Debug))
     {
-        std::cout << i << " " << *choice << std::endl;
-        i++;
-        choice++;
+        int i = 0;
+        for (char** choice = choices; *choice; choice++)
+            Trace::Event(Trace::Debug, "GvfsService::on_ask_question()",
+                         "choice %d: %s", i++, *choice);
+    }
+    int shared;
+    // тот же вопрос о том же узле уже задавался, например, о ключе SSH
+    if (CredentialCache::Instance().answer(m_file->get_uri(), message, shared))
+    {
+        Metrics::Instance().increment(Metrics::SharedAnswers);
+        g_mount_operation_set_choice(op, shared);
+        g_mount_operation_reply(op, G_MOUNT_OPERATION_HANDLED);
+        return;
     }
-#endif // NDEBUG
     if (m_uiCallbacks)
         {
             int answer = g_mount_operation_get_choice(op);
             m_uiCallbacks->onAskQuestion(message, choices, answer);
             if (answer != -1)
                 {
+                    CredentialCache::Instance().storeAnswer(m_file->get_uri(),
+                                                            message, answer);
                     g_mount_operation_set_choice(op, answer);
                     g_mount_operation_reply(op, G_MOUNT_OPERATION_HANDLED);
                 }
                 else g_mount_operation_reply(op, G_MOUNT_OPERATION_ABORTED);
         }
-        else g_mount_operation_reply(op, G_MOUNT_OPERATION_HANDLED);
+        else
+        {
+            // Спросить некого (фоновое монтирование): ответ по умолчанию
+            // мог бы, например, принять неизвестный ключ узла SSH. GVFS
+            // завершит монтирование ошибкой G_IO_ERROR_FAILED_HANDLED,
+            // которая не повторяется (см. GvfsServiceException::isTransient()).
+            TRACE_INFO("GvfsService::on_ask_question()",
+                       "no one to answer, aborted");
+            g_mount_operation_reply(op, G_MOUNT_OPERATION_ABORTED);
+        }
 }
 
 void GvfsService::on_ask_password(GMountOperation* op, const char* message,
@@ -495,25 +489,16 @@ void GvfsService::on_ask_password(GMountOperation* op, const char* message,
                                   const char* default_domain,
                                   GAskPasswordFlags flags)
 {
-#ifndef NDEBUG
-    std::cout << std::hex << std::this_thread::get_id() << std::dec
-              << " Gvfs on signal_ask_password ask password: "
-              << message << std::endl
-              << std::hex << std::this_thread::get_id() << std::dec
-              << " Gvfs on signal_ask_password default user: "
-              << default_user << std::endl
-              << std::hex << std::this_thread::get_id() << std::dec
-              << " Gvfs on signal_ask_password default domain: "
-              << default_domain << std::endl;
-#endif // NDEBUG
+    Trace::Span span("GvfsService::on_ask_password()", message ? message : "");
+    TRACE_DEBUG("GvfsService::on_ask_password()",
+                "default user: %s default domain: %s",
+                default_user ? default_user : "",
+                default_domain ? default_domain : "");
     if ((flags & G_ASK_PASSWORD_ANONYMOUS_SUPPORTED) &&
         (g_mount_operation_get_username(op) == nullptr) &&
         (g_mount_operation_get_password(op) == nullptr))
     {
-#ifndef NDEBUG
-        std::cout << std::hex << std::this_thread::get_id() << std::dec
-                  << " Gvfs on signal_ask_password set anonymous" << std::endl;
-#endif // NDEBUG
+        TRACE_DEBUG("GvfsService::on_ask_password()", "set anonymous");
         g_mount_operation_set_anonymous(op, true);
     }
     g_mount_operation_reply(op, G_MOUNT_OPERATION_HANDLED);
@@ -523,70 +508,152 @@ void GvfsService::on_ask_password(GMountOperation* op, const char* message,
 
 void GvfsService::on_aborted(Glib::RefPtr<Gio::MountOperation>& mount_operation)
 {
-std::cout << std::hex << std::this_thread::get_id() << std::dec
-<< " on signal_aborted" << std::endl;
+    TRACE_WARNING("GvfsService::on_aborted()", "mount operation aborted");
 }
 
-void GvfsService::mount_cb(Glib::RefPtr<Gio::AsyncResult>& result)
+GioTask<Glib::RefPtr<Gio::Mount>>
+GvfsService::mountTask(Glib::RefPtr<Gio::MountOperation> mount_operation)
 {
-#ifndef NDEBUG
-    std::cout << std::hex << std::this_thread::get_id() << std::dec
-              << " GvfsService::mount_cb()" << std::endl;
-#endif // NDEBUG
-    try
+    // Недоступный сервер отклоняется за доли секунды, а не по истечении
+    // системного времени соединения внутри GVFS. Проверка -- одна, до
+    // повторов: ее ошибка завершает монтирование сразу, иначе быстрый отказ
+    // растянулся бы на все попытки политики повтора.
+    if (m_connectTimeout > 0) co_await reachTask(m_connectTimeout);
+    for (unsigned int attempt = 1; ; attempt++)
     {
-        m_file->mount_enclosing_volume_finish(result);
+        std::shared_ptr<GvfsServiceException> mountError, findError;
+        try
+        {
+            // рукопожатие с сервером и, если нужно, запрос пароля
+            Trace::Span span("mount_enclosing_volume", std::to_string(attempt));
+            co_await AwaitMount(m_file, mount_operation, m_cancellable);
+        }
+        catch (const GvfsServiceException& ex)
+        {
+            TRACE_ERROR("GvfsService::mountTask()", "Glib::Error: %s",
+                        ex.what().c_str());
+            mountError = std::make_shared<GvfsServiceException>(ex);
+        }
+        // Если адрес уже подключен (пользователь завел два ресурса про один
+        // и тот же сервер), то точка монтирования будет найдена, и ошибка
+        // "already mount" будет проигнорирована, что правильно. В случае
+        // других ошибок монтирования точки монтирования нет.
+        Glib::RefPtr<Gio::Mount> mount;
+        checkCancelled();
+        try
+        {
+            Trace::Span span("find_enclosing_mount", std::to_string(attempt));
+            mount = co_await AwaitFindMount(m_file, m_cancellable);
+        }
+        catch (const GvfsServiceException& ex)
+        {
+            findError = std::make_shared<GvfsServiceException>(ex);
+        }
+        if (mount.operator->() != nullptr) co_return mount;
+        if (mountError.get() == nullptr)
+        {
+            if (findError.get() == nullptr) co_return mount;
+            mountError = findError;
+        }
+        if (!mountError->isTransient() || (attempt >= m_retryPolicy.attempts))
+            throw *mountError;
+        unsigned int delay = Backoff::Delay(attempt, m_retryPolicy.delay,
+                                            m_retryPolicy.maxDelay);
+        Metrics::Instance().increment(Metrics::MountRetries);
+        TRACE_INFO("GvfsService::mountTask()", "retry %u in %u ms", attempt,
+                   delay);
+        if (m_uiCallbacks)
+            m_uiCallbacks->onMountRetry(attempt + 1, m_retryPolicy.attempts,
+                                        delay, mountError->what());
+        co_await AwaitDelay(delay);
+        checkCancelled();
     }
-    catch (const Glib::Error& ex)
+}
+
+void GvfsService::checkCancelled() const
+{
+    // отмена между асинхронными операциями: find_enclosing_mount мог бы
+    // найти точку монтирования, которую GVFS все-таки успел подсоединить
+    if (m_cancellable && m_cancellable->is_cancelled())
+        throw GvfsServiceException(G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                                   "mount cancelled");
+}
+
+bool GvfsService::backendMount(MountBackend& backend,
+                               const std::string &userName,
+                               const std::string &password)
+{
+    MountBackend::MountInfo info;
+    for (unsigned int attempt = 1; ; attempt++)
     {
-        std::cerr << std::hex << std::this_thread::get_id() << std::dec
-                  << " GvfsService::mount_cb() Glib::Error: "<< ex.what().raw()
-                  << std::endl;
-        // fill exception
-        m_exception = std::make_shared<GvfsServiceException>(ex.domain(), ex.code(), ex.what());
+        try
+        {
+            if (!backend.mount(m_file->get_parse_name(), userName, password, info))
+            {
+                Metrics::Instance().increment(Metrics::MountFailures);
+                return false;
+            }
+            break;
+        }
+        catch (const GvfsServiceException& ex)
+        {
+            if (!ex.isTransient() || (attempt >= m_retryPolicy.attempts))
+            {
+                Metrics::Instance().increment(Metrics::MountFailures);
+                throw;
+            }
+            unsigned int delay = Backoff::Delay(attempt, m_retryPolicy.delay,
+                                                m_retryPolicy.maxDelay);
+            Metrics::Instance().increment(Metrics::MountRetries);
+            if (m_uiCallbacks)
+                m_uiCallbacks->onMountRetry(attempt + 1, m_retryPolicy.attempts,
+                                            delay, ex.what());
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        }
     }
-    m_mainLoop->quit();
+    assignInfo(info);
+    return true;
 }
 
-bool GvfsService::unmount_cb(Glib::RefPtr<Gio::AsyncResult> &result)
+bool GvfsService::backendUmount(MountBackend& backend)
 {
-    Glib::RefPtr<Gio::Mount> mount = Glib::RefPtr<Gio::Mount>::cast_dynamic(result->get_source_object_base());
-    bool success = false;
+    bool l_unmounted = false;
     try
     {
-        success = mount->unmount_finish(result);
+        l_unmounted = backend.unmount(m_file->get_parse_name());
     }
-    catch (const Glib::Error& ex)
+    catch (const GvfsServiceException&)
     {
-        std::cerr << std::hex << std::this_thread::get_id() << std::dec
-                  << " GvfsService::unmount_cb() Glib::Error: "<< ex.what().raw()
-                  << std::endl;
-        // fill exception
-        m_exception = std::make_shared<GvfsServiceException>(ex.domain(), ex.code(), ex.what());
+        assignInfo(MountBackend::MountInfo());
+        Metrics::Instance().increment(Metrics::UnmountFailures);
+        throw;
     }
-    m_mainLoop->quit();
-    return success;
+    if (l_unmounted) assignInfo(MountBackend::MountInfo());
+    return l_unmounted;
 }
 
-Glib::RefPtr<Gio::Mount> GvfsService::find_mount_cb(Glib::RefPtr<Gio::AsyncResult>& result)
+bool GvfsService::backendMounted(MountBackend& backend)
 {
-#ifndef NDEBUG
-    std::cout << std::hex << std::this_thread::get_id() << std::dec
-              << " GvfsService::find_mount_cb()" << std::endl;
-#endif // NDEBUG
-    Glib::RefPtr<Gio::Mount> l_mount;
+    MountBackend::MountInfo info;
+    bool l_mounted = false;
     try
     {
-        l_mount = m_file->find_enclosing_mount_finish(result);
+        l_mounted = backend.mounted(m_file->get_parse_name(), info);
     }
-    catch (const Glib::Error& ex)
+    catch (const GvfsServiceException& ex)
     {
-        std::cerr << std::hex << std::this_thread::get_id() << std::dec
-                  << " GvfsService::find_mount_cb() Glib::Error: "
-                  << ex.what().raw() << std::endl;
-        // fill exception
-        m_exception = std::make_shared<GvfsServiceException>(ex.domain(), ex.code(), ex.what());
+        TRACE_WARNING("GvfsService::backendMounted()", "error: %s",
+                      ex.what().c_str());
     }
-    m_mainLoop->quit();
-    return l_mount;
+    // don't escalate error here
+    assignInfo(l_mounted ? info : MountBackend::MountInfo());
+    return l_mounted;
+}
+
+void GvfsService::assignInfo(const MountBackend::MountInfo& info)
+{
+    m_mount.reset();
+    m_mountName = info.name;
+    m_mountPath = info.path;
+    m_mountScheme = info.scheme;
 }
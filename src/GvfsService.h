@@ -6,7 +6,9 @@
 #include <vector>
 #include <gtkmm.h>
 #include "glibmmconf.h"
+#include "GioTask.h"
 #include "GvfsServiceException.h"
+#include "MountBackend.h"
 
 class UiCallbacks;
 
@@ -27,6 +29,29 @@ class UiCallbacks;
 class GvfsService
 {
 public:
+    ///
+    /// @brief Политика повтора монтирования после временных ошибок.
+    ///
+    /// Задержка перед n-м повтором -- delay * 2^(n-1), но не более maxDelay,
+    /// со случайным разбросом в пределах ее второй половины, чтобы
+    /// одновременные повторы не приходили на сервер разом. Временные ошибки
+    /// определяет GvfsServiceException::isTransient().
+    ///
+    struct RetryPolicy
+    {
+        unsigned int attempts; ///< Число попыток, включая первую.
+        unsigned int delay; ///< Задержка перед первым повтором, мс.
+        unsigned int maxDelay; ///< Предельная задержка, мс.
+
+        ///
+        /// Конструктор.
+        ///
+        /// По умолчанию повторов нет.
+        ///
+        RetryPolicy(unsigned int a = 1, unsigned int d = 0, unsigned int md = 0):
+            attempts(a), delay(d), maxDelay(md) {}
+    };
+
     ///
     /// Конструктор.
     ///
@@ -39,6 +64,51 @@ public:
     ///
     GvfsService(UiCallbacks* uic = nullptr);
 
+    ///
+    /// Назначить политику повтора монтирования.
+    ///
+    /// @param [in] policy Политика повтора.
+    /// @return Ссылка на данный экземпляр класса.
+    ///
+    inline GvfsService& setRetryPolicy(const RetryPolicy& policy)
+    { m_retryPolicy = policy; return *this; }
+    ///
+    /// Назначить объект отмены монтирования.
+    ///
+    /// @param [in] cancellable Объект отмены.
+    /// @return Ссылка на данный экземпляр класса.
+    ///
+    /// Отмена (Gio::Cancellable::cancel()) допускается из любого потока.
+    /// Отмененное монтирование, в том числе в паузе между повторами,
+    /// завершается исключением GvfsServiceException с кодом
+    /// G_IO_ERROR_CANCELLED.
+    ///
+    inline GvfsService& setCancellable(const Glib::RefPtr<Gio::Cancellable>& cancellable)
+    { m_cancellable = cancellable; return *this; }
+    ///
+    /// Назначить принудительное отсоединение.
+    ///
+    /// @param [in] force Отсоединять, даже если точка монтирования занята
+    ///                   или сервер не отвечает (G_MOUNT_UNMOUNT_FORCE).
+    /// @return Ссылка на данный экземпляр класса.
+    ///
+    inline GvfsService& setForceUnmount(bool force)
+    { m_forceUnmount = force; return *this; }
+    ///
+    /// Назначить проверку доступности сервера перед монтированием.
+    ///
+    /// @param [in] timeout Предельное время соединения TCP с сервером, мс;
+    ///                     0 -- не проверять (по умолчанию).
+    /// @return Ссылка на данный экземпляр класса.
+    ///
+    /// Перед монтированием устанавливается соединение TCP с портом
+    /// протокола на сервере ресурса (см. reachable()). Если сервер
+    /// недоступен, монтирование не начинается и не повторяется: ошибка
+    /// соединения сразу пробрасывается.
+    ///
+    inline GvfsService& setConnectTimeout(unsigned int timeout)
+    { m_connectTimeout = timeout; return *this; }
+
     ///
     /// Имя подмонтированного ресурса.
     ///
@@ -64,31 +134,46 @@ public:
     /// Если ресурс не подмонтирован -- пустая строка.
     ///
     inline const std::string& getMountScheme() const { return m_mountScheme; }
+    ///
+    /// Точка монтирования GIO, содержащая ресурс.
+    ///
+    /// @return Указатель на экземпляр Gio::Mount.
+    ///
+    /// Если ресурс не подмонтирован -- пустой указатель. Указатель можно
+    /// сохранить и передавать в umount() и mounted() для того же ресурса.
+    ///
+    inline const Glib::RefPtr<Gio::Mount>& getMount() const { return m_mount; }
 
     ///
     /// Подсоединить указанный ресурс.
     ///
-    /// @param [in] resPath URL ресурса.
+    /// @param [in] file Ресурс (разобранный URL).
     /// @param [in] userName Имя пользователя для аутентификации на ресурсе.
     /// @param [in] password Пароль для аутентификации на ресурсе.
     /// @return Результат операции.
     /// @throw GvfsServiceException
     ///
     /// В случае неудачного завершения операции порождает исключение
-    /// GvfsServiceException.
+    /// GvfsServiceException. Временные ошибки монтирования повторяются
+    /// согласно политике повтора (см. setRetryPolicy()), о каждом повторе
+    /// сообщается через UiCallbacks::onMountRetry().
     ///
     /// В случае успеха заполняются свойства "имя ресурса", "путь к ресурсу"
-    /// и "схема из URI ресурса".
+    /// и "схема из URI ресурса", а также точка монтирования GIO (см.
+    /// getMount()). Монтирование и поиск точки монтирования выполняются
+    /// сопрограммой mountTask() в главном цикле операции.
     ///
     /// Если в данном экземпляре уже запущена другая операция, немедленно
     /// возвращает false (для использования в будущем).
     ///
-    bool mount(const std::string& resPath, const std::string &userName,
+    bool mount(const Glib::RefPtr<Gio::File>& file, const std::string &userName,
                const std::string &password);
     ///
     /// Отсоединить указанный ресурс.
     ///
-    /// @param [in] resPath URL ресурса.
+    /// @param [in] file Ресурс (разобранный URL).
+    /// @param [in] mount Точка монтирования GIO, содержащая ресурс, если она
+    ///                   известна вызывающему коду.
     /// @return Результат операции.
     /// @throw GvfsServiceException
     ///
@@ -103,23 +188,83 @@ public:
     /// свойства "имя ресурса", "путь к ресурсу" и "схема из URI ресурса"
     /// сбрасываются.
     ///
+    /// Если mount не задана, она ищется асинхронно по file. Поиск и
+    /// отсоединение выполняются сопрограммой umountTask() в главном цикле
+    /// операции.
+    ///
+    /// Ресурс с разорванным сеансом связи можно отсоединить только
+    /// принудительно (см. setForceUnmount()).
+    ///
     /// Если в данном экземпляре уже запущена другая операция, немедленно
     /// возвращает false (для использования в будущем).
     ///
-    bool umount(const std::string& resPath);
+    bool umount(const Glib::RefPtr<Gio::File>& file,
+                const Glib::RefPtr<Gio::Mount>& mount);
     ///
     /// Проверить статус, наличие соединения, ресурса.
     ///
-    /// @param [in] resPath URL ресурса.
+    /// @param [in] file Ресурс (разобранный URL).
+    /// @param [in] mount Точка монтирования GIO, содержащая ресурс, если она
+    ///                   известна вызывающему коду.
     /// @return Результат операции.
     ///
     /// В случае, если ресурс подсоединен, заполняются свойства "имя
-    /// ресурса", "путь к ресурсу" и "схема из URI ресурса".
+    /// ресурса", "путь к ресурсу" и "схема из URI ресурса", а также точка
+    /// монтирования GIO.
+    ///
+    /// Известная точка монтирования считается действующей без обращения к
+    /// GVFS: ее актуальность поддерживает вызывающий код по событиям
+    /// GvfsServiceMonitor. Иначе точка монтирования ищется асинхронно,
+    /// сопрограммой findTask() в главном цикле операции.
+    ///
+    /// Если в данном экземпляре уже запущена другая операция, немедленно
+    /// возвращает false (для использования в будущем).
+    ///
+    bool mounted(const Glib::RefPtr<Gio::File>& file,
+                 const Glib::RefPtr<Gio::Mount>& mount);
+    ///
+    /// Проверить, что сеанс связи с подсоединенным ресурсом жив.
+    ///
+    /// @param [in] file Ресурс (разобранный URL).
+    /// @param [in] timeout Предельное время ожидания ответа, мс.
+    /// @return Ресурс ответил вовремя.
+    ///
+    /// В отличие от mounted(), который доверяет известной точке
+    /// монтирования, запрашивает у GVFS сведения о файловой системе ресурса
+    /// (см. AwaitFilesystemInfo), на что демон GVFS обращается к серверу.
+    /// Ошибки не пробрасываются, а трактуются как разорванный сеанс.
+    ///
+    /// При установленной реализации MountBackend вместо запроса вызывается
+    /// MountBackend::mounted().
     ///
     /// Если в данном экземпляре уже запущена другая операция, немедленно
     /// возвращает false (для использования в будущем).
     ///
-    bool mounted(const std::string& resPath);
+    bool probe(const Glib::RefPtr<Gio::File>& file, unsigned int timeout);
+    ///
+    /// Проверить, что сервер ресурса принимает соединения.
+    ///
+    /// @param [in] file Ресурс (разобранный URL).
+    /// @param [in] timeout Предельное время соединения, мс.
+    /// @return Соединение установлено; false, если проверка не состоялась.
+    /// @throw GvfsServiceException
+    ///
+    /// Узел и порт берутся из URL ресурса (см. MountPoint::UrlHost(),
+    /// MountPoint::UrlPort()), соединение TCP устанавливается без участия
+    /// GVFS (см. AwaitConnect) и сразу закрывается. Если сервер отказал в
+    /// соединении или не ответил вовремя, порождает исключение
+    /// GvfsServiceException с адресом сервера в сообщении. Если порт
+    /// протокола неизвестен, имя узла не удалось разрешить или ssh
+    /// соединяется с узлом ресурса SFTP по своей конфигурации (см.
+    /// HostListReader::SshRedirects()), возвращает false: о доступности
+    /// такого сервера судить GVFS.
+    ///
+    /// Установленная реализация MountBackend на проверку не влияет.
+    ///
+    /// Если в данном экземпляре уже запущена другая операция, немедленно
+    /// возвращает false (для использования в будущем).
+    ///
+    bool reachable(const Glib::RefPtr<Gio::File>& file, unsigned int timeout);
 
 private:
 
@@ -139,9 +284,13 @@ private:
     /// в операцию монтирования. Если пользователь откзывается от выбора,
     /// процедура прерывается.
     ///
-    /// Если свойство m_uiCallbacks не заполнено, процедура продолжается
-    /// таким образом, как будто выбран вариант по умолчанию - первый из
-    /// предложенных.
+    /// Если свойство m_uiCallbacks не заполнено и ответа в CredentialCache
+    /// нет, процедура прерывается: вариант по умолчанию мог бы, например,
+    /// принять неизвестный ключ узла SSH.
+    ///
+    /// Ответ оператора запоминается в CredentialCache; на тот же вопрос о
+    /// том же узле при монтировании другого ресурса отвечается без
+    /// оператора.
     ///
     void on_ask_question(Glib::RefPtr<Gio::MountOperation>& mount_operation,
                          const Glib::ustring& msg,
@@ -168,7 +317,7 @@ private:
                          Gio::AskPasswordFlags flags);
 #else
 // "Смешанные" слоты обработки сигналов. Слоты регистрируются через
-// C-интерфейс glib, подробнее см. в GvfsService.cpp.
+// C-интерфейс glib с помощью GlibTrampoline, подробнее см. в GvfsService.cpp.
 
     ///
     /// Слот обработки сигнала "ask question" в процедуре монтирования.
@@ -176,19 +325,21 @@ private:
     /// @param [in] op Текущая операция монтирования.
     /// @param [in] message Сообщение (вопрос) пользователю.
     /// @param [in] choices Варианты ответа.
-    /// @param [in] user_data Расширенные данные (не используется).
     ///
     /// Через указатель на экземпляр класса UiCallbacks вопрос и варианты
     /// ответа отображаются пользователю, а выбранный вариант передается
     /// в операцию монтирования. Если пользователь откзывается от выбора,
     /// процедура монтирования прерывается.
     ///
-    /// Если свойство m_uiCallbacks не заполнено, процедура продолжается
-    /// таким образом, как будто выбран вариант по умолчанию -- первый из
-    /// предложенных.
+    /// Если свойство m_uiCallbacks не заполнено и ответа в CredentialCache
+    /// нет, процедура монтирования прерывается: вариант по умолчанию мог бы,
+    /// например, принять неизвестный ключ узла SSH.
+    ///
+    /// Ответ оператора запоминается в CredentialCache; на тот же вопрос о
+    /// том же узле при монтировании другого ресурса отвечается без
+    /// оператора.
     ///
-    void on_ask_question(GMountOperation* op, char* message, char** choices,
-                         gpointer user_data);
+    void on_ask_question(GMountOperation* op, char* message, char** choices);
     ///
     /// Слот обработки сигнала "ask password" в процедуре монтирования.
     ///
@@ -221,35 +372,84 @@ private:
     void on_aborted(Glib::RefPtr<Gio::MountOperation>& mount_operation);
 
     ///
-    /// Слот асинхронного завершения процедуры монтирования.
+    /// Сопрограмма монтирования ресурса #m_file.
+    ///
+    /// @param [in] mount_operation Текущая операция монтирования.
+    /// @return Точка монтирования, содержащая ресурс.
+    /// @throw GvfsServiceException
+    ///
+    /// Подсоединяет ресурс и затем ищет точку монтирования (см.
+    /// AwaitMount, AwaitFindMount). Если назначена проверка доступности
+    /// сервера (см. setConnectTimeout()), она выполняется один раз перед
+    /// первой попыткой, и ее ошибка не повторяется. Если ресурс уже был
+    /// подключен (ошибка "already mounted"), точка монтирования будет
+    /// найдена, и ошибка
+    /// проигнорирована. Временная ошибка монтирования повторяется после
+    /// задержки (см. AwaitDelay, Backoff::Delay()), пока не исчерпаны попытки.
+    /// Отмена (см. setCancellable()) проверяется после каждого шага.
+    /// Иначе пробрасывается ошибка монтирования.
     ///
-    /// @param [in] result Результат текущей операции.
+    GioTask<Glib::RefPtr<Gio::Mount>>
+    mountTask(Glib::RefPtr<Gio::MountOperation> mount_operation);
     ///
-    /// В случае возникновения исключения в слоте, оно транслируется в
-    /// GvfsServiceException и сохраняется в свойстве m_exception. Это
-    /// исключение будет проброшено в методе mount().
+    /// Сопрограмма проверки сеанса связи с ресурсом #m_file.
     ///
-    void mount_cb(Glib::RefPtr<Gio::AsyncResult>& result);
+    /// @param [in] timeout Предельное время ожидания ответа, мс.
+    /// @throw GvfsServiceException
+    ///
+    GioTask<> probeTask(unsigned int timeout);
+    ///
+    /// Сопрограмма отсоединения ресурса #m_file.
+    ///
+    /// @param [in] mount_operation Текущая операция отсоединения.
+    /// @return Отсоединен ресурс или нет.
+    /// @throw GvfsServiceException
     ///
-    /// Слот асинхронного завершения процедуры отмонтирования.
+    /// Если точка монтирования #m_mount неизвестна, сначала ищет ее (см.
+    /// findTask()); если ресурс не подсоединен, возвращает false. Затем
+    /// отсоединяет точку монтирования, принудительно, если так назначено
+    /// (см. setForceUnmount(), AwaitUnmount).
+    ///
+    GioTask<bool> umountTask(Glib::RefPtr<Gio::MountOperation> mount_operation);
+    ///
+    /// Сопрограмма поиска точки монтирования ресурса #m_file.
+    ///
+    /// @return Точка монтирования, содержащая ресурс; пустой указатель,
+    ///         если ресурс не подсоединен.
+    /// @throw GvfsServiceException
     ///
-    /// @param [in] result Результат текущей операции.
-    /// @return Отмонтирован ресурс или нет.
+    GioTask<Glib::RefPtr<Gio::Mount>> findTask();
     ///
-    /// В случае возникновения исключения в слоте, оно транслируется в
-    /// GvfsServiceException и сохраняется в свойстве m_exception. Это
-    /// исключение будет проброшено в методе umount().
+    /// Сопрограмма проверки доступности сервера ресурса #m_file.
+    ///
+    /// @param [in] timeout Предельное время соединения, мс.
+    /// @return Соединение установлено.
+    /// @throw GvfsServiceException
+    ///
+    GioTask<bool> reachTask(unsigned int timeout);
+    ///
+    /// Прервать монтирование, если оно отменено (см. setCancellable()).
+    ///
+    /// @throw GvfsServiceException
+    ///
+    void checkCancelled() const;
+
     ///
-    bool unmount_cb(Glib::RefPtr<Gio::AsyncResult>& result);
+    /// Операции mount(), umount() и mounted() через установленную реализацию
+    /// MountBackend (см. MountBackend::Install()) вместо GIO.
     ///
-    /// Слот асинхронного завершения проверки статуса ресурса.
+    /// Точка монтирования GIO при этом не заполняется. Повторы после
+    /// временных ошибок выполняются так же, как в mountTask(), но с
+    /// блокирующей задержкой.
     ///
-    /// @param [in] result Результат текущей операции.
-    /// @return Указатель на экземпляр Gio::Mount для искомого ресурса.
+    bool backendMount(MountBackend& backend, const std::string &userName,
+                      const std::string &password);
+    bool backendUmount(MountBackend& backend);
+    bool backendMounted(MountBackend& backend);
     ///
-    /// Если ресурс не смонтирован ранее, возвращает пустой указатель.
+    /// Заполнить свойства ресурса из свойств, сообщенных MountBackend.
     ///
-    Glib::RefPtr<Gio::Mount> find_mount_cb(Glib::RefPtr<Gio::AsyncResult>& result);
+    void assignInfo(const MountBackend::MountInfo& info);
 
     std::string m_mountName; ///< Свойство "имя ресурса" для текущего
                              ///< смонтированного ресурса.
@@ -258,9 +458,16 @@ private:
     std::string m_mountScheme; ///< Свойство "схема из URI ресурса" для
                                ///< текущего смонтированного ресурса.
     Glib::RefPtr<Gio::File> m_file; ///< Соответствует ресурсу текущей операции.
+    Glib::RefPtr<Gio::Mount> m_mount; ///< Точка монтирования GIO ресурса
+                                      ///< текущей операции.
     Glib::RefPtr<Glib::MainLoop> m_mainLoop; ///< Главный цикл glib.
     std::shared_ptr<GvfsServiceException> m_exception; ///< Исключение, возникшее
                                                        ///< в ходе процедуры
                                                        ///< монтирования/отмонтирования.
     UiCallbacks* m_uiCallbacks; ///< Обратные вызовы UI.
+    RetryPolicy m_retryPolicy; ///< Политика повтора монтирования.
+    Glib::RefPtr<Gio::Cancellable> m_cancellable; ///< Отмена монтирования.
+    bool m_forceUnmount; ///< Принудительное отсоединение.
+    unsigned int m_connectTimeout; ///< Время проверки доступности сервера,
+                                   ///< мс.
 };
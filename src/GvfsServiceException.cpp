@@ -0,0 +1,42 @@
+#include <gio/gio.h>
+#include "GvfsServiceException.h"
+
+bool GvfsServiceException::isTransient() const
+{
+  if (domain() == G_IO_ERROR)
+    switch (code())
+    {
+      case G_IO_ERROR_TIMED_OUT:
+      case G_IO_ERROR_BUSY:
+      case G_IO_ERROR_WOULD_BLOCK:
+      case G_IO_ERROR_HOST_UNREACHABLE:
+      case G_IO_ERROR_NETWORK_UNREACHABLE:
+      case G_IO_ERROR_CONNECTION_REFUSED:
+      case G_IO_ERROR_NOT_CONNECTED:
+      // G_IO_ERROR_CONNECTION_CLOSED -- синоним
+      case G_IO_ERROR_BROKEN_PIPE:
+        return true;
+      // вопрос при монтировании остался без ответа (нет оператора) или
+      // оператор отказался отвечать: повтор задаст тот же вопрос
+      case G_IO_ERROR_FAILED_HANDLED:
+        return false;
+      default:
+        return false;
+    }
+  // демон GVFS не ответил вовремя или перезапускается
+  if (domain() == G_DBUS_ERROR)
+    switch (code())
+    {
+      case G_DBUS_ERROR_NO_REPLY:
+      case G_DBUS_ERROR_TIMEOUT:
+      case G_DBUS_ERROR_TIMED_OUT:
+      case G_DBUS_ERROR_LIMITS_EXCEEDED:
+      case G_DBUS_ERROR_SERVICE_UNKNOWN:
+        return true;
+      default:
+        return false;
+    }
+  if (domain() == G_RESOLVER_ERROR)
+    return code() == G_RESOLVER_ERROR_TEMPORARY_FAILURE;
+  return false;
+}
@@ -29,4 +29,17 @@ class GvfsServiceException: public Glib::Error
     /// @param [in] other Копируемый экземпляр класса.
     ///
     GvfsServiceException(const GvfsServiceException& other): Error(other) {}
+
+    ///
+    /// Признак временной ошибки.
+    ///
+    /// @return Временная ошибка или постоянная.
+    ///
+    /// Временные ошибки (истечение времени ожидания, отказ в соединении,
+    /// недоступность сети, занятость демона GVFS и т.п.) могут исчезнуть
+    /// сами, и операцию имеет смысл повторить. Постоянные ошибки (неверный
+    /// пароль, отсутствие ресурса, отмена пользователем и т.п.) повтором не
+    /// исправляются. Неизвестные ошибки считаются постоянными.
+    ///
+    bool isTransient() const;
 };
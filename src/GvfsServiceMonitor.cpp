@@ -1,8 +1,10 @@
+#include <cstdlib>
 #include <functional>
-#include <iostream>
 #include <string>
 #include <vector>
+#include "Metrics.h"
 #include "Plugin.h"
+#include "Trace.h"
 #include "GvfsServiceMonitor.h"
 
 #ifndef USE_GIO_MOUNTOPERATION_ONLY
@@ -38,13 +40,15 @@ extern "C" void monitor_mount_pre_unmount_wrapper(GVolumeMonitor* volume_monitor
 GvfsServiceMonitor GvfsServiceMonitor::m_instance;
 
 GvfsServiceMonitor::GvfsServiceMonitor():
-  m_quit(false)
+  m_quit(false),
+  m_maxDepth(0)
 {
 }
 
 GvfsServiceMonitor::~GvfsServiceMonitor()
 {
-  if ((m_mainLoop.operator->() != nullptr) && m_mainLoop->is_running())
+  if ((m_backend.operator->() != nullptr) ||
+      ((m_mainLoop.operator->() != nullptr) && m_mainLoop->is_running()))
     quit();
 }
 
@@ -54,41 +58,31 @@ void GvfsServiceMonitor::onMountAdded(const Glib::RefPtr<Gio::Mount>& mount)
   std::string name, path, scheme;
   name = mount->get_name();
   Glib::RefPtr< const Gio::File > file = mount->get_root();
+  if (m_trace.is_open()) traceEvent("added", file->get_uri());
   path = file->get_path();
   scheme = file->get_uri_scheme();
 //  Glib::object_unref(file);
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountAdded() name: " << name << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountAdded() path: " << path << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountAdded() scheme: " << scheme << std::endl;
-#endif // NDEBUG
+  TRACE_DEBUG("GvfsServiceMonitor::onMountAdded()", "name: %s path: %s scheme: %s",
+              name.c_str(), path.c_str(), scheme.c_str());
   JobPtr job(new Job());
   job->mount = true;
-  m_jobs.put(job);
-  m_jobs.notify_one();
+  job->handle = mount;
+  enqueue(job);
 }
 
 void GvfsServiceMonitor::onMountRemoved(const Glib::RefPtr<Gio::Mount>& mount)
 {
   JobPtr job(new Job());
+  job->handle = mount;
   job->name = mount->get_name();
   Glib::RefPtr< const Gio::File > file = mount->get_root();
+  if (m_trace.is_open()) traceEvent("removed", file->get_uri());
   job->path = file->get_path();
   job->scheme = file->get_uri_scheme();
 //  Gio::File::object_unref(file);
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountRemoved() name: " << job->name << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountRemoved() path: " << job->path << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountRemoved() scheme: " << job->scheme << std::endl;
-#endif // NDEBUG
-  m_jobs.put(job);
-  m_jobs.notify_one();
+  TRACE_DEBUG("GvfsServiceMonitor::onMountRemoved()", "name: %s path: %s scheme: %s",
+              job->name.c_str(), job->path.c_str(), job->scheme.c_str());
+  enqueue(job);
 }
 
 void GvfsServiceMonitor::onMountChanged(const Glib::RefPtr<Gio::Mount>& mount)
@@ -96,17 +90,12 @@ void GvfsServiceMonitor::onMountChanged(const Glib::RefPtr<Gio::Mount>& mount)
   std::string name, path, scheme;
   name = mount->get_name();
   Glib::RefPtr< const Gio::File > file = mount->get_root();
+  if (m_trace.is_open()) traceEvent("changed", file->get_uri());
   path = file->get_path();
   scheme = file->get_uri_scheme();
 //  Gio::File::object_unref(file);
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountChanged() name: " << name << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountChanged() path: " << path << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountChanged() scheme: " << scheme << std::endl;
-#endif // NDEBUG
+  TRACE_DEBUG("GvfsServiceMonitor::onMountChanged()", "name: %s path: %s scheme: %s",
+              name.c_str(), path.c_str(), scheme.c_str());
 }
 
 void GvfsServiceMonitor::onMountPreunmount(const Glib::RefPtr<Gio::Mount>& mount)
@@ -117,14 +106,8 @@ void GvfsServiceMonitor::onMountPreunmount(const Glib::RefPtr<Gio::Mount>& mount
   path = file->get_path();
   scheme = file->get_uri_scheme();
 //  Gio::File::object_unref(file);
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountPreunmount name: " << name << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountPreunmount path: " << path << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountPreunmount scheme: " << scheme << std::endl;
-#endif // NDEBUG
+  TRACE_DEBUG("GvfsServiceMonitor::onMountPreunmount()", "name: %s path: %s scheme: %s",
+              name.c_str(), path.c_str(), scheme.c_str());
 }
 #else // USE_GIO_MOUNTOPERATION_ONLY
 void GvfsServiceMonitor::onMountAdded(GVolumeMonitor* monitor, GMount* mount)
@@ -146,26 +129,27 @@ void GvfsServiceMonitor::onMountAdded(GVolumeMonitor* monitor, GMount* mount)
       scheme = buffer;
       g_free(buffer);
     }
+    if (m_trace.is_open())
+    {
+      buffer = g_file_get_uri(file);
+      traceEvent("added", buffer);
+      g_free(buffer);
+    }
     g_object_unref(file);
   }
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountAdded() name: " << name << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountAdded() path: " << path << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountAdded() scheme: " << scheme << std::endl;
-#endif // NDEBUG
+  TRACE_DEBUG("GvfsServiceMonitor::onMountAdded()", "name: %s path: %s scheme: %s",
+              name.c_str(), path.c_str(), scheme.c_str());
   JobPtr job(new Job());
   job->mount = true;
-  m_jobs.put(job);
-  m_jobs.notify_one();
+  job->handle = Glib::wrap(mount, true);
+  enqueue(job);
 }
 
 void GvfsServiceMonitor::onMountRemoved(GVolumeMonitor* monitor, GMount* mount)
 {
   char* buffer = nullptr;
   JobPtr job(new Job());
+  job->handle = Glib::wrap(mount, true);
   buffer = g_mount_get_name(mount);
   job->name = buffer;
   g_free(buffer);
@@ -181,18 +165,17 @@ void GvfsServiceMonitor::onMountRemoved(GVolumeMonitor* monitor, GMount* mount)
       job->scheme = buffer;
       g_free(buffer);
     }
+    if (m_trace.is_open())
+    {
+      buffer = g_file_get_uri(file);
+      traceEvent("removed", buffer);
+      g_free(buffer);
+    }
     g_object_unref(file);
   }
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountRemoved() name: " << job->name << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountRemoved() path: " << job->path << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountRemoved() scheme: " << job->scheme << std::endl;
-#endif // NDEBUG
-  m_jobs.put(job);
-  m_jobs.notify_one();
+  TRACE_DEBUG("GvfsServiceMonitor::onMountRemoved()", "name: %s path: %s scheme: %s",
+              job->name.c_str(), job->path.c_str(), job->scheme.c_str());
+  enqueue(job);
 }
 
 void GvfsServiceMonitor::onMountChanged(GVolumeMonitor* monitor, GMount* mount)
@@ -214,16 +197,16 @@ void GvfsServiceMonitor::onMountChanged(GVolumeMonitor* monitor, GMount* mount)
       scheme = buffer;
       g_free(buffer);
     }
+    if (m_trace.is_open())
+    {
+      buffer = g_file_get_uri(file);
+      traceEvent("changed", buffer);
+      g_free(buffer);
+    }
     g_object_unref(file);
   }
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountChanged() name: " << name << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountChanged() path: " << path << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountChanged() scheme: " << scheme << std::endl;
-#endif // NDEBUG
+  TRACE_DEBUG("GvfsServiceMonitor::onMountChanged()", "name: %s path: %s scheme: %s",
+              name.c_str(), path.c_str(), scheme.c_str());
 }
 
 void GvfsServiceMonitor::onMountPreunmount(GVolumeMonitor* monitor,
@@ -248,24 +231,48 @@ void GvfsServiceMonitor::onMountPreunmount(GVolumeMonitor* monitor,
     }
     g_object_unref(file);
   }
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountPreunmount name: " << name << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountPreunmount path: " << path << std::endl
-            << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::onMountPreunmount scheme: " << scheme << std::endl;
-#endif // NDEBUG
+  TRACE_DEBUG("GvfsServiceMonitor::onMountPreunmount()", "name: %s path: %s scheme: %s",
+              name.c_str(), path.c_str(), scheme.c_str());
 }
 #endif // USE_GIO_MOUNTOPERATION_ONLY
 
+void GvfsServiceMonitor::onBackendEvent(bool mount,
+                                        const MountBackend::MountInfo& info)
+{
+  TRACE_DEBUG("GvfsServiceMonitor::onBackendEvent()", "%s %s %s",
+              mount ? "mount" : "unmount", info.name.c_str(), info.path.c_str());
+  JobPtr job(new Job());
+  job->mount = mount;
+  job->name = info.name;
+  job->path = info.path;
+  job->scheme = info.scheme;
+  enqueue(job);
+}
+
 void GvfsServiceMonitor::run()
 {
-  if ((m_mainLoop.operator->() != nullptr) && m_mainLoop->is_running())
+  using namespace std::placeholders;
+
+  if ((m_backend.operator->() != nullptr) ||
+      ((m_mainLoop.operator->() != nullptr) && m_mainLoop->is_running()))
     return;
-  // запускаем главный цикл монитора в отдельном потоке
-  m_thread = std::make_shared<std::thread>(std::bind(&GvfsServiceMonitor::loop,
-                                                     this));
+  const char* traceFile = std::getenv("GVFSPANEL_EVENT_TRACE");
+  if (traceFile && *traceFile && !m_trace.is_open())
+  {
+    m_trace.open(traceFile, std::ios::out | std::ios::app);
+    m_traceStart = std::chrono::steady_clock::now();
+  }
+  m_backend = MountBackend::Installed();
+  if (m_backend.operator->() != nullptr)
+    m_backend->subscribe(std::bind(&GvfsServiceMonitor::onBackendEvent, this,
+                                   _1, _2));
+    else
+    {
+      // запускаем главный цикл монитора в отдельном потоке
+      m_thread = std::make_shared<std::thread>(
+        std::bind(&GvfsServiceMonitor::loop, this)
+      );
+    }
   // запускаем обработчик сигналов в отдельном потоке
   m_quit = false;
   m_worker = std::make_shared<std::thread>(std::bind(&GvfsServiceMonitor::worker,
@@ -274,21 +281,27 @@ void GvfsServiceMonitor::run()
 
 void GvfsServiceMonitor::quit()
 {
-  if ((m_mainLoop.operator->() == nullptr) ||
-      ((m_mainLoop.operator->() != nullptr) && !m_mainLoop->is_running()))
-    return;
+  if (m_backend.operator->() != nullptr)
+  {
+    m_backend->unsubscribe();
+    m_backend.reset();
+  }
+  else
+  {
+    if ((m_mainLoop.operator->() == nullptr) ||
+        ((m_mainLoop.operator->() != nullptr) && !m_mainLoop->is_running()))
+      return;
+    m_mainLoop->quit();
+    m_thread->join();
+  }
   m_quit = true;
-  m_mainLoop->quit();
-  m_thread->join();
   m_worker->join();
+  if (m_trace.is_open()) m_trace.close();
 }
 
 void GvfsServiceMonitor::loop()
 {
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::loop() run" << std::endl;
-#endif // NDEBUG
+  TRACE_DEBUG("GvfsServiceMonitor::loop()", "run");
 #ifdef USE_GIO_MOUNTOPERATION_ONLY
   using namespace std::placeholders;
   // извлекаем указатель на Volume Monitor
@@ -342,18 +355,12 @@ void GvfsServiceMonitor::loop()
   g_object_unref(monitor);
   monitor = nullptr;
 #endif // USE_GIO_MOUNTOPERATION_ONLY
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::loop() end" << std::endl;
-#endif //
+  TRACE_DEBUG("GvfsServiceMonitor::loop()", "end");
 }
 
 void GvfsServiceMonitor::worker()
 {
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::worker() run" << std::endl;
-#endif // NDEBUG
+  TRACE_DEBUG("GvfsServiceMonitor::worker()", "run");
   while (!m_quit)
   {
     if (!m_jobs.wait_for(std::chrono::milliseconds(500)))
@@ -361,13 +368,30 @@ void GvfsServiceMonitor::worker()
       // есть новое задание
       JobPtr job(m_jobs.get());
       if (job->mount)
-        Plugin::getInstance().onPointMounted();
+        Plugin::getInstance().onPointMounted(job->handle);
         else Plugin::getInstance().onPointUnmounted(job->name, job->path,
-                                                    job->scheme);
+                                                    job->scheme, job->handle);
+      m_latency.record(std::chrono::steady_clock::now() - job->queued);
     }
   }
-#ifndef NDEBUG
-  std::cout << std::hex << std::this_thread::get_id() << std::dec
-            << " GvfsServiceMonitor::worker() end" << std::endl;
-#endif // NDEBUG
+  TRACE_DEBUG("GvfsServiceMonitor::worker()", "end");
+}
+
+void GvfsServiceMonitor::enqueue(const JobPtr& job)
+{
+  job->queued = std::chrono::steady_clock::now();
+  m_jobs.put(job);
+  m_jobs.notify_one();
+  Metrics::Instance().increment(Metrics::Events);
+  unsigned long depth = m_jobs.size(),
+                max = m_maxDepth;
+  while ((depth > max) && !m_maxDepth.compare_exchange_weak(max, depth));
+}
+
+void GvfsServiceMonitor::traceEvent(const char* kind, const std::string& uri)
+{
+  m_trace << std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - m_traceStart
+             ).count()
+          << " " << kind << " " << uri << std::endl;
 }
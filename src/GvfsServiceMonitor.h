@@ -1,10 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <memory>
 #include <thread>
 #include <gtkmm.h>
 #include "glibmmconf.h"
 #include "JobUnitQueue.h"
+#include "LatencyHistogram.h"
+#include "MountBackend.h"
 
 /// 
 /// @brief Обертка вокруг GVolumeMonitor, монитор точек монтирования GVFS
@@ -113,17 +118,50 @@ class GvfsServiceMonitor
     void onMountPreunmount(GVolumeMonitor* monitor, GMount* mount);
 #endif // USE_GIO_MOUNTOPERATION_ONLY
 
+    ///
+    /// Обработчик событий установленной реализации MountBackend.
+    ///
+    /// @param [in] mount Точка монтирования подсоединена или отключена.
+    /// @param [in] info Свойства точки монтирования.
+    ///
+    /// Событие преобразуется в Job без точки монтирования GIO.
+    ///
+    void onBackendEvent(bool mount, const MountBackend::MountInfo& info);
+
     ///
     /// Запуск главного цикла монитора, работает в отдельном потоке.
     ///
-    /// Перед запуском цикла подключаются обработчики сигналов.
+    /// Перед запуском цикла подключаются обработчики сигналов. Если
+    /// установлена реализация MountBackend, то вместо главного цикла
+    /// монитор подписывается на ее события.
     ///
     void run();
 
+    ///
+    /// @return Текущее число необработанных событий в очереди.
+    ///
+    inline size_t queueDepth() { return m_jobs.size(); }
+    ///
+    /// @return Наибольшее число необработанных событий в очереди с момента
+    ///         последнего сброса статистики.
+    ///
+    inline unsigned long maxQueueDepth() const { return m_maxDepth; }
+    ///
+    /// Гистограмма задержки обработки событий: от постановки в очередь до
+    /// возврата из обработчика Plugin::onPointMounted() или
+    /// Plugin::onPointUnmounted().
+    ///
+    inline LatencyHistogram& eventLatency() { return m_latency; }
+    ///
+    /// Сбросить статистику очереди событий.
+    ///
+    inline void resetStats() { m_maxDepth = 0; m_latency.reset(); }
+
     ///
     /// Остановка главного цикла монитора.
     ///
-    /// После остановки цикла отключаются обработчики сигналов.
+    /// После остановки цикла отключаются обработчики сигналов (или монитор
+    /// отписывается от событий MountBackend).
     ///
     void quit();
 
@@ -137,6 +175,9 @@ class GvfsServiceMonitor
       std::string name, ///< Наименование ресурса.
                   path, ///< URL ресурса.
                   scheme; ///< Протокол (схема) из URL.
+      Glib::RefPtr<Gio::Mount> handle; ///< Точка монтирования GIO.
+      std::chrono::steady_clock::time_point queued; ///< Момент постановки
+                                                    ///< в очередь.
 
       ///
       /// Конструктор по умолчанию.
@@ -173,12 +214,37 @@ class GvfsServiceMonitor
     ///
     void worker();
 
+    ///
+    /// Поставить задание в очередь #m_jobs и учесть глубину очереди.
+    ///
+    void enqueue(const JobPtr& job);
+
+    ///
+    /// Записать событие GVFS в файл трассы.
+    ///
+    /// @param [in] kind Вид события: "added", "removed" или "changed".
+    /// @param [in] uri URI корня точки монтирования.
+    ///
+    /// Файл трассы открывается в run(), если задана переменная окружения
+    /// GVFSPANEL_EVENT_TRACE. Строка трассы: время от запуска монитора в
+    /// миллисекундах, вид события и URI. Трассу можно воспроизвести
+    /// нагрузочным генератором из bench/.
+    ///
+    void traceEvent(const char* kind, const std::string& uri);
+
     Glib::RefPtr<Glib::MainLoop> m_mainLoop; ///< Главный цикл glib.
     std::shared_ptr<std::thread> m_thread; ///< Поток, в котором работает
                                            ///< главный цикл, принимающий
                                            ///< сигналы от gtkmm.
     std::shared_ptr<std::thread> m_worker; ///< Поток обработки заданий из
                                            ///< #m_jobs.
+    std::shared_ptr<MountBackend> m_backend; ///< Реализация MountBackend,
+                                             ///< на события которой подписан
+                                             ///< монитор.
     bool m_quit; ///< Флаг остановки для потока m_worker.
     JobQueue m_jobs; ///< Очередь заданий для m_worker.
+    std::atomic_ulong m_maxDepth; ///< Наибольшая глубина очереди #m_jobs.
+    LatencyHistogram m_latency; ///< Задержка обработки заданий.
+    std::ofstream m_trace; ///< Файл трассы событий.
+    std::chrono::steady_clock::time_point m_traceStart; ///< Начало трассы.
 };
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <fnmatch.h>
+#include <glob.h>
+#include <WideMB.h> // far2l/utils
+#include "HostListReader.h"
+
+namespace {
+
+/// Системная конфигурация клиента ssh.
+const char* const SystemSshConfig = "/etc/ssh/ssh_config";
+/// Предельная глубина вложенности директив Include, как и в ssh.
+const unsigned int MaxSshIncludeDepth = 16;
+
+///
+/// Домашняя директория пользователя.
+///
+std::string HomeDir()
+{
+  const char* env = getenv("HOME");
+  return env ? env : "";
+}
+
+///
+/// Отбросить пробельные символы по краям строки.
+///
+std::string Trim(const std::string& s)
+{
+  std::string::size_type begin = 0, end = s.size();
+  while ((begin < end) && std::isspace(static_cast<unsigned char>(s[begin]))) begin++;
+  while ((end > begin) && std::isspace(static_cast<unsigned char>(s[end - 1]))) end--;
+  return s.substr(begin, end - begin);
+}
+
+///
+/// Отбросить кавычки вокруг значения.
+///
+std::string Unquote(const std::string& s)
+{
+  if ((s.size() >= 2) && (s.front() == '"') && (s.back() == '"'))
+    return s.substr(1, s.size() - 2);
+  return s;
+}
+
+///
+/// @brief Блок директив конфигурации клиента ssh.
+///
+struct SshConfigBlock
+{
+  std::vector<std::string> patterns; ///< Шаблоны узлов из директивы Host.
+  std::string user; ///< Первое значение директивы User в блоке.
+  bool conditional = false; ///< Блок Match, его условия не проверяются.
+  bool redirects = false; ///< В блоке есть директивы HostName, Port,
+                          ///< ProxyJump или ProxyCommand.
+
+  ///
+  /// Подходит ли блок узлу.
+  ///
+  /// Как и в ssh: узел должен подойти хотя бы одному шаблону и ни одному
+  /// отрицанию ("!шаблон"); регистр букв не различается.
+  ///
+  bool matches(const std::string& host) const
+  {
+    bool matched = false;
+    for (const auto& pattern : patterns)
+      if (!pattern.empty() && (pattern[0] == '!'))
+      {
+        if (fnmatch(pattern.c_str() + 1, host.c_str(), FNM_CASEFOLD) == 0)
+          return false;
+      }
+      else if (fnmatch(pattern.c_str(), host.c_str(), FNM_CASEFOLD) == 0)
+        matched = true;
+    return matched;
+  }
+};
+
+///
+/// Разобрать файл конфигурации клиента ssh.
+///
+/// @param [in] fileName Имя файла.
+/// @param [in,out] blocks Блоки директив. Директивы до первого блока Host
+///                        относятся ко всем узлам, как шаблон "*".
+/// @param [in] includeDir Каталог относительных путей директивы Include;
+///                        пустая строка -- директивы Include пропускаются.
+/// @param [in] depth Глубина вложенности директив Include.
+/// @return false, если файл не удалось открыть.
+///
+bool ParseSshConfig(const std::string& fileName,
+                    std::vector<SshConfigBlock>& blocks,
+                    const std::string& includeDir, unsigned int depth = 0)
+{
+  std::ifstream file(fileName);
+  if (!file) return false;
+  if (depth == 0)
+  {
+    blocks.emplace_back();
+    blocks.back().patterns.push_back("*");
+  }
+  std::string line;
+  while (std::getline(file, line))
+  {
+    line = Trim(line);
+    if (line.empty() || (line[0] == '#')) continue;
+    // "Ключ значение" или "Ключ=значение"
+    std::string::size_type pos = 0;
+    while ((pos < line.size()) && !std::isspace(static_cast<unsigned char>(line[pos])) &&
+           (line[pos] != '='))
+      pos++;
+    std::string keyword(line.substr(0, pos)), args(Trim(line.substr(pos)));
+    if (!args.empty() && (args[0] == '=')) args = Trim(args.substr(1));
+    for (auto& ch : keyword) ch = std::tolower(static_cast<unsigned char>(ch));
+    if (keyword == "host")
+      {
+        blocks.emplace_back();
+        std::istringstream stream(args);
+        std::string alias;
+        while (stream >> alias) blocks.back().patterns.push_back(Unquote(alias));
+      }
+      else if (keyword == "match")
+      {
+        blocks.emplace_back();
+        blocks.back().conditional = true;
+      }
+      else if ((keyword == "user") && blocks.back().user.empty())
+      {
+        std::istringstream stream(args);
+        stream >> blocks.back().user;
+        blocks.back().user = Unquote(blocks.back().user);
+      }
+      else if ((keyword == "hostname") || (keyword == "port") ||
+               (keyword == "proxyjump") || (keyword == "proxycommand"))
+      {
+        // "none" отменяет переадресацию
+        if (Unquote(args) != "none") blocks.back().redirects = true;
+      }
+      else if ((keyword == "include") && !includeDir.empty() &&
+               (depth < MaxSshIncludeDepth))
+      {
+        std::istringstream stream(args);
+        std::string pattern;
+        while (stream >> pattern)
+        {
+          pattern = Unquote(pattern);
+          if ((pattern[0] != '/') && (pattern[0] != '~'))
+            pattern = includeDir + "/" + pattern;
+          glob_t found;
+          if (glob(pattern.c_str(), GLOB_TILDE, nullptr, &found) == 0)
+            for (size_t i = 0; i < found.gl_pathc; i++)
+              ParseSshConfig(found.gl_pathv[i], blocks, includeDir, depth + 1);
+          globfree(&found);
+        }
+      }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+std::wstring HostListReader::GtkBookmarksPath()
+{
+  const char* env = getenv("XDG_CONFIG_HOME");
+  std::string path((env && *env) ? std::string(env) : HomeDir() + "/.config");
+  path.append("/gtk-3.0/bookmarks");
+  return StrMB2Wide(path);
+}
+
+std::wstring HostListReader::SshConfigPath()
+{
+  return StrMB2Wide(HomeDir() + "/.ssh/config");
+}
+
+bool HostListReader::ReadGtkBookmarks(const std::wstring& fileName,
+                                      const CatalogFile::EntryHandler& handler)
+{
+  std::ifstream file(StrWide2MB(fileName));
+  if (!file) return false;
+  std::string line;
+  while (std::getline(file, line))
+  {
+    // "URI [метка]"
+    std::string uri(Trim(line.substr(0, line.find(' '))));
+    std::string::size_type pos = uri.find("://");
+    if ((pos == std::string::npos) || (pos == 0)) continue;
+    std::string scheme(uri.substr(0, pos));
+    for (auto& ch : scheme) ch = std::tolower(static_cast<unsigned char>(ch));
+    if (scheme == "file") continue;
+    std::string authority(uri.substr(pos + 3));
+    authority = authority.substr(0, authority.find('/'));
+    std::string::size_type at = authority.rfind('@');
+    std::string host((at == std::string::npos) ? authority : authority.substr(at + 1));
+    if (host.empty()) continue;
+    CatalogFile::Entry entry;
+    StrMB2Wide(uri, entry.url);
+    if (at != std::string::npos)
+    {
+      // пароль в URI закладки, если он там есть, не берется
+      std::string user(authority.substr(0, at));
+      StrMB2Wide(user.substr(0, user.find(':')), entry.user);
+    }
+    entry.askPassword = false;
+    entry.keepMounted = false;
+    entry.autoMount = false;
+    handler(entry);
+  }
+  return true;
+}
+
+bool HostListReader::ReadSshConfig(const std::wstring& fileName,
+                                   const CatalogFile::EntryHandler& handler)
+{
+  // блок Match здесь не проверить, его директивы не учитываются
+  std::vector<SshConfigBlock> blocks;
+  if (!ParseSshConfig(StrWide2MB(fileName), blocks, std::string())) return false;
+  std::vector<std::string> aliases;
+  for (const auto& block : blocks)
+    for (const auto& alias : block.patterns)
+    {
+      // шаблоны и отрицания конкретных узлов не задают
+      if (alias.find_first_of("*?!") != std::string::npos) continue;
+      if (std::find(aliases.begin(), aliases.end(), alias) == aliases.end())
+        aliases.push_back(alias);
+    }
+  for (const auto& alias : aliases)
+  {
+    CatalogFile::Entry entry;
+    StrMB2Wide("sftp://" + alias, entry.url);
+    // как и в ssh, действует первое значение из подходящих узлу блоков
+    for (const auto& block : blocks)
+      if (!block.user.empty() && block.matches(alias))
+      {
+        StrMB2Wide(block.user, entry.user);
+        break;
+      }
+    entry.askPassword = false;
+    entry.keepMounted = false;
+    entry.autoMount = false;
+    handler(entry);
+  }
+  return true;
+}
+
+bool HostListReader::SshRedirects(const std::wstring& host)
+{
+  std::string name(StrWide2MB(host));
+  std::vector<SshConfigBlock> blocks;
+  // как и ssh: сначала конфигурация пользователя, затем системная
+  ParseSshConfig(StrWide2MB(SshConfigPath()), blocks, HomeDir() + "/.ssh");
+  ParseSshConfig(SystemSshConfig, blocks, "/etc/ssh");
+  for (const auto& block : blocks)
+    // условия блока Match не проверить, считаем, что он подходит
+    if (block.redirects && (block.conditional || block.matches(name)))
+      return true;
+  return false;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include "CatalogFile.h"
+
+///
+/// @brief Чтение списков удаленных ресурсов из конфигурации других программ.
+
+/// Поддерживаются два источника:
+/// * закладки GTK ($XDG_CONFIG_HOME/gtk-3.0/bookmarks): каждая строка --
+///   URI и необязательная метка; берутся только URI удаленных ресурсов
+///   (с непустым именем узла), локальные каталоги (file://) пропускаются;
+/// * конфигурация клиента ssh (~/.ssh/config): каждый псевдоним из
+///   директив Host, кроме шаблонов (с символами "*", "?", "!"), дает
+///   ресурс sftp://псевдоним; имя пользователя берется, как и в ssh, из
+///   первой директивы User среди блоков, подходящих псевдониму (включая
+///   директивы до первого блока Host и блоки с шаблонами вроде "Host *").
+///   Имя узла, порт и ключи ssh при монтировании берет из своей
+///   конфигурации сам.
+///
+/// Прочитанные записи передаются обработчику в том же виде, что и записи
+/// файла каталога.
+///
+/// @author cycleg
+///
+class HostListReader
+{
+  public:
+    ///
+    /// @return Путь к файлу закладок GTK.
+    ///
+    static std::wstring GtkBookmarksPath();
+    ///
+    /// @return Путь к файлу конфигурации клиента ssh.
+    ///
+    static std::wstring SshConfigPath();
+
+    ///
+    /// Прочитать закладки GTK.
+    ///
+    /// @param [in] fileName Имя файла закладок.
+    /// @param [in] handler Обработчик прочитанных записей.
+    /// @return false, если файл не удалось открыть.
+    ///
+    static bool ReadGtkBookmarks(const std::wstring& fileName,
+                                 const CatalogFile::EntryHandler& handler);
+    ///
+    /// Прочитать конфигурацию клиента ssh.
+    ///
+    /// @param [in] fileName Имя файла конфигурации.
+    /// @param [in] handler Обработчик прочитанных записей.
+    /// @return false, если файл не удалось открыть.
+    ///
+    /// Директивы Include не обрабатываются.
+    ///
+    static bool ReadSshConfig(const std::wstring& fileName,
+                              const CatalogFile::EntryHandler& handler);
+    ///
+    /// Переадресует ли конфигурация клиента ssh соединение с узлом.
+    ///
+    /// @param [in] host Имя узла (псевдоним) из URL ресурса.
+    /// @return true, если в подходящем узлу блоке конфигурации пользователя
+    ///         или системной (/etc/ssh/ssh_config), включая файлы директив
+    ///         Include, заданы HostName, Port, ProxyJump или ProxyCommand.
+    ///
+    /// GVFS соединяется с таким узлом не по адресу и порту из URL, и
+    /// проверять их доступность бессмысленно (см.
+    /// GvfsService::setConnectTimeout()). Условия блоков Match не
+    /// проверяются: такой блок считается подходящим.
+    ///
+    static bool SshRedirects(const std::wstring& host);
+};
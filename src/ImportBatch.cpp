@@ -0,0 +1,28 @@
+#include "MountPointStorage.h"
+#include "ImportBatch.h"
+
+ImportBatch::ImportBatch(const std::map<std::wstring, MountPoint>& catalog):
+  m_duplicates(0)
+{
+  m_known.reserve(catalog.size());
+  for (const auto& point : catalog)
+    m_known.insert(MountPoint::CanonicalUrl(point.first));
+}
+
+bool ImportBatch::add(const CatalogFile::Entry& entry)
+{
+  if (entry.url.empty()) return false;
+  if (!m_known.insert(MountPoint::CanonicalUrl(entry.url)).second)
+  {
+    m_duplicates++;
+    return false;
+  }
+  MountPoint point(MountPointStorage::PointFactory());
+  point.setUrl(entry.url)
+       .setUser(entry.user)
+       .setAskPassword(entry.askPassword)
+       .setKeepMounted(entry.keepMounted)
+       .setAutoMount(entry.autoMount);
+  m_points.push_back(point);
+  return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "CatalogFile.h"
+#include "MountPoint.h"
+
+///
+/// @brief Пакет новых ресурсов для массового импорта.
+
+/// Собирает новые ресурсы из внешних источников (файлов каталога, закладок
+/// GTK, конфигурации ssh) и отбрасывает дубликаты. Дубликатом считается
+/// ресурс, канонический URL которого (см. MountPoint::CanonicalUrl()) уже
+/// есть в каталоге или в самом пакете. Проверка выполняется по хеш-индексу,
+/// поэтому время сборки пакета линейно по числу записей.
+///
+/// Описания новых ресурсов создаются фабрикой
+/// MountPointStorage::PointFactory(). Собранный пакет сохраняется в
+/// хранилище одной операцией, см. MountPointStorage::SaveBatch().
+///
+/// @author cycleg
+///
+class ImportBatch
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] catalog Набор известных ресурсов, ключ -- URL ресурса.
+    ///
+    ImportBatch(const std::map<std::wstring, MountPoint>& catalog);
+
+    ///
+    /// Добавить запись в пакет.
+    ///
+    /// @param [in] entry Запись о ресурсе.
+    /// @return true, если запись добавлена, false -- если это дубликат.
+    ///
+    bool add(const CatalogFile::Entry& entry);
+
+    ///
+    /// @return Новые ресурсы.
+    ///
+    inline const std::vector<MountPoint>& points() const { return m_points; }
+    ///
+    /// @return Число отброшенных дубликатов.
+    ///
+    inline unsigned int duplicates() const { return m_duplicates; }
+
+  private:
+    std::unordered_set<std::wstring> m_known; ///< Канонические URL известных
+                                              ///< ресурсов.
+    std::vector<MountPoint> m_points; ///< Новые ресурсы.
+    unsigned int m_duplicates; ///< Число отброшенных дубликатов.
+};
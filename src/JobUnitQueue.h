@@ -60,6 +60,16 @@ template <class Job> class JobUnitQueue
       return (cond.wait_for(lock, abs_time) == std::cv_status::timeout);
     }
 
+    ///
+    /// @return Число заданий в очереди.
+    ///
+    inline size_t size()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      (void)lock;
+      return jobs.size();
+    }
+
     ///
     /// Отправить уведомление о появлении задания в очереди.
     ///
@@ -71,6 +81,17 @@ template <class Job> class JobUnitQueue
       cond.notify_one();
     }
 
+    ///
+    /// Отправить уведомление всем ожидающим потокам.
+    ///
+    /// Используется при остановке обработчиков очереди, чтобы они не ждали
+    /// истечения таймаута.
+    ///
+    inline void notify_all()
+    {
+      cond.notify_all();
+    }
+
   private:
     std::list<Job> jobs; ///< Очередь заданий.
     std::mutex mutex; ///< Мутекс списка заданий и переменной состояния.
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <WideMB.h> // far2l/utils
+#include "GvfsService.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "KeepaliveProber.h"
+
+KeepaliveProber::KeepaliveProber():
+  m_timeout(0),
+  m_random(std::random_device()()),
+  m_quit(false)
+{
+}
+
+KeepaliveProber::~KeepaliveProber()
+{
+  quit();
+}
+
+void KeepaliveProber::run(unsigned int minInterval, unsigned int maxInterval,
+                          unsigned int timeout, const TargetsCallback& targets,
+                          const ResultCallback& result)
+{
+  if (m_thread || (minInterval == 0)) return;
+  m_minInterval = std::chrono::milliseconds(minInterval);
+  m_maxInterval = std::chrono::milliseconds(std::max(minInterval, maxInterval));
+  m_timeout = timeout;
+  m_targets = targets;
+  m_result = result;
+  m_quit = false;
+  m_thread = std::make_shared<std::thread>(std::bind(&KeepaliveProber::loop,
+                                                     this));
+}
+
+void KeepaliveProber::quit()
+{
+  if (!m_thread) return;
+  {
+    std::lock_guard<std::mutex> lck(m_quitMutex);
+    m_quit = true;
+  }
+  m_wake.notify_all();
+  m_thread->join();
+  m_thread.reset();
+  m_schedule.clear();
+}
+
+void KeepaliveProber::loop()
+{
+  TRACE_DEBUG("KeepaliveProber::loop()", "run");
+  std::chrono::steady_clock::time_point wakeup =
+    std::chrono::steady_clock::now() + m_minInterval;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lck(m_quitMutex);
+      if (m_wake.wait_until(lck, wakeup, [this] () { return m_quit; })) break;
+    }
+    reconcile();
+    for (auto& entry : m_schedule)
+    {
+      if (entry.second.due > std::chrono::steady_clock::now()) continue;
+      // проверки -- фоновая работа, она уступает операциям оператора
+      if (m_gate) m_gate();
+      {
+        std::lock_guard<std::mutex> lck(m_quitMutex);
+        if (m_quit) break;
+      }
+      GvfsService service;
+      bool alive = service.probe(entry.second.file, m_timeout);
+      if (alive)
+        entry.second.interval = std::min(entry.second.interval * 2,
+                                         m_maxInterval);
+        else
+        {
+          Metrics::Instance().increment(Metrics::KeepaliveFailures);
+          TRACE_WARNING("KeepaliveProber::loop()", "%s: no response",
+                        StrWide2MB(entry.first).c_str());
+          entry.second.interval = m_minInterval;
+        }
+      entry.second.due = std::chrono::steady_clock::now() +
+                         jitter(entry.second.interval, 0.25);
+      m_result(entry.first, alive);
+    }
+    // без ресурсов список проверяется с минимальным интервалом
+    wakeup = std::chrono::steady_clock::now() + m_minInterval;
+    for (const auto& entry : m_schedule)
+      wakeup = std::min(wakeup, entry.second.due);
+  }
+  TRACE_DEBUG("KeepaliveProber::loop()", "end");
+}
+
+void KeepaliveProber::reconcile()
+{
+  std::vector<Target> targets;
+  m_targets(targets);
+  std::map<std::wstring, Schedule> schedule;
+  for (auto& target : targets)
+  {
+    auto it = m_schedule.find(target.url);
+    if (it != m_schedule.end())
+    {
+      schedule.insert(*it);
+      continue;
+    }
+    Schedule entry;
+    entry.file = target.file;
+    entry.interval = m_minInterval;
+    // первая проверка -- в случайный момент минимального интервала
+    entry.due = std::chrono::steady_clock::now() + jitter(m_minInterval / 2, 1.0);
+    schedule.insert(std::pair<std::wstring, Schedule>(target.url, entry));
+  }
+  m_schedule.swap(schedule);
+}
+
+std::chrono::milliseconds KeepaliveProber::jitter(std::chrono::milliseconds interval,
+                                                  double spread)
+{
+  std::uniform_real_distribution<double> distribution(1.0 - spread,
+                                                      1.0 + spread);
+  return std::chrono::milliseconds(
+    static_cast<long>(interval.count() * distribution(m_random))
+  );
+}
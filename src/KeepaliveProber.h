@@ -0,0 +1,148 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtkmm.h>
+
+///
+/// @brief Фоновая проверка сеансов связи со смонтированными ресурсами.
+
+/// Разорванный сеанс SFTP/SMB обнаруживается обычно только тогда, когда
+/// far2l пытается перейти в точку монтирования и блокируется на ней. Чтобы
+/// узнать об этом заранее, отдельный поток периодически проверяет каждый
+/// смонтированный ресурс запросом сведений о файловой системе с
+/// ограничением времени (GvfsService::probe()).
+///
+/// Интервал проверки у каждого ресурса свой: после каждого успешного ответа
+/// он удваивается, пока не достигнет максимального, а после неудачи
+/// возвращается к минимальному. Стабильные ресурсы, таким образом,
+/// проверяются редко, а "мерцающие" -- часто. Первая проверка нового
+/// ресурса назначается со случайным сдвигом в пределах минимального
+/// интервала, а каждый следующий интервал -- со случайным разбросом в
+/// четверть, чтобы проверки разных ресурсов не приходились на один момент.
+///
+/// Список ресурсов поток получает и результаты проверок отдает через
+/// обратные вызовы, которые вызываются в потоке проверки.
+///
+/// Перед каждой проверкой вызывается ожидание (см. setGate()): проверки
+/// уступают операциям, которых ждет оператор.
+///
+/// @author cycleg
+///
+class KeepaliveProber
+{
+  public:
+    ///
+    /// @brief Проверяемый ресурс.
+    ///
+    struct Target
+    {
+      std::wstring url; ///< URL ресурса.
+      Glib::RefPtr<Gio::File> file; ///< Разобранный URL ресурса.
+    };
+
+    ///
+    /// Получение списка смонтированных ресурсов.
+    ///
+    typedef std::function<void(std::vector<Target>&)> TargetsCallback;
+    ///
+    /// Результат проверки: URL ресурса и признак ответа.
+    ///
+    typedef std::function<void(const std::wstring&, bool)> ResultCallback;
+    ///
+    /// Ожидание перед каждой проверкой, например, пока оператор ждет
+    /// монтирования.
+    ///
+    typedef std::function<void()> GateCallback;
+
+    ///
+    /// Конструктор.
+    ///
+    KeepaliveProber();
+    ///
+    /// Деструктор.
+    ///
+    ~KeepaliveProber();
+
+    ///
+    /// Запустить проверку в отдельном потоке.
+    ///
+    /// @param [in] minInterval Минимальный интервал проверки, мс.
+    /// @param [in] maxInterval Максимальный интервал проверки, мс.
+    /// @param [in] timeout Предельное время ответа ресурса, мс.
+    /// @param [in] targets Получение списка ресурсов.
+    /// @param [in] result Обработчик результата проверки.
+    ///
+    void run(unsigned int minInterval, unsigned int maxInterval,
+             unsigned int timeout, const TargetsCallback& targets,
+             const ResultCallback& result);
+    ///
+    /// Остановить проверку.
+    ///
+    /// Текущая проверка, если она идет, дожидается ответа или истечения
+    /// времени ожидания.
+    ///
+    void quit();
+    ///
+    /// Назначить ожидание перед каждой проверкой.
+    ///
+    /// @param [in] gate Ожидание; вызывается в потоке проверки, до запуска
+    ///                  проверки (см. run()).
+    ///
+    inline void setGate(const GateCallback& gate) { m_gate = gate; }
+
+  private:
+    ///
+    /// @brief Расписание проверок ресурса.
+    ///
+    struct Schedule
+    {
+      Glib::RefPtr<Gio::File> file; ///< Разобранный URL ресурса.
+      std::chrono::milliseconds interval; ///< Текущий интервал проверки.
+      std::chrono::steady_clock::time_point due; ///< Момент проверки.
+    };
+
+    ///
+    /// Цикл проверки.
+    ///
+    void loop();
+    ///
+    /// Сверить расписание со списком смонтированных ресурсов.
+    ///
+    /// Новые ресурсы добавляются со случайным сдвигом первой проверки,
+    /// отключенные -- удаляются.
+    ///
+    void reconcile();
+    ///
+    /// Интервал со случайным разбросом.
+    ///
+    /// @param [in] interval Интервал.
+    /// @param [in] spread Доля разброса: результат лежит в пределах
+    ///                    interval * (1 +- spread).
+    /// @return Интервал с разбросом.
+    ///
+    std::chrono::milliseconds jitter(std::chrono::milliseconds interval,
+                                     double spread);
+
+    std::chrono::milliseconds m_minInterval; ///< Минимальный интервал.
+    std::chrono::milliseconds m_maxInterval; ///< Максимальный интервал.
+    unsigned int m_timeout; ///< Предельное время ответа, мс.
+    TargetsCallback m_targets; ///< Получение списка ресурсов.
+    ResultCallback m_result; ///< Обработчик результата.
+    GateCallback m_gate; ///< Ожидание перед проверкой.
+    std::map<std::wstring, Schedule> m_schedule; ///< Расписание проверок,
+                                                 ///< ключ -- URL ресурса.
+    std::minstd_rand m_random; ///< Генератор разброса.
+    bool m_quit; ///< Флаг остановки потока.
+    std::mutex m_quitMutex; ///< Мутекс флага остановки.
+    std::condition_variable m_wake; ///< Сигнал остановки.
+    std::shared_ptr<std::thread> m_thread; ///< Поток проверки.
+};
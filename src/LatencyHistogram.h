@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+///
+/// @brief Гистограмма длительностей с логарифмическими интервалами.
+
+/// Длительности в микросекундах раскладываются по интервалам [2^(i-1), 2^i),
+/// нулевой интервал -- длительности меньше 1 мкс. Запись -- несколько
+/// атомарных операций без блокировок, поэтому гистограмму можно заполнять
+/// из разных потоков на "горячем" пути и одновременно читать из потока
+/// отчета. Процентили получаются с точностью до интервала (верхняя граница).
+///
+/// @author cycleg
+///
+class LatencyHistogram
+{
+  public:
+    static const unsigned int Buckets = 40; ///< Число интервалов.
+
+    LatencyHistogram() { reset(); }
+
+    ///
+    /// Учесть длительность.
+    ///
+    /// @param [in] duration Длительность.
+    ///
+    inline void record(std::chrono::steady_clock::duration duration)
+    {
+      uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      duration
+                    ).count();
+      unsigned int bucket = 0;
+      while ((bucket < Buckets - 1) && (us >> bucket)) bucket++;
+      m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+      m_count.fetch_add(1, std::memory_order_relaxed);
+      m_sum.fetch_add(us, std::memory_order_relaxed);
+      uint64_t max = m_max.load(std::memory_order_relaxed);
+      while ((us > max) &&
+             !m_max.compare_exchange_weak(max, us, std::memory_order_relaxed));
+    }
+
+    ///
+    /// Сбросить накопленные значения.
+    ///
+    inline void reset()
+    {
+      for (auto& bucket : m_buckets) bucket = 0;
+      m_count = 0;
+      m_sum = 0;
+      m_max = 0;
+    }
+
+    ///
+    /// @return Число учтенных длительностей.
+    ///
+    inline uint64_t count() const { return m_count; }
+    ///
+    /// @return Сумма длительностей, мкс.
+    ///
+    inline uint64_t sum() const { return m_sum; }
+    ///
+    /// @return Наибольшая длительность, мкс.
+    ///
+    inline uint64_t max() const { return m_max; }
+    ///
+    /// @return Средняя длительность, мкс.
+    ///
+    inline double mean() const
+    { return m_count ? static_cast<double>(m_sum) / m_count : 0.0; }
+
+    ///
+    /// Процентиль длительности.
+    ///
+    /// @param [in] q Доля, 0..1.
+    /// @return Верхняя граница интервала, в который попадает процентиль, мкс.
+    ///
+    inline uint64_t percentile(double q) const
+    {
+      uint64_t total = m_count, rank = static_cast<uint64_t>(q * total), seen = 0;
+      for (unsigned int i = 0; i < Buckets; i++)
+      {
+        seen += m_buckets[i];
+        if (seen > rank) return (i == 0) ? 1 : (uint64_t(1) << i);
+      }
+      return m_max;
+    }
+
+  private:
+    std::atomic<uint64_t> m_buckets[Buckets]; ///< Счетчики интервалов.
+    std::atomic<uint64_t> m_count; ///< Число длительностей.
+    std::atomic<uint64_t> m_sum; ///< Сумма длительностей, мкс.
+    std::atomic<uint64_t> m_max; ///< Наибольшая длительность, мкс.
+};
@@ -85,5 +85,81 @@ enum LngStringsID
   MDeleteResourceTitle,
   MDeleteresourceConfirmation,
 
+  MPasswordStorageSwitch,
+  MPasswordsMoved,
+  MPasswordStorageSwitched,
+
+  MF2Bar,
+  MF5ImportBar,
+  MCommandsTitle,
+  MExportCatalog,
+  MImportCatalog,
+  MCatalogFileName,
+  MCatalogFileError,
+  MCatalogExported,
+  MCatalogImported,
+  MCatalogDuplicates,
+  MCatalogNotSaved,
+  MCatalogImportConfirm,
+
+  MImportHostLists,
+
+  MMountRetry,
+
+  MDiagnostics,
+  MResetMetrics,
+
+  MExportTrace,
+  MTraceExported,
+  MTraceExportError,
+
+  MKeepMounted,
+
+  MConfigSpeculativeMount,
+
+  MAutoMount,
+
+  MResourceNotResponding,
+  MForceUnmount,
+
+  MPasswordStorageKept,
+  MPasswordCopiesLeft,
+
+  MDiagLatency,
+  MDiagCount,
+  MDiagMean,
+  MDiagMedian,
+  MDiagP99,
+  MDiagMax,
+  MDiagMount,
+  MDiagUnmount,
+  MDiagProbe,
+  MDiagSecretLookup,
+  MDiagRegistryRead,
+  MDiagRegistryWrite,
+  MDiagKeepalive,
+  MDiagEvents,
+  MDiagMountRetries,
+  MDiagMountFailures,
+  MDiagUnmountFailures,
+  MDiagStatusCacheHits,
+  MDiagKeepaliveFailures,
+  MDiagRemounts,
+  MDiagSpeculativeMounts,
+  MDiagSpeculativeHits,
+  MDiagSpeculativeUnused,
+  MDiagWarmUpMounts,
+  MDiagSharedPasswords,
+  MDiagSharedAnswers,
+  MDiagRestoredStates,
+  MDiagRestoreCorrections,
+  MDiagStaleMounts,
+  MDiagUnreachableHosts,
+  MDiagFailedOperations,
+  MDiagMounted,
+  MDiagQueueDepth,
+
+  MPasswordCopiesRemoved,
+
   __LAST_LNG_ENTRY__
 };
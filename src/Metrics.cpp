@@ -0,0 +1,36 @@
+#include "Metrics.h"
+
+Metrics::Metrics()
+{
+  for (auto& counter : m_counters) counter = 0;
+}
+
+Metrics& Metrics::Instance()
+{
+  static Metrics instance;
+  return instance;
+}
+
+void Metrics::setSampler(Gauge gauge, const Sampler& sampler)
+{
+  std::lock_guard<std::mutex> lck(m_samplersMutex);
+  m_samplers[gauge] = sampler;
+}
+
+long Metrics::gauge(Gauge gauge) const
+{
+  Sampler sampler;
+  {
+    // сборщик может сам захватывать мутексы, поэтому вызывается без
+    // блокировки
+    std::lock_guard<std::mutex> lck(m_samplersMutex);
+    sampler = m_samplers[gauge];
+  }
+  return sampler ? sampler() : 0;
+}
+
+void Metrics::reset()
+{
+  for (auto& histogram : m_histograms) histogram.reset();
+  for (auto& counter : m_counters) counter = 0;
+}
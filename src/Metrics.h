@@ -0,0 +1,186 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include "LatencyHistogram.h"
+
+///
+/// @brief Реестр метрик дополнения.
+
+/// Синглет с тремя видами метрик:
+/// * гистограммы длительностей операций (LatencyHistogram) -- монтирование,
+///   отсоединение, проверка статуса и сеанса связи, поиск пароля в
+///   безопасном хранилище, чтение и запись реестра;
+/// * счетчики событий -- событий монитора GVFS, повторов монтирования,
+///   неудач монтирования и отсоединения, пропущенных проверок статуса,
+///   разорванных сеансов, переподключений, сбоев фоновых операций;
+/// * показатели текущего состояния (gauges) -- число подсоединенных
+///   ресурсов, глубина очереди событий монитора.
+///
+/// Гистограммы и счетчики пополняются на "горячем" пути без блокировок.
+/// Показатели не хранятся: владелец состояния регистрирует функцию-сборщик
+/// (setSampler()), которая вызывается только при чтении показателя.
+///
+/// Метрики показываются в диалоге диагностики (меню команд по F2), см.
+/// Plugin::showDiagnostics().
+///
+/// @author cycleg
+///
+class Metrics
+{
+  public:
+    ///
+    /// Гистограммы длительностей.
+    ///
+    enum Histogram
+    {
+      Mount = 0, ///< GvfsService::mount(), вместе с повторами.
+      Unmount, ///< GvfsService::umount().
+      Probe, ///< GvfsService::mounted().
+      SecretLookup, ///< Поиск пароля в безопасном хранилище.
+      RegistryRead, ///< RegistryStorage::GetValue().
+      RegistryWrite, ///< RegistryStorage::SetValue().
+      Keepalive, ///< GvfsService::probe(), проверка сеанса связи.
+      HistogramsNumber
+    };
+
+    ///
+    /// Счетчики.
+    ///
+    enum Counter
+    {
+      Events = 0, ///< События монитора GVFS, поставленные в очередь.
+      MountRetries, ///< Повторные попытки монтирования.
+      MountFailures, ///< Неудачные монтирования.
+      UnmountFailures, ///< Неудачные отсоединения.
+      StatusCacheHits, ///< Проверки статуса ресурса, пропущенные из-за
+                       ///< неустаревшего статуса.
+      KeepaliveFailures, ///< Разорванные сеансы связи, найденные
+                         ///< KeepaliveProber.
+      Remounts, ///< Удачные переподключения ресурсов с флагом
+                ///< "поддерживать подсоединенным".
+      SpeculativeMounts, ///< Удачные упреждающие монтирования.
+      SpeculativeHits, ///< Открытия ресурсов, смонтированных или
+                       ///< монтируемых упреждающе.
+      SpeculativeUnused, ///< Упреждающие монтирования, отсоединенные
+                         ///< невостребованными.
+      WarmUpMounts, ///< Ресурсы, подсоединенные при запуске.
+      SharedPasswords, ///< Монтирования с паролем другого ресурса того же
+                       ///< узла (см. CredentialCache).
+      SharedAnswers, ///< Вопросы при монтировании, на которые ответ взят из
+                     ///< CredentialCache.
+      RestoredStates, ///< Ресурсы, статус которых восстановлен при запуске
+                      ///< (см. SessionStateStorage).
+      RestoreCorrections, ///< Восстановленные статусы, опровергнутые
+                          ///< проверкой в фоне.
+      StaleMounts, ///< Переходы на смонтированные ресурсы, не ответившие
+                   ///< вовремя.
+      UnreachableHosts, ///< Монтирования, отклоненные проверкой доступности
+                        ///< узла (см. GvfsService::setConnectTimeout()).
+      FailedOperations, ///< Операции планировщика, завершившиеся
+                        ///< исключением (см. OperationScheduler).
+      CountersNumber
+    };
+
+    ///
+    /// Показатели текущего состояния.
+    ///
+    enum Gauge
+    {
+      MountedCount = 0, ///< Число подсоединенных ресурсов.
+      QueueDepth, ///< Глубина очереди событий монитора.
+      GaugesNumber
+    };
+
+    ///
+    /// Функция-сборщик значения показателя.
+    ///
+    typedef std::function<long()> Sampler;
+
+    ///
+    /// @brief Замер длительности операции в области видимости.
+    ///
+    /// Длительность от создания до уничтожения экземпляра учитывается в
+    /// гистограмме, в том числе при выходе из области по исключению.
+    ///
+    class Scope
+    {
+      public:
+        explicit Scope(Histogram histogram):
+          m_histogram(histogram), m_start(std::chrono::steady_clock::now())
+        {
+        }
+
+        ~Scope()
+        {
+          Metrics::Instance().record(m_histogram,
+                                     std::chrono::steady_clock::now() - m_start);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+      private:
+        Histogram m_histogram; ///< Гистограмма замера.
+        std::chrono::steady_clock::time_point m_start; ///< Начало операции.
+    };
+
+    ///
+    /// Доступ к экземпляру-синглету.
+    ///
+    static Metrics& Instance();
+
+    ///
+    /// Учесть длительность операции.
+    ///
+    inline void record(Histogram histogram,
+                       std::chrono::steady_clock::duration duration)
+    { m_histograms[histogram].record(duration); }
+    ///
+    /// @return Гистограмма длительностей.
+    ///
+    inline const LatencyHistogram& histogram(Histogram histogram) const
+    { return m_histograms[histogram]; }
+
+    ///
+    /// Увеличить счетчик.
+    ///
+    inline void increment(Counter counter, unsigned long n = 1)
+    { m_counters[counter].fetch_add(n, std::memory_order_relaxed); }
+    ///
+    /// @return Значение счетчика.
+    ///
+    inline unsigned long counter(Counter counter) const
+    { return m_counters[counter].load(std::memory_order_relaxed); }
+
+    ///
+    /// Зарегистрировать функцию-сборщик показателя.
+    ///
+    /// @param [in] gauge Показатель.
+    /// @param [in] sampler Функция-сборщик; пустая функция снимает
+    ///                     регистрацию.
+    ///
+    void setSampler(Gauge gauge, const Sampler& sampler);
+    ///
+    /// @return Текущее значение показателя; 0, если сборщик не
+    ///         зарегистрирован.
+    ///
+    /// Сборщик вызывается в потоке вызывающего.
+    ///
+    long gauge(Gauge gauge) const;
+
+    ///
+    /// Сбросить гистограммы и счетчики.
+    ///
+    void reset();
+
+  private:
+    Metrics();
+
+    LatencyHistogram m_histograms[HistogramsNumber]; ///< Гистограммы.
+    std::atomic_ulong m_counters[CountersNumber]; ///< Счетчики.
+    Sampler m_samplers[GaugesNumber]; ///< Сборщики показателей.
+    mutable std::mutex m_samplersMutex; ///< Охрана m_samplers.
+};
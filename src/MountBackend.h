@@ -0,0 +1,111 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "GvfsServiceException.h"
+
+///
+/// @brief Подменный механизм монтирования ресурсов.
+
+/// Интерфейс, на который GvfsService и GvfsServiceMonitor переключаются
+/// вместо GIO/GVFS, если экземпляр реализации установлен методом Install().
+/// Используется для воспроизводимых измерений и нагрузочных испытаний логики
+/// дополнения без сетевых серверов, см. FakeMountBackend. Если реализация не
+/// установлена, классы работают с GIO напрямую.
+///
+/// Ресурсы идентифицируются URL. Операции синхронные, ошибки сообщаются
+/// исключением GvfsServiceException. События о подсоединении и отключении
+/// точек монтирования доставляются подписчику в отдельном потоке, как и
+/// события монитора GVFS.
+///
+/// Реализация устанавливается до запуска GvfsServiceMonitor и после этого не
+/// меняется.
+///
+/// @author cycleg
+///
+class MountBackend
+{
+  public:
+    ///
+    /// @brief Свойства подсоединенного ресурса.
+    ///
+    struct MountInfo
+    {
+      std::string name, ///< Имя точки монтирования.
+                  path, ///< Путь в локальной файловой системе.
+                  scheme; ///< Схема из URL.
+    };
+
+    ///
+    /// Обработчик событий: подсоединена (true) или отключена (false) точка
+    /// монтирования. Для события об отключении path -- корень точки
+    /// монтирования.
+    ///
+    typedef std::function<void(bool, const MountInfo&)> EventHandler;
+
+    virtual ~MountBackend() {}
+
+    ///
+    /// Подсоединить ресурс.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [in] user Имя пользователя.
+    /// @param [in] password Пароль.
+    /// @param [out] info Свойства подсоединенного ресурса.
+    /// @return Результат операции.
+    /// @throw GvfsServiceException
+    ///
+    virtual bool mount(const std::string& url, const std::string& user,
+                       const std::string& password, MountInfo& info) = 0;
+    ///
+    /// Отсоединить ресурс.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @return Результат операции.
+    /// @throw GvfsServiceException
+    ///
+    virtual bool unmount(const std::string& url) = 0;
+    ///
+    /// Проверить статус ресурса.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [out] info Свойства ресурса, если он подсоединен.
+    /// @return Подсоединен ресурс или нет.
+    ///
+    virtual bool mounted(const std::string& url, MountInfo& info) = 0;
+
+    ///
+    /// Подписаться на события о точках монтирования.
+    ///
+    /// @param [in] handler Обработчик событий.
+    ///
+    virtual void subscribe(const EventHandler& handler) = 0;
+    ///
+    /// Отписаться от событий.
+    ///
+    /// После возврата обработчик больше не вызывается.
+    ///
+    virtual void unsubscribe() = 0;
+
+    ///
+    /// Установить реализацию.
+    ///
+    /// @param [in] backend Реализация; пустой указатель возвращает работу с
+    ///                     GIO.
+    ///
+    static inline void Install(const std::shared_ptr<MountBackend>& backend)
+    { Instance() = backend; }
+    ///
+    /// @return Установленная реализация или пустой указатель.
+    ///
+    static inline const std::shared_ptr<MountBackend>& Installed()
+    { return Instance(); }
+
+  private:
+    static inline std::shared_ptr<MountBackend>& Instance()
+    {
+      static std::shared_ptr<MountBackend> instance;
+      return instance;
+    }
+};
@@ -1,9 +1,35 @@
+#include <cwctype>
 #include <string>
 #include <WideMB.h> // far2l/utils
 #include <PlatformConstants.h> // far2l/utils
+#include "CredentialCache.h"
 #include "GvfsService.h"
+#include "Metrics.h"
 #include "MountPoint.h"
 
+namespace {
+
+///
+/// Порт по умолчанию для схемы URL.
+///
+const wchar_t* DefaultPort(const std::wstring& scheme)
+{
+    static const struct { const wchar_t* scheme; const wchar_t* port; } ports[] = {
+        { L"ftp", L"21" },
+        { L"sftp", L"22" },
+        { L"smb", L"445" },
+        { L"http", L"80" },
+        { L"dav", L"80" },
+        { L"https", L"443" },
+        { L"davs", L"443" }
+    };
+    for (const auto& entry : ports)
+        if (scheme == entry.scheme) return entry.port;
+    return nullptr;
+}
+
+} // anonymous namespace
+
 MountPoint::MountPoint(const MountPoint& other):
     m_proto(other.m_proto),
     m_url(other.m_url),
@@ -13,7 +39,13 @@ MountPoint::MountPoint(const MountPoint& other):
     m_shareName(other.m_shareName),
     m_storageId(other.m_storageId),
     m_askPassword(other.m_askPassword),
-    m_wasMounted(other.m_wasMounted)
+    m_keepMounted(other.m_keepMounted),
+    m_autoMount(other.m_autoMount),
+    m_wasMounted(other.m_wasMounted),
+    m_stale(other.m_stale),
+    m_file(other.m_file),
+    m_mount(other.m_mount),
+    m_verified(other.m_verified)
 {
 }
 
@@ -27,17 +59,48 @@ MountPoint& MountPoint::operator=(const MountPoint& other)
     m_shareName = other.m_shareName;
     m_storageId = other.m_storageId;
     m_askPassword = other.m_askPassword;
+    m_keepMounted = other.m_keepMounted;
+    m_autoMount = other.m_autoMount;
     m_wasMounted = other.m_wasMounted;
+    m_stale = other.m_stale;
+    m_file = other.m_file;
+    m_mount = other.m_mount;
+    m_verified = other.m_verified;
     return *this;
 }
 
 MountPoint::MountPoint():
     m_proto(EProtocol::Unknown),
     m_askPassword(false),
-    m_wasMounted(false)
+    m_keepMounted(false),
+    m_autoMount(false),
+    m_wasMounted(false),
+    m_stale(false)
 {
 }
 
+bool MountPoint::sameRecord(MountPoint const& other) const
+{
+    return (m_url == other.m_url) && (m_user == other.m_user) &&
+           (m_password == other.m_password) &&
+           (m_askPassword == other.m_askPassword) &&
+           (m_keepMounted == other.m_keepMounted) &&
+           (m_autoMount == other.m_autoMount) &&
+           (m_storageId == other.m_storageId);
+}
+
+MountPoint& MountPoint::assignRecord(MountPoint const& other)
+{
+    setUrl(other.m_url);
+    m_user = other.m_user;
+    m_password = other.m_password;
+    m_askPassword = other.m_askPassword;
+    m_keepMounted = other.m_keepMounted;
+    m_autoMount = other.m_autoMount;
+    m_storageId = other.m_storageId;
+    return *this;
+}
+
 MountPoint::EProtocol MountPoint::SchemeToProto(const std::string& scheme)
 {
     MountPoint::EProtocol ret = EProtocol::Unknown;
@@ -49,9 +112,88 @@ MountPoint::EProtocol MountPoint::SchemeToProto(const std::string& scheme)
     return ret;
 }
 
+const Glib::RefPtr<Gio::File>& MountPoint::getFile()
+{
+    if (m_file.operator->() == nullptr)
+        m_file = Gio::File::create_for_parse_name(StrWide2MB(m_url));
+    return m_file;
+}
+
+bool MountPoint::SplitUrl(const std::wstring& url, UrlParts& parts)
+{
+    parts = UrlParts();
+    std::wstring::size_type pos = url.find(L"://");
+    if (pos == std::wstring::npos) return false;
+    parts.scheme = url.substr(0, pos);
+    for (auto& ch : parts.scheme) ch = std::towlower(ch);
+    std::wstring authority(url.substr(pos + 3));
+    pos = authority.find(L'/');
+    if (pos != std::wstring::npos)
+    {
+        parts.path = authority.substr(pos);
+        authority.erase(pos);
+    }
+    // имя пользователя в URL регистр сохраняет
+    pos = authority.rfind(L'@');
+    if (pos != std::wstring::npos)
+    {
+        parts.userInfo = authority.substr(0, pos);
+        authority.erase(0, pos + 1);
+    }
+    pos = authority.rfind(L':');
+    // двоеточие внутри IPv6-адреса в квадратных скобках -- не порт
+    if ((pos != std::wstring::npos) && (authority.find(L']', pos) == std::wstring::npos))
+    {
+        parts.port = authority.substr(pos + 1);
+        authority.erase(pos);
+    }
+    if (parts.port.empty())
+    {
+        const wchar_t* port = DefaultPort(parts.scheme);
+        if (port) parts.port = port;
+    }
+    for (auto& ch : authority) ch = std::towlower(ch);
+    parts.host = authority;
+    return true;
+}
+
+std::wstring MountPoint::CanonicalUrl(const std::wstring& url)
+{
+    UrlParts parts;
+    if (!SplitUrl(url, parts)) return url;
+    std::wstring ret(parts.scheme + L"://");
+    if (!parts.userInfo.empty()) ret += parts.userInfo + L'@';
+    ret += parts.host;
+    const wchar_t* port = DefaultPort(parts.scheme);
+    if (!parts.port.empty() && (!port || (parts.port != port)))
+        ret += L':' + parts.port;
+    while (!parts.path.empty() && (parts.path.back() == L'/')) parts.path.pop_back();
+    return ret + parts.path;
+}
+
+std::wstring MountPoint::UrlHost(const std::wstring& url)
+{
+    UrlParts parts;
+    SplitUrl(url, parts);
+    return parts.host;
+}
+
+std::wstring MountPoint::UrlPort(const std::wstring& url)
+{
+    UrlParts parts;
+    SplitUrl(url, parts);
+    return parts.port;
+}
+
+MountPoint::EProtocol MountPoint::UrlProto(const std::wstring& url)
+{
+    UrlParts parts;
+    if (!SplitUrl(url, parts)) return EProtocol::Unknown;
+    return SchemeToProto(StrWide2MB(parts.scheme));
+}
+
 bool MountPoint::mount(GvfsService* service)
 {
-    std::string url(StrWide2MB(m_url));
     std::string userName(StrWide2MB(m_user));
     std::string password(StrWide2MB(m_password));
 
@@ -62,15 +204,39 @@ bool MountPoint::mount(GvfsService* service)
       m_wasMounted = true;
       return true;
     }
-    if (url.empty()) return false;
+    if (m_url.empty()) return false;
 
-    bool success = service->mount(url, userName, password);
+    // пароль, с которым подсоединен другой ресурс того же узла
+    std::wstring shared;
+    bool fromCache = password.empty() &&
+                     CredentialCache::Instance().password(m_url, m_user, shared);
+    if (fromCache)
+    {
+        password = StrWide2MB(shared);
+        Metrics::Instance().increment(Metrics::SharedPasswords);
+    }
+    bool success = false;
+    try
+    {
+        success = service->mount(getFile(), userName, password);
+    }
+    catch (const GvfsServiceException& e)
+    {
+        if (fromCache && !e.isTransient())
+            CredentialCache::Instance().forgetPassword(m_url, m_user);
+        throw;
+    }
     if (success)
     {
+        CredentialCache::Instance().storePassword(m_url, m_user,
+                                                  StrMB2Wide(password));
+        m_mount = service->getMount();
         m_proto = MountPoint::SchemeToProto(service->getMountScheme());
         StrMB2Wide(service->getMountPath(), m_mountPointPath);
         StrMB2Wide(service->getMountName(), m_shareName);
         m_wasMounted = true;
+        m_stale = false;
+        m_verified = std::chrono::steady_clock::now();
     }
     return success;
 }
@@ -83,55 +249,67 @@ bool MountPoint::unmount(GvfsService* service)
         return true;
     }
 
-    std::string url(StrWide2MB(this->m_url));
-    if (url.empty()) return false;
+    if (m_url.empty()) return false;
 
     bool success = false;
     try
     {
-        success = service->umount(url);
+        success = service->umount(getFile(), m_mount);
     }
     catch (const GvfsServiceException& e)
     {
         // exception equal to unmount
-        m_wasMounted = false;
-        m_shareName.clear();
-        m_mountPointPath.clear();
-        m_proto = EProtocol::Unknown;
+        detach();
+        // но действительное состояние ресурса неизвестно
+        invalidateStatus();
         throw; // escalate error
     }
-    if (success)
-    {
-        m_wasMounted = false;
-        m_shareName.clear();
-        m_mountPointPath.clear();
-        m_proto = EProtocol::Unknown;
-    }
+    if (success) detach();
     return success;
 }
 
 void MountPoint::mountCheck(GvfsService* service)
 {
-    std::string url(StrWide2MB(m_url));
-    if (url.empty())
+    if (m_url.empty())
     {
-        m_wasMounted = false;
-        m_shareName.clear();
-        m_mountPointPath.clear();
-        m_proto = EProtocol::Unknown;
+        detach();
         return;
     }
-    if (service->mounted(url))
+    if (service->mounted(getFile(), m_mount))
         {
+            m_mount = service->getMount();
             m_proto = MountPoint::SchemeToProto(service->getMountScheme());
             StrMB2Wide(service->getMountPath(), m_mountPointPath);
             StrMB2Wide(service->getMountName(), m_shareName);
+            m_verified = std::chrono::steady_clock::now();
         }
-        else
-        {
-            m_wasMounted = false;
-            m_shareName.clear();
-            m_mountPointPath.clear();
-            m_proto = EProtocol::Unknown;
-        }
+        else detach();
+}
+
+bool MountPoint::belongsTo(const Glib::RefPtr<Gio::Mount>& mount)
+{
+    if (m_url.empty() || (mount.operator->() == nullptr)) return false;
+    Glib::RefPtr<Gio::File> root = mount->get_root();
+    return getFile()->equal(root) || getFile()->has_prefix(root);
+}
+
+void MountPoint::attach(const Glib::RefPtr<Gio::Mount>& mount)
+{
+    m_mount = mount;
+    m_proto = MountPoint::SchemeToProto(getFile()->get_uri_scheme());
+    StrMB2Wide(getFile()->get_path(), m_mountPointPath);
+    StrMB2Wide(mount->get_name(), m_shareName);
+    m_stale = false;
+    m_verified = std::chrono::steady_clock::now();
+}
+
+void MountPoint::detach()
+{
+    m_wasMounted = false;
+    m_mount.reset();
+    m_shareName.clear();
+    m_mountPointPath.clear();
+    m_proto = EProtocol::Unknown;
+    m_stale = false;
+    m_verified = std::chrono::steady_clock::now();
 }
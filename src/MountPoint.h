@@ -3,12 +3,15 @@
 ///
 #pragma once
 
+#include <chrono>
 #include <string>
+#include <gtkmm.h>
 #include "GvfsServiceException.h"
 
 class GvfsService;
 
 class MountPointStorage;
+class SessionStateStorage;
 
 ///
 /// Класс-хранилище для описания и состояния монтируемых ресурсов.
@@ -19,6 +22,8 @@ class MountPointStorage;
 /// * имя пользователя для аутентификации на ресурсе (#m_user);
 /// * пароль (#m_password);
 /// * флаг "спрашивать пароль перед монтированием" (#m_askPassword);
+/// * флаг "поддерживать подсоединенным" (#m_keepMounted);
+/// * флаг "подсоединять при запуске" (#m_autoMount);
 /// * свойство #m_storageId (используется только в MountPointStorage).
 ///
 /// Над ресурсом опеределены три основные операции:
@@ -30,11 +35,29 @@ class MountPointStorage;
 /// указатель на экземпляр которого передается в соответствующие методы класса
 /// MountPoint как параметр.
 ///
+/// Ресурс хранит разобранный URL (Gio::File, создается один раз при первом
+/// обращении) и точку монтирования GIO (Gio::Mount), в которой он
+/// подсоединен. Точка монтирования запоминается после mount() и
+/// mountCheck() и обновляется по событиям монитора GVFS (см. attach(),
+/// detach()), поэтому повторные проверки статуса и отсоединение ресурса
+/// обходятся без разбора URL и поиска точки монтирования.
+///
+/// Кроме того, ресурс помнит момент, когда его статус был достоверно
+/// установлен (монтирование, проверка, событие монитора GVFS). Пока статус
+/// не устарел (см. statusFresh()) и не сброшен (invalidateStatus()),
+/// повторная проверка не нужна. Смонтированный ресурс, сеанс связи с
+/// которым разорван, помечается как "зависший" (см. isStale()).
+///
+/// Состояние ресурса переживает перезапуск far2l в хранилище
+/// SessionStateStorage, пока жив сеанс GVFS.
+///
 /// @authors invy, cycleg
 ///
 class MountPoint
 {
   friend class MountPointStorage; ///< Для сериализации.
+  friend class SessionStateStorage; ///< Для сохранения состояния между
+                                    ///< запусками far2l.
 
   public:
     ///
@@ -94,6 +117,18 @@ class MountPoint
     /// 
     inline bool wasMounted() const { return m_wasMounted; }
     ///
+    /// Признак разорванного сеанса связи со смонтированным ресурсом.
+    ///
+    /// @return Ресурс смонтирован, но не ответил на последнюю проверку
+    ///         сеанса.
+    ///
+    /// Точка монтирования такого ресурса еще существует, но обращение к ней
+    /// может надолго заблокировать вызывающий поток. Признак выставляет
+    /// KeepaliveProber (через setStale()) и сбрасывают mount(), attach() и
+    /// detach().
+    ///
+    inline bool isStale() const { return m_stale; }
+    ///
     /// Используемый в ресурсе транспортный протокол.
     ///
     /// @return Протокол.
@@ -143,6 +178,25 @@ class MountPoint
     ///
     inline bool getAskPassword() const { return m_askPassword; }
     ///
+    /// Флаг "поддерживать подсоединенным".
+    ///
+    /// @return Состояние флага.
+    ///
+    /// Ресурс с этим флагом, смонтированный в текущем сеансе и неожиданно
+    /// отсоединившийся, монтируется заново в фоне (см.
+    /// Plugin::onPointUnmounted()).
+    ///
+    inline bool getKeepMounted() const { return m_keepMounted; }
+    ///
+    /// Флаг "подсоединять при запуске".
+    ///
+    /// @return Состояние флага.
+    ///
+    /// Ресурсы с этим флагом монтируются в фоне после инициализации плагина
+    /// (см. Plugin::warmUp()).
+    ///
+    inline bool getAutoMount() const { return m_autoMount; }
+    ///
     /// Уникальный идентификатор ресурса в хранилище.
     ///
     /// @return Id.
@@ -150,6 +204,22 @@ class MountPoint
     /// В качестве идентификаторов в хранилище используются UUID.
     ///
     inline const std::wstring& getStorageId() const { return m_storageId; }
+    ///
+    /// Ресурс в виде объекта GIO.
+    ///
+    /// @return Разобранный URL ресурса.
+    ///
+    /// Объект создается при первом обращении и сохраняется до изменения URL.
+    ///
+    const Glib::RefPtr<Gio::File>& getFile();
+    ///
+    /// Точка монтирования GIO, в которой подсоединен ресурс.
+    ///
+    /// @return Указатель на экземпляр Gio::Mount.
+    ///
+    /// Если ресурс не смонтирован, возвращает пустой указатель.
+    ///
+    inline const Glib::RefPtr<Gio::Mount>& getMount() const { return m_mount; }
 
     ///
     /// Назначить URL ресурсу.
@@ -157,8 +227,20 @@ class MountPoint
     /// @param [in] s Новый URL.
     /// @return Ссылка на данный экземпляр класса.
     ///
+    /// При смене URL сохраненные объекты GIO (см. getFile(), getMount())
+    /// сбрасываются.
+    ///
     inline MountPoint& setUrl(const std::wstring& s)
-    { m_url = s; return *this; }
+    {
+      if (s != m_url)
+      {
+        m_file.reset();
+        m_mount.reset();
+        invalidateStatus();
+      }
+      m_url = s;
+      return *this;
+    }
     ///
     /// Назначить ресурсу имя пользователя.
     ///
@@ -183,6 +265,22 @@ class MountPoint
     ///
     inline MountPoint& setAskPassword(bool ask)
     { m_askPassword = ask; return *this; }
+    ///
+    /// Назначить ресурсу флаг "поддерживать подсоединенным".
+    ///
+    /// @param [in] keep Новое значение флага.
+    /// @return Ссылка на данный экземпляр класса.
+    ///
+    inline MountPoint& setKeepMounted(bool keep)
+    { m_keepMounted = keep; return *this; }
+    ///
+    /// Назначить ресурсу флаг "подсоединять при запуске".
+    ///
+    /// @param [in] autoMount Новое значение флага.
+    /// @return Ссылка на данный экземпляр класса.
+    ///
+    inline MountPoint& setAutoMount(bool autoMount)
+    { m_autoMount = autoMount; return *this; }
 
     ///
     /// Сравнить два ресурса на равенство.
@@ -197,6 +295,28 @@ class MountPoint
       return (m_url == other.m_url) && (m_user == other.m_user);
     }
 
+    ///
+    /// Сравнить хранимые свойства двух ресурсов.
+    ///
+    /// @param [in] other Ресурс для сравнения.
+    /// @return Совпадают ли все хранимые свойства.
+    ///
+    /// В отличие от operator==, сравниваются все свойства, сохраняемые в
+    /// MountPointStorage: URL, имя пользователя, пароль, флаги и
+    /// идентификатор в хранилище.
+    ///
+    bool sameRecord(MountPoint const& other) const;
+    ///
+    /// Присвоить хранимые свойства другого ресурса.
+    ///
+    /// @param [in] other Ресурс-источник.
+    /// @return Ссылка на данный экземпляр класса.
+    ///
+    /// Состояние смонтированности ресурса не меняется. Используется для
+    /// обновления записи, измененной в хранилище другим экземпляром far2l.
+    ///
+    MountPoint& assignRecord(MountPoint const& other);
+
     ///
     /// Транслирует схему из URI ресурса в транспортный протокл.
     ///
@@ -208,6 +328,70 @@ class MountPoint
     ///
     static EProtocol SchemeToProto(const std::string& scheme);
 
+    ///
+    /// Составные части URL ресурса, см. SplitUrl().
+    ///
+    struct UrlParts
+    {
+        std::wstring scheme;   ///< Схема в нижнем регистре.
+        std::wstring userInfo; ///< Имя пользователя (и пароль) до "@", регистр
+                               ///< сохраняется.
+        std::wstring host;     ///< Имя узла в нижнем регистре, адрес IPv6 --
+                               ///< в квадратных скобках.
+        std::wstring port;     ///< Порт, явно указанный в URL, иначе порт по
+                               ///< умолчанию для схемы; пустая строка, если
+                               ///< он неизвестен (например, для "file").
+        std::wstring path;     ///< Путь, начиная с "/"; может быть пустым.
+    };
+    ///
+    /// Разобрать URL ресурса на составные части.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [out] parts Составные части URL.
+    /// @return false, если URL не содержит схемы; parts при этом пусты.
+    ///
+    /// CanonicalUrl(), UrlHost(), UrlPort(), UrlProto() и ключи
+    /// CredentialCache строятся по результату этого метода.
+    ///
+    static bool SplitUrl(const std::wstring& url, UrlParts& parts);
+    ///
+    /// Привести URL ресурса к каноническому виду.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @return URL в каноническом виде.
+    ///
+    /// Схема и имя узла приводятся к нижнему регистру, порт по умолчанию для
+    /// схемы и завершающие символы "/" в пути отбрасываются. Используется
+    /// для поиска дубликатов: URL, записанные по-разному, но указывающие на
+    /// один и тот же ресурс, в каноническом виде совпадают.
+    ///
+    static std::wstring CanonicalUrl(const std::wstring& url);
+    ///
+    /// Выделить из URL ресурса имя узла.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @return Имя узла в нижнем регистре, без имени пользователя и порта;
+    ///         адрес IPv6 -- в квадратных скобках. Пустая строка, если URL
+    ///         не содержит схемы.
+    ///
+    static std::wstring UrlHost(const std::wstring& url);
+    ///
+    /// Выделить из URL ресурса порт TCP сервера.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @return Порт, явно указанный в URL, иначе порт по умолчанию для
+    ///         схемы. Пустая строка, если URL не содержит схемы или порт для
+    ///         схемы неизвестен (например, "file").
+    ///
+    static std::wstring UrlPort(const std::wstring& url);
+    ///
+    /// Определить транспортный протокол по схеме URL ресурса.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @return Транспортный протокол, см. SchemeToProto().
+    ///
+    static EProtocol UrlProto(const std::wstring& url);
+
     ///
     /// Подсоединить ресурс к локальной файловой системе.
     ///
@@ -234,6 +418,11 @@ class MountPoint
     /// перед монтированием ресурса, но после вызова mount() при выставленном
     /// флаге пароль всегда будет пустым.
     ///
+    /// Если пароль пуст, используется пароль из CredentialCache, с которым
+    /// в этом сеансе был подсоединен ресурс того же узла и пользователя.
+    /// Пароль удачного монтирования запоминается в CredentialCache, а
+    /// пароль из кэша, который не подошел, забывается.
+    ///
     bool mount(GvfsService* service);
     ///
     /// Отсоединить ресурс от локальной файловой системы.
@@ -269,6 +458,72 @@ class MountPoint
     ///
     void mountCheck(GvfsService* service);
 
+    ///
+    /// Проверить, что ресурс находится в точке монтирования GIO.
+    ///
+    /// @param [in] mount Точка монтирования.
+    /// @return Находится или нет.
+    ///
+    /// Проверка выполняется сравнением URI ресурса и корня точки
+    /// монтирования, без обращения к GVFS.
+    ///
+    bool belongsTo(const Glib::RefPtr<Gio::Mount>& mount);
+    ///
+    /// Отметить ресурс смонтированным в точке монтирования GIO.
+    ///
+    /// @param [in] mount Точка монтирования, содержащая ресурс.
+    ///
+    /// Используется при обработке события "mount added" монитора GVFS:
+    /// свойства "имя ресурса", "путь к ресурсу" и "используемый протокол"
+    /// заполняются без обращения к GVFS.
+    ///
+    void attach(const Glib::RefPtr<Gio::Mount>& mount);
+    ///
+    /// Отметить ресурс отсоединенным.
+    ///
+    /// Используется при обработке события "mount removed" монитора GVFS:
+    /// точка монтирования уже удалена, поэтому обращаться к GVFS не нужно.
+    ///
+    void detach();
+
+    ///
+    /// Проверить, что статус смонтированности ресурса не устарел.
+    ///
+    /// @param [in] ttl Время жизни статуса.
+    /// @return Статус установлен не раньше, чем ttl назад, и с тех пор не
+    ///         сбрасывался.
+    ///
+    /// Статус обновляют mount(), unmount(), mountCheck(), attach() и
+    /// detach(). При нулевом ttl статус всегда считается устаревшим.
+    ///
+    inline bool statusFresh(std::chrono::steady_clock::duration ttl) const
+    {
+      return (m_verified != std::chrono::steady_clock::time_point()) &&
+             (std::chrono::steady_clock::now() - m_verified < ttl);
+    }
+    ///
+    /// Сбросить статус смонтированности ресурса.
+    ///
+    /// Статус остается прежним, но при следующей проверке ресурс будет
+    /// опрошен заново.
+    ///
+    inline void invalidateStatus()
+    { m_verified = std::chrono::steady_clock::time_point(); }
+    ///
+    /// Отметить результат проверки сеанса связи с ресурсом.
+    ///
+    /// @param [in] stale Сеанс разорван.
+    ///
+    /// Ответивший ресурс считается проверенным (см. statusFresh()),
+    /// статус неответившего сбрасывается.
+    ///
+    inline void setStale(bool stale)
+    {
+      m_stale = stale;
+      if (stale) invalidateStatus();
+        else m_verified = std::chrono::steady_clock::now();
+    }
+
   private:
     ///
     /// Простой конструктор.
@@ -289,6 +544,17 @@ class MountPoint
     std::wstring m_storageId; ///< Идентификатор ресурса в хранилище;
                               ///< используется в основном в MountPointStorage.
     bool m_askPassword; ///< Флаг "спрашивать пароль перед монтированием".
+    bool m_keepMounted; ///< Флаг "поддерживать подсоединенным".
+    bool m_autoMount; ///< Флаг "подсоединять при запуске".
     bool m_wasMounted; ///< True, если для данного ресурса вызывался mount() и
                        ///< он завершился успешно.
+    bool m_stale; ///< Сеанс связи со смонтированным ресурсом разорван.
+    Glib::RefPtr<Gio::File> m_file; ///< Разобранный URL ресурса.
+    Glib::RefPtr<Gio::Mount> m_mount; ///< Точка монтирования GIO, в которой
+                                      ///< подсоединен ресурс.
+    std::chrono::steady_clock::time_point m_verified; ///< Момент последнего
+                                                      ///< достоверного
+                                                      ///< определения статуса;
+                                                      ///< по умолчанию --
+                                                      ///< статус неизвестен.
 };
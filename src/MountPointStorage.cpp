@@ -1,4 +1,5 @@
 #include <cstring>
+#include <set>
 #include <windows.h>
 #include <WideMB.h> // far2l/utils
 #include <PlatformConstants.h> // far2l/utils
@@ -9,8 +10,12 @@
 #endif
 
 #ifdef USE_SECRET_STORAGE
+#include <atomic>
 #include "Configuration.h"
+#include "GioAwait.h"
+#include "Metrics.h"
 #include "SecretServiceStorage.h"
+#include "WorkerPool.h"
 #endif
 
 #include "MountPointStorage.h"
@@ -19,7 +24,10 @@
 
 const wchar_t* MountPointStorage::StoragePath = L"Resources";
 const wchar_t* MountPointStorage::StorageVersionKey = L"Version";
-const DWORD MountPointStorage::StorageVersion = 5;
+const DWORD MountPointStorage::StorageVersion = 7;
+#ifdef USE_SECRET_STORAGE
+const unsigned int MountPointStorage::MigrationConcurrency = 8;
+#endif
 
 MountPointStorage::MountPointStorage(const std::wstring& registryFolder):
   RegistryStorage(registryFolder),
@@ -95,13 +103,19 @@ void MountPointStorage::LoadAll(std::map<std::wstring, MountPoint>& storage)
       point.m_storageId = subKey;
       // load always converse record to current storage version
       // TODO: load error
-      if (Load(point))
+      if (Load(point, true))
           storage.insert(std::pair<std::wstring, MountPoint>(point.getUrl(),
                          point));
     }
     index++;
   } while (res == ERROR_SUCCESS);
   WINPORT(RegCloseKey)(hKey);
+#ifdef USE_SECRET_STORAGE
+  // записи версий 1-3 паролей в безопасном хранилище не держат; пароли
+  // нужны до конвертации, она записи пересохраняет
+  if ((m_version >= 4) && Configuration::Instance()->useSecretStorage())
+    LoadPasswords(storage);
+#endif
   if (m_version < StorageVersion)
   {
     // storage conversion
@@ -154,7 +168,9 @@ bool MountPointStorage::Save(const MountPoint& point)
   }
   if (res != ERROR_SUCCESS) return false;
   std::vector<BYTE> l_password;
-  DWORD l_askPassword = point.m_askPassword;
+  DWORD l_askPassword = point.m_askPassword,
+        l_keepMounted = point.m_keepMounted,
+        l_autoMount = point.m_autoMount;
   bool ret = true;
 #ifdef USE_SECRET_STORAGE
   if (Configuration::Instance()->useSecretStorage())
@@ -179,7 +195,9 @@ bool MountPointStorage::Save(const MountPoint& point)
         SetValue(hKey, L"URL", point.m_url) &&
         SetValue(hKey, L"User", point.m_user) &&
         SetValue(hKey, L"Password", l_password) &&
-        SetValue(hKey, L"AskPassword", l_askPassword);
+        SetValue(hKey, L"AskPassword", l_askPassword) &&
+        SetValue(hKey, L"KeepMounted", l_keepMounted) &&
+        SetValue(hKey, L"AutoMount", l_autoMount);
   WINPORT(RegCloseKey)(hKey);
   return ret;
 }
@@ -206,6 +224,301 @@ void MountPointStorage::Delete(const MountPoint& point) const
 #endif
 }
 
+bool MountPointStorage::SaveBatch(const std::vector<MountPoint>& points,
+                                  std::vector<std::wstring>& failed)
+{
+  failed.clear();
+  if (!valid()) return false;
+  if (m_version < StorageVersion)
+  {
+    // LoadAll() не вызывали, придется конвертировать хранилище здесь
+    std::map<std::wstring, MountPoint> buffer;
+    LoadAll(buffer);
+  }
+  HKEY hStorage = nullptr;
+  LONG res = WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, m_registryFolder.c_str(),
+                                   0, KEY_WRITE, &hStorage);
+  WINPORT(SetLastError)(res);
+  if (res != ERROR_SUCCESS)
+  {
+    for (const auto& point : points) failed.push_back(point.m_storageId);
+    return false;
+  }
+  std::set<std::wstring> unsaved;
+#ifdef USE_SECRET_STORAGE
+  bool useSecretStorage = Configuration::Instance()->useSecretStorage();
+  std::vector<const MountPoint*> secrets;
+  if (useSecretStorage)
+    for (const auto& point : points)
+      if (!point.m_password.empty()) secrets.push_back(&point);
+  // Пароли сохраняются первыми: запись без пароля в реестр не попадает,
+  // иначе при следующей загрузке ресурс появился бы без пароля.
+  std::unique_ptr<std::atomic_bool[]> results(
+    new std::atomic_bool[secrets.size()]
+  );
+  if (!secrets.empty())
+  {
+    // результаты пишутся из рабочих потоков, каждый в свою ячейку
+    WorkerPool pool(MigrationConcurrency);
+    for (unsigned int i = 0; i < secrets.size(); i++)
+    {
+      const MountPoint* point = secrets[i];
+      std::atomic_bool* result = &results[i];
+      pool.submit([point, result] ()
+                  {
+                    SecretServiceStorage storage;
+                    *result = storage.SavePassword(point->m_storageId,
+                                                   point->m_password);
+                  });
+    }
+  }
+  for (unsigned int i = 0; i < secrets.size(); i++)
+    if (!results[i]) unsaved.insert(secrets[i]->m_storageId);
+#endif
+  for (const auto& point : points)
+  {
+    if (unsaved.count(point.m_storageId) > 0)
+    {
+      failed.push_back(point.m_storageId);
+      continue;
+    }
+    HKEY hKey = nullptr;
+    DWORD disposition;
+    res = WINPORT(RegCreateKeyEx)(hStorage, point.m_storageId.c_str(), 0,
+                                  nullptr, 0, KEY_WRITE, nullptr, &hKey,
+                                  &disposition);
+    bool ret = (res == ERROR_SUCCESS);
+    if (ret)
+    {
+      std::vector<BYTE> l_password;
+      DWORD l_askPassword = point.m_askPassword,
+            l_keepMounted = point.m_keepMounted,
+            l_autoMount = point.m_autoMount;
+#ifdef USE_SECRET_STORAGE
+      // пароль уже в безопасном хранилище, в реестр -- пустая строка
+      if (!useSecretStorage)
+#endif
+      {
+#ifdef USE_OPENSSL
+        Encrypt(point.m_storageId, point.m_password, l_password);
+#else
+        Encrypt(point.m_password, l_password);
+#endif
+      }
+      ret = SetValue(hKey, L"URL", point.m_url) &&
+            SetValue(hKey, L"User", point.m_user) &&
+            SetValue(hKey, L"Password", l_password) &&
+            SetValue(hKey, L"AskPassword", l_askPassword) &&
+            SetValue(hKey, L"KeepMounted", l_keepMounted) &&
+            SetValue(hKey, L"AutoMount", l_autoMount);
+      WINPORT(RegCloseKey)(hKey);
+      // неполная новая запись не загрузится, но и лежать в реестре ей незачем
+      if (!ret && (disposition == REG_CREATED_NEW_KEY))
+        WINPORT(RegDeleteKey)(hStorage, point.m_storageId.c_str());
+    }
+    if (ret) continue;
+    failed.push_back(point.m_storageId);
+#ifdef USE_SECRET_STORAGE
+    // пароль записи, не попавшей в реестр, -- "мусор" в хранилище
+    if (useSecretStorage && !point.m_password.empty())
+    {
+      SecretServiceStorage storage;
+      storage.RemovePassword(point.m_storageId);
+    }
+#endif
+  }
+  WINPORT(RegCloseKey)(hStorage);
+  return failed.empty();
+}
+
+bool MountPointStorage::LoadOne(const std::wstring& id, MountPoint& point) const
+{
+  if (!valid()) return false;
+  MountPoint l_point(point);
+  l_point.m_storageId = id;
+  if (!Load(l_point)) return false;
+  point = l_point;
+  return true;
+}
+
+bool MountPointStorage::Exists(const std::wstring& id) const
+{
+  if (!valid()) return false;
+  HKEY hKey = nullptr;
+  std::wstring key = m_registryFolder;
+  key.append(WGOOD_SLASH);
+  key.append(id);
+  LONG res = WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, key.c_str(), 0,
+                                   KEY_READ, &hKey);
+  if (res != ERROR_SUCCESS) return false;
+  WINPORT(RegCloseKey)(hKey);
+  return true;
+}
+
+void MountPointStorage::LoadIds(std::vector<std::wstring>& ids) const
+{
+  ids.clear();
+  if (!valid()) return;
+  HKEY hKey = nullptr;
+  LONG res;
+  DWORD index = 0;
+  if (WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, m_registryFolder.c_str(), 0,
+                            KEY_ENUMERATE_SUB_KEYS | KEY_READ, &hKey) != ERROR_SUCCESS)
+    return;
+  do
+  {
+    wchar_t subKey[MAX_PATH];
+    FILETIME tTime;
+    DWORD subKeySize = MAX_PATH * sizeof(wchar_t);
+    std::memset(subKey, 0, subKeySize);
+    res = WINPORT(RegEnumKeyEx)(hKey, index, subKey, &subKeySize, 0, nullptr,
+                                nullptr, &tTime);
+    if (res == ERROR_SUCCESS) ids.push_back(subKey);
+    index++;
+  } while (res == ERROR_SUCCESS);
+  WINPORT(RegCloseKey)(hKey);
+}
+
+bool MountPointStorage::WriteMarker(const std::wstring& name) const
+{
+  if (!valid()) return false;
+  HKEY hKey = nullptr;
+  LONG res = WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, m_registryFolder.c_str(),
+                                   0, KEY_WRITE, &hKey);
+  if (res != ERROR_SUCCESS) return false;
+  bool ret = SetValue(hKey, name, name);
+  WINPORT(RegCloseKey)(hKey);
+  return ret;
+}
+
+void MountPointStorage::RemoveMarker(const std::wstring& name) const
+{
+  HKEY hKey = nullptr;
+  LONG res = WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, m_registryFolder.c_str(),
+                                   0, KEY_WRITE, &hKey);
+  if (res != ERROR_SUCCESS) return;
+  WINPORT(RegDeleteValue)(hKey, name.c_str());
+  WINPORT(RegCloseKey)(hKey);
+}
+
+#ifdef USE_SECRET_STORAGE
+bool MountPointStorage::SwitchPasswordStorage(
+  const std::map<std::wstring, MountPoint>& points, bool toSecretStorage,
+  const ProgressCallback& progress, std::vector<std::wstring>& failed)
+{
+  failed.clear();
+  if (!valid()) return false;
+  if (m_version < StorageVersion)
+  {
+    // хранилище нужно сначала сконвертировать
+    std::map<std::wstring, MountPoint> buffer;
+    LoadAll(buffer);
+  }
+  std::vector<const MountPoint*> records;
+  for (const auto& point : points) records.push_back(&point.second);
+  const unsigned int total = records.size();
+  // результаты пишутся из рабочих потоков, каждый в свою ячейку
+  std::unique_ptr<std::atomic_bool[]> results(new std::atomic_bool[total]);
+  for (unsigned int i = 0; i < total; i++) results[i] = false;
+  // Первый проход: пароли копируются в новое хранилище, старые копии не
+  // трогаются. Второй проход: если скопированы все пароли, старые копии
+  // удаляются, иначе удаляются новые, и старое хранилище остается в силе.
+  // Так неудача на любой записи не оставляет ее без пароля. Ход каждого
+  // прохода индицируется отдельно, от 0 до total.
+  auto pass = [&] (bool save, bool secret)
+              {
+                if (progress) progress(!save, 0, total);
+                if (!secret)
+                {
+                  for (unsigned int i = 0; i < total; i++)
+                  {
+                    results[i] = SavePasswordValue(*records[i], !save);
+                    if (progress) progress(!save, i + 1, total);
+                  }
+                  return;
+                }
+                WorkerPool pool(MigrationConcurrency);
+                for (unsigned int i = 0; i < total; i++)
+                {
+                  const MountPoint* point = records[i];
+                  std::atomic_bool* result = &results[i];
+                  pool.submit([point, result, save] ()
+                              {
+                                SecretServiceStorage storage;
+                                // отсутствие пароля в хранилище при удалении
+                                // -- не ошибка, см.
+                                // SecretServiceStorage::onPasswordRemoved()
+                                *result = save ?
+                                  storage.SavePassword(point->m_storageId,
+                                                       point->m_password) :
+                                  storage.RemovePassword(point->m_storageId);
+                              });
+                }
+                while (!pool.wait(std::chrono::milliseconds(100)))
+                  if (progress) progress(!save, pool.completed(), total);
+                if (progress) progress(!save, total, total);
+              };
+  pass(true, toSecretStorage);
+  for (unsigned int i = 0; i < total; i++)
+    if (!results[i]) failed.push_back(records[i]->m_storageId);
+  bool switched = failed.empty();
+  // новые копии откатываются без учета ошибок: старые в силе
+  pass(false, switched ? !toSecretStorage : toSecretStorage);
+  if (switched)
+  {
+    // неудача удаления старой копии пароль не теряет, но оставляет "мусор"
+    for (unsigned int i = 0; i < total; i++)
+      if (!results[i]) failed.push_back(records[i]->m_storageId);
+  }
+  return switched;
+}
+
+void MountPointStorage::LoadPasswords(std::map<std::wstring, MountPoint>& points)
+{
+  if (points.empty()) return;
+  Glib::init();
+  // контекст только для поиска паролей, как и в SecretServiceStorage
+  Glib::RefPtr<Glib::MainContext> main_context = Glib::MainContext::create();
+  g_main_context_push_thread_default(main_context->gobj());
+  Glib::RefPtr<Glib::MainLoop> loop = Glib::MainLoop::create(main_context, false);
+  std::vector< GioTask<> > tasks;
+  tasks.reserve(points.size());
+  for (auto& point : points) tasks.push_back(PasswordTask(point.second));
+  GioTask<>::RunAll(tasks, loop);
+  g_main_context_pop_thread_default(main_context->gobj());
+}
+
+GioTask<> MountPointStorage::PasswordTask(MountPoint& point)
+{
+  Metrics::Scope scope(Metrics::SecretLookup);
+  point.m_password = co_await AwaitPasswordLookup(point.m_storageId);
+}
+
+bool MountPointStorage::SavePasswordValue(const MountPoint& point,
+                                          bool clear) const
+{
+  HKEY hKey = nullptr;
+  std::wstring key = m_registryFolder;
+  key.append(WGOOD_SLASH);
+  key.append(point.m_storageId);
+  LONG res = WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, key.c_str(), 0,
+                                   KEY_WRITE, &hKey);
+  if (res != ERROR_SUCCESS) return false;
+  std::vector<BYTE> l_password;
+  if (!clear)
+  {
+#ifdef USE_OPENSSL
+    Encrypt(point.m_storageId, point.m_password, l_password);
+#else
+    Encrypt(point.m_password, l_password);
+#endif
+  }
+  bool ret = SetValue(hKey, L"Password", l_password);
+  WINPORT(RegCloseKey)(hKey);
+  return ret;
+}
+#endif
+
 void MountPointStorage::GenerateId(std::wstring& id)
 {
   uuid_t uuid;
@@ -258,6 +571,8 @@ void MountPointStorage::Decrypt(const std::vector<BYTE>& in, std::wstring& out)
     case 3:
     case 4:
     case 5:
+    case 6:
+    case 7:
       {
         unsigned int i = 0;
         wchar_t symbol = 0;
@@ -297,6 +612,8 @@ void MountPointStorage::Decrypt(const std::wstring& keydata,
     case 3:
     case 4:
     case 5:
+    case 6:
+    case 7:
       crypto.decrypt(in, plain);
       for (const BYTE ch : plain) buf.push_back(ch);
       StrMB2Wide(buf, out);
@@ -307,7 +624,7 @@ void MountPointStorage::Decrypt(const std::wstring& keydata,
 }
 #endif
 
-bool MountPointStorage::Load(MountPoint& point) const
+bool MountPointStorage::Load(MountPoint& point, bool deferSecret) const
 {
   // не удалось создать хранилище на диске
   if (!m_version) return false;
@@ -320,7 +637,7 @@ bool MountPointStorage::Load(MountPoint& point) const
   if (res != ERROR_SUCCESS) return false;
   std::wstring l_url, l_user;
   std::vector<BYTE> l_password;
-  DWORD l_askPassword;
+  DWORD l_askPassword, l_keepMounted = 0, l_autoMount = 0;
   bool ret = GetValue(hKey, L"User", l_user)  &&
              GetValue(hKey, L"Password", l_password);
   switch (m_version)
@@ -375,11 +692,14 @@ bool MountPointStorage::Load(MountPoint& point) const
 #ifdef USE_SECRET_STORAGE
         if (Configuration::Instance()->useSecretStorage())
           {
-            SecretServiceStorage storage;
             // Здесь делаем ссылочную целостность слабой: если пароль не
             // удалось извлечь из стороннего хранилища, это не означает
             // порчу всей записи. Пусть пользователь введет пароль заново.
-            storage.LoadPassword(point.m_storageId, point.m_password);
+            if (!deferSecret)
+            {
+              SecretServiceStorage storage;
+              storage.LoadPassword(point.m_storageId, point.m_password);
+            }
           }
           else
 #endif
@@ -394,9 +714,14 @@ bool MountPointStorage::Load(MountPoint& point) const
       }
       break;
     case 5:
+    case 6:
+    case 7:
+      // флаг KeepMounted появился в версии 6, AutoMount -- в версии 7
       ret = ret &&
             GetValue(hKey, L"URL", l_url) &&
-            GetValue(hKey, L"AskPassword", l_askPassword);
+            GetValue(hKey, L"AskPassword", l_askPassword) &&
+            ((m_version < 6) || GetValue(hKey, L"KeepMounted", l_keepMounted)) &&
+            ((m_version < 7) || GetValue(hKey, L"AutoMount", l_autoMount));
       if (ret)
       {
         point.m_url = l_url;
@@ -404,8 +729,11 @@ bool MountPointStorage::Load(MountPoint& point) const
 #ifdef USE_SECRET_STORAGE
         if (Configuration::Instance()->useSecretStorage())
           {
-            SecretServiceStorage storage;
-            storage.LoadPassword(point.m_storageId, point.m_password);
+            if (!deferSecret)
+            {
+              SecretServiceStorage storage;
+              storage.LoadPassword(point.m_storageId, point.m_password);
+            }
           }
           else
 #endif
@@ -417,6 +745,8 @@ bool MountPointStorage::Load(MountPoint& point) const
 #endif
           }
         point.m_askPassword = (l_askPassword == 1);
+        point.m_keepMounted = (l_keepMounted == 1);
+        point.m_autoMount = (l_autoMount == 1);
       }
       break;
     default:
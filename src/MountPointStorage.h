@@ -3,10 +3,14 @@
 ///
 #pragma once
 
+#include <functional>
 #include <map>
 #include <vector>
 #include "MountPoint.h"
 #include "RegistryStorage.h"
+#ifdef USE_SECRET_STORAGE
+#include "GioTask.h"
+#endif
 
 /// 
 /// @brief Вспомогательный класс для управления хранилищем описаний ресурсов.
@@ -36,6 +40,9 @@
 ///
 class MountPointStorage: public RegistryStorage
 {
+  friend class StorageBench; ///< Для измерения закрытых методов, см.
+                             ///< bench/StorageBench.cpp.
+
   public:
     ///
     /// Конструктор.
@@ -77,7 +84,9 @@ class MountPointStorage: public RegistryStorage
     /// записи из хранилища обновляются до текущей версии, а затем сохраняются,
     /// обновляя таким образом и само хранилище.
     ///
-    /// В ходе загрузки пароль дешифруется методом Decrypt().
+    /// В ходе загрузки пароль дешифруется методом Decrypt(). Пароли из
+    /// безопасного хранилища ищутся для всех записей одновременно, после
+    /// чтения записей из реестра (см. LoadPasswords()).
     ///
     void LoadAll(std::map<std::wstring, MountPoint>& storage);
     ///
@@ -101,8 +110,131 @@ class MountPointStorage: public RegistryStorage
     /// @param [in] point Удаляемая запись.
     ///
     void Delete(const MountPoint& point) const;
+    ///
+    /// Сохранить набор новых записей в хранилище одним пакетом.
+    ///
+    /// @param [in] points Сохраняемые записи.
+    /// @param [out] failed Идентификаторы записей, которые сохранить не
+    ///                     удалось.
+    /// @return true, если сохранены все записи.
+    ///
+    /// В отличие от поочередных вызовов Save(), версия хранилища проверяется
+    /// и папка хранилища открывается один раз на весь пакет, а пароли в
+    /// безопасное хранилище сохраняются параллельно, не более чем в
+    /// MigrationConcurrency потоках. Пустые пароли в безопасное хранилище не
+    /// сохраняются. Пароли сохраняются до записей в реестре: запись, пароль
+    /// которой сохранить не удалось, в реестр не пишется, а пароль записи,
+    /// не попавшей в реестр, из безопасного хранилища удаляется.
+    /// Используется при массовом импорте ресурсов.
+    ///
+    bool SaveBatch(const std::vector<MountPoint>& points,
+                   std::vector<std::wstring>& failed);
+    ///
+    /// Загрузить одну запись из хранилища.
+    ///
+    /// @param [in] id Идентификатор записи.
+    /// @param [in,out] point Буфер для загружаемой записи.
+    /// @return Результат загрузки.
+    ///
+    /// Если загрузка не удалась, содержимое буфера не меняется. Неудачей
+    /// считается и неполная запись, например, сохраняемая в этот момент
+    /// другим экземпляром far2l.
+    ///
+    bool LoadOne(const std::wstring& id, MountPoint& point) const;
+    ///
+    /// Проверить наличие записи в хранилище.
+    ///
+    /// @param [in] id Идентификатор записи.
+    /// @return Есть ли запись в хранилище.
+    ///
+    bool Exists(const std::wstring& id) const;
+    ///
+    /// Получить идентификаторы всех записей в хранилище.
+    ///
+    /// @param [out] ids Идентификаторы записей.
+    ///
+    /// Сами записи не загружаются.
+    ///
+    void LoadIds(std::vector<std::wstring>& ids) const;
+    ///
+    /// Записать в папку хранилища ключ-метку.
+    ///
+    /// @param [in] name Имя ключа.
+    /// @return Результат операции.
+    ///
+    /// Используется для поиска хранилища в файловой системе, см.
+    /// CatalogWatcher.
+    ///
+    bool WriteMarker(const std::wstring& name) const;
+    ///
+    /// Удалить из папки хранилища ключ-метку.
+    ///
+    /// @param [in] name Имя ключа.
+    ///
+    void RemoveMarker(const std::wstring& name) const;
+#ifdef USE_SECRET_STORAGE
+    ///
+    /// Обратный вызов для индикации хода массовой операции.
+    ///
+    /// Параметры: признак второго прохода (удаления копий паролей), число
+    /// записей, обработанных в текущем проходе, и общее число записей.
+    ///
+    typedef std::function<void(bool, unsigned int, unsigned int)>
+      ProgressCallback;
+
+    ///
+    /// Перенести пароли всех записей в другое хранилище паролей.
+    ///
+    /// @param [in] points Переносимые записи.
+    /// @param [in] toSecretStorage true -- перенос из реестра в безопасное
+    ///                             хранилище, false -- обратно.
+    /// @param [in] progress Индикатор хода операции (необязательный).
+    /// @param [out] failed Идентификаторы записей, пароли которых сохранить
+    ///                     в новом хранилище не удалось, если хранилище не
+    ///                     сменено; иначе -- записей, старые копии паролей
+    ///                     которых удалить не удалось.
+    /// @return true, если пароли всех записей сохранены в новом хранилище, и
+    ///         оно должно сменить старое.
+    ///
+    /// Обращения к безопасному хранилищу выполняются параллельно, не более
+    /// чем в MigrationConcurrency потоках, изменения в реестре -- в
+    /// вызывающем потоке. Индикатор вызывается в вызывающем потоке, ход
+    /// каждого из двух проходов (см. ниже) индицируется отдельно.
+    ///
+    /// Сначала пароли всех записей сохраняются в новом хранилище, старые
+    /// копии при этом не трогаются. Если это удалось для всех записей,
+    /// старые копии удаляются; неудача удаления также попадает в failed,
+    /// поскольку в старом хранилище остается "мусор". Иначе удаляются уже
+    /// сохраненные новые копии, и в силе остается старое хранилище: ни одна
+    /// запись не остается без пароля.
+    ///
+    /// Значение параметра конфигурации "использовать безопасное хранилище"
+    /// метод не меняет; если метод вернул false, вызывающий код должен
+    /// вернуть прежнее значение.
+    ///
+    bool SwitchPasswordStorage(const std::map<std::wstring, MountPoint>& points,
+                               bool toSecretStorage,
+                               const ProgressCallback& progress,
+                               std::vector<std::wstring>& failed);
+#endif
 
   private:
+#ifdef USE_SECRET_STORAGE
+    static const unsigned int MigrationConcurrency; ///< Число параллельных
+                                                    ///< обращений к безопасному
+                                                    ///< хранилищу при переносе
+                                                    ///< паролей.
+
+    ///
+    /// Записать в реестр пароль записи в зашифрованном виде.
+    ///
+    /// @param [in] point Запись.
+    /// @param [in] clear true -- вместо пароля записать пустое значение.
+    /// @return Результат операции.
+    ///
+    bool SavePasswordValue(const MountPoint& point, bool clear) const;
+#endif
+
     static const wchar_t* StoragePath; ///< Подпапка реестра, в которой
                                        ///< хранятся записи.
     static const wchar_t* StorageVersionKey; ///< Имя ключа реестра с версией
@@ -177,12 +309,35 @@ class MountPointStorage: public RegistryStorage
     /// Загрузить следующую запись из хранилища.
     ///
     /// @param [in,out] point Буфер для загружаемой записи.
+    ///
+    /// @param [in] deferSecret Не искать пароль в безопасном хранилище:
+    ///                         его ищет вызывающий код.
     /// @return Результат загрузки.
     ///
     /// Возвращает true, если загрузка прошла успешно, false - в прочих
     /// случаях. Если загрузка не удалась, содержимое буфера не меняется.
     ///
-    bool Load(MountPoint& point) const;
+    bool Load(MountPoint& point, bool deferSecret = false) const;
+#ifdef USE_SECRET_STORAGE
+    ///
+    /// Загрузить пароли записей из безопасного хранилища.
+    ///
+    /// @param [in,out] points Записи, загруженные без паролей.
+    ///
+    /// Поиски паролей (см. PasswordTask()) выполняются одновременно в одном
+    /// главном цикле glib вызывающего потока, см. GioTask::RunAll(). Запись,
+    /// пароль которой не найден, остается без пароля: пусть пользователь
+    /// введет его заново.
+    ///
+    static void LoadPasswords(std::map<std::wstring, MountPoint>& points);
+    ///
+    /// Сопрограмма поиска пароля записи в безопасном хранилище.
+    ///
+    /// @param [in,out] point Запись; должна существовать до завершения
+    ///                       сопрограммы.
+    ///
+    static GioTask<> PasswordTask(MountPoint& point);
+#endif
 
     DWORD m_version; ///< Версия данных, загружаемая из хранилища.
 };
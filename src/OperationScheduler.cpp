@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <glibmm/error.h>
+#include "Metrics.h"
+#include "Trace.h"
+#include "OperationScheduler.h"
+
+OperationScheduler::OperationScheduler():
+  m_concurrency(0),
+  m_active(0),
+  m_backgroundLimit(0),
+  m_background(0),
+  m_aging(0),
+  m_rate(0),
+  m_quit(true)
+{
+  for (auto& holds : m_holds) holds = 0;
+}
+
+OperationScheduler::~OperationScheduler()
+{
+  quit();
+}
+
+void OperationScheduler::run(unsigned int concurrency, unsigned int rate)
+{
+  if (m_thread) return;
+  m_concurrency = std::max(concurrency, 1u);
+  m_rate = rate;
+  m_pool.reset(new WorkerPool(m_concurrency));
+  m_quit = false;
+  m_thread = std::make_shared<std::thread>(std::bind(&OperationScheduler::loop,
+                                                     this));
+}
+
+void OperationScheduler::quit()
+{
+  if (!m_thread) return;
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_quit = true;
+    m_entries.clear();
+  }
+  m_wake.notify_all();
+  m_thread->join();
+  m_thread.reset();
+  // дожидаемся выполняемых операций; назначать новые они уже не смогут
+  m_pool.reset();
+  m_starts.clear();
+  m_occupied.clear();
+  m_active = 0;
+  m_background = 0;
+}
+
+void OperationScheduler::setLaneLimit(const std::wstring& kind,
+                                      unsigned int limit)
+{
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    if (limit > 0) m_limits[kind] = limit;
+      else m_limits.erase(kind);
+  }
+  m_wake.notify_all();
+}
+
+void OperationScheduler::setBackgroundLimit(unsigned int limit)
+{
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_backgroundLimit = limit;
+  }
+  m_wake.notify_all();
+}
+
+void OperationScheduler::setAging(std::chrono::milliseconds step)
+{
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_aging = step;
+  }
+  m_wake.notify_all();
+}
+
+bool OperationScheduler::awaitForeground(std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lck(m_mutex);
+  return m_wake.wait_for(lck, timeout,
+                         [this] () { return foreground() == PrioritiesNumber; });
+}
+
+void OperationScheduler::schedule(const std::wstring& key,
+                                  const Operation& operation,
+                                  std::chrono::milliseconds delay,
+                                  const Traits& traits)
+{
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    if (m_quit) return;
+    Entry& entry = m_entries[key];
+    entry.operation = operation;
+    entry.due = std::chrono::steady_clock::now() + delay;
+    entry.traits = traits;
+  }
+  m_wake.notify_all();
+}
+
+void OperationScheduler::cancel(const std::wstring& key)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  m_entries.erase(key);
+}
+
+size_t OperationScheduler::pending()
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  return m_entries.size();
+}
+
+void OperationScheduler::loop()
+{
+  typedef std::pair<Priority, std::map<std::wstring, Entry>::iterator> Due;
+  std::unique_lock<std::mutex> lck(m_mutex);
+  while (!m_quit)
+  {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    // окно ограничения частоты запусков
+    while (!m_starts.empty() && (now - m_starts.front() >= std::chrono::minutes(1)))
+      m_starts.pop_front();
+    std::chrono::steady_clock::time_point wakeup = now + std::chrono::minutes(1);
+    // наступившие операции -- по приоритету, затем в порядке наступления
+    std::vector<Due> due;
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+      if (it->second.due > now) wakeup = std::min(wakeup, it->second.due);
+        else due.push_back(Due(effective(it->second, now), it));
+    std::stable_sort(due.begin(), due.end(),
+                     [] (const Due& a, const Due& b)
+                     {
+                       if (a.first != b.first) return a.first < b.first;
+                       return a.second->second.due < b.second->second.due;
+                     });
+    Priority held = foreground();
+    bool aging = false;
+    for (const auto& item : due)
+    {
+      // все рабочие потоки заняты, ждем завершения операции
+      if (m_active >= m_concurrency) break;
+      Entry& entry = item.second->second;
+      // оператор ждет более важную операцию вне планировщика
+      if (item.first > held)
+      {
+        aging = true;
+        continue;
+      }
+      // старение меняет очередность, но не делает фоновую операцию
+      // операцией оператора: предел фоновых потоков считается по
+      // назначенному приоритету
+      bool background = (entry.traits.priority == Background);
+      if (background && (m_backgroundLimit > 0) &&
+          (m_background >= m_backgroundLimit))
+      {
+        aging = true;
+        continue;
+      }
+      // заполненная полоса не задерживает операции других полос
+      if (!lanesFree(entry.traits)) continue;
+      if (entry.traits.throttled)
+      {
+        if ((m_rate > 0) && (m_starts.size() >= m_rate))
+        {
+          // лимит исчерпан, ждем освобождения окна
+          wakeup = std::min(wakeup, m_starts.front() + std::chrono::minutes(1));
+          continue;
+        }
+        m_starts.push_back(now);
+      }
+      occupy(entry.traits, 1);
+      m_active++;
+      if (background) m_background++;
+      m_pool->submit(std::bind(&OperationScheduler::execute, this,
+                               entry.operation, entry.traits, background));
+      m_entries.erase(item.second);
+    }
+    // отложенные по приоритету операции стареют
+    if (aging && (m_aging.count() > 0)) wakeup = std::min(wakeup, now + m_aging);
+    m_wake.wait_until(lck, wakeup);
+  }
+}
+
+OperationScheduler::Priority
+OperationScheduler::effective(const Entry& entry,
+                              std::chrono::steady_clock::time_point now) const
+{
+  int priority = entry.traits.priority;
+  if ((m_aging.count() > 0) && (now > entry.due))
+    priority -= static_cast<int>((now - entry.due) / m_aging);
+  return static_cast<Priority>(std::max(priority, static_cast<int>(Interactive)));
+}
+
+OperationScheduler::Priority OperationScheduler::foreground() const
+{
+  for (int priority = Interactive; priority < PrioritiesNumber; priority++)
+    if (m_holds[priority] > 0) return static_cast<Priority>(priority);
+  return PrioritiesNumber;
+}
+
+void OperationScheduler::hold(Priority priority, int delta)
+{
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_holds[priority] += delta;
+  }
+  m_wake.notify_all();
+}
+
+bool OperationScheduler::lanesFree(const Traits& traits) const
+{
+  for (const auto& lane : traits.lanes)
+  {
+    auto limit = m_limits.find(lane.kind);
+    if (limit == m_limits.end()) continue;
+    auto occupied = m_occupied.find(lane.kind + L':' + lane.name);
+    if ((occupied != m_occupied.end()) && (occupied->second >= limit->second))
+      return false;
+  }
+  return true;
+}
+
+void OperationScheduler::occupy(const Traits& traits, int delta)
+{
+  for (const auto& lane : traits.lanes)
+  {
+    std::wstring key(lane.kind + L':' + lane.name);
+    if (delta > 0) m_occupied[key]++;
+      else
+      {
+        auto it = m_occupied.find(key);
+        if ((it != m_occupied.end()) && (--it->second == 0)) m_occupied.erase(it);
+      }
+  }
+}
+
+void OperationScheduler::execute(const Operation& operation,
+                                 const Traits& traits, bool background)
+{
+  // исключение операции не должно ни завершить far2l, ни оставить занятыми
+  // полосы и рабочий поток
+  try
+  {
+    operation();
+  }
+  catch (const Glib::Error& ex)
+  {
+    Metrics::Instance().increment(Metrics::FailedOperations);
+    TRACE_ERROR("OperationScheduler::execute()", "Glib::Error: %s",
+                ex.what().c_str());
+  }
+  catch (const std::exception& ex)
+  {
+    Metrics::Instance().increment(Metrics::FailedOperations);
+    TRACE_ERROR("OperationScheduler::execute()", "std::exception: %s",
+                ex.what());
+  }
+  catch (...)
+  {
+    Metrics::Instance().increment(Metrics::FailedOperations);
+    TRACE_ERROR("OperationScheduler::execute()", "unknown exception");
+  }
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    occupy(traits, -1);
+    m_active--;
+    if (background) m_background--;
+  }
+  // освободилось место в полосах, пора запускать ожидающие операции
+  m_wake.notify_all();
+}
+
+OperationScheduler::Foreground::Foreground(OperationScheduler& scheduler,
+                                           Priority priority):
+  m_scheduler(scheduler),
+  m_priority(priority)
+{
+  m_scheduler.hold(m_priority, 1);
+}
+
+OperationScheduler::Foreground::~Foreground()
+{
+  m_scheduler.hold(m_priority, -1);
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "WorkerPool.h"
+
+///
+/// @brief Планировщик фоновых операций над ресурсами.
+
+/// Операции (функторы) назначаются на момент в будущем под уникальным
+/// ключом, например, "remount:<URL>". Повторное назначение операции с тем же
+/// ключом замещает прежнюю, еще не запущенную; назначенную операцию можно
+/// отменить. Наступившие операции выполняются в пуле рабочих потоков
+/// (WorkerPool) с ограниченным параллелизмом, в порядке наступления.
+///
+/// Операция может принадлежать нескольким полосам (Lane), например, полосе
+/// протокола и полосе узла. У каждого вида полос свой предел одновременно
+/// выполняемых операций (см. setLaneLimit()), и операция запускается, только
+/// если ни одна из ее полос не заполнена. Наступившие операции заполненной
+/// полосы ждут своей очереди, не задерживая операции других полос: зависший
+/// сервер SMB не отнимает у SFTP все рабочие потоки, а к одному узлу не
+/// открываются десятки сеансов разом.
+///
+/// У каждой операции есть приоритет (Priority): наступившие операции
+/// запускаются в порядке приоритета, а при равном -- в порядке наступления.
+/// Фоновые операции (Background) занимают не больше заданного числа рабочих
+/// потоков (см. setBackgroundLimit()), остальные потоки остаются
+/// операциям, которых ждет оператор. Пока оператор ждет операцию,
+/// выполняемую вне планировщика, например, монтирование в главном потоке
+/// far2l, планировщик не запускает операции ниже ее приоритета (см.
+/// Foreground). Чтобы фоновые операции все-таки продвигались, приоритет
+/// наступившей операции повышается на ступень за каждый интервал старения
+/// (см. setAging()), проведенный в ожидании; предел фоновых потоков
+/// по-прежнему считается по назначенному приоритету.
+///
+/// Кроме того, число запусков операций с признаком Traits::throttled
+/// ограничено в скользящем окне в одну минуту: если лимит исчерпан, такие
+/// операции ждут, пока не истечет минута с момента самого раннего из
+/// учтенных запусков. Так массовое отключение ресурсов не превращается в
+/// шквал переподключений.
+///
+/// Операция может сама назначать операции, в том числе с собственным
+/// ключом -- так реализуются повторы с нарастающей задержкой (см.
+/// Backoff::Delay()).
+///
+/// @author cycleg
+///
+class OperationScheduler
+{
+  public:
+    typedef std::function<void()> Operation; ///< Операция.
+
+    ///
+    /// Приоритет операции, по убыванию.
+    ///
+    enum Priority
+    {
+      Interactive = 0, ///< Операция, которой ждет оператор.
+      Visible, ///< Операция над ресурсом, видимым оператору.
+      Background, ///< Фоновое обслуживание.
+      PrioritiesNumber
+    };
+
+    ///
+    /// @brief Полоса выполнения.
+    ///
+    struct Lane
+    {
+      std::wstring kind; ///< Вид полосы, например, "proto" или "host".
+      std::wstring name; ///< Имя полосы внутри вида.
+    };
+
+    ///
+    /// @brief Свойства операции.
+    ///
+    struct Traits
+    {
+      std::vector<Lane> lanes; ///< Полосы операции.
+      bool throttled; ///< Запуск учитывается в ограничении частоты.
+      Priority priority; ///< Приоритет операции.
+
+      Traits(): throttled(false), priority(Background) {}
+    };
+
+    ///
+    /// @brief Операция, которой ждет оператор, вне планировщика.
+    ///
+    /// Пока экземпляр существует, планировщик не запускает операции с
+    /// приоритетом ниже заданного, с учетом старения. Уже запущенные
+    /// операции не прерываются.
+    ///
+    class Foreground
+    {
+      public:
+        Foreground(OperationScheduler& scheduler, Priority priority);
+        ~Foreground();
+
+        Foreground(const Foreground&) = delete;
+        Foreground& operator=(const Foreground&) = delete;
+
+      private:
+        OperationScheduler& m_scheduler; ///< Планировщик.
+        Priority m_priority; ///< Приоритет операции.
+    };
+
+    ///
+    /// Конструктор.
+    ///
+    OperationScheduler();
+    ///
+    /// Деструктор.
+    ///
+    ~OperationScheduler();
+
+    ///
+    /// Запустить планировщик.
+    ///
+    /// @param [in] concurrency Число одновременно выполняемых операций.
+    /// @param [in] rate Предельное число запусков операций с признаком
+    ///                  Traits::throttled в минуту; 0 -- без ограничения.
+    ///
+    void run(unsigned int concurrency, unsigned int rate);
+    ///
+    /// Остановить планировщик.
+    ///
+    /// Назначенные операции отменяются, выполняемые -- дожидаются
+    /// завершения. После остановки новые операции не назначаются.
+    ///
+    void quit();
+    ///
+    /// Задать предел одновременно выполняемых операций в полосах вида.
+    ///
+    /// @param [in] kind Вид полос.
+    /// @param [in] limit Предел для каждой полосы этого вида; 0 -- без
+    ///                   ограничения (по умолчанию).
+    ///
+    void setLaneLimit(const std::wstring& kind, unsigned int limit);
+    ///
+    /// Задать предел одновременно выполняемых фоновых операций.
+    ///
+    /// @param [in] limit Предел для операций с приоритетом Background (с
+    ///                   учетом старения); 0 -- без ограничения (по
+    ///                   умолчанию).
+    ///
+    void setBackgroundLimit(unsigned int limit);
+    ///
+    /// Задать интервал старения.
+    ///
+    /// @param [in] step Время ожидания наступившей операции, за которое ее
+    ///                  приоритет повышается на ступень; 0 -- без старения
+    ///                  (по умолчанию).
+    ///
+    void setAging(std::chrono::milliseconds step);
+    ///
+    /// Дождаться, пока оператор не ждет ни одной операции (см.
+    /// Foreground).
+    ///
+    /// @param [in] timeout Предельное время ожидания.
+    /// @return Операций, которых ждет оператор, нет.
+    ///
+    /// Для фоновых работ вне планировщика, например, проверки сеансов связи
+    /// (KeepaliveProber).
+    ///
+    bool awaitForeground(std::chrono::milliseconds timeout);
+
+    ///
+    /// Назначить операцию.
+    ///
+    /// @param [in] key Ключ операции.
+    /// @param [in] operation Операция.
+    /// @param [in] delay Задержка запуска.
+    /// @param [in] traits Свойства операции.
+    ///
+    void schedule(const std::wstring& key, const Operation& operation,
+                  std::chrono::milliseconds delay = std::chrono::milliseconds(0),
+                  const Traits& traits = Traits());
+    ///
+    /// Отменить назначенную, но еще не запущенную операцию.
+    ///
+    /// @param [in] key Ключ операции.
+    ///
+    void cancel(const std::wstring& key);
+    ///
+    /// @return Число назначенных, но еще не запущенных операций.
+    ///
+    size_t pending();
+
+  private:
+    ///
+    /// @brief Назначенная операция.
+    ///
+    struct Entry
+    {
+      Operation operation; ///< Операция.
+      std::chrono::steady_clock::time_point due; ///< Момент запуска.
+      Traits traits; ///< Свойства операции.
+    };
+
+    ///
+    /// Цикл запуска наступивших операций.
+    ///
+    void loop();
+    ///
+    /// Приоритет наступившей операции с учетом старения.
+    ///
+    /// @param [in] entry Операция.
+    /// @param [in] now Текущий момент.
+    /// @return Приоритет.
+    ///
+    Priority effective(const Entry& entry,
+                       std::chrono::steady_clock::time_point now) const;
+    ///
+    /// @return Наивысший приоритет операций, которых ждет оператор, или
+    ///         PrioritiesNumber, если таких нет.
+    ///
+    Priority foreground() const;
+    ///
+    /// Учесть начало или завершение операции, которой ждет оператор.
+    ///
+    /// @param [in] priority Приоритет операции.
+    /// @param [in] delta +1 при начале, -1 при завершении.
+    ///
+    void hold(Priority priority, int delta);
+    ///
+    /// Проверить, есть ли место во всех полосах операции.
+    ///
+    /// @param [in] traits Свойства операции.
+    /// @return Ни одна полоса не заполнена.
+    ///
+    bool lanesFree(const Traits& traits) const;
+    ///
+    /// Учесть запуск или завершение операции в ее полосах.
+    ///
+    /// @param [in] traits Свойства операции.
+    /// @param [in] delta +1 при запуске, -1 при завершении.
+    ///
+    void occupy(const Traits& traits, int delta);
+    ///
+    /// Выполнить операцию в рабочем потоке и учесть ее завершение.
+    ///
+    /// Исключение, выпущенное операцией, перехватывается: оно записывается
+    /// в трассировку и учитывается счетчиком Metrics::FailedOperations, а
+    /// завершение операции учитывается как обычно.
+    ///
+    /// @param [in] operation Операция.
+    /// @param [in] traits Свойства операции.
+    /// @param [in] background Операция учтена как фоновая.
+    ///
+    void execute(const Operation& operation, const Traits& traits,
+                 bool background);
+
+    std::map<std::wstring, Entry> m_entries; ///< Назначенные операции.
+    std::deque<std::chrono::steady_clock::time_point> m_starts; ///< Моменты
+                                                                ///< запусков
+                                                                ///< за
+                                                                ///< последнюю
+                                                                ///< минуту.
+    std::map<std::wstring, unsigned int> m_limits; ///< Пределы полос по
+                                                   ///< видам.
+    std::map<std::wstring, unsigned int> m_occupied; ///< Выполняемые операции
+                                                     ///< по полосам, ключ --
+                                                     ///< "вид:имя".
+    unsigned int m_concurrency; ///< Число одновременно выполняемых операций.
+    unsigned int m_active; ///< Число выполняемых операций.
+    unsigned int m_backgroundLimit; ///< Предел фоновых операций.
+    unsigned int m_background; ///< Число выполняемых фоновых операций.
+    std::chrono::milliseconds m_aging; ///< Интервал старения.
+    unsigned int m_holds[PrioritiesNumber]; ///< Число операций, которых ждет
+                                            ///< оператор, по приоритетам.
+    unsigned int m_rate; ///< Предельное число запусков в минуту.
+    std::unique_ptr<WorkerPool> m_pool; ///< Пул выполнения операций.
+    bool m_quit; ///< Флаг остановки.
+    std::mutex m_mutex; ///< Мутекс всех полей выше, кроме m_pool.
+    std::condition_variable m_wake; ///< Сигнал об изменении m_entries или
+                                    ///< завершении операции.
+    std::shared_ptr<std::thread> m_thread; ///< Поток планировщика.
+};
@@ -1,12 +1,31 @@
-#include <iostream> // debug output
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cwchar>
+#include <functional>
+#include <optional>
+#include <unordered_set>
 #include <WideMB.h> // far2l/utils
 #include <PlatformConstants.h> // far2l/utils
+#include "Backoff.h"
+#include "CatalogFile.h"
 #include "Configuration.h"
+#include "CredentialCache.h"
 #include "dialogs.h"
+#ifdef USE_FAKE_BACKEND
+#include "FakeMountBackend.h"
+#endif // USE_FAKE_BACKEND
 #include "GvfsService.h"
 #include "GvfsServiceMonitor.h"
+#include "HostListReader.h"
+#include "ImportBatch.h"
+#include "KeepaliveProber.h"
 #include "LngStringIDs.h"
+#include "Metrics.h"
 #include "MountPointStorage.h"
+#include "OperationScheduler.h"
+#include "SessionStateStorage.h"
+#include "Trace.h"
 #include "UiCallbacks.h"
 #include "Plugin.h"
 
@@ -15,6 +34,35 @@
 // чтобы TEXT из WinCompat.h работал с макросом
 #define MACRO_TEXT(s) TEXT(s)
 
+const unsigned int Plugin::SchedulerConcurrency = 8;
+const unsigned int Plugin::RecentSize = 8;
+
+namespace {
+
+// названия метрик в диалоге диагностики, в порядке перечислений Metrics
+const int HistogramNames[] = {
+    MDiagMount, MDiagUnmount, MDiagProbe, MDiagSecretLookup,
+    MDiagRegistryRead, MDiagRegistryWrite, MDiagKeepalive
+};
+const int CounterNames[] = {
+    MDiagEvents, MDiagMountRetries, MDiagMountFailures, MDiagUnmountFailures,
+    MDiagStatusCacheHits, MDiagKeepaliveFailures, MDiagRemounts,
+    MDiagSpeculativeMounts, MDiagSpeculativeHits, MDiagSpeculativeUnused,
+    MDiagWarmUpMounts, MDiagSharedPasswords, MDiagSharedAnswers,
+    MDiagRestoredStates, MDiagRestoreCorrections, MDiagStaleMounts,
+    MDiagUnreachableHosts, MDiagFailedOperations
+};
+const int GaugeNames[] = { MDiagMounted, MDiagQueueDepth };
+
+static_assert(ARRAYSIZE(HistogramNames) == Metrics::HistogramsNumber,
+              "HistogramNames must match Metrics::Histogram");
+static_assert(ARRAYSIZE(CounterNames) == Metrics::CountersNumber,
+              "CounterNames must match Metrics::Counter");
+static_assert(ARRAYSIZE(GaugeNames) == Metrics::GaugesNumber,
+              "GaugeNames must match Metrics::Gauge");
+
+} // anonymous namespace
+
 Plugin& Plugin::getInstance()
 {
     static Plugin instance;
@@ -22,7 +70,8 @@ Plugin& Plugin::getInstance()
 }
 
 Plugin::Plugin():
-  m_firstDemand(true)
+  m_exiting(false),
+  m_statusDemand(true)
 {
     Opt.AddToDisksMenu = true;
     Opt.AddToPluginsMenu = true;
@@ -33,6 +82,35 @@ Plugin::~Plugin()
     clearPanelItems();
 }
 
+Plugin::ProcessedPoint::ProcessedPoint(Plugin& plugin, const std::wstring& url):
+    m_plugin(plugin),
+    m_point(nullptr)
+{
+    std::lock_guard<TimedMutex> lck(m_plugin.m_pointsMutex);
+    m_previous = m_plugin.m_processedPointId;
+    auto it = m_plugin.m_mountPoints.find(url);
+    if (it == m_plugin.m_mountPoints.end()) return;
+    m_point = &it->second;
+    m_plugin.m_processedPointId = m_point->getStorageId();
+}
+
+Plugin::ProcessedPoint::~ProcessedPoint()
+{
+    std::set<std::wstring> deferred;
+    {
+        std::lock_guard<TimedMutex> lck(m_plugin.m_pointsMutex);
+        m_plugin.m_processedPointId = m_previous;
+        if (m_previous.empty()) deferred.swap(m_plugin.m_deferredCatalogIds);
+    }
+    // изменения хранилища, отложенные на время операции
+    Plugin* plugin = &m_plugin;
+    for (const auto& id : deferred)
+        m_plugin.m_scheduler.schedule(
+            L"catalog:" + id,
+            [plugin, id] () { plugin->onCatalogChanged({ id }, false); }
+        );
+}
+
 int Plugin::getVersion()
 {
     return 1;
@@ -42,6 +120,7 @@ void Plugin::setStartupInfo(const PluginStartupInfo* psi)
 {
     static const wchar_t* emptyHint = L"";
     m_pPsi = *psi;
+    Trace::Start();
 
     // key bar
     // all blocked in processKey()
@@ -53,7 +132,8 @@ void Plugin::setStartupInfo(const PluginStartupInfo* psi)
             .setShiftKey(5, emptyHint);
     for (int i = 2; i < 6; i++) m_keyBar.setAltKey(i, emptyHint);
 
-    m_keyBar.setNormalKey(6, m_pPsi.GetMsg(m_pPsi.ModuleNumber, MF7Bar))
+    m_keyBar.setNormalKey(1, m_pPsi.GetMsg(m_pPsi.ModuleNumber, MF2Bar))
+            .setNormalKey(6, m_pPsi.GetMsg(m_pPsi.ModuleNumber, MF7Bar))
             .setShiftKey(3, m_pPsi.GetMsg(m_pPsi.ModuleNumber, MF7Bar))
             .setShiftKey(7, m_pPsi.GetMsg(m_pPsi.ModuleNumber, MShiftF8Bar));
     m_registryRoot.append(m_pPsi.RootKey);
@@ -65,38 +145,125 @@ void Plugin::setStartupInfo(const PluginStartupInfo* psi)
     // load mount points from registry
     MountPointStorage storage(m_registryRoot);
     storage.LoadAll(m_mountPoints);
+    // состояние ресурсов с прошлого запуска в том же сеансе GVFS: панель
+    // показывает его сразу, без опроса GVFS, а проверяется оно в фоне
+    std::vector<std::wstring> restored;
+    SessionStateStorage session(m_registryRoot);
+    if (Configuration::Instance()->persistSession())
+        session.Restore(m_mountPoints, restored);
+        else session.Invalidate();
+    Metrics::Instance().increment(Metrics::RestoredStates, restored.size());
+    // изменения хранилища другими экземплярами far2l
+    m_catalogWatcher.run(m_registryRoot,
+                         std::bind(&Plugin::onCatalogChanged, this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2));
     // gtkmm initialization
     Gio::init();
+#ifdef USE_FAKE_BACKEND
+    // сценарий имитации механизма монтирования для измерений
+    const char* fakeScript = std::getenv("GVFSPANEL_FAKE_BACKEND");
+    if (fakeScript && *fakeScript)
+    {
+        std::shared_ptr<FakeMountBackend> backend =
+            std::make_shared<FakeMountBackend>();
+        std::string error;
+        if (backend->load(fakeScript, error))
+            MountBackend::Install(backend);
+            else TRACE_ERROR("Plugin::setStartupInfo()", "fake backend: %s",
+                             error.c_str());
+    }
+#endif // USE_FAKE_BACKEND
     // Запускается главный цикл обработки сигналов от gtkmm (glib).
     GvfsServiceMonitor::instance().run();
+    // показатели собираются только при показе диагностики
+    Metrics::Instance().setSampler(Metrics::MountedCount,
+        [this] () -> long
+        {
+            std::lock_guard<TimedMutex> lck(m_pointsMutex);
+            return std::count_if(m_mountPoints.begin(), m_mountPoints.end(),
+                                 [] (const auto& point)
+                                 { return point.second.isMounted(); });
+        });
+    Metrics::Instance().setSampler(Metrics::QueueDepth,
+        [] () -> long { return GvfsServiceMonitor::instance().queueDepth(); });
+    // фоновые операции над ресурсами
+    Configuration* config = Configuration::Instance();
+    CredentialCache::Instance().setEnabled(config->shareCredentials());
+    m_scheduler.setLaneLimit(L"proto", config->protocolConcurrency());
+    m_scheduler.setLaneLimit(L"host", config->hostConcurrency());
+    m_scheduler.setLaneLimit(L"warmup", config->warmUpConcurrency());
+    m_scheduler.setBackgroundLimit(config->backgroundConcurrency());
+    m_scheduler.setAging(std::chrono::milliseconds(config->schedulerAging()));
+    m_scheduler.run(SchedulerConcurrency, config->remountRate());
+    for (const auto& url : restored)
+        m_scheduler.schedule(L"verify:" + url,
+                             std::bind(&Plugin::verifyRestored, this, url),
+                             std::chrono::milliseconds(0), ResourceLanes(url));
+    // проверка сеансов связи со смонтированными ресурсами
+    m_prober.setGate(
+        [this] ()
+        {
+            m_scheduler.awaitForeground(std::chrono::milliseconds(
+                Configuration::Instance()->schedulerAging()
+            ));
+        });
+    m_prober.run(config->keepaliveInterval(), config->keepaliveMaxInterval(),
+                 config->keepaliveTimeout(),
+                 std::bind(&Plugin::keepaliveTargets, this,
+                           std::placeholders::_1),
+                 std::bind(&Plugin::onKeepalive, this, std::placeholders::_1,
+                           std::placeholders::_2));
+    // рабочий набор ресурсов готов к тому моменту, когда понадобится
+    warmUp();
 }
 
 void Plugin::exitFar()
 {
+    Metrics::Instance().setSampler(Metrics::MountedCount, Metrics::Sampler());
+    Metrics::Instance().setSampler(Metrics::QueueDepth, Metrics::Sampler());
+    {
+        // иначе остановка планировщика ждала бы завершения монтирований
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        m_exiting = true;
+        for (auto& mount : m_backgroundMounts) mount.second.cancellable->cancel();
+    }
+    m_scheduler.quit();
+    m_prober.quit();
+    m_catalogWatcher.quit();
     GvfsServiceMonitor::instance().quit();
-    if (Configuration::Instance()->unmountAtExit())
+    for (auto& mntPoint : m_mountPoints)
     {
-        for (auto& mntPoint : m_mountPoints)
+        bool needUnmount = false;
+        if (Configuration::Instance()->unmountAtExit())
         {
             // unmount all known VFS
-            bool needUnmount = mntPoint.second.isMounted();
+            needUnmount = mntPoint.second.isMounted();
             if (Configuration::Instance()->unmountThisSessionOnly())
               // unmount all VFS, mounted in current session
               needUnmount = needUnmount && mntPoint.second.wasMounted();
-            if (needUnmount)
-                try
-                {
-                    GvfsService service;
-                    m_processedPointId = mntPoint.second.getStorageId();
-                    mntPoint.second.unmount(&service);
-                    m_processedPointId.clear();
-                }
-                catch (const GvfsServiceException& error)
-                {
-                    // ignore error here
-                }
         }
+        // невостребованные упреждающие монтирования не переживают сеанс
+        if (m_speculative.count(mntPoint.first) > 0)
+            needUnmount = mntPoint.second.isMounted();
+        if (needUnmount)
+            try
+            {
+                GvfsService service;
+                ProcessedPoint processed(*this, mntPoint.first);
+                mntPoint.second.unmount(&service);
+            }
+            catch (const GvfsServiceException& error)
+            {
+                // ignore error here
+            }
     }
+    if (Configuration::Instance()->persistSession())
+    {
+        SessionStateStorage session(m_registryRoot);
+        session.Save(m_mountPoints);
+    }
+    Trace::Stop();
 }
 
 void Plugin::getPluginInfo(PluginInfo* info)
@@ -135,14 +302,8 @@ int Plugin::configure(int item)
 #ifdef USE_SECRET_STORAGE
       if (changeStorage != Configuration::Instance()->useSecretStorage())
       {
-        // сменилось хранилище паролей, обновляем записи ресурсов
-        MountPointStorage storage(m_registryRoot);
-        for (auto& mountPoint : m_mountPoints)
-        {
-            storage.Delete(mountPoint.second);
-            // TODO: save error
-            storage.Save(mountPoint.second);
-        }
+        // сменилось хранилище паролей, переносим пароли ресурсов
+        switchPasswordStorage(Configuration::Instance()->useSecretStorage());
       }
 #endif
     }
@@ -154,17 +315,26 @@ HANDLE Plugin::openPlugin(int openFrom, INT_PTR item)
     UNUSED(openFrom)
     UNUSED(item)
 
+    m_statusDemand = true;
+    m_dwellUrl.clear();
+    if (Configuration::Instance()->speculativeMount()) speculateRecent();
     return static_cast<HANDLE>(this);
 }
 
 void Plugin::closePlugin(HANDLE Plugin)
 {
-    UNUSED(Plugin)
+    if (!getFilePanel(Plugin)) m_scheduler.cancel(L"speculate");
+    m_filePanels.erase(Plugin);
 }
 
 void Plugin::getOpenPluginInfo(HANDLE Plugin, OpenPluginInfo* pluginInfo)
 {
-    UNUSED(Plugin)
+    CatalogFilePanel* filePanel = getFilePanel(Plugin);
+    if (filePanel)
+    {
+        filePanel->getOpenPluginInfo(pluginInfo);
+        return;
+    }
 
     static const wchar_t* pluginPanelTitle = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MGvfsPanel);
     pluginInfo->StructSize = sizeof(*pluginInfo);
@@ -189,12 +359,18 @@ void Plugin::getOpenPluginInfo(HANDLE Plugin, OpenPluginInfo* pluginInfo)
 
 int Plugin::getFindData(HANDLE Plugin, PluginPanelItem** PanelItem, int* itemsNumber, int OpMode)
 {
-    UNUSED(Plugin)
     UNUSED(OpMode)
 
-    if (m_firstDemand)
+    CatalogFilePanel* filePanel = getFilePanel(Plugin);
+    if (filePanel)
+    {
+        filePanel->getFindData(PanelItem, itemsNumber);
+        return 1;
+    }
+
+    if (m_statusDemand)
     {
-      m_firstDemand = false;
+      m_statusDemand = false;
       checkResourcesStatus();
     }
     updatePanelItems();
@@ -222,9 +398,37 @@ int Plugin::processHostFile(HANDLE Plugin, PluginPanelItem* PanelItem, int items
 
 int Plugin::processKey(HANDLE Plugin, int key, unsigned int controlState)
 {
-#ifndef NDEBUG
-    std::cout << "Plugin::processKey() key = " << key << std::endl;
-#endif // NDEBUG
+    TRACE_DEBUG("Plugin::processKey()", "key = %d", key);
+    CatalogFilePanel* filePanel = getFilePanel(Plugin);
+    if (filePanel)
+    {
+        if ((controlState == 0) && (key == VK_F5))
+        {
+            // import catalog file
+            const wchar_t* msgItems[2] = { nullptr };
+            msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MImportCatalog);
+            msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCatalogImportConfirm);
+            if (m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_MB_YESNO, nullptr,
+                               msgItems, ARRAYSIZE(msgItems), 0) == 0)
+            {
+                importCatalog(filePanel->getFileName());
+                m_pPsi.Control(PANEL_PASSIVE, FCTL_UPDATEPANEL, 0, 0);
+                m_pPsi.Control(PANEL_PASSIVE, FCTL_REDRAWPANEL, 0, 0);
+            }
+            return 1;
+        }
+        // catalog file panel is read only, block all modifying keys
+        if (((controlState == 0) && (key >= VK_F3) && (key <= VK_F8)) ||
+            ((controlState == PKF_SHIFT) && (key >= VK_F1) && (key <= VK_F8)) ||
+            ((controlState == PKF_ALT) && (key >= VK_F3) && (key <= VK_F6)))
+            return 1;
+        return 0;
+    }
+    if ((controlState == 0) && (key == VK_F2))
+    {
+        commandsMenu(Plugin);
+        return 1;
+    }
     if (((controlState == 0) && ((key == VK_F3) || (key == VK_F5) || (key == VK_F6))) ||
         ((controlState == PKF_SHIFT) && 
          (((key >= VK_F1) && (key <= VK_F3)) || (key == VK_F5) || (key == VK_F6))) ||
@@ -240,9 +444,11 @@ int Plugin::processKey(HANDLE Plugin, int key, unsigned int controlState)
         if (!item) return 1; // no item, drop key
         std::wstring name = item->CustomColumnData[1];
         free(item);
-        auto it = m_mountPoints.find(name);
-        if (it == m_mountPoints.end()) return 1; // no point, drop key
-        if (it->second.isMounted())
+        // пока ресурс отмечен, наблюдатель за хранилищем его не трогает
+        ProcessedPoint processed(*this, name);
+        MountPoint* point = processed.point();
+        if (point == nullptr) return 1; // no point, drop key
+        if (point->isMounted())
         {
             const wchar_t* msgItems[2] = { nullptr };
             msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceTitle);
@@ -251,10 +457,15 @@ int Plugin::processKey(HANDLE Plugin, int key, unsigned int controlState)
                            nullptr, msgItems, ARRAYSIZE(msgItems), 0);
             return 1;
         }
-        MountPoint changedMountPt(it->second);
+        MountPoint changedMountPt(*point);
         if (!EditResourceDlg(m_pPsi, changedMountPt)) return 1;
+        std::unique_lock<TimedMutex> lck(m_pointsMutex, std::defer_lock);
+        // запираем "вручную", чтобы освободить мутекс до завершения
+        // метода и избежать клинча в checkResourcesStatus()
+        lck.lock();
         if (checkMountpointDuplicate(changedMountPt))
         {
+          lck.unlock();
           const wchar_t* msgItems[2] = { nullptr };
           msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceTitle);
           msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceAlreadyExists);
@@ -262,12 +473,8 @@ int Plugin::processKey(HANDLE Plugin, int key, unsigned int controlState)
                          nullptr, msgItems, ARRAYSIZE(msgItems), 0);
           return 1;
         }
-        std::unique_lock<std::mutex> lck(m_pointsMutex, std::defer_lock);
-        // запираем "вручную", чтобы освободить мутекс до завершения
-        // метода и избежать клинча в checkResourcesStatus()
-        lck.lock();
         MountPointStorage storage(m_registryRoot);
-        m_mountPoints.erase(it);
+        m_mountPoints.erase(name);
         m_mountPoints.insert(std::pair<std::wstring, MountPoint>(
             changedMountPt.getUrl(), changedMountPt
         ));
@@ -282,8 +489,11 @@ int Plugin::processKey(HANDLE Plugin, int key, unsigned int controlState)
         // add new resource
         MountPoint point(MountPointStorage::PointFactory());
         if (!EditResourceDlg(m_pPsi, point)) return 1;
+        std::unique_lock<TimedMutex> lck(m_pointsMutex, std::defer_lock);
+        lck.lock();
         if (checkMountpointDuplicate(point))
         {
+            lck.unlock();
             const wchar_t* msgItems[2] = { nullptr };
             msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceTitle);
             msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceAlreadyExists);
@@ -291,8 +501,6 @@ int Plugin::processKey(HANDLE Plugin, int key, unsigned int controlState)
                            nullptr, msgItems, ARRAYSIZE(msgItems), 0);
             return 1;
         }
-        std::unique_lock<std::mutex> lck(m_pointsMutex, std::defer_lock);
-        lck.lock();
         MountPointStorage storage(m_registryRoot);
         m_mountPoints.insert(std::pair<std::wstring, MountPoint>(
             point.getUrl(), point
@@ -310,10 +518,11 @@ int Plugin::processKey(HANDLE Plugin, int key, unsigned int controlState)
         if (!item) return 1; // no item, drop key
         std::wstring name = item->CustomColumnData[1];
         free(item);
-        auto it = m_mountPoints.find(name);
-        if ((it != m_mountPoints.end()) && it->second.isMounted())
+        ProcessedPoint processed(*this, name);
+        MountPoint* point = processed.point();
+        if ((point != nullptr) && point->isMounted())
         {
-            unmountResource(it->second);
+            unmountResource(*point);
             m_pPsi.Control(Plugin, FCTL_UPDATEPANEL, 0, 0);
             m_pPsi.Control(Plugin, FCTL_REDRAWPANEL, 0, 0);
         }
@@ -332,43 +541,59 @@ int Plugin::processKey(HANDLE Plugin, int key, unsigned int controlState)
 
 int Plugin::processEvent(HANDLE Plugin, int Event, void* Param)
 {
-    UNUSED(Plugin)
-    UNUSED(Event)
     UNUSED(Param)
 
+    // курсор двигается с перерисовкой панели, FE_IDLE ловит остановку
+    if (((Event == FE_REDRAW) || (Event == FE_IDLE)) && !getFilePanel(Plugin) &&
+        Configuration::Instance()->speculativeMount())
+        trackCursor(Plugin);
     return 0;
 }
 
 int Plugin::setDirectory(HANDLE Plugin, const wchar_t* Dir, int OpMode)
 {
+    if (getFilePanel(Plugin)) return 0;
     if(OpMode == 0)
     {
-        auto it = m_mountPoints.find(std::wstring(Dir));
-        if (it != m_mountPoints.end())
+        claimBackgroundMount(std::wstring(Dir));
+        // пока ресурс отмечен, наблюдатель за хранилищем его не трогает, а
+        // фоновые потоки пропускают
+        ProcessedPoint processed(*this, std::wstring(Dir));
+        MountPoint* point = processed.point();
+        if (point != nullptr)
         {
-            if (!it->second.isMounted())
+            if (!point->isMounted())
             {
                 const wchar_t* msgItems[2] = { nullptr };
                 bool isMount = false;
                 HANDLE hScreen = nullptr;
-                if (it->second.getAskPassword())
+                // пароль, введенный для другого ресурса того же узла,
+                // спрашивать снова не нужно (см. CredentialCache)
+                if (!Unattended(*point))
                 {
-                  if (!AskPasswordDlg(m_pPsi, it->second)) return 0;
+                  if (!AskPasswordDlg(m_pPsi, *point)) return 0;
                 }
                 hScreen = m_pPsi.SaveScreen(0, 0, -1, -1);
+                // фоновые операции не запускаются, пока оператор ждет
+                OperationScheduler::Foreground foreground(
+                    m_scheduler, OperationScheduler::Interactive
+                );
                 try
                 {
                     UiCallbacks callbacks(m_pPsi);
                     GvfsService service(&callbacks);
+                    Configuration* config = Configuration::Instance();
+                    service.setRetryPolicy(GvfsService::RetryPolicy(
+                        config->mountAttempts(), config->mountRetryDelay(),
+                        config->mountRetryMaxDelay()
+                    )).setConnectTimeout(config->connectTimeout());
                     msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceMount);
                     msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MPleaseWait);
                     m_pPsi.Message(m_pPsi.ModuleNumber, 0, nullptr, msgItems,
                                    ARRAYSIZE(msgItems), 0);
                     // для сообщения об ошибке
                     msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MMountError);
-                    m_processedPointId = it->second.getStorageId();
-                    isMount = it->second.mount(&service);
-                    m_processedPointId.clear();
+                    isMount = point->mount(&service);
                 }
                 catch (const GvfsServiceException& error)
                 {
@@ -380,10 +605,20 @@ int Plugin::setDirectory(HANDLE Plugin, const wchar_t* Dir, int OpMode)
                 m_pPsi.RestoreScreen(hScreen);
                 if (!isMount) return 0;
             }
+            else
+            {
+                // только что смонтированный ресурс ответил при монтировании
+                if (!checkResourceAlive(Plugin, *point)) return 0;
+            }
             // change directory to:
-            std::wstring dir = it->second.getMountPath();
+            std::wstring dir = point->getMountPath();
             if (!dir.empty())
             {
+                auto recent = std::find(m_recent.begin(), m_recent.end(),
+                                        point->getUrl());
+                if (recent != m_recent.end()) m_recent.erase(recent);
+                m_recent.push_front(point->getUrl());
+                if (m_recent.size() > RecentSize) m_recent.pop_back();
                 m_pPsi.Control(Plugin, FCTL_SETPANELDIR, 0, (LONG_PTR)(dir.c_str()));
                 return 1;
             }
@@ -394,10 +629,11 @@ int Plugin::setDirectory(HANDLE Plugin, const wchar_t* Dir, int OpMode)
 
 int Plugin::makeDirectory(HANDLE Plugin, const wchar_t** Name, int OpMode)
 {
-    UNUSED(Plugin)
     UNUSED(Name)
     UNUSED(OpMode)
 
+    if (getFilePanel(Plugin)) return -1;
+
     // add new resource
     MountPoint point(MountPointStorage::PointFactory());
     if (!EditResourceDlg(m_pPsi, point))
@@ -405,8 +641,10 @@ int Plugin::makeDirectory(HANDLE Plugin, const wchar_t** Name, int OpMode)
         // user cancelled operation
         return -1;
     }
+    std::unique_lock<TimedMutex> lck(m_pointsMutex);
     if (checkMountpointDuplicate(point))
       {
+          lck.unlock();
           const wchar_t* msgItems[2] = { nullptr };
           msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceTitle);
           msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceAlreadyExists);
@@ -415,7 +653,6 @@ int Plugin::makeDirectory(HANDLE Plugin, const wchar_t** Name, int OpMode)
       }
       else
       {
-          std::lock_guard<std::mutex> lck(m_pointsMutex);
           MountPointStorage storage(m_registryRoot);
           // TODO: save error
           storage.Save(point);
@@ -428,9 +665,10 @@ int Plugin::makeDirectory(HANDLE Plugin, const wchar_t** Name, int OpMode)
 
 int Plugin::deleteFiles(HANDLE Plugin, PluginPanelItem* PanelItem, int itemsNumber, int OpMode)
 {
-    UNUSED(Plugin)
     UNUSED(OpMode)
 
+    if (getFilePanel(Plugin)) return 0;
+
     const wchar_t* msgItems[2] = { nullptr };
     msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MDeleteResourceTitle);
     msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MDeleteresourceConfirmation);
@@ -446,19 +684,16 @@ int Plugin::deleteFiles(HANDLE Plugin, PluginPanelItem* PanelItem, int itemsNumb
 
     for (int i = 0; i < itemsNumber; ++i)
     {
-        auto name = PanelItem[i].CustomColumnData[1];
-        auto it = m_mountPoints.find(name);
-        if (it != m_mountPoints.end())
-        {
-            std::lock_guard<std::mutex> lck(m_pointsMutex);
-            MountPointStorage storage(m_registryRoot);
-            if (it->second.isMounted())
-            {
-                unmountResource(it->second);
-            }
-            storage.Delete(it->second);
-            m_mountPoints.erase(it);
-        }
+        std::wstring name(PanelItem[i].CustomColumnData[1]);
+        ProcessedPoint processed(*this, name);
+        MountPoint* point = processed.point();
+        if (point == nullptr) continue;
+        // отсоединяется без мутекса: фоновые потоки ресурс пропускают
+        if (point->isMounted()) unmountResource(*point);
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        MountPointStorage storage(m_registryRoot);
+        storage.Delete(*point);
+        m_mountPoints.erase(name);
     }
     return 0;
 }
@@ -502,22 +737,67 @@ int Plugin::processEditorInput(const INPUT_RECORD* Rec)
     return 0;
 }
 
-void Plugin::onPointMounted()
+HANDLE Plugin::openFilePlugin(const wchar_t* fileName,
+                              const unsigned char* fileHeader,
+                              int fileHeaderSize, int OpMode)
+{
+    UNUSED(OpMode)
+
+    if ((fileName == nullptr) ||
+        !CatalogFile::IsCatalogFile(fileName, fileHeader, fileHeaderSize))
+    {
+        return INVALID_HANDLE_VALUE;
+    }
+    std::unique_ptr<CatalogFilePanel> filePanel(
+        new CatalogFilePanel(m_pPsi, fileName)
+    );
+    std::wstring error;
+    HANDLE hScreen = m_pPsi.SaveScreen(0, 0, -1, -1);
+    const wchar_t* msgItems[2] = { nullptr };
+    msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MGvfsPanel);
+    msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MPleaseWait);
+    m_pPsi.Message(m_pPsi.ModuleNumber, 0, nullptr, msgItems,
+                   ARRAYSIZE(msgItems), 0);
+    bool loaded = filePanel->load(error);
+    m_pPsi.RestoreScreen(hScreen);
+    if (!loaded)
+    {
+        msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCatalogFileError);
+        msgItems[1] = error.c_str();
+        m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_WARNING | FMSG_MB_OK,
+                       nullptr, msgItems, ARRAYSIZE(msgItems), 0);
+        return INVALID_HANDLE_VALUE;
+    }
+    HANDLE handle = static_cast<HANDLE>(filePanel.get());
+    m_filePanels[handle] = std::move(filePanel);
+    return handle;
+}
+
+void Plugin::onPointMounted(const Glib::RefPtr<Gio::Mount>& mount)
 {
     // проверяем в фоновом потоке, никаких уведомлений оператору
     bool changed = false;
-    std::unique_lock<std::mutex> lck(m_pointsMutex, std::defer_lock);
+    std::unique_lock<TimedMutex> lck(m_pointsMutex, std::defer_lock);
     // запираем "вручную", чтобы освободить мутекс до завершения метода и
     // избежать клинча в checkResourcesStatus()
     lck.lock();
     for (auto& mountPoint : m_mountPoints)
     {
-        if (!mountPoint.second.isMounted() &&
-            (mountPoint.second.getStorageId() != m_processedPointId))
+        if (mountPoint.second.isMounted() ||
+            (mountPoint.second.getStorageId() == m_processedPointId))
+            continue;
+        if (mount.operator->() == nullptr)
         {
+            // событие подменного механизма монтирования (MountBackend),
+            // точки монтирования GIO нет -- опрашиваем его
             GvfsService service;
             mountPoint.second.mountCheck(&service);
-            if (mountPoint.second.isMounted()) changed = true;
+            changed = changed || mountPoint.second.isMounted();
+        }
+        else if (mountPoint.second.belongsTo(mount))
+        {
+            mountPoint.second.attach(mount);
+            changed = true;
         }
     }
     lck.unlock();
@@ -529,36 +809,495 @@ void Plugin::onPointMounted()
 }
 
 void Plugin::onPointUnmounted(const std::string& name, const std::string& path,
-                              const std::string& scheme)
+                              const std::string& scheme,
+                              const Glib::RefPtr<Gio::Mount>& mount)
 {
     std::wstring wname(StrMB2Wide(name)),
                  wpath(StrMB2Wide(path));
+    std::vector<std::wstring> remounts;
     bool changed = false;
-    std::unique_lock<std::mutex> lck(m_pointsMutex, std::defer_lock);
+    std::unique_lock<TimedMutex> lck(m_pointsMutex, std::defer_lock);
     // запираем "вручную", чтобы освободить мутекс до завершения метода и
     // избежать клинча в checkResourcesStatus()
     lck.lock();
     for (auto& mountPoint : m_mountPoints)
     {
-        if (mountPoint.second.isMounted() &&
-            (mountPoint.second.getStorageId() != m_processedPointId) &&
-            (mountPoint.second.getMountName() == wname) &&
-            (mountPoint.second.getProto() == MountPoint::SchemeToProto(scheme)) &&
-            (mountPoint.second.getMountPath().find(wpath) == 0))
+        if (!mountPoint.second.isMounted() ||
+            (mountPoint.second.getStorageId() == m_processedPointId))
+            continue;
+        // точка монтирования ресурса, найденная GVFS при монтировании,
+        // может быть другим экземпляром Gio::Mount, поэтому сравниваются
+        // и свойства точки монтирования
+        if (((mount.operator->() != nullptr) &&
+             (mountPoint.second.getMount().operator->() != nullptr) &&
+             (mountPoint.second.getMount()->gobj() == mount->gobj())) ||
+            ((mountPoint.second.getMountName() == wname) &&
+             (mountPoint.second.getProto() == MountPoint::SchemeToProto(scheme)) &&
+             (mountPoint.second.getMountPath().find(wpath) == 0)))
         {
-            // фактически точка уже отмонтирована, поэтому "большой круг"
-            // много времени не займет
-            GvfsService service;
-            try
+            // ресурс, смонтированный в этом сеансе, отсоединился не по
+            // команде оператора; без запроса пароля его можно переподключить
+            if (mountPoint.second.getKeepMounted() &&
+                mountPoint.second.wasMounted() &&
+                Unattended(mountPoint.second))
+                remounts.push_back(mountPoint.first);
+            // фактически точка уже отмонтирована, обращаться к GVFS не нужно
+            mountPoint.second.detach();
+            changed = true;
+        }
+        else if (mountPoint.second.getProto() == MountPoint::SchemeToProto(scheme))
+            // сопоставление по свойствам точки могло не сработать, ресурс
+            // перепроверяется при следующем обновлении панели
+            mountPoint.second.invalidateStatus();
+    }
+    lck.unlock();
+    for (const auto& url : remounts) scheduleRemount(url, 1);
+    if (changed)
+    {
+        m_pPsi.Control(static_cast<HANDLE>(this), FCTL_UPDATEPANEL, 0, 0);
+        m_pPsi.Control(static_cast<HANDLE>(this), FCTL_REDRAWPANEL, 0, 0);
+    }
+}
+
+void Plugin::onCatalogChanged(const std::set<std::wstring>& ids, bool rescan)
+{
+    bool changed = false;
+    std::set<std::wstring> l_ids(ids);
+    MountPointStorage storage(m_registryRoot);
+    std::unique_lock<TimedMutex> lck(m_pointsMutex, std::defer_lock);
+    // запираем "вручную", чтобы освободить мутекс до завершения метода и
+    // избежать клинча в checkResourcesStatus()
+    lck.lock();
+    // индекс "идентификатор записи -> URL"
+    std::map<std::wstring, std::wstring> index;
+    for (const auto& mountPoint : m_mountPoints)
+        index[mountPoint.second.getStorageId()] = mountPoint.first;
+    if (rescan)
+    {
+        std::vector<std::wstring> stored;
+        storage.LoadIds(stored);
+        l_ids.insert(stored.begin(), stored.end());
+        for (const auto& record : index) l_ids.insert(record.first);
+    }
+    for (const auto& id : l_ids)
+    {
+        // узел ресурса, занятого операцией оператора, трогать нельзя: на
+        // него ссылается главный поток; запись перечитается по завершению
+        // операции (см. ProcessedPoint)
+        if (id == m_processedPointId)
+        {
+            m_deferredCatalogIds.insert(id);
+            continue;
+        }
+        auto record = index.find(id);
+        auto it = (record == index.end()) ? m_mountPoints.end()
+                                          : m_mountPoints.find(record->second);
+        if (!storage.Exists(id))
+        {
+            // запись удалена
+            if (it != m_mountPoints.end())
             {
-                mountPoint.second.unmount(&service);
+                m_mountPoints.erase(it);
+                changed = true;
             }
-            catch (const GvfsServiceException& error)
+            continue;
+        }
+        MountPoint point(MountPointStorage::PointFactory());
+        // неполная запись, ее допишут, и придет новое событие
+        if (!storage.LoadOne(id, point)) continue;
+        if (it != m_mountPoints.end())
             {
-                // ignore error here
+                if (it->second.sameRecord(point)) continue;
+                MountPoint updated(it->second);
+                updated.assignRecord(point);
+                if (!updated.isMounted())
+                {
+                    GvfsService service;
+                    updated.mountCheck(&service);
+                }
+                // URL -- ключ набора: узел сохраняется, если URL не менялся
+                if (updated.getUrl() == it->first)
+                    {
+                        it->second = updated;
+                    }
+                    else
+                    {
+                        m_mountPoints.erase(it);
+                        m_mountPoints.insert(std::pair<std::wstring, MountPoint>(
+                            updated.getUrl(), updated
+                        ));
+                    }
             }
+            else
+            {
+                GvfsService service;
+                point.mountCheck(&service);
+                m_mountPoints.insert(std::pair<std::wstring, MountPoint>(
+                    point.getUrl(), point
+                ));
+            }
+        changed = true;
+    }
+    lck.unlock();
+    if (changed)
+    {
+        m_pPsi.Control(static_cast<HANDLE>(this), FCTL_UPDATEPANEL, 0, 0);
+        m_pPsi.Control(static_cast<HANDLE>(this), FCTL_REDRAWPANEL, 0, 0);
+    }
+}
+
+void Plugin::scheduleRemount(const std::wstring& url, unsigned int attempt)
+{
+    Configuration* config = Configuration::Instance();
+    unsigned int delay = Backoff::Delay(attempt, config->remountDelay(),
+                                        config->remountMaxDelay());
+    TRACE_INFO("Plugin::scheduleRemount()", "%s: attempt %u in %u ms",
+               StrWide2MB(url).c_str(), attempt, delay);
+    // переподключения после массового обрыва ограничены по частоте
+    OperationScheduler::Traits traits(ResourceLanes(url));
+    traits.throttled = true;
+    m_scheduler.schedule(L"remount:" + url,
+                         std::bind(&Plugin::remount, this, url, attempt),
+                         std::chrono::milliseconds(delay), traits);
+}
+
+void Plugin::remount(const std::wstring& url, unsigned int attempt)
+{
+    std::optional<MountPoint> point;
+    Glib::RefPtr<Gio::Cancellable> cancellable = Gio::Cancellable::create();
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        auto it = m_mountPoints.find(url);
+        // ресурс удален, подсоединен заново или флаг снят; идущее фоновое
+        // монтирование подсоединит его и без нас
+        if (m_exiting || (it == m_mountPoints.end()) ||
+            it->second.isMounted() || !it->second.getKeepMounted() ||
+            (it->second.getStorageId() == m_processedPointId) ||
+            (m_backgroundMounts.count(url) > 0))
+            return;
+        point.emplace(it->second);
+        // как и прочие фоновые монтирования, отменяется в exitFar()
+        m_backgroundMounts[url] = BackgroundMount{ cancellable, false };
+    }
+    // монтируется копия, чтобы не держать мутекс набора ресурсов
+    bool success = false;
+    try
+    {
+        GvfsService service;
+        service.setCancellable(cancellable)
+               .setConnectTimeout(Configuration::Instance()->connectTimeout());
+        success = point->mount(&service);
+    }
+    catch (const GvfsServiceException& error)
+    {
+        TRACE_WARNING("Plugin::remount()", "%s: %s", StrWide2MB(url).c_str(),
+                      error.what().c_str());
+    }
+    bool changed = false, retry = false;
+    std::unique_lock<TimedMutex> lck(m_pointsMutex, std::defer_lock);
+    // запираем "вручную", чтобы освободить мутекс до завершения метода и
+    // избежать клинча в checkResourcesStatus()
+    lck.lock();
+    m_backgroundMounts.erase(url);
+    auto it = m_mountPoints.find(url);
+    if (!success)
+        // отмененное при завершении работы монтирование не повторяется
+        retry = !m_exiting;
+        else if ((it != m_mountPoints.end()) && !it->second.isMounted())
+        {
+            // запись могли изменить, пока шло монтирование
+            MountPoint updated(*point);
+            updated.assignRecord(it->second);
+            it->second = updated;
             changed = true;
         }
+    lck.unlock();
+    m_backgroundMountDone.notify_all();
+    if (retry)
+    {
+        scheduleRemount(url, attempt + 1);
+        return;
+    }
+    if (success) Metrics::Instance().increment(Metrics::Remounts);
+    if (changed)
+    {
+        m_pPsi.Control(static_cast<HANDLE>(this), FCTL_UPDATEPANEL, 0, 0);
+        m_pPsi.Control(static_cast<HANDLE>(this), FCTL_REDRAWPANEL, 0, 0);
+    }
+}
+
+bool Plugin::mountInBackground(const std::wstring& url, bool speculative)
+{
+    std::optional<MountPoint> point;
+    Glib::RefPtr<Gio::Cancellable> cancellable = Gio::Cancellable::create();
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        auto it = m_mountPoints.find(url);
+        // пароль в фоне спросить некому
+        if (m_exiting || (it == m_mountPoints.end()) ||
+            it->second.isMounted() || !Unattended(it->second) ||
+            (it->second.getStorageId() == m_processedPointId) ||
+            (m_backgroundMounts.count(url) > 0))
+            return false;
+        point.emplace(it->second);
+        m_backgroundMounts[url] = BackgroundMount{ cancellable, speculative };
+    }
+    TRACE_INFO("Plugin::mountInBackground()", "%s", StrWide2MB(url).c_str());
+    bool success = false;
+    try
+    {
+        GvfsService service;
+        service.setCancellable(cancellable)
+               .setConnectTimeout(Configuration::Instance()->connectTimeout());
+        success = point->mount(&service);
+    }
+    catch (const GvfsServiceException& error)
+    {
+        TRACE_INFO("Plugin::mountInBackground()", "%s: %s",
+                   StrWide2MB(url).c_str(), error.what().c_str());
+    }
+    bool changed = false;
+    std::unique_lock<TimedMutex> lck(m_pointsMutex, std::defer_lock);
+    // запираем "вручную", чтобы освободить мутекс до завершения метода и
+    // избежать клинча в checkResourcesStatus()
+    lck.lock();
+    m_backgroundMounts.erase(url);
+    auto it = m_mountPoints.find(url);
+    if (success && (it != m_mountPoints.end()))
+    {
+        // точку монтирования мог уже подхватить монитор GVFS
+        if (!it->second.isMounted())
+        {
+            MountPoint updated(*point);
+            updated.assignRecord(it->second);
+            it->second = updated;
+        }
+        // под тем же мутексом, что и завершение: claimBackgroundMount() не
+        // должен проскочить между ними
+        if (speculative) m_speculative.insert(url);
+        changed = true;
+    }
+    lck.unlock();
+    m_backgroundMountDone.notify_all();
+    if (changed)
+    {
+        m_pPsi.Control(static_cast<HANDLE>(this), FCTL_UPDATEPANEL, 0, 0);
+        m_pPsi.Control(static_cast<HANDLE>(this), FCTL_REDRAWPANEL, 0, 0);
+    }
+    return changed;
+}
+
+void Plugin::speculate(const std::wstring& url)
+{
+    if (!mountInBackground(url, true)) return;
+    Metrics::Instance().increment(Metrics::SpeculativeMounts);
+    m_scheduler.schedule(L"retire:" + url,
+                         std::bind(&Plugin::retireSpeculation, this, url),
+                         std::chrono::milliseconds(
+                           Configuration::Instance()->speculativeGrace()
+                         ),
+                         ResourceLanes(url));
+}
+
+void Plugin::retireSpeculation(const std::wstring& url)
+{
+    std::optional<MountPoint> point;
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        // ресурс открыли
+        if (m_speculative.erase(url) == 0) return;
+        auto it = m_mountPoints.find(url);
+        if ((it == m_mountPoints.end()) || !it->second.isMounted() ||
+            (it->second.getStorageId() == m_processedPointId))
+            return;
+        point.emplace(it->second);
+        // отмечаем отсоединенным заранее, чтобы событие монитора GVFS не
+        // приняли за обрыв связи (см. onPointUnmounted())
+        it->second.detach();
+    }
+    Metrics::Instance().increment(Metrics::SpeculativeUnused);
+    TRACE_INFO("Plugin::retireSpeculation()", "%s", StrWide2MB(url).c_str());
+    bool success = false;
+    try
+    {
+        GvfsService service;
+        success = point->unmount(&service);
+    }
+    catch (const GvfsServiceException& error)
+    {
+        TRACE_WARNING("Plugin::retireSpeculation()", "%s: %s",
+                      StrWide2MB(url).c_str(), error.what().c_str());
+    }
+    if (!success)
+    {
+        // действительное состояние ресурса неизвестно
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        auto it = m_mountPoints.find(url);
+        if (it != m_mountPoints.end()) it->second.invalidateStatus();
+    }
+    m_pPsi.Control(static_cast<HANDLE>(this), FCTL_UPDATEPANEL, 0, 0);
+    m_pPsi.Control(static_cast<HANDLE>(this), FCTL_REDRAWPANEL, 0, 0);
+}
+
+void Plugin::verifyRestored(const std::wstring& url)
+{
+    std::optional<MountPoint> point;
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        auto it = m_mountPoints.find(url);
+        if (m_exiting || (it == m_mountPoints.end()) ||
+            (it->second.getStorageId() == m_processedPointId))
+            return;
+        point.emplace(it->second);
+    }
+    bool mounted = point->isMounted(),
+         wasMounted = point->wasMounted();
+    std::wstring path(point->getMountPath());
+    {
+        // проверяется копия, чтобы не держать мутекс набора ресурсов
+        GvfsService service;
+        point->mountCheck(&service);
+    }
+    bool corrected = (point->isMounted() != mounted) ||
+                     (point->getMountPath() != path);
+    bool changed = false, remount = false, autoMount = false;
+    std::unique_lock<TimedMutex> lck(m_pointsMutex, std::defer_lock);
+    // запираем "вручную", чтобы освободить мутекс до завершения метода и
+    // избежать клинча в checkResourcesStatus()
+    lck.lock();
+    auto it = m_mountPoints.find(url);
+    // статус могли обновить монитор GVFS или оператор, пока шла проверка
+    if ((it != m_mountPoints.end()) && !m_exiting &&
+        (it->second.isMounted() == mounted) &&
+        (it->second.getMountPath() == path) &&
+        (it->second.getStorageId() != m_processedPointId))
+    {
+        MountPoint updated(*point);
+        updated.assignRecord(it->second);
+        it->second = updated;
+        changed = corrected;
+        if (corrected && !updated.isMounted() && Unattended(updated))
+        {
+            // ресурс отсоединили, пока far2l не был запущен
+            remount = updated.getKeepMounted() && wasMounted;
+            autoMount = !remount && updated.getAutoMount();
+        }
+    }
+    lck.unlock();
+    if (!changed) return;
+    Metrics::Instance().increment(Metrics::RestoreCorrections);
+    TRACE_INFO("Plugin::verifyRestored()", "%s: %s", StrWide2MB(url).c_str(),
+               point->isMounted() ? "mounted" : "not mounted");
+    if (remount) scheduleRemount(url, 1);
+    if (autoMount)
+        m_scheduler.schedule(L"warmup:" + url,
+                             std::bind(&Plugin::warmUpMount, this, url),
+                             std::chrono::milliseconds(0), WarmUpLanes(url));
+    m_pPsi.Control(static_cast<HANDLE>(this), FCTL_UPDATEPANEL, 0, 0);
+    m_pPsi.Control(static_cast<HANDLE>(this), FCTL_REDRAWPANEL, 0, 0);
+}
+
+void Plugin::warmUp()
+{
+    // ресурсы по узлам
+    std::map< std::wstring, std::vector<std::wstring> > hosts;
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        for (const auto& mountPoint : m_mountPoints)
+            if (mountPoint.second.getAutoMount() && Unattended(mountPoint.second))
+                hosts[std::to_wstring(static_cast<int>(
+                        MountPoint::UrlProto(mountPoint.first)
+                      )) + L':' + MountPoint::UrlHost(mountPoint.first)]
+                    .push_back(mountPoint.first);
+    }
+    size_t count = 0;
+    for (const auto& host : hosts)
+    {
+        // первый ресурс узла проходит аутентификацию, остальные монтируются
+        // после него с общими паролем и ответами (см. CredentialCache)
+        std::vector<std::wstring> rest(host.second.begin() + 1,
+                                       host.second.end());
+        const std::wstring& url = host.second.front();
+        m_scheduler.schedule(L"warmup:" + url,
+                             [this, url, rest] ()
+                             {
+                                 warmUpMount(url);
+                                 for (const auto& other : rest)
+                                     m_scheduler.schedule(L"warmup:" + other,
+                                         std::bind(&Plugin::warmUpMount, this,
+                                                   other),
+                                         std::chrono::milliseconds(0),
+                                         WarmUpLanes(other));
+                             },
+                             std::chrono::milliseconds(0), WarmUpLanes(url));
+        count += host.second.size();
+    }
+    if (count > 0)
+        TRACE_INFO("Plugin::warmUp()", "%zu resources on %zu hosts", count,
+                   hosts.size());
+}
+
+void Plugin::warmUpMount(const std::wstring& url)
+{
+    if (mountInBackground(url, false))
+        Metrics::Instance().increment(Metrics::WarmUpMounts);
+}
+
+OperationScheduler::Traits Plugin::WarmUpLanes(const std::wstring& url)
+{
+    OperationScheduler::Traits traits(ResourceLanes(url));
+    traits.lanes.push_back(OperationScheduler::Lane{L"warmup", L""});
+    return traits;
+}
+
+bool Plugin::Unattended(const MountPoint& point)
+{
+    std::wstring password;
+    return !point.getAskPassword() ||
+           CredentialCache::Instance().password(point.getUrl(), point.getUser(),
+                                                password);
+}
+
+OperationScheduler::Traits Plugin::ResourceLanes(const std::wstring& url)
+{
+    OperationScheduler::Traits traits;
+    traits.lanes.push_back(OperationScheduler::Lane{
+        L"proto",
+        std::to_wstring(static_cast<int>(MountPoint::UrlProto(url)))
+    });
+    traits.lanes.push_back(OperationScheduler::Lane{L"host",
+                                                    MountPoint::UrlHost(url)});
+    return traits;
+}
+
+void Plugin::keepaliveTargets(std::vector<KeepaliveProber::Target>& targets)
+{
+    std::lock_guard<TimedMutex> lck(m_pointsMutex);
+    for (auto& mountPoint : m_mountPoints)
+    {
+        if (!mountPoint.second.isMounted() ||
+            (mountPoint.second.getStorageId() == m_processedPointId))
+            continue;
+        KeepaliveProber::Target target;
+        target.url = mountPoint.first;
+        target.file = mountPoint.second.getFile();
+        targets.push_back(target);
+    }
+}
+
+void Plugin::onKeepalive(const std::wstring& url, bool alive)
+{
+    bool changed = false;
+    std::unique_lock<TimedMutex> lck(m_pointsMutex, std::defer_lock);
+    // запираем "вручную", чтобы освободить мутекс до завершения метода и
+    // избежать клинча в checkResourcesStatus()
+    lck.lock();
+    auto it = m_mountPoints.find(url);
+    if ((it != m_mountPoints.end()) && it->second.isMounted() &&
+        (it->second.getStorageId() != m_processedPointId))
+    {
+        changed = (it->second.isStale() == alive);
+        it->second.setStale(!alive);
     }
     lck.unlock();
     if (changed)
@@ -585,22 +1324,23 @@ void Plugin::clearPanelItems()
 void Plugin::updatePanelItems()
 {
     clearPanelItems();
-    std::lock_guard<std::mutex> lck(m_pointsMutex);
+    std::lock_guard<TimedMutex> lck(m_pointsMutex);
     for (const auto& mountPoint : m_mountPoints)
     {
         PluginPanelItem item;
         memset(&item, 0, sizeof(item));
         item.FindData.lpwszFileName = wcsdup(mountPoint.second.getUrl().c_str());
         if (item.FindData.lpwszFileName == nullptr) {
-#ifndef NDEBUG
-          std::cout << "Plugin::updatePanelItems() can't create panel item (lpwszFileName)" << std::endl;
-#endif // NDEBUG
+          TRACE_ERROR("Plugin::updatePanelItems()",
+                      "can't create panel item (lpwszFileName)");
           continue;
         }
         item.FindData.dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
         item.CustomColumnNumber = 3;
         wchar_t** data = new wchar_t*[3];
-        data[0] = wcsdup(mountPoint.second.isMounted() ? TEXT("*") : TEXT(" ")); // C0
+        // разорванный сеанс связи отмечается отдельно
+        data[0] = wcsdup(!mountPoint.second.isMounted() ? TEXT(" ") :
+                         mountPoint.second.isStale() ? TEXT("!") : TEXT("*")); // C0
         data[1] = wcsdup(mountPoint.second.getUrl().c_str()); // C1
         data[2] = wcsdup(mountPoint.second.getUser().c_str()); // C2
         item.CustomColumnData = data;
@@ -608,16 +1348,19 @@ void Plugin::updatePanelItems()
     }
 }
 
-void Plugin::unmountResource(MountPoint& point)
+void Plugin::unmountResource(MountPoint& point, bool force)
 {
     const wchar_t* msgItems[2] = { nullptr };
     msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MUnmountError);
+    OperationScheduler::Foreground foreground(m_scheduler,
+                                              OperationScheduler::Interactive);
     try
     {
         GvfsService service;
-        m_processedPointId = point.getStorageId();
+        // сервер зависшего ресурса не ответит на обычное отсоединение
+        service.setForceUnmount(force || point.isStale());
+        ProcessedPoint processed(*this, point.getUrl());
         point.unmount(&service);
-        m_processedPointId.clear();
     }
     catch (const GvfsServiceException& error)
     {
@@ -628,6 +1371,55 @@ void Plugin::unmountResource(MountPoint& point)
     }
 }
 
+bool Plugin::checkResourceAlive(HANDLE Plugin, MountPoint& point)
+{
+    unsigned int timeout = Configuration::Instance()->staleCheckTimeout();
+    if (timeout == 0) return true;
+    bool alive = false;
+    {
+        OperationScheduler::Foreground foreground(
+            m_scheduler, OperationScheduler::Interactive
+        );
+        const wchar_t* msgItems[2] = { nullptr };
+        msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceStatus);
+        msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MPleaseWait);
+        HANDLE hScreen = m_pPsi.SaveScreen(0, 0, -1, -1);
+        m_pPsi.Message(m_pPsi.ModuleNumber, 0, nullptr, msgItems,
+                       ARRAYSIZE(msgItems), 0);
+        GvfsService service;
+        alive = service.probe(point.getFile(), timeout);
+        m_pPsi.RestoreScreen(hScreen);
+    }
+    bool changed = false;
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        changed = (point.isStale() == alive);
+        point.setStale(!alive);
+    }
+    if (changed)
+    {
+        m_pPsi.Control(Plugin, FCTL_UPDATEPANEL, 0, 0);
+        m_pPsi.Control(Plugin, FCTL_REDRAWPANEL, 0, 0);
+    }
+    if (alive) return true;
+    Metrics::Instance().increment(Metrics::StaleMounts);
+    TRACE_WARNING("Plugin::checkResourceAlive()", "%s: no response in %u ms",
+                  StrWide2MB(point.getUrl()).c_str(), timeout);
+    const wchar_t* msgItems[4] = { nullptr };
+    msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceNotResponding);
+    msgItems[1] = point.getUrl().c_str();
+    msgItems[2] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MForceUnmount);
+    msgItems[3] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCancel);
+    if (m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_WARNING, nullptr, msgItems,
+                       ARRAYSIZE(msgItems), 2) == 0)
+    {
+        unmountResource(point, true);
+        m_pPsi.Control(Plugin, FCTL_UPDATEPANEL, 0, 0);
+        m_pPsi.Control(Plugin, FCTL_REDRAWPANEL, 0, 0);
+    }
+    return false;
+}
+
 PluginPanelItem* Plugin::getPanelCurrentItem(HANDLE Plugin)
 {
     PluginPanelItem* PPI = nullptr;
@@ -645,8 +1437,101 @@ PluginPanelItem* Plugin::getPanelCurrentItem(HANDLE Plugin)
     return PPI;
 }
 
+void Plugin::trackCursor(HANDLE Plugin)
+{
+    std::wstring url;
+    PluginPanelItem* item = getPanelCurrentItem(Plugin);
+    if (item)
+    {
+        if (item->FindData.lpwszFileName) url = item->FindData.lpwszFileName;
+        free(item);
+    }
+    if (url == m_dwellUrl) return;
+    // курсор ушел: монтирование прежнего ресурса больше не нужно
+    m_scheduler.cancel(L"speculate");
+    if (!m_dwellUrl.empty()) cancelSpeculation(m_dwellUrl);
+    m_dwellUrl = url;
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        if (m_mountPoints.find(url) == m_mountPoints.end()) return;
+    }
+    // ресурс под курсором виден оператору
+    OperationScheduler::Traits traits(ResourceLanes(url));
+    traits.priority = OperationScheduler::Visible;
+    m_scheduler.schedule(L"speculate", std::bind(&Plugin::speculate, this, url),
+                         std::chrono::milliseconds(
+                           Configuration::Instance()->speculativeDwell()
+                         ),
+                         traits);
+}
+
+void Plugin::speculateRecent()
+{
+    std::lock_guard<TimedMutex> lck(m_pointsMutex);
+    for (const auto& url : m_recent)
+    {
+        auto it = m_mountPoints.find(url);
+        if ((it == m_mountPoints.end()) || it->second.isMounted() ||
+            !Unattended(it->second))
+            continue;
+        m_scheduler.schedule(L"speculate-recent",
+                             std::bind(&Plugin::speculate, this, url),
+                             std::chrono::milliseconds(0), ResourceLanes(url));
+        break;
+    }
+}
+
+void Plugin::cancelSpeculation(const std::wstring& url)
+{
+    std::lock_guard<TimedMutex> lck(m_pointsMutex);
+    auto it = m_backgroundMounts.find(url);
+    // монтирование при запуске курсором не отменяется
+    if ((it != m_backgroundMounts.end()) && it->second.speculative)
+        it->second.cancellable->cancel();
+}
+
+void Plugin::claimBackgroundMount(const std::wstring& url)
+{
+    std::unique_lock<TimedMutex> lck(m_pointsMutex);
+    if (m_backgroundMounts.count(url) > 0)
+    {
+        lck.unlock();
+        const wchar_t* msgItems[2] = { nullptr };
+        msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResourceMount);
+        msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MPleaseWait);
+        HANDLE hScreen = m_pPsi.SaveScreen(0, 0, -1, -1);
+        m_pPsi.Message(m_pPsi.ModuleNumber, 0, nullptr, msgItems,
+                       ARRAYSIZE(msgItems), 0);
+        lck.lock();
+        m_backgroundMountDone.wait(lck, [this, &url] () {
+                                     return m_backgroundMounts.count(url) == 0;
+                                   });
+        lck.unlock();
+        m_pPsi.RestoreScreen(hScreen);
+        lck.lock();
+    }
+    bool hit = (m_speculative.erase(url) > 0);
+    lck.unlock();
+    // оператор открывает ресурс сам, ожидание курсора уже ни к чему
+    m_scheduler.cancel(L"speculate");
+    if (!hit) return;
+    m_scheduler.cancel(L"retire:" + url);
+    Metrics::Instance().increment(Metrics::SpeculativeHits);
+}
+
 void Plugin::checkResourcesStatus()
 {
+    std::chrono::milliseconds ttl(Configuration::Instance()->statusTtl());
+    std::lock_guard<TimedMutex> lck(m_pointsMutex);
+    std::vector<MountPoint*> stale;
+    for (auto& mountPoint : m_mountPoints)
+        if (!mountPoint.second.statusFresh(ttl))
+            stale.push_back(&mountPoint.second);
+    Metrics::Instance().increment(Metrics::StatusCacheHits,
+                                  m_mountPoints.size() - stale.size());
+    if (stale.empty()) return;
+    OperationScheduler::Foreground foreground(m_scheduler,
+                                              OperationScheduler::Visible);
     HANDLE hScreen = nullptr;
     const wchar_t* msgItems[2] = { nullptr };
     hScreen = m_pPsi.SaveScreen(0, 0, -1, -1);
@@ -654,15 +1539,83 @@ void Plugin::checkResourcesStatus()
     msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MPleaseWait);
     m_pPsi.Message(m_pPsi.ModuleNumber, 0, nullptr, msgItems,
                    ARRAYSIZE(msgItems), 0);
-    std::lock_guard<std::mutex> lck(m_pointsMutex);
-    for (auto& mountPoint : m_mountPoints)
+    for (auto point : stale)
     {
         GvfsService service;
-        mountPoint.second.mountCheck(&service);
+        point->mountCheck(&service);
     }
     m_pPsi.RestoreScreen(hScreen);
 }
 
+#ifdef USE_SECRET_STORAGE
+void Plugin::switchPasswordStorage(bool toSecretStorage)
+{
+    const wchar_t* title = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MPasswordStorageSwitch);
+    std::vector<std::wstring> failed;
+    // пароли переносятся по копии списка: перенос и сообщения не должны
+    // задерживать фоновые потоки, ожидающие m_pointsMutex
+    std::map<std::wstring, MountPoint> points;
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        points = m_mountPoints;
+    }
+    HANDLE hScreen = m_pPsi.SaveScreen(0, 0, -1, -1);
+    MountPointStorage storage(m_registryRoot);
+    bool switched = storage.SwitchPasswordStorage(
+        points, toSecretStorage,
+        [this, title] (bool cleanup, unsigned int done, unsigned int total)
+        {
+            std::wstring counter = std::to_wstring(done) + L" / " +
+                                   std::to_wstring(total);
+            const wchar_t* msgItems[3] = { nullptr };
+            msgItems[0] = title;
+            msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber,
+                                        cleanup ? MPasswordCopiesRemoved :
+                                                  MPasswordsMoved);
+            msgItems[2] = counter.c_str();
+            m_pPsi.Message(m_pPsi.ModuleNumber, 0, nullptr, msgItems,
+                           ARRAYSIZE(msgItems), 0);
+        },
+        failed
+    );
+    m_pPsi.RestoreScreen(hScreen);
+    if (!switched)
+    {
+        // пароли остались в прежнем хранилище, из него их и загружать
+        Configuration::Instance()->setUseSecretStorage(!toSecretStorage);
+        Configuration::Instance()->save();
+    }
+    std::vector<const wchar_t*> msgItems;
+    msgItems.push_back(title);
+    if (failed.empty())
+    {
+        msgItems.push_back(m_pPsi.GetMsg(m_pPsi.ModuleNumber, MPasswordStorageSwitched));
+        m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_MB_OK, nullptr,
+                       msgItems.data(), msgItems.size(), 0);
+        return;
+    }
+    // в сообщении не больше MaxReportedResources ресурсов, прочие -- "..."
+    const unsigned int MaxReportedResources = 10;
+    msgItems.push_back(m_pPsi.GetMsg(m_pPsi.ModuleNumber,
+                                     switched ? MPasswordCopiesLeft :
+                                                MPasswordStorageKept));
+    for (const auto& mountPoint : points)
+    {
+        if (std::find(failed.begin(), failed.end(),
+                      mountPoint.second.getStorageId()) == failed.end())
+            continue;
+        if (msgItems.size() == MaxReportedResources + 2)
+        {
+            msgItems.push_back(L"...");
+            break;
+        }
+        msgItems.push_back(mountPoint.second.getUrl().c_str());
+    }
+    m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_WARNING | FMSG_MB_OK, nullptr,
+                   msgItems.data(), msgItems.size(), 0);
+}
+#endif
+
 bool Plugin::checkMountpointDuplicate(MountPoint const& point) const
 {
     auto it = m_mountPoints.find(point.getUrl());
@@ -672,3 +1625,268 @@ bool Plugin::checkMountpointDuplicate(MountPoint const& point) const
     if (it->second.getStorageId() == point.getStorageId()) return false;
     return (it->second == point);
 }
+
+CatalogFilePanel* Plugin::getFilePanel(HANDLE Plugin) const
+{
+    auto it = m_filePanels.find(Plugin);
+    return (it == m_filePanels.end()) ? nullptr : it->second.get();
+}
+
+void Plugin::commandsMenu(HANDLE Plugin)
+{
+    FarMenuItem menuItems[4];
+    memset(menuItems, 0, sizeof(menuItems));
+    menuItems[0].Text = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MExportCatalog);
+    menuItems[1].Text = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MImportCatalog);
+    menuItems[2].Text = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MImportHostLists);
+    menuItems[3].Text = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MDiagnostics);
+    int selected = m_pPsi.Menu(m_pPsi.ModuleNumber, -1, -1, 0, FMENU_WRAPMODE,
+                               m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCommandsTitle),
+                               nullptr, nullptr, nullptr, nullptr, menuItems,
+                               ARRAYSIZE(menuItems));
+    // по умолчанию файл каталога в домашней директории
+    const char* home = std::getenv("HOME");
+    std::wstring fileName(StrMB2Wide(home ? home : ""));
+    fileName.append(L"/gvfspanel").append(CatalogFile::Extension);
+    switch (selected)
+    {
+        case 0:
+            if (askCatalogFileName(MExportCatalog, fileName))
+                exportCatalog(fileName);
+            break;
+        case 1:
+            if (askCatalogFileName(MImportCatalog, fileName))
+            {
+                importCatalog(fileName);
+                m_pPsi.Control(Plugin, FCTL_UPDATEPANEL, 0, 0);
+                m_pPsi.Control(Plugin, FCTL_REDRAWPANEL, 0, 0);
+            }
+            break;
+        case 2:
+            importHostLists();
+            m_pPsi.Control(Plugin, FCTL_UPDATEPANEL, 0, 0);
+            m_pPsi.Control(Plugin, FCTL_REDRAWPANEL, 0, 0);
+            break;
+        case 3:
+            showDiagnostics();
+            break;
+        default:
+            break;
+    }
+}
+
+void Plugin::showDiagnostics()
+{
+    Metrics& metrics = Metrics::Instance();
+    auto msg = [this] (int id) { return m_pPsi.GetMsg(m_pPsi.ModuleNumber, id); };
+    // ширина колонки названий -- по самому длинному в текущем языке
+    int width = std::wcslen(msg(MDiagLatency));
+    for (int id : HistogramNames) width = std::max<int>(width, std::wcslen(msg(id)));
+    for (int id : CounterNames) width = std::max<int>(width, std::wcslen(msg(id)));
+    for (int id : GaugeNames) width = std::max<int>(width, std::wcslen(msg(id)));
+    int button;
+    do
+    {
+        std::vector<std::wstring> lines;
+        wchar_t buffer[160];
+        swprintf(buffer, ARRAYSIZE(buffer), L"%-*ls %8ls %10ls %8ls %8ls %8ls",
+                 width, msg(MDiagLatency), msg(MDiagCount), msg(MDiagMean),
+                 msg(MDiagMedian), msg(MDiagP99), msg(MDiagMax));
+        lines.push_back(buffer);
+        for (int i = 0; i < Metrics::HistogramsNumber; i++)
+        {
+            Metrics::Histogram id = static_cast<Metrics::Histogram>(i);
+            const LatencyHistogram& histogram = metrics.histogram(id);
+            swprintf(buffer, ARRAYSIZE(buffer),
+                     L"%-*ls %8llu %10.0f %8llu %8llu %8llu",
+                     width, msg(HistogramNames[i]),
+                     static_cast<unsigned long long>(histogram.count()),
+                     histogram.mean(),
+                     static_cast<unsigned long long>(histogram.percentile(0.5)),
+                     static_cast<unsigned long long>(histogram.percentile(0.99)),
+                     static_cast<unsigned long long>(histogram.max()));
+            lines.push_back(buffer);
+        }
+        lines.push_back(L"\x01");
+        for (int i = 0; i < Metrics::CountersNumber; i++)
+        {
+            Metrics::Counter id = static_cast<Metrics::Counter>(i);
+            swprintf(buffer, ARRAYSIZE(buffer), L"%-*ls %8lu",
+                     width, msg(CounterNames[i]), metrics.counter(id));
+            lines.push_back(buffer);
+        }
+        for (int i = 0; i < Metrics::GaugesNumber; i++)
+        {
+            Metrics::Gauge id = static_cast<Metrics::Gauge>(i);
+            swprintf(buffer, ARRAYSIZE(buffer), L"%-*ls %8ld",
+                     width, msg(GaugeNames[i]), metrics.gauge(id));
+            lines.push_back(buffer);
+        }
+        std::vector<const wchar_t*> msgItems;
+        msgItems.push_back(m_pPsi.GetMsg(m_pPsi.ModuleNumber, MDiagnostics));
+        for (const auto& line : lines) msgItems.push_back(line.c_str());
+        msgItems.push_back(m_pPsi.GetMsg(m_pPsi.ModuleNumber, MOk));
+        msgItems.push_back(m_pPsi.GetMsg(m_pPsi.ModuleNumber, MResetMetrics));
+        msgItems.push_back(m_pPsi.GetMsg(m_pPsi.ModuleNumber, MExportTrace));
+        button = m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_LEFTALIGN, nullptr,
+                                msgItems.data(), msgItems.size(), 3);
+        if (button == 1) metrics.reset();
+    } while (button == 1);
+    if (button == 2) exportTrace();
+}
+
+void Plugin::exportTrace()
+{
+    // по умолчанию файл в домашней директории
+    const char* home = std::getenv("HOME");
+    std::string fileName(home ? home : "");
+    fileName.append("/gvfspanel-trace.json");
+    std::string error;
+    std::wstring text;
+    const wchar_t* msgItems[3] = { nullptr };
+    msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MExportTrace);
+    if (Trace::ExportChrome(fileName, Trace::HistorySeconds, error))
+        {
+            text = StrMB2Wide(fileName);
+            msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MTraceExported);
+            msgItems[2] = text.c_str();
+            m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_MB_OK, nullptr, msgItems,
+                           ARRAYSIZE(msgItems), 0);
+        }
+        else
+        {
+            text = StrMB2Wide(error);
+            msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MTraceExportError);
+            msgItems[2] = text.c_str();
+            m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_WARNING | FMSG_MB_OK,
+                           nullptr, msgItems, ARRAYSIZE(msgItems), 0);
+        }
+}
+
+bool Plugin::askCatalogFileName(int title, std::wstring& fileName)
+{
+    wchar_t buffer[MAX_PATH] = { 0 };
+    if (!m_pPsi.InputBox(m_pPsi.GetMsg(m_pPsi.ModuleNumber, title),
+                         m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCatalogFileName),
+                         L"GvfsPanelCatalogFile", fileName.c_str(), buffer,
+                         ARRAYSIZE(buffer), nullptr,
+                         FIB_BUTTONS | FIB_EXPANDENV | FIB_NOUSELASTHISTORY))
+        return false;
+    fileName = buffer;
+    return !fileName.empty();
+}
+
+void Plugin::exportCatalog(const std::wstring& fileName)
+{
+    std::wstring error, counter;
+    bool success;
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        success = CatalogFile::Write(fileName, m_mountPoints, error);
+        counter = std::to_wstring(m_mountPoints.size());
+    }
+    const wchar_t* msgItems[3] = { nullptr };
+    if (!success)
+    {
+        msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCatalogFileError);
+        msgItems[1] = error.c_str();
+        m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_WARNING | FMSG_MB_OK,
+                       nullptr, msgItems, 2, 0);
+        return;
+    }
+    msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MExportCatalog);
+    msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCatalogExported);
+    msgItems[2] = counter.c_str();
+    m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_MB_OK, nullptr, msgItems,
+                   ARRAYSIZE(msgItems), 0);
+}
+
+void Plugin::importCatalog(const std::wstring& fileName)
+{
+    std::unique_ptr<ImportBatch> batch;
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        batch.reset(new ImportBatch(m_mountPoints));
+    }
+    unsigned int failed = 0;
+    std::wstring error;
+    const wchar_t* msgItems[2] = { nullptr };
+    HANDLE hScreen = m_pPsi.SaveScreen(0, 0, -1, -1);
+    msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MImportCatalog);
+    msgItems[1] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MPleaseWait);
+    m_pPsi.Message(m_pPsi.ModuleNumber, 0, nullptr, msgItems,
+                   ARRAYSIZE(msgItems), 0);
+    ImportBatch* l_batch = batch.get();
+    bool success = CatalogFile::Read(
+        fileName,
+        [l_batch] (const CatalogFile::Entry& entry) { l_batch->add(entry); },
+        error
+    );
+    // файл с ошибкой не загружается даже частично
+    if (success) failed = addResources(batch->points());
+    m_pPsi.RestoreScreen(hScreen);
+    if (!success)
+    {
+        msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCatalogFileError);
+        msgItems[1] = error.c_str();
+        m_pPsi.Message(m_pPsi.ModuleNumber, FMSG_WARNING | FMSG_MB_OK,
+                       nullptr, msgItems, ARRAYSIZE(msgItems), 0);
+        return;
+    }
+    reportImport(MImportCatalog, *batch, failed);
+}
+
+void Plugin::importHostLists()
+{
+    std::unique_ptr<ImportBatch> batch;
+    {
+        std::lock_guard<TimedMutex> lck(m_pointsMutex);
+        batch.reset(new ImportBatch(m_mountPoints));
+    }
+    ImportBatch* l_batch = batch.get();
+    auto handler = [l_batch] (const CatalogFile::Entry& entry)
+                   {
+                       l_batch->add(entry);
+                   };
+    // отсутствие любого из файлов -- не ошибка
+    HostListReader::ReadGtkBookmarks(HostListReader::GtkBookmarksPath(), handler);
+    HostListReader::ReadSshConfig(HostListReader::SshConfigPath(), handler);
+    unsigned int failed = addResources(batch->points());
+    reportImport(MImportHostLists, *batch, failed);
+}
+
+void Plugin::reportImport(int title, const ImportBatch& batch,
+                          unsigned int failed)
+{
+    std::wstring imported(m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCatalogImported)),
+                 skipped(m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCatalogDuplicates)),
+                 notSaved(m_pPsi.GetMsg(m_pPsi.ModuleNumber, MCatalogNotSaved));
+    imported.append(L" ").append(std::to_wstring(batch.points().size() - failed));
+    skipped.append(L" ").append(std::to_wstring(batch.duplicates()));
+    notSaved.append(L" ").append(std::to_wstring(failed));
+    const wchar_t* msgItems[4] = { nullptr };
+    msgItems[0] = m_pPsi.GetMsg(m_pPsi.ModuleNumber, title);
+    msgItems[1] = imported.c_str();
+    msgItems[2] = skipped.c_str();
+    msgItems[3] = notSaved.c_str();
+    m_pPsi.Message(m_pPsi.ModuleNumber, failed ? FMSG_WARNING | FMSG_MB_OK : FMSG_MB_OK,
+                   nullptr, msgItems, ARRAYSIZE(msgItems), 0);
+}
+
+unsigned int Plugin::addResources(const std::vector<MountPoint>& points)
+{
+    if (points.empty()) return 0;
+    std::vector<std::wstring> failed;
+    std::lock_guard<TimedMutex> lck(m_pointsMutex);
+    MountPointStorage storage(m_registryRoot);
+    storage.SaveBatch(points, failed);
+    std::unordered_set<std::wstring> l_failed(failed.begin(), failed.end());
+    for (const auto& point : points)
+    {
+        if (l_failed.count(point.getStorageId())) continue;
+        m_mountPoints.insert(
+            std::pair<std::wstring, MountPoint>(point.getUrl(), point)
+        );
+    }
+    return failed.size();
+}
@@ -1,12 +1,21 @@
 #pragma once
 
 #include <farplug-wide.h>
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <vector>
+#include "CatalogFilePanel.h"
+#include "CatalogWatcher.h"
+#include "ImportBatch.h"
+#include "KeepaliveProber.h"
 #include "KeyBarTitlesHelper.h"
 #include "MountPoint.h"
+#include "OperationScheduler.h"
+#include "TimedMutex.h"
 
 ///
 /// Параметры FAR-плагина.
@@ -81,32 +90,274 @@ public:
     int putFiles(HANDLE Plugin, PluginPanelItem* PanelItem, int itemsNumber, int Move, const wchar_t* srcPath, int OpMode);
     int processEditorEvent(int Event, void* Param);
     int processEditorInput(const INPUT_RECORD* Rec);
+    ///
+    /// Открыть файл каталога ресурсов (*.gvfsmounts) как панель.
+    ///
+    /// @param [in] fileName Имя файла.
+    /// @param [in] fileHeader Начало содержимого файла.
+    /// @param [in] fileHeaderSize Размер начала содержимого файла.
+    /// @param [in] OpMode Режим операции.
+    /// @return Дескриптор панели файла каталога или INVALID_HANDLE_VALUE.
+    ///
+    HANDLE openFilePlugin(const wchar_t* fileName,
+                          const unsigned char* fileHeader, int fileHeaderSize,
+                          int OpMode);
 
     ///
     /// Обработка события "ресурс подсоединен".
     ///
-    /// Вызывается в потоке монитора виртуальной файловой системы. Проверяется
-    /// статус всех известных ресурсов, не подсоединенных на данный момент, за
+    /// @param [in] mount Добавленная точка монтирования GIO.
+    ///
+    /// Вызывается в потоке монитора виртуальной файловой системы. Среди
+    /// известных ресурсов, не подсоединенных на данный момент, за
     /// исключением ресурса, операция над которым инициирована оператором
-    /// (#m_processedPointId не пусто).
+    /// (#m_processedPointId не пусто), ищутся находящиеся в точке
+    /// монтирования (см. MountPoint::belongsTo()); они отмечаются
+    /// подсоединенными без обращения к GVFS.
     ///
-    void onPointMounted();
+    /// Пустой mount приходит от подменного механизма монтирования
+    /// (MountBackend); тогда статус тех же ресурсов опрашивается.
+    ///
+    void onPointMounted(const Glib::RefPtr<Gio::Mount>& mount);
     ///
     /// Обработка события "ресурс отсоединен".
     ///
     /// @param [in] name Имя отмонтированного ресурса.
     /// @param [in] path Точка монтирования ресурса в локальной файловой системе.
     /// @param [in] scheme Использованный при монтировании транспортный протокол.
+    /// @param [in] mount Удаленная точка монтирования GIO.
     ///
     /// Вызывается в потоке монитора виртуальной файловой системы. Проверяется
     /// статус всех известных ресурсов, подсоединенных на данный момент, за
     /// исключением ресурса, операция над которым инициирована оператором
-    /// (#m_processedPointId не пусто).
+    /// (#m_processedPointId не пусто). Ресурсы, находившиеся в удаленной точке
+    /// монтирования, отмечаются отсоединенными без обращения к GVFS.
+    ///
+    /// Ресурсы с флагом "поддерживать подсоединенным", смонтированные в
+    /// текущем сеансе и не требующие запроса пароля, переподключаются в фоне
+    /// (см. scheduleRemount()).
     ///
     void onPointUnmounted(const std::string& name, const std::string& path,
-                          const std::string& scheme);
+                          const std::string& scheme,
+                          const Glib::RefPtr<Gio::Mount>& mount);
+
+    ///
+    /// Обработка изменений хранилища ресурсов другими экземплярами far2l.
+    ///
+    /// @param [in] ids Идентификаторы измененных записей.
+    /// @param [in] rescan Сверить с хранилищем все записи.
+    ///
+    /// Вызывается в потоке наблюдателя CatalogWatcher. Перечитываются только
+    /// указанные записи: новые добавляются в набор ресурсов, измененные
+    /// обновляются с сохранением состояния смонтированности (на месте, если
+    /// URL не изменился), удаленные исключаются. Панель обновляется, только
+    /// если набор изменился.
+    ///
+    /// Запись ресурса, занятого операцией оператора (см. ProcessedPoint),
+    /// откладывается до завершения операции: главный поток держит ссылку на
+    /// ресурс вне мутекса.
+    ///
+    void onCatalogChanged(const std::set<std::wstring>& ids, bool rescan);
+
+    ///
+    /// Список смонтированных ресурсов для проверки сеансов связи.
+    ///
+    /// @param [out] targets Ресурсы.
+    ///
+    /// Вызывается в потоке KeepaliveProber. Ресурс, операция над которым
+    /// инициирована оператором, не проверяется.
+    ///
+    void keepaliveTargets(std::vector<KeepaliveProber::Target>& targets);
+    ///
+    /// Обработка результата проверки сеанса связи с ресурсом.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [in] alive Ресурс ответил.
+    ///
+    /// Вызывается в потоке KeepaliveProber. Ресурс отмечается зависшим или
+    /// снова живым (см. MountPoint::setStale()), панель обновляется, только
+    /// если отметка изменилась.
+    ///
+    void onKeepalive(const std::wstring& url, bool alive);
+
+    ///
+    /// Назначить переподключение ресурса.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [in] attempt Номер попытки, начиная с 1.
+    ///
+    /// Задержка растет с номером попытки (см. Backoff::Delay(),
+    /// Configuration::remountDelay()), частота попыток по всем ресурсам
+    /// ограничена планировщиком.
+    ///
+    void scheduleRemount(const std::wstring& url, unsigned int attempt);
+    ///
+    /// Переподключить ресурс с сохраненными аутентификационными данными.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [in] attempt Номер попытки.
+    ///
+    /// Выполняется в потоке планировщика. Ресурс не переподключается, если
+    /// он удален из набора, уже подсоединен, с него снят флаг
+    /// "поддерживать подсоединенным", над ним работает оператор или его
+    /// уже монтируют в фоне. Как и mountInBackground(), монтирование
+    /// учитывается в #m_backgroundMounts и прерывается при завершении работы
+    /// far2l. После неудачи, если работа не завершается, назначается
+    /// следующая попытка.
+    ///
+    void remount(const std::wstring& url, unsigned int attempt);
+    ///
+    /// Подсоединить ресурс в фоне с сохраненными аутентификационными
+    /// данными.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @param [in] speculative Монтирование упреждающее: ресурс, который
+    ///                         так и не откроют, будет отсоединен.
+    /// @return Ресурс подсоединен.
+    ///
+    /// Ресурсы, запрашивающие пароль, не монтируются, если пароля для их
+    /// узла нет в CredentialCache (см. Unattended()): спросить его в фоне
+    /// некому. Пока идет упреждающее монтирование, его можно отменить (см.
+    /// cancelSpeculation()), а setDirectory() дожидается завершения любого
+    /// (см. claimBackgroundMount()). Панель обновляется по завершению
+    /// каждого удачного монтирования.
+    ///
+    bool mountInBackground(const std::wstring& url, bool speculative);
+    ///
+    /// Упреждающе подсоединить ресурс.
+    ///
+    /// @param [in] url URL ресурса.
+    ///
+    /// Выполняется в потоке планировщика, когда курсор простоял на ресурсе
+    /// заданное время (см. trackCursor()) или ресурс недавно открывали (см.
+    /// speculateRecent()). Смонтированный ресурс, который так и не открыли,
+    /// отсоединяется по истечении Configuration::speculativeGrace() (см.
+    /// retireSpeculation()).
+    ///
+    void speculate(const std::wstring& url);
+    ///
+    /// Отсоединить невостребованный упреждающе смонтированный ресурс.
+    ///
+    /// @param [in] url URL ресурса.
+    ///
+    /// Выполняется в потоке планировщика. Если ресурс за это время открыли,
+    /// ничего не делает.
+    ///
+    void retireSpeculation(const std::wstring& url);
+    ///
+    /// Проверить статус ресурса, восстановленный при запуске.
+    ///
+    /// @param [in] url URL ресурса.
+    ///
+    /// Выполняется в потоке планировщика. Статус, восстановленный из
+    /// SessionStateStorage, показывается сразу, а проверяется в фоне. Если
+    /// ресурс на деле не подсоединен, он переподключается или монтируется
+    /// так же, как при обрыве связи или при запуске.
+    ///
+    void verifyRestored(const std::wstring& url);
+    ///
+    /// Подсоединить ресурсы с флагом "подсоединять при запуске".
+    ///
+    /// Вызывается после инициализации плагина и назначает монтирование
+    /// ресурсов планировщику (см. mountInBackground()). Ресурсы монтируются
+    /// параллельно, не более Configuration::warmUpConcurrency()
+    /// одновременно, в пределах полос протокола и узла каждого.
+    ///
+    /// Из ресурсов одного узла сначала монтируется один, а остальные --
+    /// после него: пароль и ответы на вопросы о ключе узла, полученные при
+    /// его монтировании, достаются остальным (см. CredentialCache).
+    ///
+    void warmUp();
+    ///
+    /// Подсоединить ресурс с флагом "подсоединять при запуске".
+    ///
+    /// @param [in] url URL ресурса.
+    ///
+    /// Выполняется в потоке планировщика.
+    ///
+    void warmUpMount(const std::wstring& url);
+    ///
+    /// Полосы планировщика для монтирования ресурса при запуске.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @return Полосы ResourceLanes() и общая полоса вида "warmup".
+    ///
+    static OperationScheduler::Traits WarmUpLanes(const std::wstring& url);
+    ///
+    /// Проверить, можно ли подсоединить ресурс без оператора.
+    ///
+    /// @param [in] point Ресурс.
+    /// @return Ресурс не запрашивает пароль перед монтированием, или пароль
+    ///         для его узла и пользователя уже есть в CredentialCache.
+    ///
+    static bool Unattended(const MountPoint& point);
+    ///
+    /// Полосы планировщика для фоновой операции над ресурсом.
+    ///
+    /// @param [in] url URL ресурса.
+    /// @return Свойства операции с полосами протокола (вид "proto") и узла
+    ///         (вид "host") ресурса.
+    ///
+    /// Пределы полос задаются Configuration::protocolConcurrency() и
+    /// Configuration::hostConcurrency(): недоступный узел или медленный
+    /// протокол занимают не больше своей доли рабочих потоков.
+    ///
+    static OperationScheduler::Traits ResourceLanes(const std::wstring& url);
+
+    ///
+    /// @return Мутекс набора ресурсов, для статистики времени удержания.
+    ///
+    inline TimedMutex& pointsMutex() { return m_pointsMutex; }
 
 private:
+    ///
+    /// @brief Идущее фоновое монтирование.
+    ///
+    struct BackgroundMount
+    {
+        Glib::RefPtr<Gio::Cancellable> cancellable; ///< Отмена монтирования.
+        bool speculative; ///< Монтирование упреждающее.
+    };
+
+    ///
+    /// @brief Операция оператора над ресурсом (#m_processedPointId).
+    ///
+    /// Пока экземпляр существует, ресурс считается занятым операцией
+    /// оператора: фоновые потоки его пропускают, а наблюдатель за
+    /// хранилищем откладывает изменения его записи (#m_deferredCatalogIds)
+    /// и не удаляет его из набора, поэтому указатель point() остается
+    /// действительным и вне мутекса. Отметка ставится и
+    /// снимается под мутексом набора ресурсов, в том числе при исключении;
+    /// вложенная отметка по завершению восстанавливает внешнюю.
+    ///
+    class ProcessedPoint
+    {
+      public:
+        ///
+        /// Конструктор.
+        ///
+        /// @param [in] plugin Плагин.
+        /// @param [in] url URL ресурса.
+        ///
+        /// Если ресурса нет в наборе, отметка не ставится (см. point()).
+        ///
+        ProcessedPoint(Plugin& plugin, const std::wstring& url);
+        ~ProcessedPoint();
+
+        ProcessedPoint(const ProcessedPoint&) = delete;
+        ProcessedPoint& operator=(const ProcessedPoint&) = delete;
+
+        ///
+        /// @return Отмеченный ресурс; nullptr, если ресурса нет в наборе.
+        ///
+        inline MountPoint* point() const { return m_point; }
+
+      private:
+        Plugin& m_plugin; ///< Плагин.
+        MountPoint* m_point; ///< Отмеченный ресурс.
+        std::wstring m_previous; ///< Прежняя отметка.
+    };
+
     ///
     /// Очистить набор отображаемых в панели элементов.
     ///
@@ -120,8 +371,27 @@ private:
     /// Отсоединить указанный ресурс.
     ///
     /// @param [in,out] point Класс-описание ресурса.
+    /// @param [in] force Отсоединить принудительно.
     ///
-    void unmountResource(MountPoint& point);
+    /// Ресурс с разорванным сеансом связи (см. MountPoint::isStale())
+    /// отсоединяется принудительно всегда.
+    ///
+    void unmountResource(MountPoint& point, bool force = false);
+    ///
+    /// Проверить перед переходом на смонтированный ресурс, что он отвечает.
+    ///
+    /// @param [in] Plugin Дескриптор панели плагина.
+    /// @param [in,out] point Класс-описание ресурса.
+    /// @return Ресурс ответил вовремя.
+    ///
+    /// Если сервер пропал, не отсоединив ресурс, обращения far2l к точке
+    /// монтирования FUSE зависают на минуты. Поэтому ресурс сначала
+    /// опрашивается средствами GIO с ограничением времени (см.
+    /// GvfsService::probe(), Configuration::staleCheckTimeout()). Не
+    /// ответивший ресурс отмечается зависшим, и оператору предлагается
+    /// отсоединить его принудительно.
+    ///
+    bool checkResourceAlive(HANDLE Plugin, MountPoint& point);
     ///
     /// Извлечь выбранный элемент панели.
     ///
@@ -130,7 +400,45 @@ private:
     ///
     PluginPanelItem* getPanelCurrentItem(HANDLE Plugin);
     ///
-    /// Преверить статус соединения со всеми ресурсами.
+    /// Отследить ресурс под курсором для упреждающего монтирования.
+    ///
+    /// @param [in] Plugin Указатель на структуру плагина в FAR.
+    ///
+    /// Вызывается по событиям панели. Если курсор перешел на другой ресурс,
+    /// назначенное упреждающее монтирование переназначается на него с
+    /// задержкой Configuration::speculativeDwell(), а идущее монтирование
+    /// прежнего ресурса отменяется.
+    ///
+    void trackCursor(HANDLE Plugin);
+    ///
+    /// Назначить упреждающее монтирование недавно открытого ресурса.
+    ///
+    /// Выбирается первый не подсоединенный ресурс из #m_recent.
+    ///
+    void speculateRecent();
+    ///
+    /// Отменить идущее упреждающее монтирование ресурса.
+    ///
+    /// @param [in] url URL ресурса.
+    ///
+    void cancelSpeculation(const std::wstring& url);
+    ///
+    /// Забрать фоновое монтирование ресурса, который открывает оператор.
+    ///
+    /// @param [in] url URL ресурса.
+    ///
+    /// Если монтирование идет, дожидается его завершения с сообщением
+    /// "подождите". Упреждающе смонтированный ресурс перестает считаться
+    /// невостребованным.
+    ///
+    void claimBackgroundMount(const std::wstring& url);
+    ///
+    /// Преверить статус соединения с ресурсами.
+    ///
+    /// Опрашиваются только ресурсы, статус которых устарел или сброшен
+    /// событием монитора GVFS (см. MountPoint::statusFresh(),
+    /// Configuration::statusTtl()). Если таких нет, метод возвращается сразу,
+    /// не показывая сообщения.
     ///
     void checkResourcesStatus();
     ///
@@ -139,11 +447,107 @@ private:
     /// @return True, если у ресурсов совпадают URL и имя пользователя.
     ///
     /// Ресурс не является копией самого себя, потому что в этом случае
-    /// совпадут еще и идентификаторы в хранилище.
+    /// совпадут еще и идентификаторы в хранилище. Вызывается под
+    /// #m_pointsMutex.
     ///
     bool checkMountpointDuplicate(MountPoint const& point) const;
+    ///
+    /// Найти панель файла каталога по дескриптору.
+    ///
+    /// @param [in] Plugin Дескриптор панели.
+    /// @return Панель файла каталога или nullptr, если дескриптор
+    ///         принадлежит основной панели плагина.
+    ///
+    CatalogFilePanel* getFilePanel(HANDLE Plugin) const;
+    ///
+    /// Меню команд плагина (F2).
+    ///
+    /// @param [in] Plugin Указатель на структуру плагина в FAR.
+    ///
+    void commandsMenu(HANDLE Plugin);
+    ///
+    /// Показать диалог диагностики с метриками дополнения, см. Metrics.
+    ///
+    /// Кнопка "Сброс" обнуляет гистограммы и счетчики и обновляет диалог,
+    /// кнопка "Трасса" выгружает трассу, см. exportTrace().
+    ///
+    void showDiagnostics();
+    ///
+    /// Выгрузить трассу последних Trace::HistorySeconds секунд в файл
+    /// ~/gvfspanel-trace.json в формате Chrome trace, см. Trace.
+    ///
+    void exportTrace();
+    ///
+    /// Запросить у оператора имя файла каталога.
+    ///
+    /// @param [in] title Идентификатор заголовка запроса.
+    /// @param [in,out] fileName Имя файла.
+    /// @return false, если оператор отказался от ввода.
+    ///
+    bool askCatalogFileName(int title, std::wstring& fileName);
+    ///
+    /// Выгрузить набор ресурсов в файл каталога.
+    ///
+    /// @param [in] fileName Имя файла.
+    ///
+    void exportCatalog(const std::wstring& fileName);
+    ///
+    /// Загрузить ресурсы из файла каталога.
+    ///
+    /// @param [in] fileName Имя файла.
+    ///
+    /// Файл читается потоково. Дубликаты (в том числе внутри самого файла)
+    /// отбрасываются по каноническому URL, см. MountPoint::CanonicalUrl(),
+    /// новые ресурсы сохраняются одним пакетом, см. addResources().
+    ///
+    void importCatalog(const std::wstring& fileName);
+    ///
+    /// Загрузить ресурсы из закладок GTK и конфигурации клиента ssh.
+    ///
+    /// Дубликаты отбрасываются так же, как и при загрузке файла каталога, см.
+    /// importCatalog() и HostListReader.
+    ///
+    void importHostLists();
+    ///
+    /// Сообщить оператору итог массовой загрузки ресурсов.
+    ///
+    /// @param [in] title Идентификатор заголовка сообщения.
+    /// @param [in] batch Пакет загруженных ресурсов.
+    /// @param [in] failed Число несохраненных ресурсов.
+    ///
+    void reportImport(int title, const ImportBatch& batch, unsigned int failed);
+    ///
+    /// Добавить новые ресурсы в набор и сохранить их одним пакетом.
+    ///
+    /// @param [in] points Новые ресурсы.
+    /// @return Число ресурсов, которые сохранить не удалось.
+    ///
+    /// Несохраненные ресурсы в набор не добавляются.
+    ///
+    unsigned int addResources(const std::vector<MountPoint>& points);
+#ifdef USE_SECRET_STORAGE
+    ///
+    /// Перенести пароли всех ресурсов в другое хранилище паролей.
+    ///
+    /// @param [in] toSecretStorage true -- в безопасное хранилище, false --
+    ///                             в реестр.
+    ///
+    /// Во время переноса оператору показывается число перенесенных паролей,
+    /// по завершению -- итог операции со списком ресурсов, пароли которых
+    /// перенести не удалось. Если не удалось сохранить в новом хранилище
+    /// хотя бы один пароль, параметр конфигурации "использовать безопасное
+    /// хранилище" возвращается к прежнему значению.
+    ///
+    void switchPasswordStorage(bool toSecretStorage);
+#endif
 
     Options Opt; ///< Параметры экземпляра плагина.
+    static const unsigned int SchedulerConcurrency; ///< Число одновременно
+                                                    ///< выполняемых фоновых
+                                                    ///< операций.
+    static const unsigned int RecentSize; ///< Длина списка недавно
+                                          ///< открытых ресурсов.
+
     KeyBarTitlesHelper m_keyBar; ///< Элемент управления посказками о
                                  ///< функциональных кнопках клавиатуры.
     PluginStartupInfo m_pPsi; ///< API между плагином и far2l.
@@ -153,10 +557,40 @@ private:
     std::map<std::wstring, MountPoint> m_mountPoints; ///< Набор ресурсов для
                                                       ///< монтирования. Ключ --
                                                       ///< URL ресурса.
-    std::mutex m_pointsMutex; ///< Мутекс набора ресурсов.
-    bool m_firstDemand; ///< Флаг того, что панель ранее не открывали.
+    TimedMutex m_pointsMutex; ///< Мутекс набора ресурсов и фоновых
+                              ///< монтирований.
+    std::map< HANDLE, std::unique_ptr<CatalogFilePanel> > m_filePanels; ///< Открытые
+                                                                      ///< панели файлов
+                                                                      ///< каталога.
+    CatalogWatcher m_catalogWatcher; ///< Наблюдатель за изменениями хранилища
+                                     ///< ресурсов.
+    KeepaliveProber m_prober; ///< Проверка сеансов связи со смонтированными
+                              ///< ресурсами.
+    OperationScheduler m_scheduler; ///< Планировщик фоновых операций над
+                                    ///< ресурсами.
+    std::map<std::wstring, BackgroundMount> m_backgroundMounts; ///< Идущие фоновые
+                                                                ///< монтирования,
+                                                                ///< ключ -- URL.
+    std::set<std::wstring> m_speculative; ///< Упреждающе смонтированные, но
+                                          ///< еще не открытые ресурсы.
+    std::condition_variable_any m_backgroundMountDone; ///< Сигнал о завершении
+                                                       ///< фонового
+                                                       ///< монтирования.
+    bool m_exiting; ///< Плагин завершает работу, новые фоновые монтирования
+                    ///< не начинаются.
+    std::wstring m_dwellUrl; ///< Ресурс под курсором.
+    std::deque<std::wstring> m_recent; ///< Недавно открытые ресурсы, первым
+                                       ///< -- последний.
+    bool m_statusDemand; ///< Флаг того, что панель только что открыли и
+                         ///< статус ресурсов нужно проверить.
     std::wstring m_processedPointId; ///< Идентификатор ресурса, над которым в
                                      ///< в данный момент производится операция
                                      ///< подсоединения или отсоединения по
-                                     ///< команде оператора.
+                                     ///< команде оператора. Меняется только
+                                     ///< под #m_pointsMutex, см.
+                                     ///< ProcessedPoint.
+    std::set<std::wstring> m_deferredCatalogIds; ///< Записи хранилища,
+                                                 ///< изменения которых
+                                                 ///< отложены до завершения
+                                                 ///< операции оператора.
 };
@@ -115,32 +115,8 @@ SHAREDSYMBOL int WINAPI _export ProcessEditorInputW(const INPUT_RECORD * Rec)
 
 SHAREDSYMBOL HANDLE WINAPI _export OpenFilePluginW(const wchar_t * fileName, const unsigned char * fileHeader, int fileHeaderSize, int OpMode)
 {
-    (void)fileName;
-    (void)fileHeader;
-    (void)fileHeaderSize;
-    (void)OpMode;
-
-    return INVALID_HANDLE_VALUE;
-#if 0
-    if (fileName == nullptr)
-    {
-        return INVALID_HANDLE_VALUE;
-    }
-    std::wstring name(fileName);
-    std::wstring ext(L".gvfsmounts");
-    if(!std::equal(name.rbegin(), name.rbegin()+ext.size(), ext.rbegin(), ext.rend()))
-    {
-        return INVALID_HANDLE_VALUE;
-    }
-    std::vector<uint8_t> fHdr(fileHeader, fileHeader+fileHeaderSize);
-    std::vector<uint8_t> xmlHdr{'<', '?', 'x', 'm', 'l'};
-    if (!std::equal(xmlHdr.begin(), xmlHdr.end(), fHdr.begin(), fHdr.begin() + xmlHdr.size()))
-    {
-        return INVALID_HANDLE_VALUE;
-    }
-    return Plugin::getInstance().openPlugin(OPEN_ANALYSE,
-                                            reinterpret_cast<intptr_t>(fileName));
-#endif
+    return Plugin::getInstance().openFilePlugin(fileName, fileHeader,
+                                                fileHeaderSize, OpMode);
 }
 
 __attribute__((constructor)) void so_init(void)
@@ -1,18 +1,21 @@
 #include <WideMB.h> // far2l/utils
+#include "Metrics.h"
 #include "RegistryStorage.h"
 
 bool RegistryStorage::SetValue(HKEY folder, const std::wstring& field,
                                  const std::vector<BYTE>& value) const
 {
+  Metrics::Scope scope(Metrics::RegistryWrite);
   if (!folder || field.empty()) return false;
   LONG res = WINPORT(RegSetValueEx)(folder, field.c_str(), 0, REG_BINARY,
-                                    &value[0], value.size());
+                                    value.data(), value.size());
   return res == ERROR_SUCCESS;
 }
 
 bool RegistryStorage::SetValue(HKEY folder, const std::wstring& field,
                                  const std::wstring& value) const
 {
+  Metrics::Scope scope(Metrics::RegistryWrite);
   if (!folder || field.empty()) return false;
   std::string buf(StrWide2MB(value));
   LONG res = WINPORT(RegSetValueEx)(folder, field.c_str(), 0, REG_SZ_MB,
@@ -23,6 +26,7 @@ bool RegistryStorage::SetValue(HKEY folder, const std::wstring& field,
 bool RegistryStorage::SetValue(HKEY folder, const std::wstring& field,
                                  const DWORD value) const
 {
+  Metrics::Scope scope(Metrics::RegistryWrite);
   if (!folder || field.empty()) return false;
   LONG res = WINPORT(RegSetValueEx)(folder, field.c_str(), 0, REG_DWORD,
                                     (BYTE *)&value, sizeof(value));
@@ -32,6 +36,7 @@ bool RegistryStorage::SetValue(HKEY folder, const std::wstring& field,
 bool RegistryStorage::GetValue(HKEY folder, const std::wstring& field,
                                  std::vector<BYTE>& value) const
 {
+  Metrics::Scope scope(Metrics::RegistryRead);
   value.clear();
   if (!folder || field.empty()) return false;
   BYTE* buf = new BYTE[MAX_PATH];
@@ -61,6 +66,7 @@ bool RegistryStorage::GetValue(HKEY folder, const std::wstring& field,
 bool RegistryStorage::GetValue(HKEY folder, const std::wstring& field,
                                  std::wstring& value) const
 {
+  Metrics::Scope scope(Metrics::RegistryRead);
   value.clear();
   if (!folder || field.empty()) return false;
   char* buf = new char[MAX_PATH];
@@ -90,6 +96,7 @@ bool RegistryStorage::GetValue(HKEY folder, const std::wstring& field,
 bool RegistryStorage::GetValue(HKEY folder, const std::wstring& field,
                                  DWORD& value) const
 {
+  Metrics::Scope scope(Metrics::RegistryRead);
   if (!folder || field.empty()) return false;
   DWORD Type, size = sizeof(DWORD);
   LONG res = WINPORT(RegQueryValueEx)(folder, field.c_str(), 0, &Type,
@@ -4,137 +4,17 @@
  *  Created on: 26.05.2017
  *      Author: cycleg
  */
-#include <atomic>
-#include <iostream>
-#include <functional>
-#include <unordered_map>
-#include <mutex>
 #include <WideMB.h> // far2l/utils
+#include "GlibTrampoline.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "SecretServiceStorage.h"
 
 #define UNUSED(x) (void)x;
 
-using namespace std::placeholders;
-
 const char* RecordLabel = "Far-gvfs password record";
 
-namespace {
-
-///
-/// @brief Таблица обратных вызовов для асинхронных операций с безопасным хранилищем.
-
-/// Обратные вызовы -- обращения к методам класса SecretServiceStorage для
-/// конкретного экземпляра этого класса. В конструкторе SecretServiceStorage
-/// экземпляр регистрируется в этой таблице, в деструкторе -- удаляется из нее.
-///
-/// При манипуляциях с таблицей потокобезопасность обеспечивается стратегией
-/// "один писатель, много читателей". Попытки зарегистрировать объект в таблице
-/// или удалить из нее задерживаются до тех пор, пока не завершатся все
-/// текущие обратные вызовы. Эти операции выполняются за фиксированное время,
-/// в отличие от обратных вызовов. Обратные вызовы могут выполняться
-/// параллельно.
-///
-/// @author cycleg
-///
-class PasswordCallbacks
-{
-  friend class ::SecretServiceStorage; ///< Только экземпляры
-                                       ///< SecretServiceStorage могут
-                                       ///< манипулировать таблицей.
-
-  public:
-    PasswordCallbacks(): m_readers(0), m_lock(m_mapMutex, std::defer_lock)
-    {
-    }
-
-    void stored(GObject* source, GAsyncResult* result, gpointer user_data)
-    {
-      if (m_readers++ == 0) m_lock.lock();
-      auto i = m_callbacks.find(static_cast<SecretServiceStorage*>(user_data));
-      if (i != m_callbacks.end()) i->second.stored(source, result, user_data);
-      if (--m_readers == 0) m_lock.unlock();
-    }
-
-    void lookup(GObject* source, GAsyncResult* result, gpointer user_data)
-    {
-      if (m_readers++ == 0) m_lock.lock();
-      auto i = m_callbacks.find(static_cast<SecretServiceStorage*>(user_data));
-      if (i != m_callbacks.end()) i->second.lookup(source, result, user_data);
-      if (--m_readers == 0) m_lock.unlock();
-    }
-
-    void cleared(GObject* source, GAsyncResult* result, gpointer user_data)
-    {
-      if (m_readers++ == 0) m_lock.lock();
-      auto i = m_callbacks.find(static_cast<SecretServiceStorage*>(user_data));
-      if (i != m_callbacks.end()) i->second.cleared(source, result, user_data);
-      if (--m_readers == 0) m_lock.unlock();
-    }
-
-  private:
-    struct callbacks
-    {
-      std::function<void(GObject*, GAsyncResult*, gpointer)>
-        stored, ///< обратный вызов для сохранения пароля
-        lookup, ///< обратный вызов для поиска пароля
-        cleared; ///< обратный вызов для удаления пароля
-    };
-
-    void registerObj(SecretServiceStorage* _this, callbacks& cb)
-    {
-      // ожидаем, когда завершатся все текущие обратные вызовы
-      std::lock_guard<std::mutex> lck(m_mapMutex);
-      m_callbacks.emplace(_this, cb);
-    }
-
-    void unregisterObj(SecretServiceStorage* _this)
-    {
-      std::lock_guard<std::mutex> lck(m_mapMutex);
-      auto i = m_callbacks.find(_this);
-      if (i != m_callbacks.end()) m_callbacks.erase(i);
-    }
-
-    std::atomic_int m_readers; ///< Число потоков-читателей таблицы (извлекших
-                               ///< указатели на вызовы).
-    std::mutex m_mapMutex; ///< Мутекс на запись таблицы обратных вызовов.
-                           ///< Заперт, если есть хотя бы один читатель таблицы
-                           ///< или имеется писатель в таблицу.
-    std::unique_lock<std::mutex> m_lock; ///< Закрыт, если есть хотя бы один
-                                         ///< читатель таблицы.
-    std::unordered_map<SecretServiceStorage*, callbacks>
-      m_callbacks; ///< Таблица обратных вызовов: ключ -- указатель на целевой
-                   ///< объект, методы которого будут вызываться.
-                                                                  
-};
-
-PasswordCallbacks callbacksRegistry;
-
-extern "C" void password_stored_wrapper(GObject* source, GAsyncResult* result,
-                                        gpointer user_data)
-{
-  callbacksRegistry.stored(source, result, user_data);
-}
-
-extern "C" void password_lookup_wrapper(GObject* source, GAsyncResult* result,
-                                        gpointer user_data)
-{
-  callbacksRegistry.lookup(source, result, user_data);
-}
-
-extern "C" void password_cleared_wrapper(GObject* source, GAsyncResult* result,
-                                         gpointer user_data)
-{
-  callbacksRegistry.cleared(source, result, user_data);
-}
-
-///
-/// @brief Схема сохранения паролей для libsecret.
-
-/// @author cycleg
-///
-const SecretSchema* SecretServiceStorageSchema() G_GNUC_CONST;
-
-const SecretSchema* SecretServiceStorageSchema()
+const SecretSchema* SecretServiceStorage::Schema()
 {
     static const SecretSchema the_schema = {
         "org.far2l.gvfspanel.secure.storage.password", SECRET_SCHEMA_NONE,
@@ -146,26 +26,10 @@ const SecretSchema* SecretServiceStorageSchema()
     return &the_schema;
 }
 
-} // anonymous namespace
-
-#define SECRET_SERVICE_STORAGE_SCHEMA SecretServiceStorageSchema()
+#define SECRET_SERVICE_STORAGE_SCHEMA SecretServiceStorage::Schema()
 
 SecretServiceStorage::SecretServiceStorage(): m_result(false)
 {
-  // регистрируем наши обратные вызовы
-  PasswordCallbacks::callbacks cb;
-  cb.stored = std::bind(&SecretServiceStorage::onPasswordStored, this, _1, _2,
-                        _3);
-  cb.lookup = std::bind(&SecretServiceStorage::onPasswordFound, this, _1, _2,
-                        _3);
-  cb.cleared = std::bind(&SecretServiceStorage::onPasswordRemoved, this, _1,
-                         _2, _3);
-  callbacksRegistry.registerObj(this, cb);
-}
-
-SecretServiceStorage::~SecretServiceStorage()
-{
-  callbacksRegistry.unregisterObj(this);
 }
 
 bool SecretServiceStorage::SavePassword(const std::wstring& id,
@@ -194,7 +58,8 @@ bool SecretServiceStorage::SavePassword(const std::wstring& id,
                         RecordLabel,
                         passwordBuf.c_str(), // The password itself.
                         nullptr, // Cancellation object.
-                        password_stored_wrapper, // Callback
+                        GlibTrampoline<SecretServiceStorage, GObject*, GAsyncResult*>::
+                          Invoke<&SecretServiceStorage::onPasswordStored>, // Callback
                         this, // User data for callback.
 
                         // These are the attributes.
@@ -218,6 +83,7 @@ bool SecretServiceStorage::SavePassword(const std::wstring& id,
 bool SecretServiceStorage::LoadPassword(const std::wstring& id,
                                        std::wstring& password)
 {
+  Metrics::Scope scope(Metrics::SecretLookup);
   std::string idBuf(StrWide2MB(id));
 
   m_password.clear();
@@ -231,7 +97,8 @@ bool SecretServiceStorage::LoadPassword(const std::wstring& id,
 
   secret_password_lookup(SECRET_SERVICE_STORAGE_SCHEMA,
                          nullptr, // Cancellation object.
-                         password_lookup_wrapper, // Callback
+                         GlibTrampoline<SecretServiceStorage, GObject*, GAsyncResult*>::
+                           Invoke<&SecretServiceStorage::onPasswordFound>, // Callback
                          this, // User data for callback.
 
                          // These are the attributes.
@@ -247,7 +114,7 @@ bool SecretServiceStorage::LoadPassword(const std::wstring& id,
   return m_result;
 }
 
-void SecretServiceStorage::RemovePassword(const std::wstring& id)
+bool SecretServiceStorage::RemovePassword(const std::wstring& id)
 {
   std::string idBuf(StrWide2MB(id));
 
@@ -261,7 +128,8 @@ void SecretServiceStorage::RemovePassword(const std::wstring& id)
 
   secret_password_clear(SECRET_SERVICE_STORAGE_SCHEMA,
                         nullptr, // Cancellation object.
-                        password_cleared_wrapper, // Callback
+                        GlibTrampoline<SecretServiceStorage, GObject*, GAsyncResult*>::
+                          Invoke<&SecretServiceStorage::onPasswordRemoved>, // Callback
                         this, // User data for callback.
 
                         // These are the attributes.
@@ -270,33 +138,30 @@ void SecretServiceStorage::RemovePassword(const std::wstring& id)
                         nullptr); // Always end with NULL.
   m_mainLoop->run();
   g_main_context_pop_thread_default(main_context->gobj());
+  return m_result;
 }
 
 void SecretServiceStorage::onPasswordStored(GObject* source,
-                                           GAsyncResult* result,
-                                           gpointer user_data)
+                                            GAsyncResult* result)
 {
   UNUSED(source);
-  UNUSED(user_data);
 
   GError* error = nullptr;
   secret_password_store_finish(result, &error);
   m_result = (error == nullptr);
   if (!m_result)
   {
-    std::cerr << "SecretServiceStorage couldn't save password: "
-              << error->message << std::endl;
+    TRACE_ERROR("SecretServiceStorage::onPasswordStored()",
+                "couldn't save password: %s", error->message);
     g_error_free (error);
   }
   m_mainLoop->quit();
 }
 
 void SecretServiceStorage::onPasswordFound(GObject* source,
-                                          GAsyncResult* result,
-                                          gpointer user_data)
+                                           GAsyncResult* result)
 {
   UNUSED(source);
-  UNUSED(user_data);
 
   GError* error = nullptr;
   gchar* password = secret_password_lookup_finish(result, &error);
@@ -310,25 +175,24 @@ void SecretServiceStorage::onPasswordFound(GObject* source,
         }
         else
         {
-          std::cerr << "SecretServiceStorage couldn't find password" << std::endl;
+          TRACE_WARNING("SecretServiceStorage::onPasswordFound()",
+                        "couldn't find password");
           m_result = false;
         }
     }
     else
     {
-      std::cerr << "SecretServiceStorage couldn't find password: "
-                << error->message << std::endl;
+      TRACE_WARNING("SecretServiceStorage::onPasswordFound()",
+                    "couldn't find password: %s", error->message);
       g_error_free (error);
     }
   m_mainLoop->quit();
 }
 
 void SecretServiceStorage::onPasswordRemoved(GObject* source,
-                                            GAsyncResult* result,
-                                            gpointer user_data)
+                                             GAsyncResult* result)
 {
   UNUSED(source);
-  UNUSED(user_data);
 
   GError* error = nullptr;
   secret_password_clear_finish(result, &error);
@@ -336,8 +200,8 @@ void SecretServiceStorage::onPasswordRemoved(GObject* source,
   m_result = (error == nullptr);
   if (!m_result)
   {
-    std::cerr << "SecretServiceStorage couldn't remove password: "
-              << error->message << std::endl;
+    TRACE_ERROR("SecretServiceStorage::onPasswordRemoved()",
+                "couldn't remove password: %s", error->message);
     g_error_free (error);
   }
   m_mainLoop->quit();
@@ -42,10 +42,6 @@ class SecretServiceStorage
     /// Конструктор.
     ///
     SecretServiceStorage();
-    ///
-    /// Деструктор.
-    ///
-    ~SecretServiceStorage();
 
     ///
     /// Сохранить пароль для данного ID.
@@ -71,37 +67,47 @@ class SecretServiceStorage
     /// Удалить из коллекции пароль для данного ID.
     ///
     /// @param [in] id Идентификатор ресурса.
+    /// @return Результат операции.
+    ///
+    /// Отсутствие пароля в коллекции ошибкой не считается.
+    ///
+    bool RemovePassword(const std::wstring& id);
+
+    ///
+    /// Схема сохранения паролей для libsecret.
+    ///
+    /// @return Указатель на статический экземпляр схемы.
     ///
-    void RemovePassword(const std::wstring& id);
+    /// Используется также для асинхронного поиска пароля, см.
+    /// AwaitPasswordLookup.
+    ///
+    static const SecretSchema* Schema() G_GNUC_CONST;
 
   private:
+// Обратные вызовы получают экземпляр класса через user_data, см.
+// GlibTrampoline.
+
     ///
     /// Обратный вызов после сохранения пароля.
     ///
     /// @param [in] source Объект, инициировавший асинхронную операцию.
     /// @param [in] result Результат операции.
-    /// @param [in] user_data В текущей реализации this.
     ///
-    void onPasswordStored(GObject* source, GAsyncResult* result,
-                          gpointer user_data);
+    void onPasswordStored(GObject* source, GAsyncResult* result);
     ///
     /// Обратный вызов после завершения поиска пароля.
     ///
     /// @param [in] source Объект, инициировавший асинхронную операцию.
     /// @param [in] result Результат операции.
-    /// @param [in] user_data В текущей реализации this.
     ///
-    void onPasswordFound(GObject* source, GAsyncResult* result,
-                         gpointer user_data);
+    void onPasswordFound(GObject* source, GAsyncResult* result);
     ///
     /// Обратный вызов после удаления пароля.
     ///
     /// @param [in] source Объект, инициировавший асинхронную операцию.
     /// @param [in] result Результат операции.
-    /// @param [in] user_data В текущей реализации this.
     ///
-    void onPasswordRemoved(GObject* source, GAsyncResult* result,
-                           gpointer user_data);
+    void onPasswordRemoved(GObject* source, GAsyncResult* result);
 
     bool m_result; ///< Результат последней асинхронной операции.
     std::string m_password; ///< Буфер для найденного пароля. Используется
@@ -0,0 +1,191 @@
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <windows.h>
+#include <WideMB.h> // far2l/utils
+#include <PlatformConstants.h> // far2l/utils
+#include "SessionStateStorage.h"
+
+const wchar_t* SessionStateStorage::StoragePath = L"Session";
+const wchar_t* SessionStateStorage::FingerprintKey = L"Fingerprint";
+
+SessionStateStorage::SessionStateStorage(const std::wstring& registryFolder):
+  RegistryStorage(registryFolder)
+{
+  m_registryFolder.append(WGOOD_SLASH);
+  m_registryFolder.append(StoragePath);
+}
+
+std::wstring SessionStateStorage::Fingerprint()
+{
+  std::string bootId;
+  {
+    std::ifstream file("/proc/sys/kernel/random/boot_id");
+    std::getline(file, bootId);
+  }
+  std::ostringstream daemons;
+  DIR* proc = opendir("/proc");
+  if (!proc) return std::wstring();
+  // в /proc процессы перечисляются по возрастанию идентификатора, так что
+  // порядок в отпечатке от запуска к запуску не меняется
+  uid_t uid = getuid();
+  while (struct dirent* entry = readdir(proc))
+  {
+    if ((entry->d_name[0] < '1') || (entry->d_name[0] > '9')) continue;
+    std::string dir = std::string("/proc/") + entry->d_name;
+    struct stat info;
+    if ((stat(dir.c_str(), &info) != 0) || (info.st_uid != uid)) continue;
+    std::string comm;
+    {
+      std::ifstream file(dir + "/comm");
+      std::getline(file, comm);
+    }
+    if (comm != "gvfsd") continue;
+    std::string line;
+    {
+      std::ifstream file(dir + "/stat");
+      std::getline(file, line);
+    }
+    // имя процесса в скобках может содержать пробелы, поэтому поля
+    // отсчитываются от последней скобки; момент запуска -- 22-е поле
+    std::string::size_type pos = line.rfind(')');
+    if (pos == std::string::npos) continue;
+    std::istringstream fields(line.substr(pos + 1));
+    std::string startTime;
+    for (int i = 3; (i <= 22) && (fields >> startTime); i++);
+    if (!fields) continue;
+    daemons << ' ' << entry->d_name << '@' << startTime;
+  }
+  closedir(proc);
+  if (bootId.empty() || daemons.str().empty()) return std::wstring();
+  return StrMB2Wide(bootId + daemons.str());
+}
+
+bool SessionStateStorage::Save(const std::map<std::wstring, MountPoint>& points) const
+{
+  std::wstring fingerprint(Fingerprint());
+  if (fingerprint.empty()) return false;
+  HKEY hKey = nullptr;
+  DWORD disposition;
+  LONG res = WINPORT(RegCreateKeyEx)(HKEY_CURRENT_USER, m_registryFolder.c_str(),
+                                     0, nullptr, 0, KEY_READ | KEY_WRITE,
+                                     nullptr, &hKey, &disposition);
+  WINPORT(SetLastError)(res);
+  if (res != ERROR_SUCCESS) return false;
+  // пока состояние не записано целиком, оно не должно приниматься на веру
+  SetValue(hKey, FingerprintKey, std::wstring());
+  std::set<std::wstring> saved;
+  bool ret = true;
+  for (const auto& point : points)
+  {
+    const MountPoint& state = point.second;
+    if (state.m_storageId.empty() || state.m_stale ||
+        (state.m_verified == std::chrono::steady_clock::time_point()))
+      continue;
+    std::wstring key = m_registryFolder;
+    key.append(WGOOD_SLASH);
+    key.append(state.m_storageId);
+    HKEY hRecord = nullptr;
+    res = WINPORT(RegCreateKeyEx)(HKEY_CURRENT_USER, key.c_str(), 0, nullptr,
+                                  0, KEY_WRITE, nullptr, &hRecord,
+                                  &disposition);
+    WINPORT(SetLastError)(res);
+    if (res != ERROR_SUCCESS)
+    {
+      ret = false;
+      continue;
+    }
+    if (SetValue(hRecord, L"ShareName", state.m_shareName) &&
+        SetValue(hRecord, L"MountPath", state.m_mountPointPath) &&
+        SetValue(hRecord, L"Proto", static_cast<DWORD>(state.m_proto)) &&
+        SetValue(hRecord, L"WasMounted", static_cast<DWORD>(state.m_wasMounted)))
+      saved.insert(state.m_storageId);
+      else ret = false;
+    WINPORT(RegCloseKey)(hRecord);
+  }
+  // записи удаленных ресурсов и ресурсов с неизвестным статусом
+  std::vector<std::wstring> obsolete;
+  DWORD index = 0;
+  do
+  {
+    wchar_t subKey[MAX_PATH];
+    FILETIME tTime;
+    DWORD subKeySize = MAX_PATH * sizeof(wchar_t);
+    std::memset(subKey, 0, subKeySize);
+    res = WINPORT(RegEnumKeyEx)(hKey, index, subKey, &subKeySize, 0, nullptr,
+                                nullptr, &tTime);
+    if ((res == ERROR_SUCCESS) && (saved.count(subKey) == 0))
+      obsolete.push_back(subKey);
+    index++;
+  } while (res == ERROR_SUCCESS);
+  for (const auto& id : obsolete)
+  {
+    std::wstring key = m_registryFolder;
+    key.append(WGOOD_SLASH);
+    key.append(id);
+    WINPORT(RegDeleteKey)(HKEY_CURRENT_USER, key.c_str());
+  }
+  ret = SetValue(hKey, FingerprintKey, fingerprint) && ret;
+  WINPORT(RegCloseKey)(hKey);
+  return ret;
+}
+
+void SessionStateStorage::Restore(std::map<std::wstring, MountPoint>& points,
+                                  std::vector<std::wstring>& restored) const
+{
+  restored.clear();
+  HKEY hKey = nullptr;
+  if (WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, m_registryFolder.c_str(), 0,
+                            KEY_READ, &hKey) != ERROR_SUCCESS)
+    return;
+  std::wstring saved;
+  bool match = GetValue(hKey, FingerprintKey, saved) && !saved.empty() &&
+               (saved == Fingerprint());
+  WINPORT(RegCloseKey)(hKey);
+  Invalidate();
+  if (!match) return;
+  for (auto& point : points)
+  {
+    MountPoint& state = point.second;
+    if (state.m_storageId.empty()) continue;
+    std::wstring key = m_registryFolder;
+    key.append(WGOOD_SLASH);
+    key.append(state.m_storageId);
+    HKEY hRecord = nullptr;
+    if (WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, key.c_str(), 0, KEY_READ,
+                              &hRecord) != ERROR_SUCCESS)
+      continue;
+    std::wstring shareName, mountPath;
+    DWORD proto, wasMounted;
+    // неполная запись не восстанавливается: статус ресурса неизвестен
+    if (GetValue(hRecord, L"ShareName", shareName) &&
+        GetValue(hRecord, L"MountPath", mountPath) &&
+        GetValue(hRecord, L"Proto", proto) &&
+        GetValue(hRecord, L"WasMounted", wasMounted) &&
+        (proto <= static_cast<DWORD>(MountPoint::EProtocol::Unknown)))
+    {
+      state.m_shareName = shareName;
+      state.m_mountPointPath = mountPath;
+      state.m_proto = static_cast<MountPoint::EProtocol>(proto);
+      state.m_wasMounted = (wasMounted != 0) && !shareName.empty();
+      state.m_stale = false;
+      state.m_verified = std::chrono::steady_clock::now();
+      restored.push_back(point.first);
+    }
+    WINPORT(RegCloseKey)(hRecord);
+  }
+}
+
+void SessionStateStorage::Invalidate() const
+{
+  HKEY hKey = nullptr;
+  if (WINPORT(RegOpenKeyEx)(HKEY_CURRENT_USER, m_registryFolder.c_str(), 0,
+                            KEY_WRITE, &hKey) != ERROR_SUCCESS)
+    return;
+  SetValue(hKey, FingerprintKey, std::wstring());
+  WINPORT(RegCloseKey)(hKey);
+}
@@ -0,0 +1,98 @@
+///
+/// @file SessionStateStorage.h
+///
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "MountPoint.h"
+#include "RegistryStorage.h"
+
+///
+/// @brief Хранилище состояния ресурсов между запусками far2l.
+
+/// Состояние ресурсов (подсоединен ли ресурс, имя и путь точки
+/// монтирования, протокол, признак "подсоединен в этом сеансе") само по
+/// себе живет только в памяти, и без хранилища каждый запуск far2l начинался
+/// бы с опроса GVFS о каждом ресурсе каталога. Точки монтирования, однако,
+/// принадлежат не far2l, а демону gvfsd, и переживают far2l, пока жив
+/// демон.
+///
+/// Поэтому при выходе из far2l последнее достоверное состояние ресурсов
+/// сохраняется в реестре far2l, в подпапке "Session" папки параметров
+/// плагина, вместе с отпечатком сеанса GVFS (см. Fingerprint()). Каждому
+/// ресурсу соответствует подпапка с именем, равным идентификатору записи в
+/// MountPointStorage. Ресурсы с неизвестным статусом и ресурсы с
+/// разорванным сеансом связи не сохраняются.
+///
+/// При запуске сохраненное состояние принимается на веру, только если
+/// отпечаток совпадает с текущим, и только один раз: отпечаток в хранилище
+/// при этом стирается. Если предыдущий запуск завершился аварийно, статус
+/// ресурсов будет определен опросом GVFS, как обычно.
+///
+/// @author cycleg
+///
+class SessionStateStorage: public RegistryStorage
+{
+  public:
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] registryFolder Имя папки, в которой находится подпапка
+    ///                            хранилища.
+    ///
+    /// К указанному в параметре registryFolder пути добавляется суффиксом
+    /// значение константы StoragePath.
+    ///
+    SessionStateStorage(const std::wstring& registryFolder);
+
+    ///
+    /// Отпечаток текущего сеанса GVFS.
+    ///
+    /// @return Идентификатор загрузки ядра, идентификаторы и моменты запуска
+    ///         процессов gvfsd текущего пользователя; пустая строка, если
+    ///         gvfsd не запущен.
+    ///
+    /// Отпечаток меняется при перезагрузке системы и при перезапуске
+    /// демона, то есть тогда, когда все точки монтирования GVFS пропадают.
+    ///
+    static std::wstring Fingerprint();
+
+    ///
+    /// Сохранить состояние ресурсов.
+    ///
+    /// @param [in] points Ресурсы.
+    /// @return Результат операции.
+    ///
+    /// Записи о ресурсах, которых больше нет или статус которых неизвестен,
+    /// из хранилища удаляются. Отпечаток сеанса записывается последним.
+    /// Если gvfsd не запущен, сохранять нечего.
+    ///
+    bool Save(const std::map<std::wstring, MountPoint>& points) const;
+    ///
+    /// Восстановить состояние ресурсов.
+    ///
+    /// @param [in,out] points Ресурсы.
+    /// @param [out] restored URL ресурсов, состояние которых восстановлено.
+    ///
+    /// Состояние восстанавливается, только если отпечаток сеанса в
+    /// хранилище совпадает с текущим. Восстановленный статус ресурса
+    /// считается только что проверенным (см. MountPoint::statusFresh()),
+    /// но точка монтирования GIO не известна; проверить ее следует в фоне.
+    /// Отпечаток в хранилище стирается в любом случае (см. Invalidate()).
+    ///
+    void Restore(std::map<std::wstring, MountPoint>& points,
+                 std::vector<std::wstring>& restored) const;
+    ///
+    /// Стереть отпечаток сеанса, чтобы сохраненное состояние больше не
+    /// принималось на веру.
+    ///
+    void Invalidate() const;
+
+  private:
+    static const wchar_t* StoragePath; ///< Подпапка реестра, в которой
+                                       ///< хранится состояние.
+    static const wchar_t* FingerprintKey; ///< Имя ключа реестра с отпечатком
+                                          ///< сеанса GVFS.
+};
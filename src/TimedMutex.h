@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include "LatencyHistogram.h"
+
+///
+/// @brief Мутекс с учетом времени удержания.
+
+/// Обертка вокруг std::mutex, совместимая с std::lock_guard и
+/// std::unique_lock. Время от захвата до освобождения мутекса учитывается в
+/// гистограмме holdTimes(), время ожидания захвата -- в waitTimes(). Метки
+/// времени пишутся только владельцем мутекса, поэтому дополнительной
+/// синхронизации не требуется; накладные расходы -- два-три обращения к
+/// steady_clock на захват.
+///
+/// @author cycleg
+///
+class TimedMutex
+{
+  public:
+    inline void lock()
+    {
+      std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+      m_mutex.lock();
+      m_acquired = std::chrono::steady_clock::now();
+      m_waitTimes.record(m_acquired - start);
+    }
+
+    inline bool try_lock()
+    {
+      if (!m_mutex.try_lock()) return false;
+      m_acquired = std::chrono::steady_clock::now();
+      return true;
+    }
+
+    inline void unlock()
+    {
+      m_holdTimes.record(std::chrono::steady_clock::now() - m_acquired);
+      m_mutex.unlock();
+    }
+
+    ///
+    /// @return Гистограмма времени удержания мутекса.
+    ///
+    inline LatencyHistogram& holdTimes() { return m_holdTimes; }
+    ///
+    /// @return Гистограмма времени ожидания захвата мутекса.
+    ///
+    inline LatencyHistogram& waitTimes() { return m_waitTimes; }
+
+  private:
+    std::mutex m_mutex; ///< Собственно мутекс.
+    std::chrono::steady_clock::time_point m_acquired; ///< Момент захвата.
+    LatencyHistogram m_holdTimes; ///< Время удержания.
+    LatencyHistogram m_waitTimes; ///< Время ожидания захвата.
+};
@@ -0,0 +1,492 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "Trace.h"
+
+#ifdef NDEBUG
+std::atomic_int Trace::m_level(Trace::Info);
+#else
+std::atomic_int Trace::m_level(Trace::Debug);
+#endif // NDEBUG
+
+namespace {
+
+const unsigned int RingCapacity = 1024; ///< Емкость буфера потока, событий.
+const std::chrono::milliseconds DrainPeriod(200); ///< Период сборщика.
+const size_t HistoryLimit = 200000; ///< Предельный размер истории, событий.
+
+/// Начало отсчета времени событий.
+const std::chrono::steady_clock::time_point Epoch =
+  std::chrono::steady_clock::now();
+
+///
+/// @brief Запись о событии в буфере потока.
+///
+struct Record
+{
+  uint64_t time; ///< Время от Epoch, нс.
+  const char* name; ///< Имя события.
+  Trace::Level level; ///< Уровень.
+  char phase; ///< Вид события в терминах Chrome trace: 'i' -- мгновенное,
+              ///< 'B' и 'E' -- начало и конец интервала.
+  char text[Trace::TextSize]; ///< Текст.
+};
+
+///
+/// @brief Событие в истории сборщика.
+///
+struct Entry
+{
+  Record record; ///< Событие.
+  pid_t tid; ///< Идентификатор потока.
+};
+
+///
+/// @brief Кольцевой буфер событий одного потока.
+///
+/// Один писатель (поток-владелец) и один читатель (сборщик); индексы
+/// головы и хвоста монотонно растут, переполнение 32-битных счетчиков
+/// безопасно, т.к. емкость -- степень двойки.
+///
+class Ring
+{
+  public:
+    explicit Ring(pid_t tid):
+      m_tid(tid), m_head(0), m_tail(0), m_dropped(0), m_reported(0),
+      m_retired(false)
+    {
+    }
+
+    ///
+    /// @return Свободная ячейка либо nullptr, если буфер полон.
+    ///
+    /// Вызывается только потоком-владельцем.
+    ///
+    inline Record* acquire()
+    {
+      uint32_t head = m_head.load(std::memory_order_relaxed);
+      if (head - m_tail.load(std::memory_order_acquire) >= RingCapacity)
+      {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+      return &m_records[head % RingCapacity];
+    }
+
+    ///
+    /// Опубликовать ячейку, полученную от acquire().
+    ///
+    inline void commit()
+    {
+      m_head.store(m_head.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+    ///
+    /// Передать накопленные события потребителю и освободить ячейки.
+    ///
+    /// Вызывается только сборщиком.
+    ///
+    template <class Consumer> void drain(Consumer consumer)
+    {
+      uint32_t tail = m_tail.load(std::memory_order_relaxed),
+               head = m_head.load(std::memory_order_acquire);
+      for (; tail != head; tail++) consumer(m_records[tail % RingCapacity]);
+      m_tail.store(tail, std::memory_order_release);
+    }
+
+    inline pid_t tid() const { return m_tid; }
+    ///
+    /// @return Число потерь с прошлого вызова.
+    ///
+    /// Вызывается только сборщиком.
+    ///
+    inline unsigned long takeDropped()
+    {
+      unsigned long dropped = m_dropped, fresh = dropped - m_reported;
+      m_reported = dropped;
+      return fresh;
+    }
+    ///
+    /// Пометить буфер завершившегося потока для удаления сборщиком.
+    ///
+    inline void retire() { m_retired = true; }
+    inline bool retired() const { return m_retired; }
+
+  private:
+    Record m_records[RingCapacity]; ///< Ячейки.
+    pid_t m_tid; ///< Идентификатор потока-владельца.
+    std::atomic<uint32_t> m_head; ///< Следующая ячейка для записи.
+    std::atomic<uint32_t> m_tail; ///< Следующая ячейка для чтения.
+    std::atomic_ulong m_dropped; ///< Отброшено событий.
+    unsigned long m_reported; ///< Потери, уже учтенные сборщиком.
+    std::atomic_bool m_retired; ///< Поток-владелец завершился.
+};
+
+///
+/// @brief Поток-сборщик событий.
+///
+class Collector
+{
+  public:
+    ///
+    /// Экземпляр-синглет.
+    ///
+    /// Не уничтожается: потоки могут завершаться и после деструкторов
+    /// статических объектов, а их буферы принадлежат сборщику.
+    ///
+    static Collector& Instance()
+    {
+      static Collector* instance = new Collector();
+      return *instance;
+    }
+
+    ///
+    /// Завести буфер для текущего потока.
+    ///
+    Ring* attach()
+    {
+      std::lock_guard<std::mutex> lck(m_ringsMutex);
+      m_rings.emplace_back(new Ring(syscall(SYS_gettid)));
+      return m_rings.back().get();
+    }
+
+    void start()
+    {
+      std::lock_guard<std::mutex> lck(m_threadMutex);
+      if (m_thread.joinable()) return;
+      {
+        std::lock_guard<std::mutex> drainLck(m_drainMutex);
+        const char* path = std::getenv("GVFSPANEL_TRACE_LOG");
+        if (path && *path) m_log.open(path);
+      }
+      m_quit = false;
+      m_thread = std::thread(&Collector::loop, this);
+    }
+
+    void stop()
+    {
+      std::lock_guard<std::mutex> lck(m_threadMutex);
+      if (!m_thread.joinable()) return;
+      {
+        std::lock_guard<std::mutex> quitLck(m_quitMutex);
+        m_quit = true;
+      }
+      m_quitCondition.notify_one();
+      m_thread.join();
+      drain();
+      std::lock_guard<std::mutex> drainLck(m_drainMutex);
+      if (m_log.is_open()) m_log.close();
+    }
+
+    bool exportChrome(const std::string& fileName, unsigned int seconds,
+                      std::string& error);
+
+  private:
+    Collector(): m_quit(false) {}
+
+    ///
+    /// Цикл потока-сборщика.
+    ///
+    void loop()
+    {
+      std::unique_lock<std::mutex> lck(m_quitMutex);
+      while (!m_quit)
+      {
+        m_quitCondition.wait_for(lck, DrainPeriod);
+        lck.unlock();
+        drain();
+        lck.lock();
+      }
+    }
+
+    ///
+    /// Опустошить буферы потоков.
+    ///
+    void drain();
+    ///
+    /// Вывести событие в журнал и, если нужно, в std::cerr.
+    ///
+    void write(const Entry& entry);
+
+    std::mutex m_ringsMutex; ///< Охрана m_rings.
+    std::vector<std::unique_ptr<Ring> > m_rings; ///< Буферы потоков.
+    std::mutex m_drainMutex; ///< Охрана истории и журнала.
+    std::deque<Entry> m_history; ///< История событий.
+    std::ofstream m_log; ///< Файл журнала.
+    std::mutex m_threadMutex; ///< Охрана запуска и остановки потока.
+    std::thread m_thread; ///< Поток-сборщик.
+    std::mutex m_quitMutex; ///< Охрана m_quit.
+    std::condition_variable m_quitCondition; ///< Сигнал завершения.
+    bool m_quit; ///< Признак завершения.
+};
+
+///
+/// @brief Буфер текущего потока.
+///
+/// Деструктор срабатывает при завершении потока и передает буфер сборщику
+/// на удаление.
+///
+class LocalRing
+{
+  public:
+    ~LocalRing() { if (m_ring) m_ring->retire(); }
+
+    inline Ring* get()
+    {
+      if (!m_ring) m_ring = Collector::Instance().attach();
+      return m_ring;
+    }
+
+  private:
+    Ring* m_ring = nullptr; ///< Буфер потока.
+};
+
+thread_local LocalRing CurrentRing;
+
+inline uint64_t Now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now() - Epoch
+         ).count();
+}
+
+const char* LevelName(Trace::Level level)
+{
+  static const char* names[] = { "debug", "info", "warning", "error" };
+  return names[level];
+}
+
+///
+/// Записать событие в буфер текущего потока.
+///
+/// @param [in] args Аргументы формата; nullptr -- событие без текста.
+///
+void Put(Trace::Level level, char phase, const char* name,
+         const char* format, va_list* args)
+{
+  Ring* ring = CurrentRing.get();
+  Record* record = ring->acquire();
+  if (!record) return;
+  record->time = Now();
+  record->name = name;
+  record->level = level;
+  record->phase = phase;
+  if (args)
+    std::vsnprintf(record->text, sizeof(record->text), format, *args);
+    else record->text[0] = 0;
+  ring->commit();
+}
+
+void JsonString(std::ostream& out, const char* s)
+{
+  out << '"';
+  for (; *s; s++)
+  {
+    unsigned char ch = *s;
+    if ((ch == '"') || (ch == '\\'))
+      {
+        out << '\\' << ch;
+      }
+      else if (ch < 0x20)
+      {
+        char buffer[8];
+        std::snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+        out << buffer;
+      }
+      else out << ch;
+  }
+  out << '"';
+}
+
+void Collector::drain()
+{
+  std::lock_guard<std::mutex> lck(m_drainMutex);
+  std::vector<Ring*> rings, retired;
+  {
+    std::lock_guard<std::mutex> ringsLck(m_ringsMutex);
+    for (const auto& ring : m_rings)
+    {
+      // буфер завершившегося потока опустошается в последний раз
+      if (ring->retired()) retired.push_back(ring.get());
+      rings.push_back(ring.get());
+    }
+  }
+  std::vector<Entry> entries;
+  unsigned long dropped = 0;
+  for (Ring* ring : rings)
+  {
+    pid_t tid = ring->tid();
+    ring->drain([&entries, tid] (const Record& record)
+                {
+                  entries.push_back(Entry{ record, tid });
+                });
+    dropped += ring->takeDropped();
+  }
+  if (!retired.empty())
+  {
+    std::lock_guard<std::mutex> ringsLck(m_ringsMutex);
+    for (Ring* ring : retired)
+      m_rings.erase(std::find_if(m_rings.begin(), m_rings.end(),
+                                 [ring] (const std::unique_ptr<Ring>& item)
+                                 { return item.get() == ring; }));
+  }
+  std::sort(entries.begin(), entries.end(),
+            [] (const Entry& a, const Entry& b)
+            { return a.record.time < b.record.time; });
+  for (const auto& entry : entries)
+  {
+    write(entry);
+    m_history.push_back(entry);
+  }
+  if (dropped && m_log.is_open())
+    m_log << "trace: " << dropped << " events dropped\n";
+  if (m_log.is_open()) m_log.flush();
+  uint64_t threshold = Now();
+  threshold = (threshold > Trace::HistorySeconds * 1000000000ull) ?
+                threshold - Trace::HistorySeconds * 1000000000ull : 0;
+  while (!m_history.empty() &&
+         ((m_history.front().record.time < threshold) ||
+          (m_history.size() > HistoryLimit)))
+    m_history.pop_front();
+}
+
+void Collector::write(const Entry& entry)
+{
+  const Record& record = entry.record;
+  if (!m_log.is_open() && (record.level < Trace::Warning)) return;
+  char line[Trace::TextSize + 160];
+  std::snprintf(line, sizeof(line), "%12.3f %7d %-7s %s%s %s",
+                record.time / 1000000.0, static_cast<int>(entry.tid),
+                LevelName(record.level),
+                (record.phase == 'B') ? "> " : ((record.phase == 'E') ? "< " : ""),
+                record.name, record.text);
+  if (m_log.is_open()) m_log << line << '\n';
+  if (record.level >= Trace::Warning) std::cerr << line << std::endl;
+}
+
+bool Collector::exportChrome(const std::string& fileName, unsigned int seconds,
+                             std::string& error)
+{
+  drain();
+  std::lock_guard<std::mutex> lck(m_drainMutex);
+  std::ofstream out(fileName);
+  if (!out)
+  {
+    error = std::strerror(errno);
+    return false;
+  }
+  if (seconds > Trace::HistorySeconds) seconds = Trace::HistorySeconds;
+  uint64_t threshold = Now();
+  threshold = (threshold > seconds * 1000000000ull) ?
+                threshold - seconds * 1000000000ull : 0;
+  const pid_t pid = getpid();
+  bool first = true;
+  out << "{\"traceEvents\":[\n";
+  for (const auto& entry : m_history)
+  {
+    const Record& record = entry.record;
+    if (record.time < threshold) continue;
+    if (!first) out << ",\n";
+    first = false;
+    char head[128];
+    std::snprintf(head, sizeof(head),
+                  "{\"cat\":\"gvfspanel\",\"ph\":\"%c\",\"ts\":%.3f,"
+                  "\"pid\":%d,\"tid\":%d,", record.phase, record.time / 1000.0,
+                  static_cast<int>(pid), static_cast<int>(entry.tid));
+    out << head;
+    if (record.phase == 'i') out << "\"s\":\"t\",";
+    out << "\"name\":";
+    JsonString(out, record.name);
+    if (record.phase != 'E')
+    {
+      out << ",\"args\":{\"level\":\"" << LevelName(record.level)
+          << "\",\"text\":";
+      JsonString(out, record.text);
+      out << "}";
+    }
+    out << "}";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  out.close();
+  if (!out)
+  {
+    error = std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+Trace::Span::Span(const char* name, const std::string& text):
+  m_name(name),
+  m_begun(Trace::Enabled(Trace::Info))
+{
+  if (m_begun) Trace::Begin(name, "%s", text.c_str());
+}
+
+Trace::Span::~Span()
+{
+  if (m_begun) Trace::End(m_name);
+}
+
+void Trace::Event(Level level, const char* name, const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  Put(level, 'i', name, format, &args);
+  va_end(args);
+}
+
+void Trace::Begin(const char* name, const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  Put(Info, 'B', name, format, &args);
+  va_end(args);
+}
+
+void Trace::End(const char* name)
+{
+  Put(Info, 'E', name, nullptr, nullptr);
+}
+
+void Trace::Start()
+{
+  const char* level = std::getenv("GVFSPANEL_TRACE_LEVEL");
+  if (level)
+  {
+    if (!std::strcmp(level, "debug")) SetLevel(Debug);
+      else if (!std::strcmp(level, "info")) SetLevel(Info);
+      else if (!std::strcmp(level, "warning")) SetLevel(Warning);
+      else if (!std::strcmp(level, "error")) SetLevel(Error);
+  }
+  Collector::Instance().start();
+}
+
+void Trace::Stop()
+{
+  Collector::Instance().stop();
+}
+
+bool Trace::ExportChrome(const std::string& fileName, unsigned int seconds,
+                         std::string& error)
+{
+  return Collector::Instance().exportChrome(fileName, seconds, error);
+}
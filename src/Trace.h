@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+///
+/// @brief Трассировка дополнения.
+
+/// Замена отладочной печати в std::cout/std::cerr. Событие -- уровень,
+/// имя (строковая константа, обычно "Класс::метод()") и короткий текст в
+/// формате printf() -- записывается в кольцевой буфер своего потока без
+/// блокировок и системных вызовов: одно чтение часов и форматирование текста
+/// в ячейку буфера. Если буфер полон, событие отбрасывается и учитывается в
+/// счетчике потерь.
+///
+/// Буферы всех потоков периодически опустошает отдельный поток-сборщик. Он
+/// пишет события в файл журнала, если тот задан переменной окружения
+/// GVFSPANEL_TRACE_LOG, предупреждения и ошибки -- в std::cerr, а события
+/// последних HistorySeconds секунд хранит в памяти для выгрузки в формате
+/// Chrome trace (chrome://tracing, Perfetto), см. ExportChrome().
+///
+/// Кроме мгновенных событий, поддерживаются интервалы (пары Begin()/End(),
+/// класс Span) -- по ним строится временная диаграмма фаз монтирования.
+///
+/// Порог уровня задается переменной окружения GVFSPANEL_TRACE_LEVEL (debug,
+/// info, warning, error); по умолчанию -- debug в отладочной сборке и info
+/// в выпускной. Проверка порога -- одно атомарное чтение; чтобы при
+/// отключенном уровне не вычислялись и аргументы, используются макросы
+/// TRACE_DEBUG() и т.д.
+///
+/// @author cycleg
+///
+class Trace
+{
+  public:
+    ///
+    /// Уровень события.
+    ///
+    enum Level
+    {
+      Debug = 0,
+      Info,
+      Warning,
+      Error
+    };
+
+    static const unsigned int TextSize = 120; ///< Предельная длина текста
+                                              ///< события, с завершающим
+                                              ///< нулем.
+    static const unsigned int HistorySeconds = 60; ///< Глубина истории для
+                                                   ///< выгрузки, с.
+
+    ///
+    /// @brief Интервал в области видимости.
+    ///
+    /// Конструктор открывает интервал (Begin()), деструктор -- закрывает
+    /// (End()), в том числе при выходе из области по исключению. Интервал
+    /// записывается на уровне Info.
+    ///
+    class Span
+    {
+      public:
+        Span(const char* name, const std::string& text);
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+      private:
+        const char* m_name; ///< Имя интервала.
+        bool m_begun; ///< Интервал открыт (уровень Info не отключен).
+    };
+
+    ///
+    /// Проверить, записываются ли события уровня.
+    ///
+    static inline bool Enabled(Level level)
+    { return level >= m_level.load(std::memory_order_relaxed); }
+    ///
+    /// Задать порог уровня.
+    ///
+    static inline void SetLevel(Level level) { m_level = level; }
+
+    ///
+    /// Записать мгновенное событие.
+    ///
+    /// @param [in] level Уровень.
+    /// @param [in] name Имя события, строковая константа.
+    /// @param [in] format Формат текста, как в printf().
+    ///
+    /// Текст длиннее TextSize обрезается.
+    ///
+    static void Event(Level level, const char* name, const char* format, ...)
+      __attribute__((format(printf, 3, 4)));
+    ///
+    /// Открыть интервал.
+    ///
+    static void Begin(const char* name, const char* format, ...)
+      __attribute__((format(printf, 2, 3)));
+    ///
+    /// Закрыть интервал, открытый в том же потоке.
+    ///
+    static void End(const char* name);
+
+    ///
+    /// Запустить поток-сборщик.
+    ///
+    /// Параметры берутся из переменных окружения GVFSPANEL_TRACE_LOG и
+    /// GVFSPANEL_TRACE_LEVEL. События, записанные до запуска, сохраняются в
+    /// буферах потоков.
+    ///
+    static void Start();
+    ///
+    /// Опустошить буферы в последний раз и остановить поток-сборщик.
+    ///
+    static void Stop();
+    ///
+    /// Выгрузить историю событий в формате Chrome trace (JSON).
+    ///
+    /// @param [in] fileName Имя файла.
+    /// @param [in] seconds Глубина выгрузки, с, не более HistorySeconds.
+    /// @param [out] error Описание ошибки.
+    /// @return Результат операции.
+    ///
+    static bool ExportChrome(const std::string& fileName, unsigned int seconds,
+                             std::string& error);
+
+  private:
+    static std::atomic_int m_level; ///< Порог уровня.
+};
+
+#define TRACE_EVENT(level, name, ...) \
+  do \
+  { \
+    if (Trace::Enabled(level)) Trace::Event(level, name, __VA_ARGS__); \
+  } while (0)
+
+#define TRACE_DEBUG(name, ...) TRACE_EVENT(Trace::Debug, name, __VA_ARGS__)
+#define TRACE_INFO(name, ...) TRACE_EVENT(Trace::Info, name, __VA_ARGS__)
+#define TRACE_WARNING(name, ...) TRACE_EVENT(Trace::Warning, name, __VA_ARGS__)
+#define TRACE_ERROR(name, ...) TRACE_EVENT(Trace::Error, name, __VA_ARGS__)
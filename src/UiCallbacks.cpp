@@ -1,6 +1,7 @@
 #include <string>
 #include <WideMB.h> // far2l/utils
 #include "dialogs.h"
+#include "LngStringIDs.h"
 #include "TextFormatter.h"
 #include "UiCallbacks.h"
 
@@ -56,3 +57,22 @@ void UiCallbacks::onAskQuestion(char* message, char** choices, int& choice) cons
     answer = -1;
   choice = answer;
 }
+
+void UiCallbacks::onMountRetry(unsigned int attempt, unsigned int attempts,
+                               unsigned int delay,
+                               const Glib::ustring& error) const
+{
+  wchar_t retry[128];
+  swprintf(retry, ARRAYSIZE(retry),
+           m_pStartupInfo.GetMsg(m_pStartupInfo.ModuleNumber, MMountRetry),
+           attempt, attempts, delay / 1000, (delay % 1000) / 100);
+  TextFormatter formatter;
+  formatter.TextWidth(AskQuestionDlgWidth - (3 + 1) * 2);
+  std::wstring reason(formatter.FitToLine(MB2Wide(error.raw().c_str())));
+  const wchar_t* msgItems[3] = { nullptr };
+  msgItems[0] = m_pStartupInfo.GetMsg(m_pStartupInfo.ModuleNumber, MResourceMount);
+  msgItems[1] = retry;
+  msgItems[2] = reason.c_str();
+  m_pStartupInfo.Message(m_pStartupInfo.ModuleNumber, 0, nullptr, msgItems,
+                         ARRAYSIZE(msgItems), 0);
+}
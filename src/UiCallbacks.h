@@ -43,6 +43,20 @@ class UiCallbacks
     ///
     void onAskQuestion(char* message, char** choices, int& choice) const;
 
+    ///
+    /// Уведомление о повторе монтирования после временной ошибки.
+    ///
+    /// @param [in] attempt Номер следующей попытки.
+    /// @param [in] attempts Общее число попыток.
+    /// @param [in] delay Задержка перед попыткой, мс.
+    /// @param [in] error Сообщение о временной ошибке.
+    ///
+    /// Показывает сообщение без кнопок поверх сообщения о ходе монтирования;
+    /// его убирает вызывающий код вместе с сообщением о ходе монтирования.
+    ///
+    void onMountRetry(unsigned int attempt, unsigned int attempts,
+                      unsigned int delay, const Glib::ustring& error) const;
+
   private:
     static const int AskQuestionDlgWidth = 78; ///< Макс. ширина диалога
                                                ///< "Ask question".
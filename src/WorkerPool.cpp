@@ -0,0 +1,69 @@
+#include <exception>
+#include "Trace.h"
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(unsigned int threads):
+  m_quit(false),
+  m_completed(0),
+  m_pending(0)
+{
+  if (!threads) threads = 1;
+  for (unsigned int i = 0; i < threads; i++)
+    m_threads.push_back(
+      std::make_shared<std::thread>(std::bind(&WorkerPool::worker, this))
+    );
+}
+
+WorkerPool::~WorkerPool()
+{
+  while (!wait(std::chrono::milliseconds(500)));
+  m_quit = true;
+  m_jobs.notify_all();
+  for (auto& thread : m_threads) thread->join();
+}
+
+void WorkerPool::submit(const Job& job)
+{
+  {
+    std::lock_guard<std::mutex> lck(m_pendingMutex);
+    m_pending++;
+  }
+  m_jobs.put(job);
+  m_jobs.notify_one();
+}
+
+bool WorkerPool::wait(std::chrono::milliseconds const& timeout)
+{
+  std::unique_lock<std::mutex> lck(m_pendingMutex);
+  return m_done.wait_for(lck, timeout, [this] { return m_pending == 0; });
+}
+
+void WorkerPool::worker()
+{
+  while (!m_quit)
+  {
+    if (!m_jobs.wait_for(std::chrono::milliseconds(500)))
+    {
+      // задание могли забрать другие потоки пула
+      Job job(m_jobs.get());
+      if (!job) continue;
+      // выпущенное заданием исключение завершило бы far2l, а пул остался бы
+      // ждать незавершенное задание
+      try
+      {
+        job();
+      }
+      catch (const std::exception& ex)
+      {
+        TRACE_ERROR("WorkerPool::worker()", "std::exception: %s", ex.what());
+      }
+      catch (...)
+      {
+        TRACE_ERROR("WorkerPool::worker()", "unknown exception");
+      }
+      m_completed++;
+      std::lock_guard<std::mutex> lck(m_pendingMutex);
+      if (--m_pending == 0) m_done.notify_all();
+    }
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "JobUnitQueue.h"
+
+///
+/// @brief Пул рабочих потоков с ограниченным параллелизмом.
+
+/// Задания (функторы) помещаются в общую очередь и выполняются не более чем
+/// в заданном при создании пула числе потоков одновременно. Используется для
+/// массовых операций, каждая из которых сама по себе синхронна и проводит
+/// основное время в ожидании ответа внешней службы (например, безопасного
+/// хранилища паролей).
+///
+/// Вызывающий поток может периодически ожидать завершения всех заданий с
+/// таймаутом, например, чтобы обновлять индикатор хода операции.
+///
+/// @author cycleg
+///
+class WorkerPool
+{
+  public:
+    typedef std::function<void()> Job; ///< Задание для пула.
+
+    ///
+    /// Конструктор.
+    ///
+    /// @param [in] threads Число рабочих потоков, не меньше одного.
+    ///
+    WorkerPool(unsigned int threads);
+    ///
+    /// Деструктор.
+    ///
+    /// Дожидается завершения всех поставленных заданий и останавливает
+    /// рабочие потоки.
+    ///
+    ~WorkerPool();
+
+    ///
+    /// Поставить задание в очередь.
+    ///
+    /// @param [in] job Задание.
+    ///
+    void submit(const Job& job);
+    ///
+    /// Ожидать завершения всех поставленных заданий с таймаутом.
+    ///
+    /// @param [in] timeout Таймаут.
+    /// @return true, если все задания завершены.
+    ///
+    bool wait(std::chrono::milliseconds const& timeout);
+    ///
+    /// @return Число завершенных заданий с момента создания пула.
+    ///
+    inline unsigned int completed() const { return m_completed; }
+
+  private:
+    typedef JobUnitQueue<Job> JobQueue; ///< Очередь заданий.
+
+    ///
+    /// Цикл обработки заданий в рабочем потоке.
+    ///
+    /// Исключение, выпущенное заданием, записывается в трассировку;
+    /// задание считается завершенным.
+    ///
+    void worker();
+
+    JobQueue m_jobs; ///< Очередь заданий.
+    std::vector< std::shared_ptr<std::thread> > m_threads; ///< Рабочие потоки.
+    std::atomic_bool m_quit; ///< Флаг остановки рабочих потоков.
+    std::atomic_uint m_completed; ///< Число завершенных заданий.
+    unsigned int m_pending; ///< Число поставленных, но не завершенных заданий.
+    std::mutex m_pendingMutex; ///< Мутекс счетчика #m_pending.
+    std::condition_variable m_done; ///< Сигнал о завершении всех заданий.
+};
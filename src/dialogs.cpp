@@ -67,6 +67,8 @@ enum class EEditResourceDlg: int
   PasswordLabel,
   PasswordInput,
   AskPasswordInput,
+  KeepMountedInput,
+  AutoMountInput,
   OkButton,
   CancelButton
 };
@@ -94,7 +96,7 @@ LONG_PTR WINAPI EditResourceDlgProc(HANDLE hDlg, int msg, int param1, LONG_PTR p
 bool EditResourceDlg(PluginStartupInfo& info, MountPoint& mountPoint)
 {
     const int DIALOG_WIDTH = 68;
-    const int DIALOG_HEIGHT = 13;
+    const int DIALOG_HEIGHT = 15;
     std::vector<InitDialogItem> initItems = {
         { DI_DOUBLEBOX, 2, 1, DIALOG_WIDTH - 3, DIALOG_HEIGHT - 2, 0, 0, 0, 0,
           MResourceTitle, L"", 0 },
@@ -118,10 +120,14 @@ bool EditResourceDlg(PluginStartupInfo& info, MountPoint& mountPoint)
 
         { DI_CHECKBOX, 4, 8, 0, 8, 0, mountPoint.getAskPassword(), 0, 0,
           MAskPasswordEveryTime, L"", 0 },
+        { DI_CHECKBOX, 4, 9, 0, 9, 0, mountPoint.getKeepMounted(), 0, 0,
+          MKeepMounted, L"", 0 },
+        { DI_CHECKBOX, 4, 10, 0, 10, 0, mountPoint.getAutoMount(), 0, 0,
+          MAutoMount, L"", 0 },
 
-        { DI_BUTTON, 0, 10, 0, 10, 0, 0, DIF_CENTERGROUP, 1,
+        { DI_BUTTON, 0, 12, 0, 12, 0, 0, DIF_CENTERGROUP, 1,
           MOk, L"", 0 },
-        { DI_BUTTON, 0, 10, 0, 10, 0, 0, DIF_CENTERGROUP, 0,
+        { DI_BUTTON, 0, 12, 0, 12, 0, 0, DIF_CENTERGROUP, 0,
           MCancel, L"", 0 }
     };
     std::vector<FarDialogItem> dialogItems;
@@ -137,6 +143,8 @@ bool EditResourceDlg(PluginStartupInfo& info, MountPoint& mountPoint)
     std::wstring l_user = DLG_GET_TEXTPTR(info, hDlg, EEditResourceDlg::UserInput);
     std::wstring l_password = DLG_GET_TEXTPTR(info, hDlg, EEditResourceDlg::PasswordInput);
     bool l_askPassword = DLG_GET_CHECKBOX(info, hDlg, EEditResourceDlg::AskPasswordInput);
+    bool l_keepMounted = DLG_GET_CHECKBOX(info, hDlg, EEditResourceDlg::KeepMountedInput);
+    bool l_autoMount = DLG_GET_CHECKBOX(info, hDlg, EEditResourceDlg::AutoMountInput);
     info.DialogFree(hDlg);
     startupInfo = nullptr;
     // check user input
@@ -174,6 +182,8 @@ bool EditResourceDlg(PluginStartupInfo& info, MountPoint& mountPoint)
     mountPoint.setUrl(l_url);
     mountPoint.setUser(l_user);
     mountPoint.setAskPassword(l_askPassword);
+    mountPoint.setKeepMounted(l_keepMounted);
+    mountPoint.setAutoMount(l_autoMount);
     if (mountPoint.getAskPassword()) l_password.clear();
     mountPoint.setPassword(l_password);
     return true;
@@ -225,6 +235,7 @@ enum class EConfigurationEditDlg: int
 #ifdef USE_SECRET_STORAGE
   , UseSecretStorage
 #endif
+  , SpeculativeMount
   , OkButton
   , CancelButton
 };
@@ -244,7 +255,7 @@ bool ConfigurationEditDlg(PluginStartupInfo& info)
 {
 #ifdef USE_SECRET_STORAGE
     const int DIALOG_WIDTH = 60;
-    const int DIALOG_HEIGHT = 9;
+    const int DIALOG_HEIGHT = 10;
     std::vector<InitDialogItem> initItems = {
         { DI_DOUBLEBOX, 2, 1, DIALOG_WIDTH - 3, DIALOG_HEIGHT - 2, 0, 0, 0, 0,
           MConfigTitle, L"", 0 },
@@ -256,15 +267,17 @@ bool ConfigurationEditDlg(PluginStartupInfo& info)
           MConfigUnmountThisSessionOnly, L"", 0 },
         { DI_CHECKBOX, 4, 4, 0, 4, 0, Configuration::Instance()->useSecretStorage(),
           0, 0, MConfigUseSecretService, L"", 0 },
+        { DI_CHECKBOX, 4, 5, 0, 5, 0, Configuration::Instance()->speculativeMount(),
+          0, 0, MConfigSpeculativeMount, L"", 0 },
 
-        { DI_BUTTON, 0, 6, 0, 6, 0, 0, DIF_CENTERGROUP, 1,
+        { DI_BUTTON, 0, 7, 0, 7, 0, 0, DIF_CENTERGROUP, 1,
           MOk, L"", 0 },
-        { DI_BUTTON, 0, 6, 0, 6, 0, 0, DIF_CENTERGROUP, 0,
+        { DI_BUTTON, 0, 7, 0, 7, 0, 0, DIF_CENTERGROUP, 0,
           MCancel, L"", 0 }
     };
 #else
     const int DIALOG_WIDTH = 59;
-    const int DIALOG_HEIGHT = 8;
+    const int DIALOG_HEIGHT = 9;
     std::vector<InitDialogItem> initItems = {
         { DI_DOUBLEBOX, 2, 1, DIALOG_WIDTH - 3, DIALOG_HEIGHT - 2, 0, 0, 0, 0,
           MConfigTitle, L"", 0 },
@@ -273,10 +286,12 @@ bool ConfigurationEditDlg(PluginStartupInfo& info)
           0, 0, MConfigUnmountAtExit, L"", 0 },
         { DI_CHECKBOX, 4, 3, 0, 3, 0, Configuration::Instance()->unmountThisSessionOnly(),
           0, 0, MConfigUnmountThisSessionOnly, L"", 0 },
+        { DI_CHECKBOX, 4, 4, 0, 4, 0, Configuration::Instance()->speculativeMount(),
+          0, 0, MConfigSpeculativeMount, L"", 0 },
 
-        { DI_BUTTON, 0, 5, 0, 5, 0, 0, DIF_CENTERGROUP, 1,
+        { DI_BUTTON, 0, 6, 0, 6, 0, 0, DIF_CENTERGROUP, 1,
           MOk, L"", 0 },
-        { DI_BUTTON, 0, 5, 0, 5, 0, 0, DIF_CENTERGROUP, 0,
+        { DI_BUTTON, 0, 6, 0, 6, 0, 0, DIF_CENTERGROUP, 0,
           MCancel, L"", 0 }
     };
 #endif
@@ -294,6 +309,7 @@ bool ConfigurationEditDlg(PluginStartupInfo& info)
 #ifdef USE_SECRET_STORAGE
     bool l_useSecretStorage = DLG_GET_CHECKBOX(info, hDlg, EConfigurationEditDlg::UseSecretStorage);
 #endif
+    bool l_speculativeMount = DLG_GET_CHECKBOX(info, hDlg, EConfigurationEditDlg::SpeculativeMount);
     info.DialogFree(hDlg);
     startupInfo = nullptr;
     // check user input
@@ -306,6 +322,7 @@ bool ConfigurationEditDlg(PluginStartupInfo& info)
 #ifdef USE_SECRET_STORAGE
     Configuration::Instance()->setUseSecretStorage(l_useSecretStorage);
 #endif
+    Configuration::Instance()->setSpeculativeMount(l_speculativeMount);
     return true;
 }
 